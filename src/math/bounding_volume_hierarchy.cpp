@@ -0,0 +1,182 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/bounding_volume_hierarchy.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace math
+{
+  namespace
+  {
+    constexpr std::uint32_t const triangles_per_leaf = 4;
+  }
+
+  bounding_volume_hierarchy::bounding_volume_hierarchy (std::vector<vector_3d> triangles)
+  {
+    std::uint32_t const triangle_count (triangles.size() / 3);
+
+    if (!triangle_count)
+    {
+      return;
+    }
+
+    std::vector<vector_3d> centers;
+    centers.reserve (triangle_count);
+    for (std::uint32_t i (0); i < triangle_count; ++i)
+    {
+      centers.emplace_back
+        ((triangles[3 * i + 0] + triangles[3 * i + 1] + triangles[3 * i + 2]) * (1.0f / 3.0f));
+    }
+
+    std::vector<std::uint32_t> order (triangle_count);
+    std::iota (order.begin(), order.end(), 0);
+
+    _triangles = std::move (triangles);
+    _nodes.reserve (2 * (triangle_count / triangles_per_leaf + 1));
+
+    build (order, centers, 0, triangle_count);
+
+    std::vector<vector_3d> sorted;
+    sorted.reserve (_triangles.size());
+    for (std::uint32_t index : order)
+    {
+      sorted.emplace_back (_triangles[3 * index + 0]);
+      sorted.emplace_back (_triangles[3 * index + 1]);
+      sorted.emplace_back (_triangles[3 * index + 2]);
+    }
+    _triangles = std::move (sorted);
+  }
+
+  void bounding_volume_hierarchy::build ( std::vector<std::uint32_t>& order
+                                        , std::vector<vector_3d> const& centers
+                                        , std::uint32_t begin
+                                        , std::uint32_t end
+                                        )
+  {
+    std::uint32_t const index (_nodes.size());
+    _nodes.emplace_back();
+
+    vector_3d min (vector_3d::max());
+    vector_3d max (vector_3d::min());
+    vector_3d center_min (vector_3d::max());
+    vector_3d center_max (vector_3d::min());
+
+    for (std::uint32_t i (begin); i < end; ++i)
+    {
+      for (std::uint32_t v (0); v < 3; ++v)
+      {
+        min = math::min (min, _triangles[3 * order[i] + v]);
+        max = math::max (max, _triangles[3 * order[i] + v]);
+      }
+      center_min = math::min (center_min, centers[order[i]]);
+      center_max = math::max (center_max, centers[order[i]]);
+    }
+
+    _nodes[index].min = min;
+    _nodes[index].max = max;
+
+    vector_3d const extent (center_max - center_min);
+    int const axis ( extent.x >= extent.y && extent.x >= extent.z ? 0
+                   : extent.y >= extent.z ? 1
+                   : 2
+                   );
+
+    if (end - begin <= triangles_per_leaf || extent[axis] <= 0.0f)
+    {
+      _nodes[index].offset = begin;
+      _nodes[index].count = end - begin;
+      return;
+    }
+
+    std::uint32_t const middle (begin + (end - begin) / 2);
+    std::nth_element ( order.begin() + begin
+                     , order.begin() + middle
+                     , order.begin() + end
+                     , [&] (std::uint32_t lhs, std::uint32_t rhs)
+                       {
+                         return centers[lhs][axis] < centers[rhs][axis];
+                       }
+                     );
+
+    build (order, centers, begin, middle);
+    std::uint32_t const second (_nodes.size());
+    build (order, centers, middle, end);
+
+    _nodes[index].offset = second;
+    _nodes[index].count = 0;
+  }
+
+  boost::optional<float> bounding_volume_hierarchy::intersect_nearest
+    (ray const& ray, float max_distance) const
+  {
+    boost::optional<float> nearest;
+
+    if (_nodes.empty() || !ray.intersect_bounds_before (min(), max(), max_distance))
+    {
+      return nearest;
+    }
+
+    std::pair<std::uint32_t, float> stack[64];
+    std::size_t stack_size (0);
+    stack[stack_size++] = {0, 0.0f};
+
+    while (stack_size)
+    {
+      auto const entry (stack[--stack_size]);
+
+      if (entry.second >= max_distance)
+      {
+        continue;
+      }
+
+      node const& current (_nodes[entry.first]);
+
+      if (current.count)
+      {
+        for (std::uint32_t i (current.offset); i < current.offset + current.count; ++i)
+        {
+          if ( auto distance = ray.intersect_triangle ( _triangles[3 * i + 0]
+                                                      , _triangles[3 * i + 1]
+                                                      , _triangles[3 * i + 2]
+                                                      )
+             )
+          {
+            if (*distance < max_distance)
+            {
+              max_distance = *distance;
+              nearest = distance;
+            }
+          }
+        }
+        continue;
+      }
+
+      std::uint32_t near_child (entry.first + 1);
+      std::uint32_t far_child (current.offset);
+
+      auto near_hit (ray.intersect_bounds_before (_nodes[near_child].min, _nodes[near_child].max, max_distance));
+      auto far_hit (ray.intersect_bounds_before (_nodes[far_child].min, _nodes[far_child].max, max_distance));
+
+      if (near_hit && far_hit && *far_hit < *near_hit)
+      {
+        std::swap (near_child, far_child);
+        std::swap (near_hit, far_hit);
+      }
+
+      // push the farther child first so the nearer one is visited first and
+      // can shrink max_distance before the farther one is popped
+      if (far_hit)
+      {
+        stack[stack_size++] = {far_child, *far_hit};
+      }
+      if (near_hit)
+      {
+        stack[stack_size++] = {near_child, *near_hit};
+      }
+    }
+
+    return nearest;
+  }
+}
@@ -0,0 +1,60 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/ray.hpp>
+#include <math/vector_3d.hpp>
+
+#include <boost/optional/optional.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace math
+{
+  //! Static bounding volume hierarchy over a triangle soup. Built once for
+  //! geometry that does not change after loading (WMO groups, models without
+  //! animated geometry) and only answers nearest hit queries.
+  class bounding_volume_hierarchy
+  {
+  public:
+    bounding_volume_hierarchy() = default;
+    //! \note triangles are given as three consecutive vertices each
+    explicit bounding_volume_hierarchy (std::vector<vector_3d> triangles);
+
+    bool empty() const
+    {
+      return _nodes.empty();
+    }
+
+    vector_3d const& min() const { return _nodes.front().min; }
+    vector_3d const& max() const { return _nodes.front().max; }
+
+    boost::optional<float> intersect_nearest
+      ( ray const&
+      , float max_distance = std::numeric_limits<float>::max()
+      ) const;
+
+  private:
+    struct node
+    {
+      vector_3d min;
+      vector_3d max;
+      //! leaf: first triangle, inner: index of the second child (the first
+      //! child always directly follows its parent)
+      std::uint32_t offset;
+      //! zero for inner nodes
+      std::uint32_t count;
+    };
+
+    void build ( std::vector<std::uint32_t>& order
+               , std::vector<vector_3d> const& centers
+               , std::uint32_t begin
+               , std::uint32_t end
+               );
+
+    std::vector<vector_3d> _triangles;
+    std::vector<node> _nodes;
+  };
+}
@@ -0,0 +1,149 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <boost/functional/hash.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace math
+{
+  //! Set of tagged float tuples where two entries are considered equal when
+  //! their tags are equal and every component differs by less than epsilon.
+  //! Components are quantized into cells much larger than epsilon and only
+  //! the cell of an entry is hashed. A component closer than epsilon to the
+  //! border of its cell additionally probes the neighbouring cell, so lookups
+  //! are expected O(1) while matching a plain epsilon comparison exactly.
+  template<std::size_t N, typename Tag, typename TagHash = boost::hash<Tag>>
+  class quantized_set
+  {
+  public:
+    using tuple = std::array<float, N>;
+
+    quantized_set (float epsilon, float cell_size)
+      : _epsilon (epsilon)
+      , _cell_size (cell_size)
+    {}
+
+    void reserve (std::size_t count)
+    {
+      _entries.reserve (count);
+      _buckets.reserve (count);
+    }
+
+    std::size_t size() const
+    {
+      return _entries.size();
+    }
+
+    bool contains (Tag const& tag, tuple const& values) const
+    {
+      std::size_t const tag_hash (TagHash() (tag));
+
+      std::array<std::int64_t, N> cells;
+      std::array<int, N> neighbours;
+      for (std::size_t i (0); i < N; ++i)
+      {
+        cells[i] = cell (values[i]);
+
+        double const lower (values[i] - cells[i] * double (_cell_size));
+        neighbours[i] = lower < _epsilon ? -1
+                      : _cell_size - lower < _epsilon ? 1
+                      : 0;
+      }
+
+      // visit every combination of home and neighbouring cell, usually one
+      for (std::uint32_t mask (0); mask < (1u << N); ++mask)
+      {
+        std::array<std::int64_t, N> probe (cells);
+        bool skip (false);
+
+        for (std::size_t i (0); i < N && !skip; ++i)
+        {
+          if (mask & (1u << i))
+          {
+            skip = !neighbours[i];
+            probe[i] += neighbours[i];
+          }
+        }
+
+        if (skip)
+        {
+          continue;
+        }
+
+        auto const range (_buckets.equal_range (bucket (tag_hash, probe)));
+        for (auto it (range.first); it != range.second; ++it)
+        {
+          entry const& candidate (_entries[it->second]);
+          if (candidate.first == tag && equal (candidate.second, values))
+          {
+            return true;
+          }
+        }
+      }
+
+      return false;
+    }
+
+    //! \returns false if an equal entry already exists
+    bool insert (Tag tag, tuple const& values)
+    {
+      if (contains (tag, values))
+      {
+        return false;
+      }
+
+      std::array<std::int64_t, N> cells;
+      for (std::size_t i (0); i < N; ++i)
+      {
+        cells[i] = cell (values[i]);
+      }
+
+      _buckets.emplace (bucket (TagHash() (tag), cells), _entries.size());
+      _entries.emplace_back (std::move (tag), values);
+
+      return true;
+    }
+
+  private:
+    using entry = std::pair<Tag, tuple>;
+
+    std::int64_t cell (float value) const
+    {
+      return static_cast<std::int64_t> (std::floor (value / double (_cell_size)));
+    }
+
+    std::size_t bucket (std::size_t tag_hash, std::array<std::int64_t, N> const& cells) const
+    {
+      std::size_t seed (tag_hash);
+      for (std::int64_t cell : cells)
+      {
+        boost::hash_combine (seed, cell);
+      }
+      return seed;
+    }
+
+    bool equal (tuple const& lhs, tuple const& rhs) const
+    {
+      for (std::size_t i (0); i < N; ++i)
+      {
+        if (!(std::abs (lhs[i] - rhs[i]) < _epsilon))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    float _epsilon;
+    float _cell_size;
+    std::vector<entry> _entries;
+    std::unordered_multimap<std::size_t, std::size_t> _buckets;
+  };
+}
@@ -47,6 +47,37 @@ namespace math
     return boost::none;
   }
 
+  boost::optional<float> ray::intersect_bounds_before
+    (vector_3d const& min, vector_3d const& max, float max_distance) const
+  {
+    float tmin (0.0f);
+    float tmax (max_distance);
+
+    for (int axis (0); axis < 3; ++axis)
+    {
+      if (_direction[axis] != 0.0f)
+      {
+        float const inverse (1.0f / _direction[axis]);
+        float const t1 ((min[axis] - _origin[axis]) * inverse);
+        float const t2 ((max[axis] - _origin[axis]) * inverse);
+
+        tmin = std::max (tmin, std::min (t1, t2));
+        tmax = std::min (tmax, std::max (t1, t2));
+      }
+      else if (_origin[axis] < min[axis] || _origin[axis] > max[axis])
+      {
+        return boost::none;
+      }
+    }
+
+    if (tmax >= tmin)
+    {
+      return tmin;
+    }
+
+    return boost::none;
+  }
+
   boost::optional<float> ray::intersect_triangle
     (vector_3d const& v0, vector_3d const& v1, vector_3d const& v2) const
   {
@@ -27,6 +27,21 @@ namespace math
     boost::optional<float> intersect_triangle
       (vector_3d const& _v0, vector_3d const& _v1, vector_3d const& _v2) const;
 
+    //! \note unlike intersect_bounds(), boxes behind the origin or only
+    //! entered after max_distance are rejected and the returned distance
+    //! is clamped to zero when the origin is inside the box.
+    boost::optional<float> intersect_bounds_before
+      (vector_3d const& _min, vector_3d const& _max, float max_distance) const;
+
+    vector_3d const& origin() const
+    {
+      return _origin;
+    }
+    vector_3d const& direction() const
+    {
+      return _direction;
+    }
+
     vector_3d position (float distance) const
     {
       return _origin + _direction * distance;
@@ -1,7 +1,8 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
 #include <mysql/mysql.h>
-#include <noggit/world.h>
+
+#include <memory>
 
 #include <cppconn/driver.h>
 #include <cppconn/prepared_statement.h>
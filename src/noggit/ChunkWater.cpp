@@ -6,6 +6,10 @@
 #include <noggit/MapChunk.h>
 #include <noggit/Misc.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 ChunkWater::ChunkWater(float x, float z)
   : xbase(x)
   , zbase(z)
@@ -185,6 +189,37 @@ void ChunkWater::update_layers()
   }
 }
 
+bool ChunkWater::is_visible ( const float& cull_distance
+                            , const math::frustum& frustum
+                            , const math::vector_3d& camera
+                            ) const
+{
+  static const float chunk_radius = std::sqrt (CHUNKSIZE * CHUNKSIZE / 2.0f);
+
+  float min (std::numeric_limits<float>::max());
+  float max (std::numeric_limits<float>::lowest());
+  for (liquid_layer const& layer : _layers)
+  {
+    // empty layers have no valid bounds
+    if (!layer.empty())
+    {
+      min = std::min (min, layer.min());
+      max = std::max (max, layer.max());
+    }
+  }
+
+  if (min > max)
+  {
+    return false;
+  }
+
+  math::vector_3d const vmin (xbase, min, zbase);
+  math::vector_3d const vmax (xbase + CHUNKSIZE, max, zbase + CHUNKSIZE);
+
+  return frustum.intersects (vmin, vmax)
+      && (((camera - (vmin + vmax) * 0.5f).length() - chunk_radius) < cull_distance);
+}
+
 bool ChunkWater::hasData(size_t layer) const
 {
   return _layers.size() > layer;
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <math/frustum.hpp>
 #include <math/vector_3d.hpp>
 #include <noggit/MapHeaders.h>
 #include <noggit/liquid_layer.hpp>
@@ -28,6 +29,12 @@ public:
             , int layer
             );
 
+  //! same test as MapChunk::is_visible, on the bounds of all layers
+  bool is_visible ( const float& cull_distance
+                  , const math::frustum& frustum
+                  , const math::vector_3d& camera
+                  ) const;
+
   void autoGen(MapChunk* chunk, float factor);
   void CropWater(MapChunk* chunkTerrain);
 
@@ -40,13 +40,19 @@ std::string AreaDB::getAreaName(int pAreaID)
   if (!pAreaID)
     return "Unknown location";
 
+  auto const cached (gAreaDB.areaNames.find (pAreaID));
+  if (cached != gAreaDB.areaNames.end())
+  {
+    return cached->second;
+  }
+
   unsigned int regionID = 0;
   std::string areaName = "";
   try
   {
     AreaDB::Record rec = gAreaDB.getByID(pAreaID);
-    areaName = rec.getLocalizedString(AreaDB::Name);
-    regionID = rec.getUInt(AreaDB::Region);
+    areaName = rec.get<AreaDB::Name>();
+    regionID = rec.get<AreaDB::Region>();
   }
   catch (AreaDB::NotFound)
   {
@@ -57,7 +63,7 @@ std::string AreaDB::getAreaName(int pAreaID)
     try
     {
       AreaDB::Record rec = gAreaDB.getByID(regionID);
-      areaName = std::string(rec.getLocalizedString(AreaDB::Name)) + std::string(": ") + areaName;
+      areaName = std::string(rec.get<AreaDB::Name>()) + std::string(": ") + areaName;
     }
     catch (AreaDB::NotFound)
     {
@@ -65,7 +71,7 @@ std::string AreaDB::getAreaName(int pAreaID)
     }
   }
 
-  return areaName;
+  return gAreaDB.areaNames.emplace (pAreaID, areaName).first->second;
 }
 
 std::string MapDB::getMapName(int pMapID)
@@ -75,7 +81,7 @@ std::string MapDB::getMapName(int pMapID)
   try
   {
     MapDB::Record rec = gMapDB.getByID(pMapID);
-    mapName = std::string(rec.getLocalizedString(MapDB::Name));
+    mapName = std::string(rec.get<MapDB::Name>());
   }
   catch (MapDB::NotFound)
   {
@@ -89,8 +95,8 @@ const char * getGroundEffectDoodad(unsigned int effectID, int DoodadNum)
 {
   try
   {
-    unsigned int doodadId = gGroundEffectTextureDB.getByID(effectID).getUInt(GroundEffectTextureDB::Doodads + DoodadNum);
-    return gGroundEffectDoodadDB.getByID(doodadId).getString(GroundEffectDoodadDB::Filename);
+    unsigned int doodadId = gGroundEffectTextureDB.getByID(effectID).get<GroundEffectTextureDB::Doodads>(DoodadNum);
+    return gGroundEffectDoodadDB.getByID(doodadId).get<GroundEffectDoodadDB::Filename>();
   }
   catch (DBCFile::NotFound)
   {
@@ -105,7 +111,7 @@ int LiquidTypeDB::getLiquidType(int pID)
   try
   {
     LiquidTypeDB::Record rec = gLiquidTypeDB.getByID(pID);
-    type = rec.getUInt(LiquidTypeDB::Type);
+    type = rec.get<LiquidTypeDB::Type>();
   }
   catch (LiquidTypeDB::NotFound)
   {
@@ -120,7 +126,7 @@ std::string  LiquidTypeDB::getLiquidName(int pID)
   try
   {
     LiquidTypeDB::Record rec = gLiquidTypeDB.getByID(pID);
-    type = std::string(rec.getString(LiquidTypeDB::Name));
+    type = std::string(rec.get<LiquidTypeDB::Name>());
   }
   catch (MapDB::NotFound)
   {
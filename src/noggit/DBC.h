@@ -5,6 +5,7 @@
 #include <noggit/DBCFile.h>
 
 #include <string>
+#include <unordered_map>
 
 class AreaDB : public DBCFile
 {
@@ -14,13 +15,17 @@ public:
   { }
 
   /// Fields
-  static const size_t AreaID = 0;    // uint
-  static const size_t Continent = 1;  // uint
-  static const size_t Region = 2;    // uint [AreaID]
-  static const size_t Flags = 4;    // bit field
-  static const size_t Name = 11;    // localisation string
+  using AreaID = column<unsigned int, 0>;
+  using Continent = column<int, 1>;
+  using Region = column<unsigned int, 2>;    // [AreaID]
+  using Flags = column<unsigned int, 4>;    // bit field
+  using Name = column<localized_string, 11>;
 
+  //! "Region: Area", memoized since it is resolved every frame
   static std::string getAreaName(int pAreaID);
+
+private:
+  std::unordered_map<int, std::string> areaNames;
 };
 
 class MapDB : public DBCFile
@@ -31,13 +36,13 @@ public:
   { }
 
   /// Fields
-  static const size_t MapID = 0;        // uint
-  static const size_t InternalName = 1;    // string
-  static const size_t AreaType = 2;      // uint
-  static const size_t IsBattleground = 3;    // uint
-  static const size_t Name = 4;        // loc
+  using MapID = column<int, 0>;
+  using InternalName = column<char const*, 1>;
+  using AreaType = column<unsigned int, 2>;
+  using IsBattleground = column<unsigned int, 3>;
+  using Name = column<localized_string, 4>;
 
-  static const size_t LoadingScreen = 57;    // uint [LoadingScreen]
+  using LoadingScreen = column<unsigned int, 57>;    // [LoadingScreen]
   static std::string getMapName(int pMapID);
 };
 
@@ -49,9 +54,9 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Name = 1;      // string
-  static const size_t Path = 2;      // string
+  using ID = column<unsigned int, 0>;
+  using Name = column<char const*, 1>;
+  using Path = column<char const*, 2>;
 };
 
 class LightDB : public DBCFile
@@ -62,14 +67,14 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Map = 1;      // uint
-  static const size_t PositionX = 2;    // float
-  static const size_t PositionY = 3;    // float
-  static const size_t PositionZ = 4;    // float
-  static const size_t RadiusInner = 5;  // float
-  static const size_t RadiusOuter = 6;  // float
-  static const size_t DataIDs = 7;    // uint[8]
+  using ID = column<unsigned int, 0>;
+  using Map = column<unsigned int, 1>;
+  using PositionX = column<float, 2>;
+  using PositionY = column<float, 3>;
+  using PositionZ = column<float, 4>;
+  using RadiusInner = column<float, 5>;
+  using RadiusOuter = column<float, 6>;
+  using DataIDs = column<int, 7, 8>;
 };
 
 class LightParamsDB : public DBCFile{
@@ -79,8 +84,8 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t skybox = 2;      // uint ref to LightSkyBox
+  using ID = column<unsigned int, 0>;
+  using skybox = column<unsigned int, 2>;    // [LightSkyBox]
 };
 
 class LightSkyboxDB : public DBCFile
@@ -91,9 +96,9 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t filename = 1;    // string
-  static const size_t flags = 2;      // uint
+  using ID = column<unsigned int, 0>;
+  using filename = column<char const*, 1>;
+  using flags = column<unsigned int, 2>;
 };
 
 class LightIntBandDB : public DBCFile
@@ -104,10 +109,10 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Entries = 1;    // uint
-  static const size_t Times = 2;      // uint
-  static const size_t Values = 18;    // uint
+  using ID = column<unsigned int, 0>;
+  using Entries = column<int, 1>;
+  using Times = column<int, 2, 16>;
+  using Values = column<int, 18, 16>;
 };
 
 class LightFloatBandDB : public DBCFile
@@ -118,10 +123,10 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Entries = 1;    // uint
-  static const size_t Times = 2;      // uint
-  static const size_t Values = 18;    // float
+  using ID = column<unsigned int, 0>;
+  using Entries = column<int, 1>;
+  using Times = column<int, 2, 16>;
+  using Values = column<float, 18, 16>;
 };
 
 class GroundEffectTextureDB : public DBCFile
@@ -132,11 +137,11 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Doodads = 1;    // uint[4]
-  static const size_t Weights = 5;    // uint[4]
-  static const size_t Amount = 9;      // uint
-  static const size_t TerrainType = 10;  // uint
+  using ID = column<unsigned int, 0>;
+  using Doodads = column<unsigned int, 1, 4>;    // [GroundEffectDoodad]
+  using Weights = column<unsigned int, 5, 4>;
+  using Amount = column<unsigned int, 9>;
+  using TerrainType = column<unsigned int, 10>;
 };
 
 class GroundEffectDoodadDB : public DBCFile
@@ -147,9 +152,9 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t InternalID = 1;    // uint
-  static const size_t Filename = 2;    // string
+  using ID = column<unsigned int, 0>;
+  using InternalID = column<unsigned int, 1>;
+  using Filename = column<char const*, 2>;
 };
 
 class LiquidTypeDB : public DBCFile
@@ -160,11 +165,11 @@ public:
   { }
 
   /// Fields
-  static const size_t ID = 0;        // uint
-  static const size_t Name = 1;      // string
-  static const size_t Type = 3;      // uint
-  static const size_t ShaderType = 15;  // uint
-  static const size_t TextureFilenames = 16;    // string[8]
+  using ID = column<unsigned int, 0>;
+  using Name = column<char const*, 1>;
+  using Type = column<int, 3>;
+  using ShaderType = column<unsigned int, 14>;    // [LiquidMaterial]
+  using TextureFilenames = column<char const*, 15, 6>;
 
   static int getLiquidType(int pID);
   static std::string getLiquidName(int pID);
@@ -4,8 +4,11 @@
 #include <noggit/Log.h>
 #include <noggit/MPQ.h>
 
+#include <algorithm>
 #include <string>
 
+std::uint32_t const DBCFile::invalidRecord;
+
 DBCFile::DBCFile(const std::string& _filename)
   : filename(_filename)
 {}
@@ -42,4 +45,61 @@ void DBCFile::open()
   f.read (stringTable.data(), stringTable.size());
 
   f.close();
+
+  buildIndex();
+}
+
+void DBCFile::buildIndex()
+{
+  denseIndex.clear();
+  sparseIndex.clear();
+
+  if (data.empty())
+  {
+    return;
+  }
+
+  unsigned int lowest (UINT32_MAX);
+  unsigned int highest (0);
+  for (Iterator i = begin(); i != end(); ++i)
+  {
+    lowest = std::min (lowest, i->getUInt (0));
+    highest = std::max (highest, i->getUInt (0));
+  }
+
+  // most tables have few gaps, so a lookup table costs about as much as the
+  // records themselves. Duplicated ids resolve to the first record, like a
+  // linear search would.
+  if (std::uint64_t (highest - lowest) < 4 * std::uint64_t (recordCount) + 64)
+  {
+    firstID = lowest;
+    denseIndex.assign (highest - lowest + 1, invalidRecord);
+
+    for (std::uint32_t record (recordCount); record-- > 0;)
+    {
+      denseIndex[getRecord (record).getUInt (0) - firstID] = record;
+    }
+  }
+  else
+  {
+    sparseIndex.reserve (recordCount);
+
+    for (std::uint32_t record (0); record < recordCount; ++record)
+    {
+      sparseIndex.emplace (getRecord (record).getUInt (0), record);
+    }
+  }
+}
+
+size_t DBCFile::findRecord (unsigned int id) const
+{
+  if (!denseIndex.empty())
+  {
+    return id < firstID || id - firstID >= denseIndex.size()
+      ? invalidRecord
+      : denseIndex[id - firstID];
+  }
+
+  auto const it (sparseIndex.find (id));
+  return it == sparseIndex.end() ? invalidRecord : it->second;
 }
@@ -3,7 +3,10 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
@@ -22,10 +25,43 @@ public:
     { }
   };
 
+  //! Column type of localized strings, read from the first non-empty locale.
+  struct localized_string {};
+
+  //! Typed view of \a Count consecutive fields starting at \a Field.
+  template<typename T, size_t Field, size_t Count = 1>
+  struct column
+  {
+    static_assert ( std::is_same<T, unsigned int>::value || std::is_same<T, int>::value
+                 || std::is_same<T, float>::value || std::is_same<T, char const*>::value
+                 || std::is_same<T, localized_string>::value
+                  , "DBC columns are four byte integers, floats or strings"
+                  );
+    static_assert (Count > 0, "a column has at least one field");
+
+    using type = T;
+    using value_type = typename std::conditional < std::is_same<T, localized_string>::value
+                                                 , char const*
+                                                 , T
+                                                 >::type;
+
+    static constexpr size_t const field = Field;
+    static constexpr size_t const count = Count;
+  };
+
   class Iterator;
   class Record
   {
   public:
+    //! \returns the \a index th field of \a Column
+    template<typename Column>
+      typename Column::value_type get (size_t index = 0) const
+    {
+      assert (Column::field + Column::count <= file.fieldCount);
+      assert (index < Column::count);
+      return read (Column::field + index, static_cast<typename Column::type const*> (nullptr));
+    }
+
     const float& getFloat(size_t field) const
     {
       assert(field < file.fieldCount);
@@ -69,6 +105,13 @@ public:
     }
   private:
     Record(const DBCFile &pfile, unsigned char *poffset) : file(pfile), offset(poffset) {}
+
+    unsigned int read (size_t field, unsigned int const*) const { return getUInt (field); }
+    int read (size_t field, int const*) const { return getInt (field); }
+    float read (size_t field, float const*) const { return getFloat (field); }
+    char const* read (size_t field, char const* const*) const { return getString (field); }
+    char const* read (size_t field, localized_string const*) const { return getLocalizedString (field); }
+
     const DBCFile &file;
     unsigned char *offset;
 
@@ -121,8 +164,20 @@ public:
 
   inline size_t getRecordCount() const { return recordCount; }
   inline size_t getFieldCount() const { return fieldCount; }
+  //! Lookups by the first field use the index built by open(), any other
+  //! field is searched linearly.
   inline Record getByID(unsigned int id, size_t field = 0)
   {
+    if (field == 0)
+    {
+      size_t const record (findRecord (id));
+      if (record == invalidRecord)
+      {
+        throw NotFound();
+      }
+      return getRecord (record);
+    }
+
     for (Iterator i = begin(); i != end(); ++i)
     {
       if (i->getUInt(field) == id)
@@ -132,6 +187,11 @@ public:
   }
 
 private:
+  static std::uint32_t const invalidRecord = UINT32_MAX;
+
+  void buildIndex();
+  size_t findRecord (unsigned int id) const;
+
   std::string filename;
   size_t recordSize;
   size_t recordCount;
@@ -139,4 +199,9 @@ private:
   size_t stringSize;
   std::vector<unsigned char> data;
   std::vector<char> stringTable;
+
+  //! record index by id, dense when the ids are mostly contiguous
+  unsigned int firstID = 0;
+  std::vector<std::uint32_t> denseIndex;
+  std::unordered_map<unsigned int, std::uint32_t> sparseIndex;
 };
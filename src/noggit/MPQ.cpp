@@ -3,6 +3,7 @@
 #include <noggit/AsyncLoader.h> // AsyncLoader
 #include <noggit/Log.h>
 #include <noggit/MPQ.h>
+#include <noggit/Misc.h>
 #include <noggit/Project.h>
 
 #include <boost/algorithm/string.hpp>
@@ -15,6 +16,7 @@
 #include <cstring>
 #include <fstream>
 #include <list>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -27,12 +29,102 @@ namespace
   ArchivesMap _openArchives;
 
   boost::mutex gListfileLoadingMutex;
+  std::unique_ptr<noggit::path_index> gListfileIndex;
   boost::mutex gMPQFileMutex;
   std::string modmpqpath = "";//this will be the path to modders archive (with 'myworld' file inside)
 }
 
 std::unordered_set<std::string> gListfile;
 
+void MPQArchive::loadGameArchives (AsyncLoader* loader, std::string const& game_directory)
+{
+  boost::filesystem::path const game_path (game_directory);
+
+  std::vector<std::string> archiveNames;
+  archiveNames.push_back("common.MPQ");
+  archiveNames.push_back("common-2.MPQ");
+  archiveNames.push_back("expansion.MPQ");
+  archiveNames.push_back("lichking.MPQ");
+  archiveNames.push_back("patch.MPQ");
+  archiveNames.push_back("patch-{number}.MPQ");
+  archiveNames.push_back("patch-{character}.MPQ");
+
+  //archiveNames.push_back( "{locale}/backup-{locale}.MPQ" );
+  //archiveNames.push_back( "{locale}/base-{locale}.MPQ" );
+  archiveNames.push_back("{locale}/locale-{locale}.MPQ");
+  //archiveNames.push_back( "{locale}/speech-{locale}.MPQ" );
+  archiveNames.push_back("{locale}/expansion-locale-{locale}.MPQ");
+  //archiveNames.push_back( "{locale}/expansion-speech-{locale}.MPQ" );
+  archiveNames.push_back("{locale}/lichking-locale-{locale}.MPQ");
+  //archiveNames.push_back( "{locale}/lichking-speech-{locale}.MPQ" );
+  archiveNames.push_back("{locale}/patch-{locale}.MPQ");
+  archiveNames.push_back("{locale}/patch-{locale}-{number}.MPQ");
+  archiveNames.push_back("{locale}/patch-{locale}-{character}.MPQ");
+
+  archiveNames.push_back("development.MPQ");
+
+  const char * locales[] = { "enGB", "enUS", "deDE", "koKR", "frFR", "zhCN", "zhTW", "esES", "esMX", "ruRU" };
+  const char * locale("****");
+
+  // Find locale, take first one.
+  for (int i(0); i < 10; ++i)
+  {
+    if (boost::filesystem::exists (game_path / "Data" / locales[i] / "realmlist.wtf"))
+    {
+      locale = locales[i];
+      Log << "Locale: " << locale << std::endl;
+      break;
+    }
+  }
+  if (!strcmp(locale, "****"))
+  {
+    LogError << "Could not find locale directory. Be sure, that there is one containing the file \"realmlist.wtf\"." << std::endl;
+    //return -1;
+  }
+
+  //! \todo  This may be done faster. Maybe.
+  for (size_t i(0); i < archiveNames.size(); ++i)
+  {
+    std::string path((game_path / "Data" / archiveNames[i]).string());
+    std::string::size_type location(std::string::npos);
+
+    do
+    {
+      location = path.find("{locale}");
+      if (location != std::string::npos)
+      {
+        path.replace(location, 8, locale);
+      }
+    } while (location != std::string::npos);
+
+    if (path.find("{number}") != std::string::npos)
+    {
+      location = path.find("{number}");
+      path.replace(location, 8, " ");
+      for (char j = '2'; j <= '9'; j++)
+      {
+        path.replace(location, 1, std::string(&j, 1));
+        if (boost::filesystem::exists(path))
+          MPQArchive::loadMPQ (loader, path, true);
+      }
+    }
+    else if (path.find("{character}") != std::string::npos)
+    {
+      location = path.find("{character}");
+      path.replace(location, 11, " ");
+      for (char c = 'a'; c <= 'z'; c++)
+      {
+        path.replace(location, 1, std::string(&c, 1));
+        if (boost::filesystem::exists(path))
+          MPQArchive::loadMPQ (loader, path, true);
+      }
+    }
+    else
+      if (boost::filesystem::exists(path))
+        MPQArchive::loadMPQ (loader, path, true);
+  }
+}
+
 void MPQArchive::loadMPQ (AsyncLoader* loader, const std::string& filename, bool doListfile)
 {
   _openArchives.emplace_back (filename, std::make_unique<MPQArchive> (filename, doListfile));
@@ -102,6 +194,10 @@ void MPQArchive::finishLoading()
   if (MPQArchive::allFinishedLoading())
   {
     LogDebug << "Completed listfile loading: " << gListfile.size() << " files\n";
+
+    // built on the loader thread instead of when a picker first needs it
+    gListfileIndex = std::make_unique<noggit::path_index>
+      (std::vector<std::string> (gListfile.begin(), gListfile.end()));
   }
 }
 
@@ -337,6 +433,58 @@ bool MPQFile::existsInMPQ(const std::string &pFilename)
   return false;
 }
 
+boost::optional<std::uint64_t> MPQFile::content_stamp(const std::string& pFilename)
+{
+  boost::mutex::scoped_lock lock(gMPQFileMutex);
+
+  std::stringstream stamp;
+  boost::system::error_code error;
+
+  std::string const diskpath(getDiskPath(pFilename));
+  std::uintmax_t const disksize(boost::filesystem::file_size(diskpath, error));
+
+  if (!error)
+  {
+    stamp << "disk " << diskpath << " " << disksize << " " << boost::filesystem::last_write_time(diskpath, error);
+  }
+  else
+  {
+    std::string filename(getMPQPath(pFilename));
+    bool found(false);
+
+    for (ArchivesMap::reverse_iterator i = _openArchives.rbegin(); i != _openArchives.rend() && !found; ++i)
+    {
+      HANDLE fileHandle;
+
+      if (!i->second->openFile(filename, &fileHandle))
+        continue;
+
+      // the attributes holding crc and time are optional, so the position
+      // in the archive and the archive's own time are added
+      DWORD crc(0);
+      ULONGLONG filetime(0);
+      ULONGLONG offset(0);
+      SFileGetFileInfo(fileHandle, SFileInfoCRC32, &crc, sizeof(crc), nullptr);
+      SFileGetFileInfo(fileHandle, SFileInfoFileTime, &filetime, sizeof(filetime), nullptr);
+      SFileGetFileInfo(fileHandle, SFileInfoByteOffset, &offset, sizeof(offset), nullptr);
+
+      stamp << "mpq " << i->first << " " << boost::filesystem::last_write_time(i->first, error)
+            << " " << SFileGetFileSize(fileHandle, nullptr) << " " << crc << " " << filetime << " " << offset;
+
+      SFileCloseFile(fileHandle);
+      found = true;
+    }
+
+    if (!found)
+    {
+      return boost::none;
+    }
+  }
+
+  std::string const key(stamp.str());
+  return misc::fnv1a(key.data(), key.size());
+}
+
 void MPQFile::save(std::string const& filename)  //save to MPQ
 {
   //! \todo Get MPQ to save to via dialog or use development.MPQ.
@@ -489,5 +637,33 @@ namespace noggit
                      );
       return filename;
     }
+
+    std::string normalized_model_filename (std::string filename)
+    {
+      filename = normalized_filename (filename);
+
+      std::size_t found;
+      if ((found = filename.rfind (".mdx")) != std::string::npos)
+      {
+        filename.replace (found, 4, ".m2");
+      }
+      else if ((found = filename.rfind (".mdl")) != std::string::npos)
+      {
+        filename.replace (found, 4, ".m2");
+      }
+
+      return filename;
+    }
+
+    path_index& listfile_index()
+    {
+      boost::mutex::scoped_lock const lock (gListfileLoadingMutex);
+      if (!gListfileIndex)
+      {
+        gListfileIndex = std::make_unique<path_index>
+          (std::vector<std::string> (gListfile.begin(), gListfile.end()));
+      }
+      return *gListfileIndex;
+    }
   }
 }
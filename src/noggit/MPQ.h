@@ -3,9 +3,13 @@
 #pragma once
 
 #include <noggit/AsyncObject.h>
+#include <noggit/path_index.hpp>
 
 #include <StormLib.h>
 
+#include <boost/optional.hpp>
+
+#include <cstdint>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -35,6 +39,9 @@ public:
   static bool allFinishedLoading();
   static void allFinishLoading();
 
+  //! loads the archives of the client at \a game_path in the order they
+  //! override each other, including the first locale found
+  static void loadGameArchives (AsyncLoader*, std::string const& game_path);
   static void loadMPQ (AsyncLoader*, const std::string& filename, bool doListfile = false);
   static void unloadAllMPQs();
   static void unloadMPQ(const std::string& filename);
@@ -92,6 +99,10 @@ public:
   static bool exists(const std::string& pFilename);
   static bool existsOnDisk(const std::string& pFilename);
   static bool existsInMPQ(const std::string& pFilename);
+  //! identifies the content the constructor would read without reading
+  //! it: path, size and modification time on disk, or the archive, size,
+  //! CRC, time and position of the file in it. boost::none if not found.
+  static boost::optional<std::uint64_t> content_stamp(const std::string& pFilename);
 
   friend class MPQArchive;
 
@@ -106,5 +117,11 @@ namespace noggit
   namespace mpq
   {
     std::string normalized_filename (std::string filename);
+    //! also maps the .mdx and .mdl names of old placements to .m2
+    std::string normalized_model_filename (std::string filename);
+
+    //! the files in the listfiles of all loaded archives, built once the
+    //! last of them is read, so callers have to wait for that
+    path_index& listfile_index();
   }
 }
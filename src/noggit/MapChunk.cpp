@@ -2,6 +2,7 @@
 
 #include <math/frustum.hpp>
 #include <math/quaternion.hpp>
+#include <math/vector_2d.hpp>
 #include <math/vector_3d.hpp>
 #include <noggit/Brush.h>
 #include <noggit/TileWater.hpp>
@@ -14,10 +15,13 @@
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/TexturingGUI.h>
+#include <noggit/undo_stack.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/matrix.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <map>
 
@@ -113,23 +117,13 @@ MapChunk::MapChunk(MapTile *maintile, MPQFile *f, bool bigAlpha)
 
     assert(fourcc == 'MCVT');
 
-    math::vector_3d *ttv = mVertices;
-
-    // vertices
-    for (int j = 0; j < 17; ++j) {
-      for (int i = 0; i < ((j % 2) ? 8 : 9); ++i) {
-        float h, xpos, zpos;
-        f->read(&h, 4);
-        xpos = i * UNITSIZE;
-        zpos = j * 0.5f * UNITSIZE;
-        if (j % 2) {
-          xpos += UNITSIZE*0.5f;
-        }
-        math::vector_3d v = math::vector_3d(xbase + xpos, ybase + h, zbase + zpos);
-        *ttv++ = v;
-        vmin.y = std::min(vmin.y, v.y);
-        vmax.y = std::max(vmax.y, v.y);
-      }
+    f->read(mHeights, sizeof (mHeights));
+
+    for (float& h : mHeights)
+    {
+      h += ybase;
+      vmin.y = std::min(vmin.y, h);
+      vmax.y = std::max(vmax.y, h);
     }
 
     vmin.x = xbase;
@@ -149,13 +143,7 @@ MapChunk::MapChunk(MapTile *maintile, MPQFile *f, bool bigAlpha)
 
     assert(fourcc == 'MCNR');
 
-    char nor[3];
-    math::vector_3d *ttn = mNormals;
-    for (int i = 0; i< mapbufsize; ++i) 
-    {
-      f->read(nor, 3);
-      *ttn++ = math::vector_3d(nor[0] / 127.0f, nor[2] / 127.0f, nor[1] / 127.0f);
-    }
+    f->read(mNormals, sizeof (mNormals));
   }
   // - MCLY ----------------------------------------------
   {
@@ -225,20 +213,24 @@ MapChunk::MapChunk(MapTile *maintile, MPQFile *f, bool bigAlpha)
     for (int i = 0; i < mapbufsize; ++i)
     {
       f->read(t, 4);
-      mccv[i] = math::vector_3d((float)t[2] / 127.0f, (float)t[1] / 127.0f, (float)t[0] / 127.0f);
+      mccv[i][0] = t[2];
+      mccv[i][1] = t[1];
+      mccv[i][2] = t[0];
     }
   }
 
   // create vertex buffers
-  gl.bufferData<GL_ARRAY_BUFFER> (vertices, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER> (normals, sizeof(mNormals), mNormals, GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER> (mccvEntry, sizeof(mccv), mccv, GL_STATIC_DRAW);
+  upload_vertices();
+  upload_normals();
+  upload_mccv();
 
   initStrip();
 
   vcenter = (vmin + vmax) * 0.5f;
 
-  math::vector_3d *ttv = mMinimap;
+  // only needed once for the buffer
+  math::vector_3d minimap_coordinates[mapbufsize];
+  math::vector_3d *ttv = minimap_coordinates;
 
   // vertices
   for (int j = 0; j < 17; ++j) {
@@ -276,27 +268,170 @@ MapChunk::MapChunk(MapTile *maintile, MPQFile *f, bool bigAlpha)
     gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   }
 
-  float ShadowAmount;
-  for (int j = 0; j<mapbufsize; ++j)
+  gl.genBuffers(1, &minimap);
+  gl.genBuffers(1, &minishadows);
+
+  gl.bufferData<GL_ARRAY_BUFFER> (minimap, sizeof(minimap_coordinates), minimap_coordinates, GL_STATIC_DRAW);
+  upload_fake_shadows ( [] (math::vector_3d const& normal)
+                        {
+                          return 1.0f - (normal.x + normal.y + normal.z);
+                        }
+                      );
+}
+
+math::vector_3d MapChunk::vertex (int index) const
+{
+  int const row (index / 17);
+  int const column (index % 17);
+  bool const inner (column >= 9);
+
+  // the same arithmetic as when the positions were stored, to the bit
+  float xpos ((inner ? column - 9 : column) * UNITSIZE);
+  float const zpos ((row * 2 + inner) * 0.5f * UNITSIZE);
+  if (inner)
   {
-    ShadowAmount = 1.0f - (mNormals[j].x + mNormals[j].y + mNormals[j].z);
-    ShadowAmount = std::min(1.0f, std::max(0.0f, ShadowAmount)) * 0.5f;
+    xpos += UNITSIZE * 0.5f;
+  }
+
+  return {xbase + xpos, mHeights[index], zbase + zpos};
+}
+
+float MapChunk::height (int index) const
+{
+  return mHeights[index];
+}
+
+void MapChunk::set_height (int index, float height)
+{
+  mHeights[index] = height;
+}
 
-    mFakeShadows[j].w = ShadowAmount;
+math::vector_3d MapChunk::normal (int index) const
+{
+  return { mNormals[index][0] / 127.0f
+         , mNormals[index][2] / 127.0f
+         , mNormals[index][1] / 127.0f
+         };
+}
+
+void MapChunk::upload_vertices()
+{
+  math::vector_3d positions[mapbufsize];
+  for (int i (0); i < mapbufsize; ++i)
+  {
+    positions[i] = vertex (i);
   }
+  gl.bufferData<GL_ARRAY_BUFFER> (vertices, sizeof (positions), positions, GL_STATIC_DRAW);
+}
 
-  gl.genBuffers(1, &minimap);
-  gl.genBuffers(1, &minishadows);
+void MapChunk::upload_normals()
+{
+  math::vector_3d expanded[mapbufsize];
+  for (int i (0); i < mapbufsize; ++i)
+  {
+    expanded[i] = normal (i);
+  }
+  gl.bufferData<GL_ARRAY_BUFFER> (normals, sizeof (expanded), expanded, GL_STATIC_DRAW);
+}
 
-  gl.bufferData<GL_ARRAY_BUFFER> (minimap, sizeof(mMinimap), mMinimap, GL_STATIC_DRAW);
-  gl.bufferData<GL_ARRAY_BUFFER> (minishadows, sizeof(mFakeShadows), mFakeShadows, GL_STATIC_DRAW);
+void MapChunk::upload_mccv()
+{
+  math::vector_3d expanded[mapbufsize];
+  for (int i (0); i < mapbufsize; ++i)
+  {
+    expanded[i] = { mccv[i][0] / 127.0f
+                  , mccv[i][1] / 127.0f
+                  , mccv[i][2] / 127.0f
+                  };
+  }
+  gl.bufferData<GL_ARRAY_BUFFER> (mccvEntry, sizeof (expanded), expanded, GL_STATIC_DRAW);
 }
 
+void MapChunk::upload_fake_shadows (std::function<float (math::vector_3d const&)> shadow)
+{
+  math::vector_4d fake_shadows[mapbufsize];
+  for (int j = 0; j < mapbufsize; ++j)
+  {
+    fake_shadows[j].w = std::min (1.0f, std::max (0.0f, shadow (normal (j)))) * 0.5f;
+  }
+  gl.bufferData<GL_ARRAY_BUFFER> (minishadows, sizeof (fake_shadows), fake_shadows, GL_STATIC_DRAW);
+}
+
+
+namespace
+{
+  struct texture_quad_vertex
+  {
+    math::vector_3d position;
+    math::vector_2d detail;
+    math::vector_2d alpha;
+  };
+}
 
-void MapChunk::drawTextures (int animtime)
+void MapChunk::upload_texture_quads (GLuint buffer)
 {
+  // base layer and blended layers wind differently, keep both as they were
+  static std::array<math::vector_2d, 4> const base {{{0.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}}};
+  static std::array<math::vector_2d, 4> const layers {{{1.0f, 0.0f}, {0.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}}};
+
+  std::vector<texture_quad_vertex> vertices;
+  vertices.reserve (16 * 16 * 8);
+
+  for (int y (0); y < 16; ++y)
+  {
+    for (int x (0); x < 16; ++x)
+    {
+      for (auto const* strip : {&base, &layers})
+      {
+        for (math::vector_2d const& corner : *strip)
+        {
+          vertices.push_back ({ {x + corner.x, y + corner.y, -2.0f}
+                              , corner * texDetail
+                              , corner * TEX_RANGE
+                              }
+                             );
+        }
+      }
+    }
+  }
+
+  gl.bufferData<GL_ARRAY_BUFFER> ( buffer
+                                 , vertices.size() * sizeof (texture_quad_vertex)
+                                 , vertices.data()
+                                 , GL_STATIC_DRAW
+                                 );
+}
+
+void MapChunk::bind_texture_quads (GLuint buffer)
+{
+  gl.clientActiveTexture (GL_TEXTURE1);
+  gl.enableClientState (GL_TEXTURE_COORD_ARRAY);
+  gl.texCoordPointer (buffer, 2, GL_FLOAT, sizeof (texture_quad_vertex), reinterpret_cast<void*> (offsetof (texture_quad_vertex, alpha)));
+
+  gl.clientActiveTexture (GL_TEXTURE0);
+  gl.enableClientState (GL_TEXTURE_COORD_ARRAY);
+  gl.texCoordPointer (buffer, 2, GL_FLOAT, sizeof (texture_quad_vertex), reinterpret_cast<void*> (offsetof (texture_quad_vertex, detail)));
+}
+
+void MapChunk::unbind_texture_quads()
+{
+  gl.clientActiveTexture (GL_TEXTURE1);
+  gl.disableClientState (GL_TEXTURE_COORD_ARRAY);
+
+  gl.clientActiveTexture (GL_TEXTURE0);
+  gl.disableClientState (GL_TEXTURE_COORD_ARRAY);
+}
+
+void MapChunk::drawTextures (int animtime, GLuint texture_quads)
+{
+  GLint const first (8 * (py * 16 + px));
+
   gl.color4f(1.0f, 1.0f, 1.0f, 1.0f);
 
+  // the shadow pass below switches to its own vertices and colors
+  gl.disableClientState (GL_COLOR_ARRAY);
+  gl.vertexPointer (texture_quads, 3, GL_FLOAT, sizeof (texture_quad_vertex), 0);
+
   if (_texture_set.num() > 0U)
   {
     _texture_set.bindTexture(0, 0);
@@ -316,16 +451,7 @@ void MapChunk::drawTextures (int animtime)
   }
 
   _texture_set.startAnim(0, animtime);
-  gl.begin(GL_TRIANGLE_STRIP);
-  gl.texCoord2f(0.0f, texDetail);
-  gl.vertex3f(static_cast<float>(px), py + 1.0f, -2.0f);
-  gl.texCoord2f(0.0f, 0.0f);
-  gl.vertex3f(static_cast<float>(px), static_cast<float>(py), -2.0f);
-  gl.texCoord2f(texDetail, texDetail);
-  gl.vertex3f(px + 1.0f, py + 1.0f, -2.0f);
-  gl.texCoord2f(texDetail, 0.0f);
-  gl.vertex3f(px + 1.0f, static_cast<float>(py), -2.0f);
-  gl.end();
+  gl.drawArrays (GL_TRIANGLE_STRIP, first, 4);
   _texture_set.stopAnim(0);
 
   if (_texture_set.num() > 1U)
@@ -346,21 +472,7 @@ void MapChunk::drawTextures (int animtime)
 
     _texture_set.startAnim(i, animtime);
 
-    gl.begin(GL_TRIANGLE_STRIP);
-    gl.multiTexCoord2f(GL_TEXTURE0, texDetail, 0.0f);
-    gl.multiTexCoord2f(GL_TEXTURE1, TEX_RANGE, 0.0f);
-    gl.vertex3f(px + 1.0f, static_cast<float>(py), -2.0f);
-    gl.multiTexCoord2f(GL_TEXTURE0, 0.0f, 0.0f);
-    gl.multiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
-    gl.vertex3f(static_cast<float>(px), static_cast<float>(py), -2.0f);
-    gl.multiTexCoord2f(GL_TEXTURE0, texDetail, texDetail);
-    gl.multiTexCoord2f(GL_TEXTURE1, TEX_RANGE, TEX_RANGE);
-    gl.vertex3f(px + 1.0f, py + 1.0f, -2.0f);
-    gl.multiTexCoord2f(GL_TEXTURE0, 0.0f, texDetail);
-    gl.multiTexCoord2f(GL_TEXTURE1, 0.0f, TEX_RANGE);
-    gl.vertex3f(static_cast<float>(px), py + 1.0f, -2.0f);
-    gl.end();
-
+    gl.drawArrays (GL_TRIANGLE_STRIP, first + 4, 4);
     _texture_set.stopAnim(i);
   }
 
@@ -370,6 +482,7 @@ void MapChunk::drawTextures (int animtime)
   opengl::texture::set_active_texture (1);
   opengl::texture::disable_texture();
 
+  gl.enableClientState (GL_COLOR_ARRAY);
   gl.vertexPointer (minimap, 3, GL_FLOAT, 0, 0);
   gl.colorPointer (minishadows, 4, GL_FLOAT, 0, 0);
 
@@ -435,6 +548,10 @@ void MapChunk::initStrip()
   opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const _ (indices);
   gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, strip_with_holes.size() * sizeof (StripType), strip_with_holes.data(), GL_STATIC_DRAW);
 
+  _lod_level = 0;
+  _lod_edge_steps = {{1, 1, 1, 1}};
+  _lod_index_count = strip_with_holes.size();
+
   for (int i = 0; i < 32; ++i)
   {
     if (i < 9)
@@ -482,40 +599,30 @@ bool MapChunk::GetVertex(float x, float z, math::vector_3d *V)
   if ((row < 0) || (column < 0) || (row > 16) || (column >((row % 2) ? 8 : 9)))
     return false;
 
-  *V = mVertices[17 * (row / 2) + ((row % 2) ? 9 : 0) + column];
+  *V = vertex (17 * (row / 2) + ((row % 2) ? 9 : 0) + column);
   return true;
 }
 
 float MapChunk::getHeight(int x, int z)
 {
   if (x > 9 || z > 9 || x < 0 || z < 0) return 0.0f;
-  return mVertices[indexNoLoD(x, z)].y;
+  return mHeights[indexNoLoD(x, z)];
 }
 
 float MapChunk::getMinHeight()
 {
-  float min (mVertices[0].y);
-
-  for (auto&& vertex : mVertices)
-  {
-    min = std::min (min, vertex.y);
-  }
-
-  return min;
+  return *std::min_element (std::begin (mHeights), std::end (mHeights));
 }
 
 void MapChunk::clearHeight()
 {
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    mVertices[i].y = 0.0f;
-  }
+  std::fill (std::begin (mHeights), std::end (mHeights), 0.0f);
 
   vmin.y = 0.0f;
   vmax.y = 0.0f;
+  mt->_chunk_tree_changed = true;
 
-  gl.bufferData<GL_ARRAY_BUFFER>
-    (vertices, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
+  upload_vertices();
 
 }
 
@@ -530,16 +637,139 @@ bool MapChunk::is_visible ( const float& cull_distance
       && (((camera - vcenter).length() - chunk_radius) < cull_distance);
 }
 
+namespace
+{
+  // xz distances from the camera to the chunk center
+  float const lod_distances[MapChunk::lod_levels - 1] = {192.0f, 384.0f, 768.0f};
+
+  int snap_to_step (int position, int step)
+  {
+    return (position + (step - 1) / 2) / step * step;
+  }
+}
+
+int MapChunk::lod_level (float cull_distance, math::vector_3d const& camera) const
+{
+  static const float chunk_radius = std::sqrt (CHUNKSIZE * CHUNKSIZE / 2.0f);
+
+  int const last_level (holes & 0xFFFF ? lod_levels - 2 : lod_levels - 1);
+
+  if ((camera - vcenter).length() - chunk_radius >= cull_distance)
+  {
+    return last_level;
+  }
+
+  float const dx (camera.x - (xbase + CHUNKSIZE * 0.5f));
+  float const dz (camera.z - (zbase + CHUNKSIZE * 0.5f));
+  float const distance (std::sqrt (dx * dx + dz * dz));
+
+  int level (0);
+  while (level < last_level && distance >= lod_distances[level])
+  {
+    ++level;
+  }
+  return level;
+}
+
+int MapChunk::lod_edge_step (int level)
+{
+  static int const steps[lod_levels] = {1, 1, 2, 8};
+  return steps[level];
+}
+
+std::vector<StripType> MapChunk::lod_indices (int level, std::array<int, 4> const& edge_steps)
+{
+  std::vector<StripType> result;
+
+  // outer vertex in row r (z) and column c (x), moved along the edges to
+  // the nearest vertex a coarser neighbour has as well
+  auto const outer
+    ( [&] (int r, int c)
+      {
+        if (r == 0) c = snap_to_step (c, edge_steps[0]);
+        else if (r == 8) c = snap_to_step (c, edge_steps[1]);
+        if (c == 0) r = snap_to_step (r, edge_steps[2]);
+        else if (c == 8) r = snap_to_step (r, edge_steps[3]);
+        return StripType (indexNoLoD (r, c));
+      }
+    );
+  auto const triangle
+    ( [&] (StripType a, StripType b, StripType c)
+      {
+        // collapsed edges leave degenerate triangles behind
+        if (a != b && b != c && a != c)
+        {
+          result.insert (result.end(), {a, b, c});
+        }
+      }
+    );
+
+  if (level == 0)
+  {
+    for (int x = 0; x < 8; ++x)
+    {
+      for (int y = 0; y < 8; ++y)
+      {
+        if (isHole (x / 2, y / 2))
+          continue;
+
+        StripType const center (indexLoD (y, x));
+        triangle (center, outer (y, x), outer (y + 1, x));
+        triangle (center, outer (y + 1, x), outer (y + 1, x + 1));
+        triangle (center, outer (y + 1, x + 1), outer (y, x + 1));
+        triangle (center, outer (y, x + 1), outer (y, x));
+      }
+    }
+  }
+  else if (level < lod_levels - 1)
+  {
+    int const step (lod_edge_step (level));
+
+    for (int x = 0; x < 8; x += step)
+    {
+      for (int y = 0; y < 8; y += step)
+      {
+        if (isHole (x / 2, y / 2))
+          continue;
+
+        triangle (outer (y, x), outer (y + step, x), outer (y + step, x + step));
+        triangle (outer (y, x), outer (y + step, x + step), outer (y, x + step));
+      }
+    }
+  }
+  else
+  {
+    StripType const center (indexNoLoD (4, 4));
+    triangle (center, outer (0, 0), outer (8, 0));
+    triangle (center, outer (8, 0), outer (8, 8));
+    triangle (center, outer (8, 8), outer (0, 8));
+    triangle (center, outer (0, 8), outer (0, 0));
+  }
+
+  return result;
+}
+
+void MapChunk::set_lod (int level, std::array<int, 4> const& edge_steps)
+{
+  if (level == _lod_level && edge_steps == _lod_edge_steps)
+  {
+    return;
+  }
+
+  std::vector<StripType> const lod (lod_indices (level, edge_steps));
+
+  opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const _ (indices);
+  gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, lod.size() * sizeof (StripType), lod.data(), GL_STATIC_DRAW);
+
+  _lod_level = level;
+  _lod_edge_steps = edge_steps;
+  _lod_index_count = lod.size();
+}
+
 void MapChunk::drawLines ( opengl::scoped::use_program& line_shader
-                         , math::frustum const& frustum
-                         , const float& cull_distance
-                         , const math::vector_3d& camera
                          , bool draw_hole_lines
                          )
 {
-  if (!is_visible (cull_distance, frustum, camera))
-    return;
-
   opengl::scoped::bool_setter<GL_LINE_SMOOTH, GL_TRUE> const line_smooth;
   gl.hint (GL_LINE_SMOOTH_HINT, GL_NICEST);
   gl.lineWidth (1.5);
@@ -599,13 +829,10 @@ void MapChunk::drawContour()
   gl.texGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
   gl.texGenfv(GL_S, GL_OBJECT_PLANE, CoordGen);
 
-  gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+  gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
 }
 
-void MapChunk::draw ( math::frustum const& frustum
-                    , const float& cull_distance
-                    , const math::vector_3d& camera
-                    , bool show_unpaintable_chunks
+void MapChunk::draw ( bool show_unpaintable_chunks
                     , bool draw_contour
                     , bool draw_paintability_overlay
                     , bool draw_chunk_flag_overlay
@@ -618,9 +845,6 @@ void MapChunk::draw ( math::frustum const& frustum
                     , int animtime
                     )
 {
-  if (!is_visible (cull_distance, frustum, camera))
-    return;
-
   bool cantPaint = noggit::ui::selected_texture::get()
                  && !canPaintTexture(*noggit::ui::selected_texture::get())
                  && show_unpaintable_chunks
@@ -669,7 +893,7 @@ void MapChunk::draw ( math::frustum const& frustum
 
   gl.enable(GL_LIGHTING);
   _texture_set.startAnim (0, animtime);
-  gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+  gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
   _texture_set.stopAnim (0);
 
   if (_texture_set.num() > 1U) {
@@ -685,7 +909,7 @@ void MapChunk::draw ( math::frustum const& frustum
     _texture_set.bindAlphamap(i - 1, 1);
 
     _texture_set.startAnim (i, animtime);
-    gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+    gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
     _texture_set.stopAnim (i);
   }
 
@@ -715,7 +939,7 @@ void MapChunk::draw ( math::frustum const& frustum
   opengl::texture::enable_texture (1);
   shadow.bind();
 
-  gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+  gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
 
   opengl::texture::disable_texture();
   gl.disable(GL_LIGHTING);
@@ -731,7 +955,7 @@ void MapChunk::draw ( math::frustum const& frustum
     if (Flags & FLAG_IMPASS)
     {
       gl.color4f(1, 1, 1, 0.6f);
-      gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+      gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
     }
   }
 
@@ -739,7 +963,7 @@ void MapChunk::draw ( math::frustum const& frustum
   {
     // draw chunks in color depending on AreaID and list color from environment
     gl.color4fv (area_id_colors[areaID]);
-    gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+    gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
   }
 
   if (cursor_type == 3 && selection)
@@ -754,9 +978,9 @@ void MapChunk::draw ( math::frustum const& frustum
       opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> const depth_test;
 
       gl.begin(GL_TRIANGLES);
-      gl.vertex3fv(mVertices[strip_without_holes[chunk->triangle + 0]]);
-      gl.vertex3fv(mVertices[strip_without_holes[chunk->triangle + 1]]);
-      gl.vertex3fv(mVertices[strip_without_holes[chunk->triangle + 2]]);
+      gl.vertex3fv(vertex (strip_without_holes[chunk->triangle + 0]));
+      gl.vertex3fv(vertex (strip_without_holes[chunk->triangle + 1]));
+      gl.vertex3fv(vertex (strip_without_holes[chunk->triangle + 2]));
       gl.end();
     }
   }
@@ -772,7 +996,7 @@ void MapChunk::draw ( math::frustum const& frustum
       gl.lineWidth(1);
       gl.polygonOffset(-1, -1);
       gl.color4f(1, 1, 1, 0.2f);
-      gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+      gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
     }
     {
       opengl::scoped::bool_setter<GL_POLYGON_OFFSET_POINT, GL_TRUE> const polygon_offset_point;
@@ -780,7 +1004,7 @@ void MapChunk::draw ( math::frustum const& frustum
       gl.pointSize(2);
       gl.polygonOffset(-1, -1);
       gl.color4f(1, 1, 1, 0.5f);
-      gl.drawElements (GL_TRIANGLES, strip_with_holes.size(), GL_UNSIGNED_SHORT, nullptr);
+      gl.drawElements (GL_TRIANGLES, _lod_index_count, GL_UNSIGNED_SHORT, nullptr);
     }
 
     gl.polygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -790,23 +1014,110 @@ void MapChunk::draw ( math::frustum const& frustum
   gl.color4f(1.0f, 1.0f, 1.0f, 1.0f);
 }
 
-void MapChunk::intersect (math::ray const& ray, selection_result* results)
+void MapChunk::intersect ( math::ray const& ray
+                         , selection_result* results
+                         , float& nearest
+                         )
 {
-  if (!ray.intersect_bounds (vmin, vmax))
+  auto const entry (ray.intersect_bounds_before (vmin, vmax, nearest));
+
+  if (!entry)
   {
     return;
   }
 
-  for (int i (0); i < strip_without_holes.size(); i += 3)
+  // walk the 8x8 unit cells the ray passes through in order of distance.
+  // the triangles of a cell don't reach outside of it, so the first cell
+  // with a hit contains the nearest one.
+  math::vector_3d const& origin (ray.origin());
+  math::vector_3d const& direction (ray.direction());
+  math::vector_3d const start (ray.position (*entry));
+
+  int x (std::min (7, std::max (0, static_cast<int> ((start.x - xbase) / UNITSIZE))));
+  int z (std::min (7, std::max (0, static_cast<int> ((start.z - zbase) / UNITSIZE))));
+
+  int const step_x (direction.x > 0.0f ? 1 : -1);
+  int const step_z (direction.z > 0.0f ? 1 : -1);
+
+  float const infinity (std::numeric_limits<float>::infinity());
+  float const delta_x (direction.x != 0.0f ? UNITSIZE / std::abs (direction.x) : infinity);
+  float const delta_z (direction.z != 0.0f ? UNITSIZE / std::abs (direction.z) : infinity);
+  float next_x ( direction.x != 0.0f
+               ? (xbase + (x + (step_x > 0)) * UNITSIZE - origin.x) / direction.x
+               : infinity
+               );
+  float next_z ( direction.z != 0.0f
+               ? (zbase + (z + (step_z > 0)) * UNITSIZE - origin.z) / direction.z
+               : infinity
+               );
+
+  float cell_entry (*entry);
+
+  while (x >= 0 && x < 8 && z >= 0 && z < 8 && cell_entry < nearest)
   {
-    if ( auto distance = ray.intersect_triangle ( mVertices[strip_without_holes[i + 0]]
-                                                , mVertices[strip_without_holes[i + 1]]
-                                                , mVertices[strip_without_holes[i + 2]]
-                                                )
-       )
+    float const cell_exit (std::min (std::min (next_x, next_z), nearest));
+
+    int const corners[] = { indexLoD (z, x)
+                          , indexNoLoD (z, x), indexNoLoD (z, x + 1)
+                          , indexNoLoD (z + 1, x), indexNoLoD (z + 1, x + 1)
+                          };
+
+    float cell_min (mHeights[corners[0]]);
+    float cell_max (cell_min);
+    for (int corner : corners)
     {
-      results->emplace_back
-        (*distance, selected_chunk_type (this, i, ray.position (*distance)));
+      cell_min = std::min (cell_min, mHeights[corner]);
+      cell_max = std::max (cell_max, mHeights[corner]);
+    }
+
+    float const y_entry (origin.y + direction.y * cell_entry);
+    float const y_exit (origin.y + direction.y * cell_exit);
+
+    if (std::max (y_entry, y_exit) >= cell_min && std::min (y_entry, y_exit) <= cell_max)
+    {
+      boost::optional<int> hit;
+      int const first ((x * 8 + z) * 12);
+
+      for (int i (first); i < first + 12; i += 3)
+      {
+        if ( auto distance = ray.intersect_triangle ( vertex (strip_without_holes[i + 0])
+                                                    , vertex (strip_without_holes[i + 1])
+                                                    , vertex (strip_without_holes[i + 2])
+                                                    )
+           )
+        {
+          if (*distance < nearest)
+          {
+            nearest = *distance;
+            hit = i;
+          }
+        }
+      }
+
+      if (hit)
+      {
+        results->emplace_back
+          (nearest, selected_chunk_type (this, *hit, ray.position (nearest)));
+        return;
+      }
+    }
+
+    if (next_x == infinity && next_z == infinity)
+    {
+      return;
+    }
+
+    cell_entry = std::min (next_x, next_z);
+
+    if (next_x < next_z)
+    {
+      x += step_x;
+      next_x += delta_x;
+    }
+    else
+    {
+      z += step_z;
+      next_z += delta_z;
     }
   }
 }
@@ -818,18 +1129,19 @@ void MapChunk::updateVerticesData()
 
   for (int i(0); i < mapbufsize; ++i)
   {
-    vmin.y = std::min(vmin.y, mVertices[i].y);
-    vmax.y = std::max(vmax.y, mVertices[i].y);
+    vmin.y = std::min(vmin.y, mHeights[i]);
+    vmax.y = std::max(vmax.y, mHeights[i]);
   }
+  mt->_chunk_tree_changed = true;
 
-  gl.bufferData<GL_ARRAY_BUFFER>(vertices, sizeof(mVertices), mVertices, GL_STATIC_DRAW);
+  upload_vertices();
 }
 
 void MapChunk::recalcNorms (std::function<boost::optional<float> (float, float)> height)
 {
   auto point
   (
-    [&] (math::vector_3d& v, float xdiff, float zdiff)
+    [&] (math::vector_3d const& v, float xdiff, float zdiff)
     {
       return math::vector_3d
              ( v.x + xdiff
@@ -843,15 +1155,17 @@ void MapChunk::recalcNorms (std::function<boost::optional<float> (float, float)>
 
   for (int i = 0; i<mapbufsize; ++i)
   {
-    math::vector_3d const P1 (point(mVertices[i], -half_unit, -half_unit));
-    math::vector_3d const P2 (point(mVertices[i],  half_unit, -half_unit));
-    math::vector_3d const P3 (point(mVertices[i],  half_unit,  half_unit));
-    math::vector_3d const P4 (point(mVertices[i], -half_unit,  half_unit));
+    math::vector_3d const v (vertex (i));
 
-    math::vector_3d const N1 ((P2 - mVertices[i]) % (P1 - mVertices[i]));
-    math::vector_3d const N2 ((P3 - mVertices[i]) % (P2 - mVertices[i]));
-    math::vector_3d const N3 ((P4 - mVertices[i]) % (P3 - mVertices[i]));
-    math::vector_3d const N4 ((P1 - mVertices[i]) % (P4 - mVertices[i]));
+    math::vector_3d const P1 (point(v, -half_unit, -half_unit));
+    math::vector_3d const P2 (point(v,  half_unit, -half_unit));
+    math::vector_3d const P3 (point(v,  half_unit,  half_unit));
+    math::vector_3d const P4 (point(v, -half_unit,  half_unit));
+
+    math::vector_3d const N1 ((P2 - v) % (P1 - v));
+    math::vector_3d const N2 ((P3 - v) % (P2 - v));
+    math::vector_3d const N3 ((P4 - v) % (P3 - v));
+    math::vector_3d const N4 ((P1 - v) % (P4 - v));
 
     math::vector_3d Norm (N1 + N2 + N3 + N4);
     Norm.normalize();
@@ -861,20 +1175,20 @@ void MapChunk::recalcNorms (std::function<boost::optional<float> (float, float)>
     Norm.z = std::floor(Norm.z * 127) / 127;
 
     //! \todo: find out why recalculating normals without changing the terrain result in slightly different normals
-    mNormals[i] = {-Norm.z, Norm.y, -Norm.x};
-  }
-  gl.bufferData<GL_ARRAY_BUFFER> (normals, sizeof(mNormals), mNormals, GL_STATIC_DRAW);
-
-  float ShadowAmount;
-  for (int j = 0; j<mapbufsize; ++j)
-  {
-    ShadowAmount = 1.0f - (-mNormals[j].x + mNormals[j].y - mNormals[j].z);
-    ShadowAmount = std::min(1.0f, std::max(0.0f, ShadowAmount)) * 0.5f;
-
-    mFakeShadows[j].w = ShadowAmount;
-  }
-
-  gl.bufferData<GL_ARRAY_BUFFER> (minishadows, sizeof(mFakeShadows), mFakeShadows, GL_STATIC_DRAW);
+    // quantized as they were saved, in MCNR order, see also
+    // map_maintenance's write_normals
+    math::vector_3d const normal (-Norm.z, Norm.y, -Norm.x);
+    mNormals[i][0] = static_cast<std::int8_t> (normal.x * 127);
+    mNormals[i][1] = static_cast<std::int8_t> (normal.z * 127);
+    mNormals[i][2] = static_cast<std::int8_t> (normal.y * 127);
+  }
+  upload_normals();
+
+  upload_fake_shadows ( [] (math::vector_3d const& normal)
+                        {
+                          return 1.0f - (-normal.x + normal.y - normal.z);
+                        }
+                      );
 }
 
 bool MapChunk::changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius)
@@ -884,14 +1198,15 @@ bool MapChunk::changeTerrain(math::vector_3d const& pos, float change, float rad
 
   for (int i = 0; i < mapbufsize; ++i)
   {
-    xdiff = mVertices[i].x - pos.x;
-    zdiff = mVertices[i].z - pos.z;
+    math::vector_3d const v (vertex (i));
+    xdiff = v.x - pos.x;
+    zdiff = v.z - pos.z;
     if (BrushType == eTerrainType_Quadra)
     {
       if ((std::abs(xdiff) < std::abs(radius / 2)) && (std::abs(zdiff) < std::abs(radius / 2)))
       {
         dist = std::sqrt(xdiff*xdiff + zdiff*zdiff);
-        mVertices[i].y += change * (1.0f - dist * inner_radius / radius);
+        mHeights[i] += change * (1.0f - dist * inner_radius / radius);
         changed = true;
       }
     }
@@ -905,22 +1220,22 @@ bool MapChunk::changeTerrain(math::vector_3d const& pos, float change, float rad
         switch (BrushType)
         {
           case eTerrainType_Flat:
-            mVertices[i].y += change;
+            mHeights[i] += change;
             break;
           case eTerrainType_Linear:
-            mVertices[i].y += change * (1.0f - dist * (1.0f - inner_radius) / radius);
+            mHeights[i] += change * (1.0f - dist * (1.0f - inner_radius) / radius);
             break;
           case eTerrainType_Smooth:
-            mVertices[i].y += change / (1.0f + dist / radius);
+            mHeights[i] += change / (1.0f + dist / radius);
             break;
           case eTerrainType_Polynom:
-            mVertices[i].y += change*((dist / radius)*(dist / radius) + dist / radius + 1.0f);
+            mHeights[i] += change*((dist / radius)*(dist / radius) + dist / radius + 1.0f);
             break;
           case eTerrainType_Trigo:
-            mVertices[i].y += change*cos(dist / radius);
+            mHeights[i] += change*cos(dist / radius);
             break;
           case eTerrainType_Gaussian:
-            mVertices[i].y += dist < radius * inner_radius ? change * std::exp(-(std::pow(radius * inner_radius / radius, 2) / (2 * std::pow(0.39f, 2)))) : change * std::exp(-(std::pow(dist / radius, 2) / (2 * std::pow(0.39f, 2))));
+            mHeights[i] += dist < radius * inner_radius ? change * std::exp(-(std::pow(radius * inner_radius / radius, 2) / (2 * std::pow(0.39f, 2)))) : change * std::exp(-(std::pow(dist / radius, 2) / (2 * std::pow(0.39f, 2))));
 
             break;
           default:
@@ -947,9 +1262,9 @@ bool MapChunk::ChangeMCCV(math::vector_3d const& pos, math::vector_4d const& col
   {
     for (int i = 0; i < mapbufsize; ++i)
     {
-      mccv[i].x = 1.0f; // set default shaders
-      mccv[i].y = 1.0f;
-      mccv[i].z = 1.0f;
+      mccv[i][0] = 127; // set default shaders
+      mccv[i][1] = 127;
+      mccv[i][2] = 127;
     }
 
     changed = true;
@@ -959,33 +1274,32 @@ bool MapChunk::ChangeMCCV(math::vector_3d const& pos, math::vector_4d const& col
 
   for (int i = 0; i < mapbufsize; ++i)
   {
-    dist = misc::dist(mVertices[i], pos);
+    dist = misc::dist(vertex (i), pos);
     if (dist <= radius)
     {
       float edit = change * (1.0f - dist / radius);
-      if (editMode)
-      {
-        mccv[i].x += (color.x - mccv[i].x)* edit;
-        mccv[i].y += (color.y - mccv[i].y)* edit;
-        mccv[i].z += (color.z - mccv[i].z)* edit;
-      }
-      else
+      math::vector_3d const target (editMode ? math::vector_3d (color.x, color.y, color.z) : math::vector_3d (1.0f, 1.0f, 1.0f));
+
+      for (int c = 0; c < 3; ++c)
       {
-        mccv[i].x += (1.0f - mccv[i].x) * edit;
-        mccv[i].y += (1.0f - mccv[i].y) * edit;
-        mccv[i].z += (1.0f - mccv[i].z) * edit;
+        // colors are stored as in MCCV. Rounding up with the probability of
+        // the fraction keeps the average of small edits, so light strokes
+        // and the falloff of the brush still show up.
+        float const current (mccv[i][c]);
+        float const wanted (std::min (std::max (target[c] * 127.0f, 0.0f), 254.0f));
+        float const step ((wanted - current) * edit);
+        float const result (std::abs (step) >= std::abs (wanted - current) ? wanted : current + step);
+        float const lower (std::floor (result));
+        float const rounded (lower + (misc::frand() < result - lower ? 1.0f : 0.0f));
+        mccv[i][c] = static_cast<std::uint8_t> (std::min (std::max (rounded, 0.0f), 254.0f));
       }
 
-      mccv[i].x = std::min(std::max(mccv[i].x, 0.0f), 2.0f);
-      mccv[i].y = std::min(std::max(mccv[i].y, 0.0f), 2.0f);
-      mccv[i].z = std::min(std::max(mccv[i].z, 0.0f), 2.0f);
-
       changed = true;
     }
   }
   if (changed)
   {
-    gl.bufferData<GL_ARRAY_BUFFER> (mccvEntry, sizeof(mccv), mccv, GL_STATIC_DRAW);
+    upload_mccv();
   }
   return changed;
 }
@@ -1004,7 +1318,8 @@ bool MapChunk::flattenTerrain ( math::vector_3d const& pos
 
   for (int i(0); i < mapbufsize; ++i)
   {
-	  float const dist(misc::dist(mVertices[i], pos));
+	  math::vector_3d const v (vertex (i));
+	  float const dist(misc::dist(v, pos));
 
 	  if (dist >= radius)
 	  {
@@ -1012,13 +1327,13 @@ bool MapChunk::flattenTerrain ( math::vector_3d const& pos
 	  }
 
 	  float const ah(origin.y
-		  + ((mVertices[i].x - origin.x) * math::cos(orientation)
-			  + (mVertices[i].z - origin.z) * math::sin(orientation)
+		  + ((v.x - origin.x) * math::cos(orientation)
+			  + (v.z - origin.z) * math::sin(orientation)
 			  ) * math::tan(angle)
 	  );
 
-	  if ((flattenType == eFlattenMode_Raise && ah < mVertices[i].y)
-		  || (flattenType == eFlattenMode_Lower && ah > mVertices[i].y)
+	  if ((flattenType == eFlattenMode_Raise && ah < mHeights[i])
+		  || (flattenType == eFlattenMode_Lower && ah > mHeights[i])
 		  )
 	  {
 		  continue;
@@ -1026,17 +1341,17 @@ bool MapChunk::flattenTerrain ( math::vector_3d const& pos
 
 	  if (BrushType == eFlattenType_Origin)
 	  {
-		  mVertices[i].y = origin.y;
+		  mHeights[i] = origin.y;
 		  changed = true;
 		  continue;
 	  }
 
-    mVertices[i].y = math::interpolation::linear
+    mHeights[i] = math::interpolation::linear
       ( BrushType == eFlattenType_Flat ? remain
       : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
       : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
       : throw std::logic_error ("bad brush type")
-      , mVertices[i].y
+      , mHeights[i]
       , ah
       );
 
@@ -1062,7 +1377,8 @@ bool MapChunk::blurTerrain ( math::vector_3d const& pos
 
   for (int i (0); i < mapbufsize; ++i)
   {
-    float const dist(misc::dist(mVertices[i], pos));
+    math::vector_3d const v (vertex (i));
+    float const dist(misc::dist(v, pos));
 
     if (dist >= radius)
     {
@@ -1078,7 +1394,7 @@ bool MapChunk::blurTerrain ( math::vector_3d const& pos
       for (int k = -Rad; k <= Rad; ++k)
       {
         float tx = pos.x + k*UNITSIZE + (j % 2) * UNITSIZE / 2.0f;
-        float dist2 = misc::dist (tx, tz, mVertices[i].x, mVertices[i].z);
+        float dist2 = misc::dist (tx, tz, v.x, v.z);
         if (dist2 > radius)
           continue;
         auto h (height (tx, tz));
@@ -1095,12 +1411,12 @@ bool MapChunk::blurTerrain ( math::vector_3d const& pos
 		continue;
 	}
 
-    mVertices[i].y = math::interpolation::linear
+    mHeights[i] = math::interpolation::linear
       ( BrushType == eFlattenType_Flat ? remain
       : BrushType == eFlattenType_Linear ? remain * (1.f - dist / radius)
       : BrushType == eFlattenType_Smooth ? pow (remain, 1.f + dist / radius)
       : throw std::logic_error ("bad brush type")
-      , mVertices[i].y
+      , mHeights[i]
       , TotalHeight / TotalWeight
       );
 
@@ -1228,7 +1544,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   //! \todo Is this still 8 if no chunk is present? Or did they correct that?
   lMCNK_header->sizeLiquid = 8;
 
-  lMCNK_header->ypos = mVertices[0].y;
+  lMCNK_header->ypos = mHeights[0];
 
   memset(lMCNK_header->low_quality_texture_map, 0, 0x10);
 
@@ -1294,7 +1610,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   float* lHeightmap = lADTFile.GetPointer<float>(lCurrentPosition + 8);
 
   for (int i = 0; i < mapbufsize; ++i)
-    lHeightmap[i] = mVertices[i].y - mVertices[0].y;
+    lHeightmap[i] = mHeights[i] - mHeights[0];
 
   lCurrentPosition += 8 + lMCVT_Size;
   lMCNK_Size += 8 + lMCVT_Size;
@@ -1312,9 +1628,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
 
     for (int i = 0; i < mapbufsize; ++i)
     {
-      *lmccv++ = ((unsigned char)(mccv[i].z * 127.0f) & 0xFF)
-        + (((unsigned char)(mccv[i].y * 127.0f) & 0xFF) << 8)
-        + (((unsigned char)(mccv[i].x * 127.0f) & 0xFF) << 16);
+      *lmccv++ = mccv[i][2] + (mccv[i][1] << 8) + (mccv[i][0] << 16);
     }
 
     lCurrentPosition += 8 + lMCCV_Size;
@@ -1333,14 +1647,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
 
   lADTFile.GetPointer<MapChunkHeader>(lMCNK_Position + 8)->ofsNormal = lCurrentPosition - lMCNK_Position;
 
-  char * lNormals = lADTFile.GetPointer<char>(lCurrentPosition + 8);
-
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    lNormals[i * 3 + 0] = static_cast<char>(mNormals[i].x * 127);
-    lNormals[i * 3 + 1] = static_cast<char>(mNormals[i].z * 127);
-    lNormals[i * 3 + 2] = static_cast<char>(mNormals[i].y * 127);
-  }
+  memcpy(lADTFile.GetPointer<char>(lCurrentPosition + 8), mNormals, lMCNR_Size);
 
   lCurrentPosition += 8 + lMCNR_Size;
   lMCNK_Size += 8 + lMCNR_Size;
@@ -1399,6 +1706,7 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
       }
       else
       {
+        lLayer->flags &= ~FLAG_ALPHA_COMPRESSED;
         lMCAL_Size += 2048;
       }
     }
@@ -1518,13 +1826,8 @@ void MapChunk::save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCI
   {
     for (size_t j = 0; j < lMaps; j++)
     {
-      unsigned char upperNibble, lowerNibble;
-      for (int k = 0; k < 2048; k++)
-      {
-        lowerNibble = (_texture_set.getAlpha(j, k * 2 + 0) & 0xF0);
-        upperNibble = (_texture_set.getAlpha(j, k * 2 + 1) & 0xF0);
-        lAlphaMaps[2048 * j + k] = (upperNibble)+(lowerNibble >> 4);
-      }
+      std::vector<char> const alpha (noggit::encode_old_alphamap (_texture_set.getAlpha(j)));
+      memcpy(lAlphaMaps + 2048 * j, alpha.data(), alpha.size());
     }
   }
 
@@ -1559,10 +1862,10 @@ bool MapChunk::fixGapLeft(const MapChunk* chunk)
 
   for (size_t i = 0; i <= 136; i+= 17)
   {
-    float h = chunk->mVertices[i + 8].y;
-    if (mVertices[i].y != h)
+    float h = chunk->mHeights[i + 8];
+    if (mHeights[i] != h)
     {
-      mVertices[i].y = h;
+      mHeights[i] = h;
       changed = true;
     }
   }
@@ -1584,10 +1887,10 @@ bool MapChunk::fixGapAbove(const MapChunk* chunk)
 
   for (size_t i = 0; i < 9; i++)
   {
-    float h = chunk->mVertices[i + 136].y;
-    if (mVertices[i].y != h)
+    float h = chunk->mHeights[i + 136];
+    if (mHeights[i] != h)
     {
-      mVertices[i].y = h;
+      mHeights[i] = h;
       changed = true;
     }
   }
@@ -1601,24 +1904,153 @@ bool MapChunk::fixGapAbove(const MapChunk* chunk)
 }
 
 
-void MapChunk::selectVertex(math::vector_3d const& pos, float radius, std::set<math::vector_3d*>& vertices)
+std::vector<std::uint8_t> MapChunk::edit_state()
+{
+  std::vector<std::uint8_t> state;
+  noggit::undo::write (state, mHeights);
+  noggit::undo::write (state, mNormals);
+  noggit::undo::write (state, mccv);
+  noggit::undo::write (state, hasMCCV);
+  noggit::undo::write (state, holes);
+  noggit::undo::write (state, areaID);
+  noggit::undo::write (state, Flags);
+  _texture_set.write_edit_state (state);
+  return state;
+}
+
+void MapChunk::restore_edit_state (std::vector<std::uint8_t> const& state)
+{
+  noggit::undo::reader in (state);
+  in.read (mHeights);
+  in.read (mNormals);
+  in.read (mccv);
+  in.read (hasMCCV);
+  in.read (holes);
+  in.read (areaID);
+  in.read (Flags);
+  _texture_set.read_edit_state (in);
+
+  updateVerticesData();
+  upload_normals();
+  upload_fake_shadows ( [] (math::vector_3d const& normal)
+                        {
+                          return 1.0f - (-normal.x + normal.y - normal.z);
+                        }
+                      );
+  upload_mccv();
+  initStrip();
+}
+
+vertex_selection MapChunk::vertices_in_range (math::vector_3d const& pos, float radius, bool ignore_height) const
 {
+  vertex_selection in_range;
+
   if (misc::getShortestDist(pos.x, pos.z, xbase, zbase, CHUNKSIZE) > radius)
   {
-    return;
+    return in_range;
+  }
+
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    math::vector_3d const v (vertex (i));
+    if ( ignore_height ? misc::dist(pos.x, pos.z, v.x, v.z) <= radius
+                       : misc::dist(v, pos) <= radius
+       )
+    {
+      in_range.set (i);
+    }
+  }
+
+  return in_range;
+}
+
+math::vector_3d_base<double> MapChunk::sum_of_vertices (vertex_selection const& selected) const
+{
+  math::vector_3d_base<double> sum;
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    if (selected[i])
+    {
+      math::vector_3d const v (vertex (i));
+      sum += {v.x, v.y, v.z};
+    }
+  }
+  return sum;
+}
+
+namespace
+{
+  //! the selection as 0 and 1, so the bulk edits below are branch free
+  //! loops over contiguous floats which get vectorized
+  void selection_weights (vertex_selection const& selected, float (&weights)[mapbufsize])
+  {
+    for (int i = 0; i < mapbufsize; ++i)
+    {
+      weights[i] = selected[i] ? 1.0f : 0.0f;
+    }
   }
 
+  double sum_of (float const (&values)[mapbufsize])
+  {
+    double sum (0.0);
+    for (float value : values)
+    {
+      sum += value;
+    }
+    return sum;
+  }
+}
+
+double MapChunk::move_vertices (vertex_selection const& selected, float change)
+{
+  float weights[mapbufsize];
+  selection_weights (selected, weights);
+
   for (int i = 0; i < mapbufsize; ++i)
   {
-    if (misc::dist(pos.x, pos.z, mVertices[i].x, mVertices[i].z) <= radius)
+    mHeights[i] += change * weights[i];
+  }
+
+  return double (change) * selected.count();
+}
+
+double MapChunk::set_heights (vertex_selection const& selected, float height)
+{
+  float weights[mapbufsize];
+  selection_weights (selected, weights);
+
+  float delta[mapbufsize];
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    delta[i] = (height - mHeights[i]) * weights[i];
+    mHeights[i] = weights[i] != 0.0f ? height : mHeights[i];
+  }
+
+  return sum_of (delta);
+}
+
+double MapChunk::orient_vertices ( vertex_selection const& selected
+                                 , math::vector_3d const& ref_pos
+                                 , math::degrees vertex_angle
+                                 , math::degrees vertex_orientation
+                                 )
+{
+  double delta (0.0);
+  for (int i = 0; i < mapbufsize; ++i)
+  {
+    if (selected[i])
     {
-      vertices.emplace(&mVertices[i]);
+      float const height (misc::angledHeight(ref_pos, vertex (i), vertex_angle, vertex_orientation));
+      delta += height - mHeights[i];
+      mHeights[i] = height;
     }
   }
+  return delta;
 }
 
-void MapChunk::fixVertices(std::set<math::vector_3d*>& selected)
+double MapChunk::fixVertices (vertex_selection const& selected)
 {
+  double delta (0.0);
   std::vector<int> ids ={ 0, 1, 17, 18 };
   // iterate through each "square" of vertices
   for (int i = 0; i < 64; ++i)
@@ -1628,7 +2060,7 @@ void MapChunk::fixVertices(std::set<math::vector_3d*>& selected)
 
     for (int& index : ids)
     {
-      if (selected.find(&mVertices[index]) == selected.end())
+      if (!selected[index])
       {
         not_selected = index;
       }
@@ -1636,33 +2068,27 @@ void MapChunk::fixVertices(std::set<math::vector_3d*>& selected)
       {
         count++;
       }
-      h += mVertices[index].y;
+      h += mHeights[index];
       index += (((i+1) % 8) == 0) ? 10 : 1;
     }
 
+    float const previous (mHeights[mid_vertex]);
+
     if (count == 2)
     {
-      mVertices[mid_vertex].y = h * 0.25f;
+      mHeights[mid_vertex] = h * 0.25f;
     }
     else if (count == 3)
     {
-      mVertices[mid_vertex].y = (h - mVertices[not_selected].y) / 3.0f;
+      mHeights[mid_vertex] = (h - mHeights[not_selected]) / 3.0f;
     }
-  }
-}
 
-bool MapChunk::isBorderChunk(std::set<math::vector_3d*>& selected)
-{
-  for (int i = 0; i < mapbufsize; ++i)
-  {
-    // border chunk if at least a vertex isn't selected
-    if (selected.find(&mVertices[i]) == selected.end())
+    if (selected[mid_vertex])
     {
-      return true;
+      delta += mHeights[mid_vertex] - previous;
     }
   }
-
-  return false;
+  return delta;
 }
 
 ChunkWater* MapChunk::liquid_chunk() const
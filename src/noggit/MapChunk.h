@@ -13,7 +13,12 @@
 #include <opengl/texture.hpp>
 #include <noggit/Misc.h>
 
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <vector>
 
 class MPQFile;
 namespace math
@@ -29,6 +34,9 @@ class sExtendableArray;
 using StripType = uint16_t;
 static const int mapbufsize = 9 * 9 + 8 * 8; // chunk size
 
+//! the vertices of a chunk selected by the vertex tool, by index
+using vertex_selection = std::bitset<mapbufsize>;
+
 class MapChunk
 {
 private:
@@ -46,16 +54,37 @@ private:
   StripType LineStrip[32];
   StripType HoleStrip[128];
 
-  math::vector_3d mNormals[mapbufsize];
-  math::vector_3d mMinimap[mapbufsize];
-  math::vector_4d mFakeShadows[mapbufsize];
-  math::vector_3d mccv[mapbufsize];
+  // per vertex data is kept in the compact form of the file, the GL
+  // buffers get expanded copies. positions follow from the heights as x
+  // and z are given by xbase, zbase and the index.
+
+  //! absolute heights, in MCVT order
+  float mHeights[mapbufsize];
+  //! as in MCNR: x, z, y scaled to 127
+  std::int8_t mNormals[mapbufsize][3];
+  //! as in MCCV without alpha: red, green, blue with 127 being 1.0
+  std::uint8_t mccv[mapbufsize][3];
+
+  math::vector_3d normal (int index) const;
+
+  void upload_vertices();
+  void upload_normals();
+  void upload_mccv();
+  void upload_fake_shadows (std::function<float (math::vector_3d const&)> shadow);
 
   void initStrip();
 
   int indexNoLoD(int x, int y);
   int indexLoD(int x, int y);
 
+  //! what the index buffer holds: the detail level and the step between
+  //! the outer vertices kept on each edge, ordered z-, z+, x-, x+
+  int _lod_level;
+  std::array<int, 4> _lod_edge_steps;
+  std::size_t _lod_index_count;
+
+  std::vector<StripType> lod_indices (int level, std::array<int, 4> const& edge_steps);
+
 public:
   MapChunk(MapTile* mt, MPQFile* f, bool bigAlpha);
 
@@ -80,17 +109,29 @@ public:
 
   GLuint minimap, minishadows;
 
-  math::vector_3d mVertices[mapbufsize];
+  math::vector_3d vertex (int index) const;
+  float height (int index) const;
+  void set_height (int index, float height);
 
   bool is_visible ( const float& cull_distance
                   , const math::frustum& frustum
                   , const math::vector_3d& camera
                   ) const;
 
-  void draw ( math::frustum const& frustum
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool show_unpaintable_chunks
+  //! 0 is the full mesh, 1 the 9x9 outer grid, 2 every other outer vertex
+  //! and 3 the corners around the middle vertex, like map_horizon draws it
+  static int const lod_levels = 4;
+  //! distance based, chunks past the cull distance get the last level as
+  //! the horizon takes over there. chunks with holes stop at level 2.
+  int lod_level (float cull_distance, math::vector_3d const& camera) const;
+  //! distance between the outer vertices along the edges of a level
+  static int lod_edge_step (int level);
+  //! edges are collapsed to the given steps so a coarser neighbour
+  //! doesn't leave cracks. the index buffer is only rebuilt on changes.
+  void set_lod (int level, std::array<int, 4> const& edge_steps);
+
+  //! culling is up to the caller, see World::update_visible_terrain
+  void draw ( bool show_unpaintable_chunks
             , bool draw_contour
             , bool draw_paintability_overlay
             , bool draw_chunk_flag_overlay
@@ -105,14 +146,19 @@ public:
   //! \todo only this function should be public, all others should be called from it
 
   void drawContour();
-  void intersect (math::ray const&, selection_result*);
+  //! only reports the hit if it is closer than \a nearest, which is updated
+  void intersect (math::ray const&, selection_result*, float& nearest);
   void drawLines ( opengl::scoped::use_program&
-                 , math::frustum const& frustum
-                 , const float& cull_distance
-                 , const math::vector_3d& camera
                  , bool draw_hole_lines
                  );
-  void drawTextures (int animtime);
+  //! 2D texture preview, drawn from the quads uploaded below with
+  //! texture coordinates bound by bind_texture_quads
+  void drawTextures (int animtime, GLuint texture_quads);
+  //! two triangle strips per chunk of a tile, one for the base layer and
+  //! one for the blended layers, each spanning one unit
+  static void upload_texture_quads (GLuint buffer);
+  static void bind_texture_quads (GLuint buffer);
+  static void unbind_texture_quads();
   bool ChangeMCCV(math::vector_3d const& pos, math::vector_4d const& color, float change, float radius, bool editMode);
 
   ChunkWater* liquid_chunk() const;
@@ -120,19 +166,28 @@ public:
   void updateVerticesData();
   void recalcNorms (std::function<boost::optional<float> (float, float)> height);
 
-  //! \todo implement Action stack for these
   bool changeTerrain(math::vector_3d const& pos, float change, float radius, int BrushType, float inner_radius);
   bool flattenTerrain(math::vector_3d const& pos, float remain, float radius, int BrushType, int flattenType, const math::vector_3d& origin, math::degrees angle, math::degrees orientation);
   bool blurTerrain ( math::vector_3d const& pos, float remain, float radius, int BrushType
                    , std::function<boost::optional<float> (float, float)> height
                    );
 
-  void selectVertex(math::vector_3d const& pos, float radius, std::set<math::vector_3d*>& vertices);
-  void fixVertices(std::set<math::vector_3d*>& selected);
-  // for the vertex tool
-  bool isBorderChunk(std::set<math::vector_3d*>& selected);
+  // for the vertex tool. the height changing functions return the change
+  // of the sum of the selected heights to keep the center up to date.
+
+  //! vertices within \a radius of \a pos, in x and z only if \a ignore_height
+  vertex_selection vertices_in_range (math::vector_3d const& pos, float radius, bool ignore_height) const;
+  math::vector_3d_base<double> sum_of_vertices (vertex_selection const& selected) const;
+  double move_vertices (vertex_selection const& selected, float change);
+  double set_heights (vertex_selection const& selected, float height);
+  double orient_vertices ( vertex_selection const& selected
+                         , math::vector_3d const& ref_pos
+                         , math::degrees vertex_angle
+                         , math::degrees vertex_orientation
+                         );
+  //! makes the middle vertices of partially selected quads follow
+  double fixVertices (vertex_selection const& selected);
 
-  //! \todo implement Action stack for these
   bool paintTexture(math::vector_3d const& pos, Brush *brush, float strength, float pressure, scoped_blp_texture_reference texture);
   bool canPaintTexture(scoped_blp_texture_reference texture);
   int addTexture(scoped_blp_texture_reference texture);
@@ -140,7 +195,6 @@ public:
   void eraseTextures();
   void change_texture_flag(scoped_blp_texture_reference tex, std::size_t flag, bool add);
 
-  //! \todo implement Action stack for these
   bool isHole(int i, int j);
   void setHole(math::vector_3d const& pos, bool big, bool add);
 
@@ -156,6 +210,11 @@ public:
 
   void clearHeight();
 
+  //! heights, normals, vertex colors, holes, flags and textures as bytes,
+  //! see noggit::undo_stack
+  std::vector<std::uint8_t> edit_state();
+  void restore_edit_state (std::vector<std::uint8_t> const& state);
+
   //! \todo this is ugly create a build struct or sth
   void save(sExtendableArray &lADTFile, int &lCurrentPosition, int &lMCIN_Position, std::map<std::string, int> &lTextures, std::vector<WMOInstance> &lObjectInstances, std::vector<ModelInstance>& lModelInstances);
 
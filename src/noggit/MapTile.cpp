@@ -10,6 +10,7 @@
 #include <noggit/TileWater.hpp>
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/World.h>
+#include <noggit/adt_object_patch.hpp>
 #include <noggit/alphamap.hpp>
 #include <noggit/map_index.hpp>
 #include <noggit/texture_set.hpp>
@@ -19,6 +20,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <list>
 #include <map>
 #include <string>
@@ -35,6 +37,12 @@ MapTile::MapTile(int pX, int pZ, const std::string& pFilename, bool pBigAlpha, b
   , mFilename(pFilename)
 {
   MPQFile theFile(mFilename);
+  // a tile read from an archive isn't in the project yet, so saving it has
+  // to write it even if nothing changed
+  if (theFile.isExternal())
+  {
+    _file_hashes[{mFilename, ""}] = misc::fnv1a (theFile.getBuffer(), theFile.getSize());
+  }
 
   Log << "Opening tile " << index.x << ", " << index.z << " (\"" << mFilename << "\") from " << (theFile.isExternal() ? "disk" : "MPQ") << "." << std::endl;
 
@@ -300,80 +308,221 @@ float MapTile::getMaxHeight()
   return maxHeight;
 }
 
-void MapTile::convert_alphamap(bool to_big_alpha)
+namespace
+{
+  int const chunk_tree_levels = 4;
+  int const chunk_tree_level_offset[chunk_tree_levels] = {0, 1, 1 + 4, 1 + 4 + 16};
+
+  int chunk_tree_node (int level, int x, int z)
+  {
+    return chunk_tree_level_offset[level] + z * (1 << level) + x;
+  }
+}
+
+void MapTile::update_chunk_tree()
+{
+  int const last_level (chunk_tree_levels - 1);
+  int const size (1 << last_level);
+
+  for (int z (0); z < size; ++z)
+  {
+    for (int x (0); x < size; ++x)
+    {
+      math::vector_3d min (math::vector_3d::max());
+      math::vector_3d max (math::vector_3d::min());
+
+      for (int j (2 * z); j < 2 * z + 2; ++j)
+      {
+        for (int i (2 * x); i < 2 * x + 2; ++i)
+        {
+          min = math::min (min, mChunks[j][i]->vmin);
+          max = math::max (max, mChunks[j][i]->vmax);
+        }
+      }
+
+      _chunk_tree_min[chunk_tree_node (last_level, x, z)] = min;
+      _chunk_tree_max[chunk_tree_node (last_level, x, z)] = max;
+    }
+  }
+
+  for (int level (last_level - 1); level >= 0; --level)
+  {
+    for (int z (0); z < (1 << level); ++z)
+    {
+      for (int x (0); x < (1 << level); ++x)
+      {
+        math::vector_3d min (math::vector_3d::max());
+        math::vector_3d max (math::vector_3d::min());
+
+        for (int j (2 * z); j < 2 * z + 2; ++j)
+        {
+          for (int i (2 * x); i < 2 * x + 2; ++i)
+          {
+            min = math::min (min, _chunk_tree_min[chunk_tree_node (level + 1, i, j)]);
+            max = math::max (max, _chunk_tree_max[chunk_tree_node (level + 1, i, j)]);
+          }
+        }
+
+        _chunk_tree_min[chunk_tree_node (level, x, z)] = min;
+        _chunk_tree_max[chunk_tree_node (level, x, z)] = max;
+      }
+    }
+  }
+
+  _chunk_tree_changed = false;
+}
+
+void MapTile::intersect_chunk_tree ( math::ray const& ray
+                                   , selection_result* results
+                                   , float& nearest
+                                   , int level
+                                   , int x
+                                   , int z
+                                   )
 {
-  mBigAlpha = true;
-  for (size_t i = 0; i < 16; i++)
+  std::pair<float, std::pair<int, int>> children[4];
+  int count (0);
+
+  for (int j (2 * z); j < 2 * z + 2; ++j)
+  {
+    for (int i (2 * x); i < 2 * x + 2; ++i)
+    {
+      auto const distance
+        ( level + 1 < chunk_tree_levels
+        ? ray.intersect_bounds_before ( _chunk_tree_min[chunk_tree_node (level + 1, i, j)]
+                                      , _chunk_tree_max[chunk_tree_node (level + 1, i, j)]
+                                      , nearest
+                                      )
+        : ray.intersect_bounds_before (mChunks[j][i]->vmin, mChunks[j][i]->vmax, nearest)
+        );
+
+      if (distance)
+      {
+        children[count++] = {*distance, {i, j}};
+      }
+    }
+  }
+
+  std::sort (children, children + count);
+
+  for (int child (0); child < count && children[child].first < nearest; ++child)
   {
-    for (size_t j = 0; j < 16; j++)
+    int const i (children[child].second.first);
+    int const j (children[child].second.second);
+
+    if (level + 1 < chunk_tree_levels)
+    {
+      intersect_chunk_tree (ray, results, nearest, level + 1, i, j);
+    }
+    else
     {
-      mChunks[i][j]->use_big_alphamap = to_big_alpha;
+      mChunks[j][i]->intersect (ray, results, nearest);
     }
   }
 }
 
-void MapTile::draw ( math::frustum const& frustum
-                   , const float& cull_distance
-                   , const math::vector_3d& camera
-                   , bool show_unpaintable_chunks
-                   , bool draw_contour
-                   , bool draw_paintability_overlay
-                   , bool draw_chunk_flag_overlay
-                   , bool draw_areaid_overlay
-                   , bool draw_wireframe_overlay
-                   , int cursor_type
-                   , std::map<int, misc::random_color>& area_id_colors
-                   , math::vector_4d shadow_color
-                   , boost::optional<selection_type> selection
-                   , int animtime
-                   )
+namespace
+{
+  float distance_to_bounds ( math::vector_3d const& point
+                           , math::vector_3d const& min
+                           , math::vector_3d const& max
+                           )
+  {
+    math::vector_3d const outside
+      ( std::max (std::max (min.x - point.x, point.x - max.x), 0.0f)
+      , std::max (std::max (min.y - point.y, point.y - max.y), 0.0f)
+      , std::max (std::max (min.z - point.z, point.z - max.z), 0.0f)
+      );
+    return outside.length();
+  }
+}
+
+void MapTile::collect_visible_chunk_tree ( math::frustum const& frustum
+                                         , const float& cull_distance
+                                         , const math::vector_3d& camera
+                                         , std::vector<MapChunk*>& chunks
+                                         , int level
+                                         , int x
+                                         , int z
+                                         )
 {
-  gl.color4f(1, 1, 1, 1);
+  // a chunk is kept if its center is closer than cull_distance plus its
+  // radius, which can't be the case if the node is farther than that
+  static float const chunk_radius (std::sqrt (CHUNKSIZE * CHUNKSIZE / 2.0f));
 
-  for (int j = 0; j<16; ++j)
+  for (int j (2 * z); j < 2 * z + 2; ++j)
   {
-    for (int i = 0; i<16; ++i)
+    for (int i (2 * x); i < 2 * x + 2; ++i)
     {
-      mChunks[j][i]->draw ( frustum
-                          , cull_distance
-                          , camera
-                          , show_unpaintable_chunks
-                          , draw_contour
-                          , draw_paintability_overlay
-                          , draw_chunk_flag_overlay
-                          , draw_areaid_overlay
-                          , draw_wireframe_overlay
-                          , cursor_type
-                          , area_id_colors
-                          , shadow_color
-                          , selection
-                          , animtime
-                          );
+      if (level + 1 < chunk_tree_levels)
+      {
+        math::vector_3d const& min (_chunk_tree_min[chunk_tree_node (level + 1, i, j)]);
+        math::vector_3d const& max (_chunk_tree_max[chunk_tree_node (level + 1, i, j)]);
+
+        if ( frustum.intersects (min, max)
+          && distance_to_bounds (camera, min, max) < cull_distance + chunk_radius
+           )
+        {
+          collect_visible_chunk_tree (frustum, cull_distance, camera, chunks, level + 1, i, j);
+        }
+      }
+      else if (mChunks[j][i]->is_visible (cull_distance, frustum, camera))
+      {
+        chunks.push_back (mChunks[j][i].get());
+      }
     }
   }
 }
 
-void MapTile::intersect (math::ray const& ray, selection_result* results) const
+void MapTile::collect_visible_chunks ( math::frustum const& frustum
+                                     , const float& cull_distance
+                                     , const math::vector_3d& camera
+                                     , std::vector<MapChunk*>& chunks
+                                     , std::vector<ChunkWater*>& water_chunks
+                                     )
 {
-  for (size_t j (0); j < 16; ++j)
+  static float const chunk_radius (std::sqrt (CHUNKSIZE * CHUNKSIZE / 2.0f));
+
+  if (_chunk_tree_changed)
+  {
+    update_chunk_tree();
+  }
+
+  if ( frustum.intersects (_chunk_tree_min[0], _chunk_tree_max[0])
+    && distance_to_bounds (camera, _chunk_tree_min[0], _chunk_tree_max[0]) < cull_distance + chunk_radius
+     )
   {
-    for (size_t i (0); i < 16; ++i)
+    collect_visible_chunk_tree (frustum, cull_distance, camera, chunks, 0, 0, 0);
+  }
+
+  // liquids are not part of the chunk tree as they may be above the terrain
+  if (Water.hasData (0))
+  {
+    for (int z (0); z < 16; ++z)
     {
-      mChunks[j][i]->intersect (ray, results);
+      for (int x (0); x < 16; ++x)
+      {
+        ChunkWater* water (Water.getChunk (x, z));
+        if (water->is_visible (cull_distance, frustum, camera))
+        {
+          water_chunks.push_back (water);
+        }
+      }
     }
   }
 }
 
-void MapTile::drawLines ( opengl::scoped::use_program& line_shader
-                        , math::frustum const& frustum
-                        , const float& cull_distance
-                        , const math::vector_3d& camera
-                        , bool draw_hole_lines
-                        )
+void MapTile::intersect (math::ray const& ray, selection_result* results, float& nearest)
 {
-  for (int j = 0; j<16; ++j)
-    for (int i = 0; i<16; ++i)
-      mChunks[j][i]->drawLines (line_shader, frustum, cull_distance, camera, draw_hole_lines);
+  if (_chunk_tree_changed)
+  {
+    update_chunk_tree();
+  }
+
+  if (ray.intersect_bounds_before (_chunk_tree_min[0], _chunk_tree_max[0], nearest))
+  {
+    intersect_chunk_tree (ray, results, nearest, 0, 0, 0);
+  }
 }
 
 void MapTile::drawMFBO (opengl::scoped::use_program& mfbo_shader)
@@ -389,32 +538,6 @@ void MapTile::drawMFBO (opengl::scoped::use_program& mfbo_shader)
   gl.drawElements (GL_TRIANGLE_FAN, sizeof (indices) / sizeof (*indices), GL_UNSIGNED_BYTE, indices);
 }
 
-void MapTile::drawWater ( opengl::scoped::use_program& water_shader
-                        , math::vector_3d water_color_light
-                        , math::vector_3d water_color_dark
-                        , int animtime
-                        , int layer
-                        )
-{
-  if (!Water.hasData(0))
-  {
-    return; //no need to draw water on tile without water =)
-  }
-
-  gl.disable(GL_COLOR_MATERIAL);
-  gl.disable(GL_LIGHTING);
-
-  Water.draw ( water_shader
-             , water_color_light
-             , water_color_dark
-             , animtime
-             , layer
-             );
-
-  gl.enable(GL_LIGHTING);
-  gl.enable(GL_COLOR_MATERIAL);
-}
-
 bool MapTile::canWaterSave() {
   return true;
 }
@@ -453,6 +576,7 @@ void MapTile::drawTextures ( float minX
                            , float maxX
                            , float maxY
                            , int animtime
+                           , GLuint texture_quads
                            )
 {
   float xOffset, yOffset;
@@ -465,12 +589,16 @@ void MapTile::drawTextures ( float minX
 
   //gl.translatef(-8,-8,0);
 
+  MapChunk::bind_texture_quads (texture_quads);
+
   for (int j = 0; j<16; ++j) {
     for (int i = 0; i<16; ++i) {
       if (((i + 1 + xOffset)>minX) && ((j + 1 + yOffset)>minY) && ((i + xOffset)<maxX) && ((j + yOffset)<maxY))
-        mChunks[j][i]->drawTextures (animtime);
+        mChunks[j][i]->drawTextures (animtime, texture_quads);
     }
   }
+
+  MapChunk::unbind_texture_quads();
 }
 
 MapChunk* MapTile::getChunk(unsigned int x, unsigned int z)
@@ -984,20 +1112,16 @@ void MapTile::saveTile(bool saveAllModels, World* world)
   lADTFile.Extend(lCurrentPosition - lADTFile.data.size()); // cleaning unused nulls at the end of file
 
 
+  if (!save_file (mFilename, "", lADTFile.data))
   {
-    MPQFile f(mFilename);
-    f.setBuffer(lADTFile.data);
-    f.SaveFile();
+    Log << "\"" << mFilename << "\" is unchanged, not written." << std::endl;
   }
 
   // save wod files
   if (wodSave)
   {
     // ADT root file
-    MPQFile f1 (mFilename, wodSavePath);
-    f1.setBuffer(lADTRootFile.data);
-    f1.SaveFile();
-    f1.close();
+    save_file (mFilename, wodSavePath, lADTRootFile.data);
 
     // both tex files
     std::stringstream texFilename1;
@@ -1005,16 +1129,8 @@ void MapTile::saveTile(bool saveAllModels, World* world)
     std::stringstream texFilename2;
     texFilename2 << mFilename.substr(0, mFilename.size() - 4) << "_tex1.adt";
 
-
-    MPQFile f2 (texFilename1.str(), wodSavePath);
-    f2.setBuffer(lADTTexFile.data);
-    f2.SaveFile();
-    f2.close();
-
-    MPQFile f3 (texFilename2.str(), wodSavePath);
-    f3.setBuffer(lADTTexFile.data);
-    f3.SaveFile();
-    f3.close();
+    save_file (texFilename1.str(), wodSavePath, lADTTexFile.data);
+    save_file (texFilename2.str(), wodSavePath, lADTTexFile.data);
 
     // both obj files
     std::stringstream objFilename1;
@@ -1022,16 +1138,8 @@ void MapTile::saveTile(bool saveAllModels, World* world)
     std::stringstream objFilename2;
     objFilename2 << mFilename.substr(0, mFilename.size() - 4) << "_obj1.adt";
 
-
-    MPQFile f4 (objFilename1.str(), wodSavePath);
-    f4.setBuffer(lADTObjFile.data);
-    f4.SaveFile();
-    f4.close();
-
-    MPQFile f5 (objFilename2.str(), wodSavePath);
-    f5.setBuffer(lADTObjFile.data);
-    f5.SaveFile();
-    f5.close();
+    save_file (objFilename1.str(), wodSavePath, lADTObjFile.data);
+    save_file (objFilename2.str(), wodSavePath, lADTObjFile.data);
   }
 
   lObjectInstances.clear();
@@ -1040,6 +1148,171 @@ void MapTile::saveTile(bool saveAllModels, World* world)
 }
 
 
+bool MapTile::saveObjects(World* world)
+{
+  // the wod split files are only written by a full save
+  if (!Settings::getInstance()->wodSavePath.empty())
+  {
+    return false;
+  }
+
+  math::vector_3d lTileExtents[2];
+  lTileExtents[0] = math::vector_3d(xbase, 0.0f, zbase);
+  lTileExtents[1] = math::vector_3d(xbase + TILESIZE, 0.0f, zbase + TILESIZE);
+
+  // same selection and order as saveTile
+  std::vector<ModelInstance const*> lModelInstances;
+  std::vector<WMOInstance const*> lObjectInstances;
+  std::map<std::string, uint32_t> lModels;
+  std::map<std::string, uint32_t> lObjects;
+
+  for (auto const& model : world->mModelInstances)
+  {
+    if (model.second.isInsideRect(lTileExtents))
+    {
+      lModelInstances.emplace_back(&model.second);
+      lModels.emplace(model.second.model->_filename, 0);
+    }
+  }
+
+  for (auto const& object : world->mWMOInstances)
+  {
+    if (object.second.isInsideRect(lTileExtents))
+    {
+      lObjectInstances.emplace_back(&object.second);
+      lObjects.emplace(object.second.wmo->_filename, 0);
+    }
+  }
+
+  if (world->mapIndex.sort_models_by_size_class())
+  {
+    std::sort(lModelInstances.begin(), lModelInstances.end(), [](ModelInstance const* m1, ModelInstance const* m2)
+    {
+      return m1->size_cat > m2->size_cat;
+    });
+  }
+
+  noggit::adt_objects objects;
+
+  for (auto& model : lModels)
+  {
+    model.second = objects.model_filenames.size();
+    objects.model_filenames.emplace_back(model.first);
+  }
+
+  for (auto& object : lObjects)
+  {
+    object.second = objects.wmo_filenames.size();
+    objects.wmo_filenames.emplace_back(object.first);
+  }
+
+  for (ModelInstance const* model : lModelInstances)
+  {
+    ENTRY_MDDF entry;
+    entry.nameID = lModels.at(model->model->_filename);
+    entry.uniqueID = model->uid;
+    entry.pos[0] = model->pos.x;
+    entry.pos[1] = model->pos.y;
+    entry.pos[2] = model->pos.z;
+    entry.rot[0] = model->dir.x;
+    entry.rot[1] = model->dir.y;
+    entry.rot[2] = model->dir.z;
+    entry.scale = (uint16_t)(model->scale * 1024);
+    entry.flags = 0;
+
+    objects.models.emplace_back(entry);
+    objects.model_extents.push_back({model->extents[0], model->extents[1]});
+  }
+
+  for (WMOInstance const* object : lObjectInstances)
+  {
+    ENTRY_MODF entry;
+    entry.nameID = lObjects.at(object->wmo->_filename);
+    entry.uniqueID = object->mUniqueID;
+    entry.pos[0] = object->pos.x;
+    entry.pos[1] = object->pos.y;
+    entry.pos[2] = object->pos.z;
+    entry.rot[0] = object->dir.x;
+    entry.rot[1] = object->dir.y;
+    entry.rot[2] = object->dir.z;
+
+    for (int i = 0; i < 3; ++i)
+    {
+      entry.extents[0][i] = object->extents[0][i];
+      entry.extents[1][i] = object->extents[1][i];
+    }
+
+    entry.flags = object->mFlags;
+    entry.doodadSet = object->doodadset;
+    entry.nameSet = object->mNameset;
+    entry.unknown = object->mUnknown;
+
+    objects.wmos.emplace_back(entry);
+  }
+
+  MPQFile f(mFilename);
+
+  if (f.isEof())
+  {
+    return false;
+  }
+
+  auto const patched(noggit::patch_adt_objects(f.getBuffer(), f.getSize(), objects));
+
+  if (!patched)
+  {
+    LogError << "Could not patch the objects of \"" << mFilename << "\", saving it completely." << std::endl;
+    return false;
+  }
+
+  if ( patched->size() == f.getSize()
+    && std::equal (patched->begin(), patched->end(), f.getBuffer())
+     )
+  {
+    Log << "Objects of ADT \"" << mFilename << "\" are unchanged, not written." << std::endl;
+    return true;
+  }
+
+  Log << "Saving objects of ADT \"" << mFilename << "\"." << std::endl;
+
+  f.setBuffer(*patched);
+  f.SaveFile();
+  _file_hashes[{mFilename, ""}] = misc::fnv1a (patched->data(), patched->size());
+
+  return true;
+}
+
+bool MapTile::save_file ( std::string const& filename
+                        , std::string const& save_path
+                        , std::vector<char> const& data
+                        )
+{
+  std::uint64_t const hash (misc::fnv1a (data.data(), data.size()));
+  auto const known (_file_hashes.emplace (std::make_pair (filename, save_path), hash));
+  if (!known.second)
+  {
+    if (known.first->second == hash)
+    {
+      return false;
+    }
+    known.first->second = hash;
+  }
+
+  if (save_path.empty())
+  {
+    MPQFile f (filename);
+    f.setBuffer (data);
+    f.SaveFile();
+  }
+  else
+  {
+    MPQFile f (filename, save_path);
+    f.setBuffer (data);
+    f.SaveFile();
+  }
+  return true;
+}
+
 void MapTile::CropWater()
 {
   for (int z = 0; z < 16; ++z)
@@ -11,8 +11,11 @@
 #include <opengl/shader.fwd.hpp>
 #include <noggit/Misc.h>
 
+#include <array>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace math
@@ -23,6 +26,20 @@ namespace math
 
 class World;
 
+//! parts of an ADT that are modified independently, see MapTile::changed
+enum tile_chunk_family
+{
+  //! MCNK heights, normals, vertex colors, shadows, holes, flags and area ids
+  tile_terrain = 0x1,
+  //! MTEX, MCLY and MCAL
+  tile_textures = 0x2,
+  //! MH2O
+  tile_liquids = 0x4,
+  //! MMDX, MMID, MWMO, MWID, MDDF, MODF and MCRF
+  tile_objects = 0x8,
+  tile_all = tile_terrain | tile_textures | tile_liquids | tile_objects
+};
+
 class MapTile
 {
 
@@ -46,8 +63,6 @@ public:
 	//! \brief Get the maximum height of terrain on this map tile.
 	float getMaxHeight();
 
-  void convert_alphamap(bool to_big_alpha);
-
   //! \brief Get chunk for sub offset x,z.
   MapChunk* getChunk(unsigned int x, unsigned int z);
   //! \todo map_index style iterators
@@ -56,47 +71,35 @@ public:
   const tile_index index;
   float xbase, zbase;
 
+  //! combination of tile_chunk_family, 0 if unchanged
   int changed;
 
-  void draw ( math::frustum const& frustum
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool show_unpaintable_chunks
-            , bool draw_contour
-            , bool draw_paintability_overlay
-            , bool draw_chunk_flag_overlay
-            , bool draw_areaid_overlay
-            , bool draw_wireframe_overlay
-            , int cursor_type
-            , std::map<int, misc::random_color>& area_id_colors
-            , math::vector_4d shadow_color
-            , boost::optional<selection_type> selection
-            , int animtime
-            );
-  void intersect (math::ray const&, selection_result*) const;
-  void drawLines ( opengl::scoped::use_program& line_shader
-                 , math::frustum const& frustum
-                 , const float& cull_distance
-                 , const math::vector_3d& camera
-                 , bool draw_hole_lines
-                 );
-  void drawWater ( opengl::scoped::use_program& water_shader
-                 , math::vector_3d water_color_light
-                 , math::vector_3d water_color_dark
-                 , int animtime
-                 , int layer
-                 );
+  //! appends the chunks passing MapChunk::is_visible and the water chunks
+  //! passing ChunkWater::is_visible. the terrain is culled through the
+  //! chunk tree, rejecting hidden quarters of the tile as a whole.
+  void collect_visible_chunks ( math::frustum const& frustum
+                              , const float& cull_distance
+                              , const math::vector_3d& camera
+                              , std::vector<MapChunk*>& chunks
+                              , std::vector<ChunkWater*>& water_chunks
+                              );
+  //! only reports a hit if it is closer than \a nearest, which is updated
+  void intersect (math::ray const&, selection_result*, float& nearest);
   void drawTextures ( float minX
                     , float minY
                     , float maxX
                     , float maxY
                     , int animtime
+                    , GLuint texture_quads
                     );
   void drawMFBO (opengl::scoped::use_program&);
 
   bool GetVertex(float x, float z, math::vector_3d *V);
 
   void saveTile(bool saveAllModels, World*);
+  //! only replaces the object chunks of the ADT saved last, keeping the
+  //! rest of the file as is. \returns false if a full save is required.
+  bool saveObjects(World*);
 	void CropWater();
 
   bool isTile(int pX, int pZ);
@@ -124,8 +127,41 @@ private:
   std::string mFilename;
 
   std::unique_ptr<MapChunk> mChunks[16][16];
+
+  //! quadtree over the chunk bounds used for picking and culling, stored level by level
+  //! from the whole tile (1x1) down to 8x8, the chunks being the last level.
+  //! only the heights change, so it is refitted lazily after edits.
+  std::array<math::vector_3d, 1 + 4 + 16 + 64> _chunk_tree_min;
+  std::array<math::vector_3d, 1 + 4 + 16 + 64> _chunk_tree_max;
+  bool _chunk_tree_changed = true;
+
+  void update_chunk_tree();
+  void intersect_chunk_tree ( math::ray const&
+                            , selection_result*
+                            , float& nearest
+                            , int level
+                            , int x
+                            , int z
+                            );
+  void collect_visible_chunk_tree ( math::frustum const&
+                                  , const float& cull_distance
+                                  , const math::vector_3d& camera
+                                  , std::vector<MapChunk*>&
+                                  , int level
+                                  , int x
+                                  , int z
+                                  );
   std::vector<TileWater*> chunksLiquids; //map chunks liquids for old style water render!!! (Not MH2O)
 
+  //! of the bytes each file held when it was last read or written, by
+  //! filename and save path, so saving unchanged bytes doesn't touch it
+  std::map<std::pair<std::string, std::string>, std::uint64_t> _file_hashes;
+  //! \returns false if the file already holds \a data
+  bool save_file ( std::string const& filename
+                 , std::string const& save_path
+                 , std::vector<char> const& data
+                 );
+
   friend class MapChunk;
   friend class TextureSet;
 };
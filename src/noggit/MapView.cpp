@@ -11,9 +11,11 @@
 #include <noggit/Project.h>
 #include <noggit/Settings.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
+#include <noggit/WMO.h> // WMOManager
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/World.h>
 #include <noggit/map_index.hpp>
+#include <noggit/minimap_baker.hpp>
 #include <noggit/ui/CurrentTexture.h>
 #include <noggit/ui/CursorSwitcher.h> // cursor_switcher
 #include <noggit/ui/DetailInfos.h> // detailInfos
@@ -51,6 +53,7 @@
 #include <QtWidgets/QStatusBar>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <fstream>
@@ -149,6 +152,7 @@ void MapView::SnapSelectedObjectToGround()
   if (_world->IsSelection(eEntry_WMO))
   {
     WMOInstance* wmo = boost::get<selected_wmo_type> (*_world->GetCurrentSelection());
+    _world->updateTilesWMO(wmo);
     math::vector_3d t = math::vector_3d(wmo->pos.x, wmo->pos.z, 0);
     _world->GetVertex(wmo->pos.x, wmo->pos.z, &t);
     wmo->pos.y = t.y;
@@ -157,6 +161,7 @@ void MapView::SnapSelectedObjectToGround()
   else if (_world->IsSelection(eEntry_Model))
   {
     ModelInstance* m2 = boost::get<selected_model_type> (*_world->GetCurrentSelection());
+    _world->updateTilesModel(m2);
     math::vector_3d t = math::vector_3d(m2->pos.x, m2->pos.z, 0);
     _world->GetVertex(m2->pos.x, m2->pos.z, &t);
     m2->pos.y = t.y;
@@ -564,6 +569,28 @@ void MapView::createGUI()
 
   //! \todo sections are not rendered on all platforms. one should
   //! probably do separator+disabled entry to force rendering
+  edit_menu->addSection ("history");
+  ADD_ACTION ( edit_menu
+             , "undo"
+             , QKeySequence::Undo
+             , [this]
+               {
+                 makeCurrent();
+                 opengl::context::scoped_setter const _ (::gl, context());
+                 _world->undo();
+               }
+             );
+  ADD_ACTION ( edit_menu
+             , "redo"
+             , QKeySequence::Redo
+             , [this]
+               {
+                 makeCurrent();
+                 opengl::context::scoped_setter const _ (::gl, context());
+                 _world->redo();
+               }
+             );
+
   edit_menu->addSection ("selected object");
   ADD_ACTION (edit_menu, "delete", Qt::Key_Delete, [this] { DeleteSelectedObject(); });
   ADD_ACTION (edit_menu, "reset rotation", "Ctrl+R", [this] { ResetSelectedObjectRotation(); });
@@ -872,7 +899,7 @@ void MapView::createGUI()
   ADD_ACTION (view_menu, "decrease camera speed", Qt::Key_O, [this] { _camera.move_speed *= 0.5f; });
   ADD_ACTION (view_menu, "increase camera speed", Qt::Key_P, [this] { _camera.move_speed *= 2.0f; });
 
-  ADD_ACTION (file_menu, "save minimaps", "Ctrl+Shift+P", [this] { Saving = true; });
+  ADD_ACTION (file_menu, "save minimaps", "Ctrl+Shift+P", [this] { bake_minimaps(); });
 
   ADD_ACTION ( view_menu
              , "turn camera around 180°"
@@ -1213,10 +1240,12 @@ MapView::MapView( math::degrees camera_yaw0
                 , noggit::ui::main_window* main_window
                 , std::unique_ptr<World> world
                 , uid_fix_mode uid_fix
+                , std::function<void (uid_fix_progress const&)> uid_fix_progress
                 )
   : _camera (camera_pos, camera_yaw0, camera_pitch0)
   , mTimespeed(0.0f)
   , _uid_fix (uid_fix)
+  , _uid_fix_progress (std::move (uid_fix_progress))
   , _main_window (main_window)
   , _world (std::move (world))
   , _status_position (new QLabel (this))
@@ -1361,10 +1390,14 @@ MapView::MapView( math::degrees camera_yaw0
     }
     else if (_uid_fix == uid_fix_mode::fix_all)
     {
-      _world->mapIndex.fixUIDs (_world.get());
+      _world->mapIndex.fixUIDs (_world.get(), _uid_fix_progress);
     }
 
+    // after the uid fix, which rewrites the saved tiles
+    _world->start_journal (_uid_fix != uid_fix_mode::fix_all);
+
     _uid_fix = uid_fix_mode::none;
+    _uid_fix_progress = nullptr;
 
     createGUI();
 
@@ -1395,20 +1428,6 @@ MapView::MapView( math::degrees camera_yaw0
       opengl::context::scoped_setter const _ (::gl, context());
       gl.clear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      //! \todo  Get this out or do it somehow else. This is ugly and is a senseless if each draw.
-      if (Saving)
-      {
-        gl.matrixMode (GL_PROJECTION);
-        gl.loadIdentity();
-        gl.ortho
-          (-2.0f * aspect_ratio(), 2.0f * aspect_ratio(), 2.0f, -2.0f, -100.0f, 300.0f);
-        gl.matrixMode (GL_MODELVIEW);
-        gl.loadIdentity();
-
-        _world->saveMap (width(), height());
-        Saving = false;
-      }
-
       switch (mViewMode)
       {
       case eViewMode_2D:
@@ -1419,6 +1438,9 @@ MapView::MapView( math::degrees camera_yaw0
         displayViewMode_3D();
         break;
       }
+
+      // sampled checks would otherwise miss errors of the last calls
+      gl.check_for_errors ("MapView::paintGL");
     }
   }
 
@@ -1439,6 +1461,53 @@ MapView::~MapView()
   _minimap->hide();
 
   _world.reset();
+
+  // unused resources are kept for reuse, their GL objects have to go
+  // while the context is still around. WMOs hold models and textures.
+  WMOManager::report();
+  WMOManager::purge_unused();
+  ModelManager::report();
+  ModelManager::purge_unused();
+  TextureManager::report();
+  TextureManager::purge_unused();
+}
+
+void MapView::bake_minimaps()
+{
+  if (_minimap_bake.valid())
+  {
+    return;
+  }
+
+  std::vector<tile_index> tiles;
+  for (int z (0); z < 64; ++z)
+  {
+    for (int x (0); x < 64; ++x)
+    {
+      if (_world->mapIndex.hasTile (tile_index (x, z)))
+      {
+        tiles.emplace_back (x, z);
+      }
+    }
+  }
+
+  noggit::minimap_bake_settings settings;
+  settings.output_directory = Project::getInstance()->getPath();
+  settings.texture_cache_directory = Settings::getInstance()->textureCachePath;
+
+  _minimap_bake_progress = 0;
+  _minimap_bake_tiles = tiles.size();
+
+  // baked from the ADTs on disk, unsaved changes are not included
+  _minimap_bake = std::async
+    ( std::launch::async
+    , [this, tiles, settings, basename = _world->basename, big_alpha = _world->mapIndex.hasBigAlpha()]
+      {
+        noggit::minimap_baker baker (basename, big_alpha);
+        return baker.bake_all
+          (tiles, settings, [this] (std::size_t done) { _minimap_bake_progress = done; });
+      }
+    );
 }
 
 void MapView::tick (float dt)
@@ -1966,9 +2035,28 @@ void MapView::tick (float dt)
     }
 #endif
 
+    if (_minimap_bake.valid())
+    {
+      timestrs << ", Minimaps: " << _minimap_bake_progress << "/" << _minimap_bake_tiles;
+    }
+
     _status_time->setText (QString::fromStdString (timestrs.str()));
   }
 
+  if ( _minimap_bake.valid()
+    && _minimap_bake.wait_for (std::chrono::seconds (0)) == std::future_status::ready
+     )
+  {
+    noggit::minimap_bake_result const result (_minimap_bake.get());
+
+    Log << "Baked " << result.written << " minimap tiles." << std::endl;
+    for (auto const& failure : result.failed)
+    {
+      LogError << "Baking minimap tile " << failure.first.x << ", " << failure.first.z
+               << " failed: " << failure.second << std::endl;
+    }
+  }
+
   if (!_last_frame_durations.empty())
   {
     while (_last_frame_durations.size() > 10)
@@ -1983,7 +2071,37 @@ void MapView::tick (float dt)
                         )
       / qreal (_last_frame_durations.size())
       );
-    _status_fps->setText ("FPS: " + QString::number (int (1. / avg_frame_duration)));
+    QString fps ("FPS: " + QString::number (int (1. / avg_frame_duration)));
+
+    if (!_last_world_draw_durations.empty())
+    {
+      while (_last_world_draw_durations.size() > 10)
+      {
+        _last_world_draw_durations.pop_front();
+      }
+
+      auto avg_world_draw_duration
+        ( std::accumulate ( _last_world_draw_durations.begin()
+                          , _last_world_draw_durations.end()
+                          , 0.
+                          )
+        / qreal (_last_world_draw_durations.size())
+        );
+
+      char const* const check_modes[] = {"full", "sampled", "release"};
+      fps += QString (", World::draw: %1 ms (%2 GL checks)")
+               .arg (avg_world_draw_duration, 0, 'f', 2)
+               .arg (check_modes[static_cast<int> (gl._check_mode)]);
+    }
+
+    fps += QString (", WMO groups: %1, WMO doodads: %2")
+             .arg (_last_wmo_draw_statistics.groups)
+             .arg (_last_wmo_draw_statistics.doodads);
+    fps += QString (", M2 instances: %1, M2 draw calls: %2")
+             .arg (_world->model_draw_statistics.instances)
+             .arg (_world->model_draw_statistics.draw_calls);
+
+    _status_fps->setText (fps);
   }
 
   guiWater->updatePos (_camera.position);
@@ -2314,6 +2432,9 @@ void MapView::displayViewMode_3D()
   opengl::matrix::look_at
     (_camera.position, _camera.look_at(), {0.0f, 1.0f, 0.0f});
 
+  WMO::reset_draw_statistics();
+  auto const world_draw_start (std::chrono::steady_clock::now());
+
   _world->draw ( _cursor_pos
                , terrainMode == editing_mode::mccv ? shader_color : cursor_color
                , cursor_type
@@ -2350,6 +2471,12 @@ void MapView::displayViewMode_3D()
                , terrainTool->_edit_type
                , _display_all_water_layers.get() ? -1 : _displayed_water_layer.get()
                );
+
+  _last_world_draw_durations.emplace_back
+    ( std::chrono::duration<qreal, std::milli>
+        (std::chrono::steady_clock::now() - world_draw_start).count()
+    );
+  _last_wmo_draw_statistics = WMO::current_draw_statistics();
 }
 
 void MapView::keyPressEvent (QKeyEvent *event)
@@ -2480,6 +2607,12 @@ void MapView::keyPressEvent (QKeyEvent *event)
 
 void MapView::keyReleaseEvent (QKeyEvent* event)
 {
+  // numpad moves of objects and the vertex tool's keys end with the key
+  if (!event->isAutoRepeat())
+  {
+    _world->end_undo_stroke();
+  }
+
   if (event->key() == Qt::Key_Shift)
     _mod_shift_down = false;
 
@@ -2722,6 +2855,9 @@ void MapView::mousePressEvent (QMouseEvent* event)
   makeCurrent();
   opengl::context::scoped_setter const _ (::gl, context());
 
+  // edits done outside of a drag, e.g. from a menu, are a step on their own
+  _world->end_undo_stroke();
+
   switch (event->button())
   {
   case Qt::LeftButton:
@@ -2847,6 +2983,8 @@ void MapView::wheelEvent (QWheelEvent* event)
 
 void MapView::mouseReleaseEvent (QMouseEvent* event)
 {
+  _world->end_undo_stroke();
+
   switch (event->button())
   {
   case Qt::LeftButton:
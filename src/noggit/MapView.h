@@ -5,8 +5,10 @@
 #include <math/vector_4d.hpp>
 #include <noggit/Misc.h>
 #include <noggit/Selection.h>
+#include <noggit/WMO.h>
 #include <noggit/bool_toggle_property.hpp>
 #include <noggit/camera.hpp>
+#include <noggit/minimap_baker.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/ObjectEditor.h>
 #include <noggit/ui/uid_fix_window.hpp>
@@ -20,7 +22,9 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QOpenGLWidget>
 
+#include <atomic>
 #include <forward_list>
+#include <future>
 #include <map>
 #include <unordered_set>
 
@@ -163,8 +167,13 @@ private:
   editing_mode saveterrainMode = terrainMode;
 
   uid_fix_mode _uid_fix;
+  std::function<void (uid_fix_progress const&)> _uid_fix_progress;
 
-  bool Saving = false;
+  void bake_minimaps();
+
+  std::atomic<std::size_t> _minimap_bake_progress;
+  std::size_t _minimap_bake_tiles;
+  std::future<noggit::minimap_bake_result> _minimap_bake;
 
   noggit::ui::toolbar* _toolbar;
 
@@ -181,6 +190,7 @@ public:
           , noggit::ui::main_window*
           , std::unique_ptr<World>
           , uid_fix_mode uid_fix = uid_fix_mode::none
+          , std::function<void (uid_fix_progress const&)> uid_fix_progress = nullptr
           );
   ~MapView();
 
@@ -218,6 +228,9 @@ private:
   QTime _startup_time;
   qreal _last_update = 0.f;
   std::list<qreal> _last_frame_durations;
+  //! CPU side milliseconds spent in World::draw
+  std::list<qreal> _last_world_draw_durations;
+  WMO::draw_statistics _last_wmo_draw_statistics = {0, 0};
 
   QTimer _update_every_event_loop;
 
@@ -103,6 +103,16 @@ namespace misc
     min.z = std::min(min.z, point.z);
     max.z = std::max(max.z, point.z);
   }
+
+  std::uint64_t fnv1a (char const* data, std::size_t size)
+  {
+    std::uint64_t hash (0xcbf29ce484222325ull);
+    for (std::size_t i (0); i < size; ++i)
+    {
+      hash = (hash ^ static_cast<unsigned char> (data[i])) * 0x100000001b3ull;
+    }
+    return hash;
+  }
 }
 
 void SetChunkHeader(sExtendableArray& pArray, int pPosition, int pMagix, int pSize)
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -31,6 +32,8 @@ namespace misc
   // used for angled tools, get the height a point (pos) should be given an origin, angle and orientation
   float angledHeight(math::vector_3d const& origin, math::vector_3d const& pos, math::radians const& angle, math::radians const& orientation);
   void extract_v3d_min_max(math::vector_3d const& point, math::vector_3d& min, math::vector_3d& max);
+  //! FNV-1a, stable across runs and platforms unlike std::hash
+  std::uint64_t fnv1a (char const* data, std::size_t size);
 
   struct random_color : math::vector_4d
   {
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <cassert>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
 
@@ -77,6 +78,41 @@ Model::~Model()
 }
 
 
+noggit::resource_memory Model::memory_usage() const
+{
+  noggit::resource_memory memory;
+  memory.cpu = sizeof (*this)
+             + _vertices.capacity() * sizeof (model_vertex)
+             + _current_vertices.capacity() * sizeof (model_vertex)
+             + _indices.capacity() * sizeof (uint16_t)
+             + _vertices_parameters.capacity() * sizeof (model_vertex_parameter)
+             + _passes.capacity() * sizeof (ModelRenderPass)
+             + bones.capacity() * sizeof (Bone);
+  memory.gpu = _finished_upload ? _current_vertices.size() * sizeof (model_vertex) : 0;
+
+  // a pooled model keeps its textures alive, so they are charged to it.
+  // Textures shared with other models are counted by each of them.
+  std::set<blp_texture const*> textures;
+  for (scoped_blp_texture_reference const& texture : _textures)
+  {
+    textures.emplace (texture.get());
+  }
+  for (auto const& texture : _replaceTextures)
+  {
+    textures.emplace (texture.second.get());
+  }
+  textures.erase (nullptr);
+
+  for (blp_texture const* texture : textures)
+  {
+    noggit::resource_memory const texture_memory (texture->memory_usage());
+    memory.cpu += texture_memory.cpu;
+    memory.gpu += texture_memory.gpu;
+  }
+
+  return memory;
+}
+
 bool Model::isAnimated(const MPQFile& f)
 {
   // see if we have any animated bones
@@ -366,6 +402,27 @@ void Model::initCommon(const MPQFile& f)
     std::sort(_passes.begin(), _passes.end());
   }
 
+  if (!animGeometry)
+  {
+    // several passes may share the same submesh, only add each range once
+    std::set<std::pair<uint16_t, uint16_t>> ranges;
+    for (auto&& pass : _passes)
+    {
+      ranges.emplace (pass.indexStart, pass.indexCount);
+    }
+
+    std::vector<math::vector_3d> triangles;
+    for (auto&& range : ranges)
+    {
+      for (size_t i (range.first); i < range.first + range.second; ++i)
+      {
+        triangles.emplace_back (_current_vertices[_indices[i]].position);
+      }
+    }
+
+    _bvh = math::bounding_volume_hierarchy (std::move (triangles));
+  }
+
   // zomg done
 }
 
@@ -918,14 +975,14 @@ void Bone::calcMatrix(Bone *allbones, int anim, int time, int animtime)
 }
 
 
-void Model::draw (bool draw_fog, int animtime)
+bool Model::prepare_draw (bool draw_fog, int animtime)
 {
   if (!finishedLoading())
-    return;
+    return false;
 
   if (!_finished_upload) {
     upload();
-    return;
+    return false;
   }
 
   if (draw_fog)
@@ -939,16 +996,42 @@ void Model::draw (bool draw_fog, int animtime)
     animcalc = true;
   }
 
-  lightsOn(GL_LIGHT4);
+  return true;
+}
 
+void Model::bind_vertices()
+{
   // assume these client states are enabled: GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_TEXTURE_COORD_ARRAY
-  opengl::scoped::buffer_binder<GL_ARRAY_BUFFER> const binder (_vertices_buffer);
-  gl.vertexPointer (3, GL_FLOAT, sizeof (model_vertex), 0);
-  gl.normalPointer (GL_FLOAT, sizeof (model_vertex), reinterpret_cast<void*> (sizeof (::math::vector_3d)));
-  gl.texCoordPointer (2, GL_FLOAT, sizeof (model_vertex), reinterpret_cast<void*> (2 * sizeof (::math::vector_3d)));
+  {
+    opengl::scoped::buffer_binder<GL_ARRAY_BUFFER> const binder (_vertices_buffer);
+    gl.vertexPointer (3, GL_FLOAT, sizeof (model_vertex), 0);
+    gl.normalPointer (GL_FLOAT, sizeof (model_vertex), reinterpret_cast<void*> (sizeof (::math::vector_3d)));
+    gl.texCoordPointer (2, GL_FLOAT, sizeof (model_vertex), reinterpret_cast<void*> (2 * sizeof (::math::vector_3d)));
+  }
 
   gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   gl.alphaFunc(GL_GREATER, 0.3f);
+}
+
+void Model::reset_pass_state()
+{
+  gl.alphaFunc(GL_GREATER, 0.0f);
+  gl.disable(GL_ALPHA_TEST);
+
+  GLfloat czero[4] = { 0, 0, 0, 1 };
+  gl.materialfv(GL_FRONT, GL_EMISSION, czero);
+  gl.color4f(1, 1, 1, 1);
+  gl.depthMask(GL_TRUE);
+}
+
+void Model::draw (bool draw_fog, int animtime)
+{
+  if (!prepare_draw (draw_fog, animtime))
+    return;
+
+  lightsOn(GL_LIGHT4);
+
+  bind_vertices();
 
   for (size_t i = 0; i < _passes.size(); ++i)
   {
@@ -968,13 +1051,7 @@ void Model::draw (bool draw_fog, int animtime)
   }
   // done with all render ops
 
-  gl.alphaFunc(GL_GREATER, 0.0f);
-  gl.disable(GL_ALPHA_TEST);
-
-  GLfloat czero[4] = { 0, 0, 0, 1 };
-  gl.materialfv(GL_FRONT, GL_EMISSION, czero);
-  gl.color4f(1, 1, 1, 1);
-  gl.depthMask(GL_TRUE);
+  reset_pass_state();
 
   lightsOff(GL_LIGHT4);
 
@@ -986,16 +1063,84 @@ void Model::draw (bool draw_fog, int animtime)
     _ribbons[i].draw();
 }
 
-std::vector<float> Model::intersect (math::ray const& ray, int animtime)
+std::size_t Model::draw_instances ( std::vector<math::matrix_4x4> const& instances
+                                  , bool blended
+                                  , bool draw_fog
+                                  , int animtime
+                                  )
 {
-  std::vector<float> results;
+  if (!prepare_draw (draw_fog, animtime))
+    return 0;
 
-  if (animated && (!animcalc || mPerInstanceAnimation))
+  bind_vertices();
+
+  std::size_t draw_calls (0);
+
+  for (ModelRenderPass& p : _passes)
+  {
+    if (p.blended() != blended || !p.init (this))
+      continue;
+
+    // init leaves the texture matrix current for animated textures
+    if (p.texanim != -1)
+      gl.matrixMode (GL_MODELVIEW);
+
+    for (math::matrix_4x4 const& model_view : instances)
+    {
+      gl.loadMatrixf (model_view.transposed());
+      gl.drawRangeElements(GL_TRIANGLES, p.vertexStart, p.vertexEnd, p.indexCount, GL_UNSIGNED_SHORT, _indices.data() + p.indexStart);
+      ++draw_calls;
+    }
+
+    if (p.texanim != -1)
+      gl.matrixMode (GL_TEXTURE);
+
+    p.deinit();
+  }
+
+  reset_pass_state();
+
+  return draw_calls;
+}
+
+bool Model::needs_single_draw() const
+{
+  return header.nLights || header.nParticleEmitters || header.nRibbonEmitters;
+}
+
+bool Model::has_blended_passes() const
+{
+  return std::any_of ( _passes.begin(), _passes.end()
+                     , [] (ModelRenderPass const& pass) { return pass.blended(); }
+                     );
+}
+
+opengl::texture const* Model::first_texture() const
+{
+  if (_passes.empty() || _specialTextures[_passes.front().tex] != -1)
+    return nullptr;
+
+  return _textures[_passes.front().tex].get();
+}
+
+boost::optional<float> Model::intersect ( math::ray const& ray
+                                         , int animtime
+                                         , float max_distance
+                                         )
+{
+  if (!animGeometry)
+  {
+    return _bvh.intersect_nearest (ray, max_distance);
+  }
+
+  if (!animcalc || mPerInstanceAnimation)
   {
     animate (0, animtime);
     animcalc = true;
   }
 
+  boost::optional<float> nearest;
+
   for (auto&& pass : _passes)
   {
     for (size_t i (pass.indexStart); i < pass.indexStart + pass.indexCount; i += 3)
@@ -1006,12 +1151,16 @@ std::vector<float> Model::intersect (math::ray const& ray, int animtime)
                                     _current_vertices[_indices[i + 2]].position)
           )
       {
-        results.emplace_back (*distance);
+        if (*distance < max_distance)
+        {
+          max_distance = *distance;
+          nearest = distance;
+        }
       }
     }
   }
 
-  return results;
+  return nearest;
 }
 
 void Model::lightsOn(opengl::light lbase)
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <math/bounding_volume_hierarchy.hpp>
 #include <math/matrix_4x4.hpp>
 #include <math/quaternion.hpp>
 #include <math/ray.hpp>
@@ -102,6 +103,12 @@ struct ModelRenderPass {
   bool init(Model *m);
   void deinit();
 
+  //! drawn after all opaque geometry, back to front
+  bool blended() const
+  {
+    return blendmode >= BM_ALPHA_BLEND;
+  }
+
   bool operator< (const ModelRenderPass &m) const
   {
     //return !trans;
@@ -156,12 +163,37 @@ public:
   void draw (bool draw_fog, int animtime);
   void drawTileMode();
 
-  std::vector<float> intersect (math::ray const&, int animtime);
+  //! draws either the opaque or the blended passes for all \a instances,
+  //! given as model view matrices, setting up every pass only once.
+  //! \returns the number of draw calls.
+  std::size_t draw_instances ( std::vector<math::matrix_4x4> const& instances
+                             , bool blended
+                             , bool draw_fog
+                             , int animtime
+                             );
+  //! lights, particles and ribbons are set up in model space for a single
+  //! instance, models using them have to be drawn with draw()
+  bool needs_single_draw() const;
+  bool has_blended_passes() const;
+  //! texture of the first pass, used to order models by state
+  opengl::texture const* first_texture() const;
+
+  //! nearest hit in model space closer than max_distance. Models without
+  //! animated geometry use a hierarchy built on load, others are animated
+  //! and tested triangle by triangle.
+  boost::optional<float> intersect ( math::ray const&
+                                   , int animtime
+                                   , float max_distance
+                                   );
 
   void updateEmitters(float dt);
 
   virtual void finishLoading();
 
+  //! including the textures it references, which stay loaded as long as
+  //! the model does, pooled or not
+  noggit::resource_memory memory_usage() const;
+
   // ===============================
   // Toggles
   // ===============================
@@ -202,6 +234,11 @@ private:
   void lightsOn(opengl::light lbase);
   void lightsOff(opengl::light lbase);
 
+  //! \returns false if the model can't be drawn yet
+  bool prepare_draw (bool draw_fog, int animtime);
+  void bind_vertices();
+  void reset_pass_state();
+
   void upload();
 
   bool _finished_upload;
@@ -220,6 +257,9 @@ private:
 
   std::vector<ModelRenderPass> _passes;
 
+  //! only built when the geometry isn't animated
+  math::bounding_volume_hierarchy _bvh;
+
   // ===============================
   // Animation
   // ===============================
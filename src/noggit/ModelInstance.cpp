@@ -6,6 +6,7 @@
 #include <noggit/Model.h> // Model, etc.
 #include <noggit/ModelInstance.h>
 #include <noggit/Settings.h>
+#include <noggit/adt_object_patch.hpp>
 #include <opengl/primitives.hpp>
 #include <opengl/scoped.hpp>
 
@@ -50,44 +51,51 @@ ModelInstance::ModelInstance(std::string const& filename, ENTRY_MDDF const*d)
   recalcExtents();
 }
 
-void ModelInstance::draw ( math::frustum const& frustum
-                         , const float& cull_distance
-                         , const math::vector_3d& camera
-                         , bool force_box
-                         , bool all_boxes
-                         , bool draw_fog
-                         , bool is_current_selection
-                         , int animtime
-                         )
+bool ModelInstance::is_visible ( math::frustum const& frustum
+                               , const float& cull_distance
+                               , const math::vector_3d& camera
+                               ) const
 {
   if(((pos - camera).length() - model->rad * scale) >= cull_distance)
-    return;
-
-  if (!frustum.intersectsSphere(pos, model->rad * scale))
-    return;
+    return false;
 
-  opengl::scoped::matrix_pusher const matrix;
+  return frustum.intersectsSphere(pos, model->rad * scale);
+}
 
-  math::matrix_4x4 const model_matrix
-    ( math::matrix_4x4 (math::matrix_4x4::translation, pos)
+math::matrix_4x4 ModelInstance::transform_matrix() const
+{
+  return math::matrix_4x4 (math::matrix_4x4::translation, pos)
     * math::matrix_4x4 ( math::matrix_4x4::rotation_yzx
                        , { math::degrees (-dir.z)
                          , math::degrees (dir.y - 90.0f)
                          , math::degrees (dir.x)
                          }
                        )
-    * math::matrix_4x4 (math::matrix_4x4::scale, scale)
-    );
+    * math::matrix_4x4 (math::matrix_4x4::scale, scale);
+}
 
-  gl.multMatrixf (model_matrix.transposed());
+void ModelInstance::draw_box ( opengl::primitives::wire_box const& wire_box
+                             , bool force_box
+                             , bool all_boxes
+                             , bool draw_fog
+                             , bool is_current_selection
+                             )
+{
+  if (!all_boxes && !is_current_selection && !force_box)
+    return;
+
+  opengl::scoped::matrix_pusher const matrix;
+
+  gl.multMatrixf (transform_matrix().transposed());
 
   if (all_boxes)
   {
-    opengl::primitives::wire_box ( TransformCoordsForModel(model->header.VertexBoxMin)
-                                 , TransformCoordsForModel(model->header.VertexBoxMax)
-                                 ).draw ({0.5f, 0.5f, 0.5f, 1.0f}, 1.0f);
+    wire_box.draw ( TransformCoordsForModel(model->header.VertexBoxMin)
+                  , TransformCoordsForModel(model->header.VertexBoxMax)
+                  , {0.5f, 0.5f, 0.5f, 1.0f}
+                  , 1.0f
+                  );
   }
-  model->draw (draw_fog, animtime);
 
   if (is_current_selection || force_box)
   {
@@ -106,15 +114,19 @@ void ModelInstance::draw ( math::frustum const& frustum
 
     math::vector_4d color = force_box ? math::vector_4d(0.0f, 0.0f, 1.0f, 1.0f) : math::vector_4d(1.0f, 1.0f, 0.0f, 1.0f);
 
-    opengl::primitives::wire_box ( TransformCoordsForModel(model->header.BoundingBoxMin)
-                                 , TransformCoordsForModel(model->header.BoundingBoxMax)
-                                 ).draw (color, 1.0f);
+    wire_box.draw ( TransformCoordsForModel(model->header.BoundingBoxMin)
+                  , TransformCoordsForModel(model->header.BoundingBoxMax)
+                  , color
+                  , 1.0f
+                  );
 
     if (is_current_selection)
     {
-      opengl::primitives::wire_box ( TransformCoordsForModel(model->header.VertexBoxMin)
-                                   , TransformCoordsForModel(model->header.VertexBoxMax)
-                                   ).draw ({1.0f, 1.0f, 1.0f, 1.0f}, 1.0f);
+      wire_box.draw ( TransformCoordsForModel(model->header.VertexBoxMin)
+                    , TransformCoordsForModel(model->header.VertexBoxMax)
+                    , {1.0f, 1.0f, 1.0f, 1.0f}
+                    , 1.0f
+                    );
 
       gl.color4fv(math::vector_4d(1.0f, 0.0f, 0.0f, 1.0f));
       gl.begin(GL_LINES);
@@ -168,40 +180,28 @@ model->draw();
 
 void ModelInstance::intersect ( math::ray const& ray
                               , selection_result* results
+                              , float& nearest
                               , int animtime
                               )
 {
-  math::matrix_4x4 const model_matrix
-    ( math::matrix_4x4 (math::matrix_4x4::translation, pos)
-    * math::matrix_4x4 ( math::matrix_4x4::rotation_yzx
-                       , { math::degrees (-dir.z)
-                         , math::degrees (dir.y - 90.0f)
-                         , math::degrees (dir.x)
-                         }
-                       )
-    * math::matrix_4x4 (math::matrix_4x4::scale, scale)
-    );
-
-  math::ray subray (model_matrix.inverted(), ray);
-
-  if ( !subray.intersect_bounds ( fixCoordSystem (model->header.VertexBoxMin)
-                                , fixCoordSystem (model->header.VertexBoxMax)
-                                )
-     )
+  if (!ray.intersect_bounds_before (extents[0], extents[1], nearest))
   {
     return;
   }
 
-  for (auto&& result : model->intersect (subray, animtime))
+  math::ray subray (transform_matrix().inverted(), ray);
+
+  //! \todo why is only sc important? these are relative to subray,
+  //! so should be inverted by model_matrix?
+  if ( auto distance = model->intersect (subray, animtime, nearest / scale))
   {
-    //! \todo why is only sc important? these are relative to subray,
-    //! so should be inverted by model_matrix?
-    results->emplace_back (result * scale, selected_model_type (this));
+    nearest = *distance * scale;
+    results->emplace_back (nearest, selected_model_type (this));
   }
 }
 
 
-void ModelInstance::draw_wmo ( const math::vector_3d& ofs
+bool ModelInstance::draw_wmo ( const math::vector_3d& ofs
                              , const math::degrees rotation
                              , math::frustum const& frustum
                              , bool draw_fog
@@ -210,7 +210,7 @@ void ModelInstance::draw_wmo ( const math::vector_3d& ofs
 {
   math::vector_3d tpos(ofs + pos);
   math::rotate (ofs.x, ofs.z, &tpos.x, &tpos.z, rotation);
-  if (!frustum.intersectsSphere(tpos, model->rad*scale)) return;
+  if (!frustum.intersectsSphere(tpos, model->rad*scale)) return false;
 
   opengl::scoped::matrix_pusher const matrix;
 
@@ -219,6 +219,8 @@ void ModelInstance::draw_wmo ( const math::vector_3d& ofs
   gl.scalef(scale, -scale, -scale);
 
   model->draw (draw_fog, animtime);
+
+  return true;
 }
 
 void ModelInstance::resetDirection(){
@@ -234,57 +236,5 @@ bool ModelInstance::isInsideRect(math::vector_3d rect[2]) const
 
 void ModelInstance::recalcExtents()
 {
-  math::vector_3d min (math::vector_3d::max()), vertex_box_min (min);
-  math::vector_3d max (math::vector_3d::min()), vertex_box_max (max);;
-  math::matrix_4x4 rot
-    ( math::matrix_4x4 (math::matrix_4x4::translation, pos)
-    * math::matrix_4x4 ( math::matrix_4x4::rotation_yzx
-                       , { math::degrees (-dir.z)
-                         , math::degrees (dir.y - 90.0f)
-                         , math::degrees (dir.x)
-                         }
-                       )
-    * math::matrix_4x4 (math::matrix_4x4::scale, scale)
-    );
-
-  math::vector_3d bounds[8 * 2];
-  math::vector_3d *ptr = bounds;
-
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMax.x, model->header.BoundingBoxMax.y, model->header.BoundingBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMin.x, model->header.BoundingBoxMax.y, model->header.BoundingBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMin.x, model->header.BoundingBoxMin.y, model->header.BoundingBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMax.x, model->header.BoundingBoxMin.y, model->header.BoundingBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMax.x, model->header.BoundingBoxMin.y, model->header.BoundingBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMax.x, model->header.BoundingBoxMax.y, model->header.BoundingBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMin.x, model->header.BoundingBoxMax.y, model->header.BoundingBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.BoundingBoxMin.x, model->header.BoundingBoxMin.y, model->header.BoundingBoxMax.z));
-
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMax.x, model->header.VertexBoxMax.y, model->header.VertexBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMin.x, model->header.VertexBoxMax.y, model->header.VertexBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMin.x, model->header.VertexBoxMin.y, model->header.VertexBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMax.x, model->header.VertexBoxMin.y, model->header.VertexBoxMin.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMax.x, model->header.VertexBoxMin.y, model->header.VertexBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMax.x, model->header.VertexBoxMax.y, model->header.VertexBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMin.x, model->header.VertexBoxMax.y, model->header.VertexBoxMax.z));
-  *ptr++ = rot * TransformCoordsForModel(math::vector_3d(model->header.VertexBoxMin.x, model->header.VertexBoxMin.y, model->header.VertexBoxMax.z));
-
-
-  for (int i = 0; i < 8 * 2; ++i)
-  {
-    misc::extract_v3d_min_max (bounds[i], min, max);
-    // vertex box only for size_cat
-    if (i >= 8)
-    {
-      misc::extract_v3d_min_max (bounds[i], vertex_box_min, vertex_box_max);
-    }
-  }
-
-  extents[0] = min;
-  extents[1] = max;
-
-  size_cat = std::max( vertex_box_max.x - vertex_box_min.x
-                     , std::max( vertex_box_max.y - vertex_box_min.y
-                               , vertex_box_max.z - vertex_box_min.z
-                               )
-                     );
-}
\ No newline at end of file
+  noggit::model_extents (model->header, pos, dir, scale, extents, size_cat);
+}
@@ -6,11 +6,13 @@
 #include <math/vector_3d.hpp> // math::vector_3d
 #include <noggit/MPQ.h> // MPQFile
 #include <noggit/MapHeaders.h> // ENTRY_MDDF
+#include <noggit/ModelHeaders.h> // ModelHeader
 #include <noggit/ModelManager.h>
 #include <noggit/Selection.h>
 #include <noggit/tile_index.hpp>
 
 namespace math { class frustum; }
+namespace opengl { namespace primitives { class wire_box; } }
 class Model;
 
 class ModelInstance
@@ -68,22 +70,28 @@ public:
     return *this;
   }
 
-  void draw ( math::frustum const& frustum
-            , const float& cull_distance
-            , const math::vector_3d& camera
-            , bool force_box
-            , bool all_boxes
-            , bool draw_fog
-            , bool is_current_selection
-            , int animtime
-            );
+  //! the model itself is drawn through noggit::model_render_queue
+  bool is_visible ( math::frustum const& frustum
+                  , const float& cull_distance
+                  , const math::vector_3d& camera
+                  ) const;
+  math::matrix_4x4 transform_matrix() const;
+  void draw_box ( opengl::primitives::wire_box const&
+                , bool force_box
+                , bool all_boxes
+                , bool draw_fog
+                , bool is_current_selection
+                );
   void drawMapTile();
   //  void drawHighlight();
+  //! only reports a hit if it is closer than \a nearest, which is updated
   void intersect ( math::ray const&
                  , selection_result*
+                 , float& nearest
                  , int animtime
                  );
-  void draw_wmo ( const math::vector_3d& ofs
+  //! returns whether the model passed frustum culling
+  bool draw_wmo ( const math::vector_3d& ofs
                 , const math::degrees
                 , math::frustum const&
                 , bool draw_fog
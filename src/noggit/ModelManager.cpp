@@ -4,30 +4,19 @@
 #include <noggit/Log.h> // LogDebug
 #include <noggit/Model.h> // Model
 #include <noggit/ModelManager.h> // ModelManager
+#include <noggit/Settings.h>
 
 #include <algorithm>
 
-namespace
+std::string ModelManager::normalized_filename (std::string filename)
 {
-  std::string normalized_filename (std::string filename)
-  {
-    filename = noggit::mpq::normalized_filename (filename);
-
-    std::size_t found;
-    if ((found = filename.rfind (".mdx")) != std::string::npos)
-    {
-      filename.replace(found, 4, ".m2");
-    }
-    else if ((found = filename.rfind (".mdl")) != std::string::npos)
-    {
-      filename.replace(found, 4, ".m2");
-    }
-
-    return filename;
-  }
+  return noggit::mpq::normalized_model_filename (filename);
 }
 
-decltype (ModelManager::_) ModelManager::_ {normalized_filename};
+decltype (ModelManager::_) ModelManager::_
+  { &ModelManager::normalized_filename
+  , [] { return Settings::getInstance()->unusedModelBudget << 20; }
+  };
 
 void ModelManager::report()
 {
@@ -38,6 +27,12 @@ void ModelManager::report()
             }
           );
   LogDebug << output;
+  LogDebug << "Models: " << _.statistics() << std::endl;
+}
+
+void ModelManager::purge_unused()
+{
+  _.purge_unused();
 }
 
 void ModelManager::resetAnim()
@@ -3,7 +3,7 @@
 #pragma once
 
 #include <noggit/Model.h>
-#include <noggit/multimap_with_normalized_key.hpp>
+#include <noggit/resource_registry.hpp>
 
 #include <map>
 #include <string>
@@ -18,36 +18,47 @@ public:
   static void updateEmitters(float dt);
 
   static void report();
+  //! frees unused models, to be called while their context is current
+  static void purge_unused();
+
+  //! the name models are loaded and saved with, .mdx and .mdl become .m2
+  static std::string normalized_filename (std::string filename);
 
 private:
   friend struct scoped_model_reference;
-  static noggit::multimap_with_normalized_key<Model> _;
+  static noggit::resource_registry<Model> _;
 };
 
 struct scoped_model_reference
 {
   scoped_model_reference (std::string const& filename)
     : _valid (true)
-    , _filename (filename)
-    , _model (ModelManager::_.emplace (_filename))
+    , _id (ModelManager::_.intern (filename))
+    , _model (ModelManager::_.acquire (_id))
   {}
 
   scoped_model_reference (scoped_model_reference const& other)
     : _valid (other._valid)
-    , _filename (other._filename)
-    , _model (ModelManager::_.emplace (_filename))
-  {}
+    , _id (other._id)
+    , _model (other._model)
+  {
+    if (_valid)
+    {
+      ModelManager::_.add_reference (_id);
+    }
+  }
   scoped_model_reference& operator= (scoped_model_reference const& other)
   {
-    _valid = other._valid;
-    _filename = other._filename;
-    _model = ModelManager::_.emplace (_filename);
+    scoped_model_reference copy (other);
+    std::swap (_valid, copy._valid);
+    std::swap (_id, copy._id);
+    std::swap (_model, copy._model);
     return *this;
   }
 
   scoped_model_reference (scoped_model_reference&& other)
     : _valid (other._valid)
-    , _filename (other._filename)
+    , _id (other._id)
     , _model (other._model)
   {
     other._valid = false;
@@ -55,9 +66,8 @@ struct scoped_model_reference
   scoped_model_reference& operator= (scoped_model_reference&& other)
   {
     std::swap (_valid, other._valid);
-    std::swap (_filename, other._filename);
+    std::swap (_id, other._id);
     std::swap (_model, other._model);
-    other._valid = false;
     return *this;
   }
 
@@ -65,7 +75,7 @@ struct scoped_model_reference
   {
     if (_valid)
     {
-      ModelManager::_.erase (_filename);
+      ModelManager::_.release (_id);
     }
   }
 
@@ -80,6 +90,6 @@ struct scoped_model_reference
 
 private:
   bool _valid;
-  std::string _filename;
+  noggit::resource_registry<Model>::id_type _id;
   Model* _model;
 };
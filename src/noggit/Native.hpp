@@ -2,8 +2,6 @@
 
 #include <string>
 
-#include <QtWidgets/QMessageBox>
-
 class Native {
 public:
     static std::string getGamePath();
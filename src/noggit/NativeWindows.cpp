@@ -68,7 +68,7 @@ std::string Native::getGamePath()
 
 	RegCloseKey(key);
 
-  QMessageBox::critical(nullptr, "Unable to load WoW", QString::fromStdString(kNotFoundMessage));
+  MessageBoxA(nullptr, kNotFoundMessage.c_str(), "Unable to load WoW", MB_OK | MB_ICONERROR);
 
 	std::string gamePath = showFileChooser();
 
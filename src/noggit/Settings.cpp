@@ -24,8 +24,14 @@ void Settings::readFromDisk()
     this->_noAntiAliasing = false;
     this->tabletMode = false;
     this->importFile = "Import.txt";
+    this->unusedTextureBudget = 256;
+    this->unusedModelBudget = 128;
+    this->unusedWMOBudget = 128;
+    this->undoMemoryLimit = 256;
 
     std::string configPath = Native::getConfigPath();
+    this->textureCachePath = (boost::filesystem::path (configPath).parent_path() / "texture_cache").string();
+    this->journalPath = (boost::filesystem::path (configPath).parent_path() / "journal").string();
     bool configFileExists = boost::filesystem::exists(configPath);
     if (!configFileExists) {
         if (createConfigFile()) {
@@ -45,6 +51,13 @@ void Settings::readFromDisk()
         config.readInto(this->tabletMode, "TabletMode");
         config.readInto(this->importFile, "ImportFile");
         config.readInto(this->wmvLogFile, "wmvLogFile");
+        config.readInto(this->textureCachePath, "TextureCachePath");
+        config.readInto(this->journalPath, "JournalPath");
+        config.readInto(this->openglChecks, "OpenGLChecks");
+        config.readInto(this->unusedTextureBudget, "UnusedTextureBudget");
+        config.readInto(this->unusedModelBudget, "UnusedModelBudget");
+        config.readInto(this->unusedWMOBudget, "UnusedWMOBudget");
+        config.readInto(this->undoMemoryLimit, "UndoMemoryLimit");
         config.readInto(this->random_tilt, "randomTilt");
         config.readInto(this->random_rotation, "randomRotation");
         config.readInto(this->random_size, "randomSize");
@@ -101,6 +114,13 @@ bool Settings::saveToDisk()
     config.add("wodSavePath", this->wodSavePath);
     config.add("ImportFile", this->importFile);
     config.add("wmvLogFile", this->wmvLogFile);
+    config.add("TextureCachePath", this->textureCachePath);
+    config.add("JournalPath", this->journalPath);
+    config.add("OpenGLChecks", this->openglChecks);
+    config.add("UnusedTextureBudget", this->unusedTextureBudget);
+    config.add("UnusedModelBudget", this->unusedModelBudget);
+    config.add("UnusedWMOBudget", this->unusedWMOBudget);
+    config.add("UndoMemoryLimit", this->undoMemoryLimit);
     config.add("mapDrawDistance", this->mapDrawDistance);
     config.add("FarZ", this->FarZ);
     config.add("randomRotation", this->random_rotation);
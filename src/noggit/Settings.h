@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include <boost/optional.hpp>
@@ -39,6 +40,16 @@ public:
   std::string wodSavePath;
   std::string importFile;
   std::string wmvLogFile;
+  std::string textureCachePath; // decoded BLPs, empty to disable
+  std::string journalPath; // unsaved edits to recover after a crash, empty to disable
+  std::string openglChecks; // full, sampled or release, empty for the build's default
+
+  // MiB of textures / models / WMOs without references kept for reuse
+  std::size_t unusedTextureBudget;
+  std::size_t unusedModelBudget;
+  std::size_t unusedWMOBudget;
+  // MiB the undo history may take
+  std::size_t undoMemoryLimit;
 
 private:
   bool _noAntiAliasing;
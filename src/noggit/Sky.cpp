@@ -23,50 +23,50 @@ SkyColor::SkyColor(int t, int col)
 
 Sky::Sky(DBCFile::Iterator data)
 {
-  pos = math::vector_3d(data->getFloat(LightDB::PositionX) / skymul, data->getFloat(LightDB::PositionY) / skymul, data->getFloat(LightDB::PositionZ) / skymul);
-  r1 = data->getFloat(LightDB::RadiusInner) / skymul;
-  r2 = data->getFloat(LightDB::RadiusOuter) / skymul;
+  pos = math::vector_3d(data->get<LightDB::PositionX>() / skymul, data->get<LightDB::PositionY>() / skymul, data->get<LightDB::PositionZ>() / skymul);
+  r1 = data->get<LightDB::RadiusInner>() / skymul;
+  r2 = data->get<LightDB::RadiusOuter>() / skymul;
 
   for (int i = 0; i<36; ++i)
     mmin[i] = -2;
 
   global = (pos.x == 0.0f && pos.y == 0.0f && pos.z == 0.0f);
 
-  int FirstId = data->getInt(LightDB::DataIDs) * NUM_SkyColorNames - 17; // cromons light fix ;) Thanks
+  int FirstId = data->get<LightDB::DataIDs>() * NUM_SkyColorNames - 17; // cromons light fix ;) Thanks
 
   for (int i = 0; i < NUM_SkyColorNames; ++i)
   {
     try
     {
       DBCFile::Record rec = gLightIntBandDB.getByID(FirstId + i);
-      int entries = rec.getInt(LightIntBandDB::Entries);
+      int entries = rec.get<LightIntBandDB::Entries>();
 
       if (entries == 0)
         mmin[i] = -1;
       else
       {
-        mmin[i] = rec.getInt(LightIntBandDB::Times);
+        mmin[i] = rec.get<LightIntBandDB::Times>();
         for (int l = 0; l < entries; l++)
         {
-          SkyColor sc(rec.getInt(LightIntBandDB::Times + l), rec.getInt(LightIntBandDB::Values + l));
+          SkyColor sc(rec.get<LightIntBandDB::Times>(l), rec.get<LightIntBandDB::Values>(l));
           colorRows[i].push_back(sc);
         }
       }
     }
     catch (...)
     {
-      LogError << "When trying to intialize sky " << data->getInt(LightDB::ID) << ", there was an error with getting an entry in a DBC (" << i << "). Sorry." << std::endl;
+      LogError << "When trying to intialize sky " << data->get<LightDB::ID>() << ", there was an error with getting an entry in a DBC (" << i << "). Sorry." << std::endl;
       DBCFile::Record rec = gLightIntBandDB.getByID(i);
-      int entries = rec.getInt(LightIntBandDB::Entries);
+      int entries = rec.get<LightIntBandDB::Entries>();
 
       if (entries == 0)
         mmin[i] = -1;
       else
       {
-        mmin[i] = rec.getInt(LightIntBandDB::Times);
+        mmin[i] = rec.get<LightIntBandDB::Times>();
         for (int l = 0; l < entries; l++)
         {
-          SkyColor sc(rec.getInt(LightIntBandDB::Times + l), rec.getInt(LightIntBandDB::Values + l));
+          SkyColor sc(rec.get<LightIntBandDB::Times>(l), rec.get<LightIntBandDB::Values>(l));
           colorRows[i].push_back(sc);
         }
       }
@@ -76,17 +76,17 @@ Sky::Sky(DBCFile::Iterator data)
 
 
   /*
-  unsigned int SKYFOG = data->getInt( LightDB::DataIDs );
-  unsigned int ID = data->getInt( LightDB::ID );
+  unsigned int SKYFOG = data->get<LightDB::DataIDs>();
+  unsigned int ID = data->get<LightDB::ID>();
   DBCFile::Record rec = gLightParamsDB.getByID( SKYFOG );
-  unsigned int skybox = rec.getInt( LightParamsDB::skybox);
+  unsigned int skybox = rec.get<LightParamsDB::skybox>();
 
 
   if ( skybox == 0 )
   alt_sky=nullptr;
   else{
   DBCFile::Record rec = gLightSkyboxDB.getByID(skybox);
-  std::string skyname= rec.getString(LightSkyboxDB::filename);
+  std::string skyname= rec.get<LightSkyboxDB::filename>();
   alt_sky=new Model(skyname); // if this is ever uncommented, use ModelManager::
   Log << "Loaded sky " << skyname << std::endl;
   }
@@ -192,7 +192,7 @@ Skies::Skies(unsigned int mapid)
 
   for (DBCFile::Iterator i = gLightDB.begin(); i != gLightDB.end(); ++i)
   {
-    if (mapid == i->getUInt(LightDB::Map))
+    if (mapid == i->get<LightDB::Map>())
     {
       Sky s(i);
       skies.push_back(s);
@@ -204,7 +204,7 @@ Skies::Skies(unsigned int mapid)
   {
     for (DBCFile::Iterator i = gLightDB.begin(); i != gLightDB.end(); ++i)
     {
-      if (0 == i->getUInt(LightDB::Map))
+      if (0 == i->get<LightDB::Map>())
       {
         Sky s(i);
         skies.push_back(s);
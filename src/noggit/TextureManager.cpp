@@ -2,6 +2,8 @@
 
 #include <noggit/TextureManager.h>
 #include <noggit/Log.h> // LogDebug
+#include <noggit/MPQ.h>
+#include <noggit/Settings.h>
 #include <opengl/context.hpp>
 #include <opengl/scoped.hpp>
 
@@ -13,7 +15,10 @@
 
 #include <algorithm>
 
-decltype (TextureManager::_) TextureManager::_;
+decltype (TextureManager::_) TextureManager::_
+  { &noggit::mpq::normalized_filename
+  , [] { return Settings::getInstance()->unusedTextureBudget << 20; }
+  };
 
 void TextureManager::report()
 {
@@ -24,172 +29,108 @@ void TextureManager::report()
             }
           );
   LogDebug << output;
+  LogDebug << "Textures: " << _.statistics() << std::endl;
+
+  auto const cache (noggit::texture_cache::current_statistics());
+  LogDebug << "Texture cache: " << cache.hits << " hits, " << cache.misses << " misses, "
+           << cache.uncached << " uncached (S3TC), " << cache.failed_writes << " failed writes, "
+           << cache.thumbnail_hits << " thumbnail hits, " << cache.thumbnail_misses << " thumbnail misses" << std::endl;
 }
 
-#include <cstdint>
-//! \todo Cross-platform syntax for packed structs.
-#pragma pack(push,1)
-struct BLPHeader
+void TextureManager::purge_unused()
 {
-  int32_t magix;
-  int32_t version;
-  uint8_t attr_0_compression;
-  uint8_t attr_1_alphadepth;
-  uint8_t attr_2_alphatype;
-  uint8_t attr_3_mipmaplevels;
-  int32_t resx;
-  int32_t resy;
-  int32_t offsets[16];
-  int32_t sizes[16];
-};
-#pragma pack(pop)
-
-#include <boost/thread.hpp>
-#include <noggit/MPQ.h>
+  _.purge_unused();
+}
 
-void blp_texture::loadFromUncompressedData(BLPHeader const* lHeader, char const* lData)
+void blp_texture::bind() const
 {
-  unsigned int const* pal = reinterpret_cast<unsigned int const*>(lData + sizeof(BLPHeader));
+  opengl::texture::bind();
 
-  unsigned char const* buf;
-  unsigned int *buf2 = new unsigned int[_width*_height];
-  unsigned int *p;
-  unsigned char const* c;
-  unsigned char const* a;
-
-  int alphabits = lHeader->attr_1_alphadepth;
-  bool hasalpha = alphabits != 0;
-
-  for (int i = 0; i<16; ++i)
+  if (!_pending.valid())
   {
-    _width = std::max(1, _width);
-    _height = std::max(1, _height);
-
-    if (lHeader->offsets[i] && lHeader->sizes[i])
-    {
-      buf = reinterpret_cast<unsigned char const*>(&lData[lHeader->offsets[i]]);
-
-      int cnt = 0;
-      p = buf2;
-      c = buf;
-      a = buf + _width*_height;
-      for (int y = 0; y<_height; y++)
-      {
-        for (int x = 0; x<_width; x++)
-        {
-          unsigned int k = pal[*c++];
-          k = ((k & 0x00FF0000) >> 16) | ((k & 0x0000FF00)) | ((k & 0x000000FF) << 16);
-          int alpha = 0xFF;
-          if (hasalpha)
-          {
-            if (alphabits == 8)
-            {
-              alpha = (*a++);
-            }
-            else if (alphabits == 1)
-            {
-              alpha = (*a & (1 << cnt++)) ? 0xff : 0;
-              if (cnt == 8)
-              {
-                cnt = 0;
-                a++;
-              }
-            }
-          }
-
-          k |= alpha << 24;
-          *p++ = k;
-        }
-      }
-
-      gl.texImage2D(GL_TEXTURE_2D, i, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf2);
-
-    }
-    else
-    {
-      return;
-    }
-
-    _width >>= 1;
-    _height >>= 1;
+    return;
   }
 
-  delete[] buf2;
+  upload (_pending.get());
+  // the decoded image isn't needed anymore
+  _pending = {};
+
+  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
-void blp_texture::loadFromCompressedData(BLPHeader const* lHeader, char const* lData)
+void blp_texture::upload (noggit::blp_image const& image) const
 {
-  //                         0 (0000) & 3 == 0                1 (0001) & 3 == 1                    7 (0111) & 3 == 3
-  const int alphatypes[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
-  const int blocksizes[] = { 8, 16, 0, 16 };
+  original_width = image.width();
+  original_height = image.height();
+  _gpu_bytes = 0;
 
-  int lTempAlphatype = lHeader->attr_2_alphatype & 3;
-  GLint format = alphatypes[lTempAlphatype];
-  int blocksize = blocksizes[lTempAlphatype];
-  format = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? (lHeader->attr_1_alphadepth == 1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT) : format;
-
-  // do every mipmap level
-  for (int i = 0; i < 16; ++i)
+  for (std::size_t i (0); i < image.levels().size(); ++i)
   {
-    _width = std::max(1, _width);
-    _height = std::max(1, _height);
+    auto const& level (image.levels()[i]);
 
-    if (lHeader->offsets[i] && lHeader->sizes[i])
+    if (image.compressed())
     {
-      gl.compressedTexImage2D(GL_TEXTURE_2D, i, format, _width, _height, 0, ((_width + 3) / 4) * ((_height + 3) / 4) * blocksize, reinterpret_cast<char const*>(lData + lHeader->offsets[i]));
+      gl.compressedTexImage2D(GL_TEXTURE_2D, i, image.format(), level.width, level.height, 0, level.size, level.data);
+      _gpu_bytes += level.size;
     }
     else
     {
-      return;
+      gl.texImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data);
+      _gpu_bytes += std::size_t (level.width) * level.height * 4;
     }
+  }
+}
 
-    _width >>= 1;
-    _height >>= 1;
+void blp_texture::finish_loading() const
+{
+  if (_pending.valid())
+  {
+    noggit::blp_image const& image (_pending.get());
+    original_width = image.width();
+    original_height = image.height();
   }
 }
 
+int blp_texture::width() const
+{
+  finish_loading();
+  return original_width;
+}
+
+int blp_texture::height() const
+{
+  finish_loading();
+  return original_height;
+}
+
+noggit::resource_memory blp_texture::memory_usage() const
+{
+  noggit::resource_memory memory;
+  memory.cpu = sizeof (*this) + _filename.capacity();
+  memory.gpu = _gpu_bytes;
+  return memory;
+}
+
 const std::string& blp_texture::filename()
 {
   return _filename;
 }
 
 blp_texture::blp_texture(const std::string& filenameArg)
+  : original_width (0)
+  , original_height (0)
+  , _gpu_bytes (0)
+  , _filename (filenameArg)
 {
-  //! \todo Unload if there already is a model loaded?
-  _filename = filenameArg;
-
-  bind();
-
-  MPQFile f(_filename);
-  if (f.isEof())
+  if (!MPQFile::exists (_filename))
   {
     LogError << "file not found: '" << _filename << "'" << std::endl;
     throw std::runtime_error ("bad filename");
   }
 
-  char const* lData = f.getPointer();
-  BLPHeader const* lHeader = reinterpret_cast<BLPHeader const*>(lData);
-  _width = original_width = lHeader->resx;
-  _height = original_height = lHeader->resy;
-
-  if (lHeader->attr_0_compression == 1)
-  {
-    loadFromUncompressedData(lHeader, lData);
-  }
-  else if (lHeader->attr_0_compression == 2)
-  {
-    loadFromCompressedData(lHeader, lData);
-  }
-  else
-  {
-    throw std::logic_error ("unimplemented BLP colorEncoding");
-  }
-
-
-  f.close();
-
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // read and decoded on a worker thread, uploaded on the first bind()
+  _pending = noggit::texture_cache::load_async (_filename).share();
 }
 
 namespace noggit
@@ -217,6 +158,7 @@ namespace noggit
 
     opengl::scoped::texture_setter<0, GL_TRUE> const texture0;
     blp_texture const texture (blp_filename);
+    texture.bind();
 
     width = width == -1 ? texture.width() : width;
     height = height == -1 ? texture.height() : height;
@@ -2,32 +2,41 @@
 
 #pragma once
 
-#include <noggit/multimap_with_normalized_key.hpp>
+#include <noggit/resource_registry.hpp>
+#include <noggit/texture_cache.hpp>
 #include <opengl/texture.hpp>
 
+#include <future>
 #include <map>
 #include <string>
 #include <vector>
 
-struct BLPHeader;
-
 struct blp_texture : public opengl::texture
 {
   blp_texture (std::string const& filename);
 
-  void loadFromUncompressedData(BLPHeader const* lHeader, char const* lData);
-  void loadFromCompressedData(BLPHeader const* lHeader, char const* lData);
+  //! uploads the image on first use, waiting for the decoder if needed.
+  //! This and the size throw whatever made reading or decoding fail.
+  virtual void bind() const override;
 
   const std::string& filename();
-  int width() const { return original_width; }
-  int height() const { return original_height; }
+  //! wait for the decoder without binding
+  int width() const;
+  int height() const;
+
+  //! the image lives on the GPU only once uploaded
+  noggit::resource_memory memory_usage() const;
 
 private:
-  int original_width;
-  int original_height;
-  int _width;
-  int _height;
+  void finish_loading() const;
+  void upload (noggit::blp_image const& image) const;
+
+  mutable int original_width;
+  mutable int original_height;
+  mutable std::size_t _gpu_bytes;
   std::string _filename;
+  //! shared so a failure is thrown again on every use instead of once
+  mutable std::shared_future<noggit::blp_image> _pending;
 };
 
 struct scoped_blp_texture_reference;
@@ -35,41 +44,48 @@ class TextureManager
 {
 public:
   static void report();
+  //! frees unused textures, to be called while their context is current
+  static void purge_unused();
 
 private:
   friend struct scoped_blp_texture_reference;
-  static noggit::multimap_with_normalized_key<blp_texture> _;
+  static noggit::resource_registry<blp_texture> _;
 };
 
 struct scoped_blp_texture_reference
 {
   scoped_blp_texture_reference (std::string const& filename)
-    : _filename (filename)
-    , _blp_texture (TextureManager::_.emplace (_filename))
+    : _id (TextureManager::_.intern (filename))
+    , _blp_texture (TextureManager::_.acquire (_id))
   {}
 
   scoped_blp_texture_reference (scoped_blp_texture_reference const& other)
-    : _filename (other._filename)
-    , _blp_texture (other._blp_texture ? TextureManager::_.emplace (_filename) : nullptr)
-  {}
+    : _id (other._id)
+    , _blp_texture (other._blp_texture)
+  {
+    if (_blp_texture)
+    {
+      TextureManager::_.add_reference (_id);
+    }
+  }
   scoped_blp_texture_reference& operator= (scoped_blp_texture_reference const& other)
   {
-    _filename = other._filename;
-    _blp_texture = other._blp_texture ? TextureManager::_.emplace (_filename) : nullptr;
+    scoped_blp_texture_reference copy (other);
+    std::swap (_id, copy._id);
+    std::swap (_blp_texture, copy._blp_texture);
     return *this;
   }
 
   scoped_blp_texture_reference (scoped_blp_texture_reference&& other)
-    : _filename (other._filename)
+    : _id (other._id)
     , _blp_texture (other._blp_texture)
   {
     other._blp_texture = nullptr;
   }
   scoped_blp_texture_reference& operator= (scoped_blp_texture_reference&& other)
   {
-    std::swap (_filename, other._filename);
+    std::swap (_id, other._id);
     std::swap (_blp_texture, other._blp_texture);
-    other._blp_texture = nullptr;
     return *this;
   }
 
@@ -77,7 +93,7 @@ struct scoped_blp_texture_reference
   {
     if (_blp_texture)
     {
-      TextureManager::_.erase (_filename);
+      TextureManager::_.release (_id);
     }
   }
 
@@ -92,11 +108,11 @@ struct scoped_blp_texture_reference
 
   bool operator== (scoped_blp_texture_reference const& other) const
   {
-    return std::tie (_filename, _blp_texture) == std::tie (other._filename, other._blp_texture);
+    return std::tie (_id, _blp_texture) == std::tie (other._id, other._blp_texture);
   }
 
 private:
-  std::string _filename;
+  noggit::resource_registry<blp_texture>::id_type _id;
   blp_texture* _blp_texture;
 };
 
@@ -32,27 +32,6 @@ void TileWater::readFromFile(MPQFile &theFile, size_t basePos)
   }
 }
 
-void TileWater::draw ( opengl::scoped::use_program& water_shader
-                     , math::vector_3d water_color_light
-                     , math::vector_3d water_color_dark
-                     , int animtime
-                     , int layer
-                     )
-{
-  for (int z = 0; z < 16; ++z)
-  {
-    for (int x = 0; x < 16; ++x)
-    {
-      chunks[z][x]->draw ( water_shader
-                         , water_color_light
-                         , water_color_dark
-                         , animtime
-                         , layer
-                         );
-    }
-  }
-}
-
 ChunkWater* TileWater::getChunk(int x, int z)
 {
   return chunks[z][x].get();
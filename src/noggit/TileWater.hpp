@@ -22,12 +22,6 @@ public:
   void readFromFile(MPQFile &theFile, size_t basePos);
   void saveToFile(sExtendableArray &lADTFile, int &lMHDR_Position, int &lCurrentPosition);
 
-  void draw ( opengl::scoped::use_program& water_shader
-            , math::vector_3d water_color_light
-            , math::vector_3d water_color_dark
-            , int animtime
-            , int layer
-            );
   bool hasData(size_t layer);
   void CropMiniChunk(int x, int z, MapChunk* chunkTerrain);
 
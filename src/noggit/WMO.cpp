@@ -3,6 +3,7 @@
 #include <math/frustum.hpp>
 #include <noggit/Log.h> // LogDebug
 #include <noggit/ModelManager.h> // ModelManager
+#include <noggit/Settings.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
 #include <noggit/WMO.h>
 #include <noggit/World.h>
@@ -10,9 +11,12 @@
 #include <opengl/scoped.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -177,7 +181,20 @@ void WMO::finishLoading ()
 
   assert (fourcc == 'MOPT');
 
-  f.seekRelative (size);
+  for (size_t i (0); i < size / 20; ++i)
+  {
+    uint16_t first_vertex, vertex_count;
+    f.read (&first_vertex, 2);
+    f.read (&vertex_count, 2);
+    // the plane is recalculated from the vertices when culling
+    f.seekRelative (16);
+
+    portals.emplace_back();
+    for (size_t v (first_vertex); v < first_vertex + vertex_count && v < portal_vertices.size(); ++v)
+    {
+      portals.back().push_back (portal_vertices[v]);
+    }
+  }
 
   // - MOPR ----------------------------------------------
 
@@ -186,7 +203,9 @@ void WMO::finishLoading ()
 
   assert(fourcc == 'MOPR');
 
-  f.seekRelative (size);
+  portal_refs.resize (size / sizeof (WMOPR));
+  f.read (portal_refs.data(), portal_refs.size() * sizeof (WMOPR));
+  f.seekRelative (size - portal_refs.size() * sizeof (WMOPR));
 
   // - MOVV ----------------------------------------------
 
@@ -303,13 +322,340 @@ void WMO::upload()
   _finished_upload = true;
 }
 
+noggit::resource_memory WMO::memory_usage() const
+{
+  noggit::resource_memory memory;
+  memory.cpu = sizeof (*this);
+  for (auto const& group : groups)
+  {
+    noggit::resource_memory const group_memory (group.memory_usage (_finished_upload));
+    memory.cpu += group_memory.cpu;
+    memory.gpu += group_memory.gpu;
+  }
+
+  // a pooled WMO keeps its textures, doodads and skybox alive, so they are
+  // charged to it, each shared one once
+  std::set<blp_texture const*> textures;
+  for (WMOMaterial const& material : mat)
+  {
+    if (material._texture)
+    {
+      textures.emplace (material._texture->get());
+    }
+  }
+  textures.erase (nullptr);
+
+  for (blp_texture const* texture : textures)
+  {
+    noggit::resource_memory const texture_memory (texture->memory_usage());
+    memory.cpu += texture_memory.cpu;
+    memory.gpu += texture_memory.gpu;
+  }
+
+  std::set<Model const*> doodads;
+  for (ModelInstance const& doodad : modelis)
+  {
+    doodads.emplace (doodad.model.get());
+  }
+  if (skybox)
+  {
+    doodads.emplace (skybox->get());
+  }
+  doodads.erase (nullptr);
+
+  for (Model const* doodad : doodads)
+  {
+    noggit::resource_memory const doodad_memory (doodad->memory_usage());
+    memory.cpu += doodad_memory.cpu;
+    memory.gpu += doodad_memory.gpu;
+  }
+
+  return memory;
+}
+
 // model.cpp
 void DrawABox(math::vector_3d pMin, math::vector_3d pMax, math::vector_4d pColor, float pLineWidth);
 
+namespace
+{
+  WMO::draw_statistics statistics = {0, 0};
+
+  //! points with a non-negative distance are inside
+  struct clip_plane
+  {
+    math::vector_3d normal;
+    float distance;
+
+    float distance_to (math::vector_3d const& point) const
+    {
+      return normal * point + distance;
+    }
+  };
+
+  std::vector<math::vector_3d> clip_polygon ( std::vector<math::vector_3d> const& polygon
+                                            , clip_plane const& plane
+                                            )
+  {
+    std::vector<math::vector_3d> clipped;
+
+    for (size_t i (0); i < polygon.size(); ++i)
+    {
+      math::vector_3d const& a (polygon[i]);
+      math::vector_3d const& b (polygon[(i + 1) % polygon.size()]);
+      float const da (plane.distance_to (a));
+      float const db (plane.distance_to (b));
+
+      if (da >= 0.0f)
+      {
+        clipped.push_back (a);
+      }
+      if ((da >= 0.0f) != (db >= 0.0f))
+      {
+        clipped.push_back (a + (b - a) * (da / (da - db)));
+      }
+    }
+
+    return clipped;
+  }
+
+  bool sphere_inside ( std::vector<clip_plane> const& planes
+                     , math::vector_3d const& position
+                     , float radius
+                     )
+  {
+    for (clip_plane const& plane : planes)
+    {
+      if (plane.distance_to (position) < -radius)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  struct portal_traversal
+  {
+    WMO const& wmo;
+    math::matrix_4x4 const& model_matrix;
+    math::frustum const& frustum;
+    math::vector_3d const& camera;
+    std::vector<std::vector<math::vector_3d>> world_portals;
+    std::vector<bool> visible;
+    std::vector<int> path;
+
+    // portal graphs have cycles and we track the path rather than the
+    // visited set, since a group may be seen through several portals
+    static std::size_t const max_depth = 32;
+
+    void enter (int group, std::vector<clip_plane> const& planes)
+    {
+      visible[group] = true;
+
+      if (path.size() >= max_depth)
+      {
+        return;
+      }
+
+      path.push_back (group);
+
+      WMOGroup const& from (wmo.groups[group]);
+      for ( size_t r (from.portal_start)
+          ; r < from.portal_start + from.portal_count && r < wmo.portal_refs.size()
+          ; ++r
+          )
+      {
+        WMOPR const& ref (wmo.portal_refs[r]);
+        if ( ref.portal < 0 || ref.portal >= int (world_portals.size())
+          || ref.group < 0 || ref.group >= int (wmo.groups.size())
+          || std::find (path.begin(), path.end(), ref.group) != path.end()
+           )
+        {
+          continue;
+        }
+
+        look_through (world_portals[ref.portal], ref.group, planes);
+      }
+
+      path.pop_back();
+    }
+
+    void look_through ( std::vector<math::vector_3d> polygon
+                      , int group
+                      , std::vector<clip_plane> const& planes
+                      )
+    {
+      if (polygon.size() < 3)
+      {
+        return;
+      }
+
+      math::vector_3d const normal
+        ((polygon[1] - polygon[0]) % (polygon[2] - polygon[0]));
+      if (normal.length_squared() == 0.0f)
+      {
+        return;
+      }
+
+      // standing in the doorway: the portal can't narrow the view
+      if (std::abs (normal.normalized() * (camera - polygon[0])) < 1.0f)
+      {
+        if (group_visible (group, planes))
+        {
+          enter (group, planes);
+        }
+        return;
+      }
+
+      for (clip_plane const& plane : planes)
+      {
+        polygon = clip_polygon (polygon, plane);
+      }
+
+      if (polygon.size() < 3)
+      {
+        return;
+      }
+
+      math::vector_3d min (polygon[0]);
+      math::vector_3d max (polygon[0]);
+      math::vector_3d centroid (0.0f, 0.0f, 0.0f);
+      for (math::vector_3d const& point : polygon)
+      {
+        min = {std::min (min.x, point.x), std::min (min.y, point.y), std::min (min.z, point.z)};
+        max = {std::max (max.x, point.x), std::max (max.y, point.y), std::max (max.z, point.z)};
+        centroid += point;
+      }
+      centroid *= 1.0f / polygon.size();
+
+      if (!frustum.intersects (min, max))
+      {
+        return;
+      }
+
+      std::vector<clip_plane> narrowed;
+      for (size_t i (0); i < polygon.size(); ++i)
+      {
+        math::vector_3d const edge_normal
+          ((polygon[i] - camera) % (polygon[(i + 1) % polygon.size()] - camera));
+        if (edge_normal.length_squared() < 1e-6f)
+        {
+          continue;
+        }
+
+        clip_plane plane {edge_normal.normalized(), 0.0f};
+        plane.distance = -(plane.normal * camera);
+        if (plane.distance_to (centroid) < 0.0f)
+        {
+          plane.normal = -plane.normal;
+          plane.distance = -plane.distance;
+        }
+        narrowed.push_back (plane);
+      }
+
+      if (group_visible (group, narrowed))
+      {
+        enter (group, narrowed);
+      }
+    }
+
+    bool group_visible (int group, std::vector<clip_plane> const& planes) const
+    {
+      WMOGroup const& g (wmo.groups[group]);
+      math::vector_3d const center ((g.VertexBoxMin + g.VertexBoxMax) * 0.5f);
+      math::vector_3d const world_center (model_matrix * center);
+      float const radius ((g.VertexBoxMax - center).length());
+
+      return frustum.intersectsSphere (world_center, radius)
+        && sphere_inside (planes, world_center, radius);
+    }
+  };
+}
+
+WMO::draw_statistics WMO::current_draw_statistics()
+{
+  return statistics;
+}
+
+void WMO::reset_draw_statistics()
+{
+  statistics = {0, 0};
+}
+
+std::vector<bool> WMO::visible_groups ( math::matrix_4x4 const& model_matrix
+                                      , math::frustum const& frustum
+                                      , math::vector_3d const& camera
+                                      ) const
+{
+  // without portals there is nothing to traverse
+  if (portals.empty() || portal_refs.empty())
+  {
+    return std::vector<bool> (groups.size(), true);
+  }
+
+  portal_traversal traversal
+    {*this, model_matrix, frustum, camera, {}, std::vector<bool> (groups.size(), false), {}};
+
+  for (auto const& portal : portals)
+  {
+    traversal.world_portals.emplace_back();
+    for (math::vector_3d const& vertex : portal)
+    {
+      traversal.world_portals.back().push_back (model_matrix * vertex);
+    }
+  }
+
+  math::vector_3d const local_camera (model_matrix.inverted() * camera);
+
+  // the smallest indoor group around the camera, nested rooms win
+  boost::optional<int> start;
+  float start_volume (std::numeric_limits<float>::max());
+
+  for (int i (0); i < int (groups.size()); ++i)
+  {
+    WMOGroup const& group (groups[i]);
+    math::vector_3d const& min (group.VertexBoxMin);
+    math::vector_3d const& max (group.VertexBoxMax);
+
+    if ( group.indoor
+      && local_camera.x >= min.x && local_camera.x <= max.x
+      && local_camera.y >= min.y && local_camera.y <= max.y
+      && local_camera.z >= min.z && local_camera.z <= max.z
+       )
+    {
+      math::vector_3d const size (max - min);
+      float const volume (size.x * size.y * size.z);
+      if (volume < start_volume)
+      {
+        start = i;
+        start_volume = volume;
+      }
+    }
+  }
+
+  if (start)
+  {
+    traversal.enter (*start, {});
+  }
+  else
+  {
+    for (int i (0); i < int (groups.size()); ++i)
+    {
+      if (!groups[i].indoor && traversal.group_visible (i, {}))
+      {
+        traversal.enter (i, {});
+      }
+    }
+  }
+
+  return traversal.visible;
+}
+
 void WMO::draw ( int doodadset
                , const math::vector_3d &ofs
                , math::degrees const angle
+               , math::matrix_4x4 const& model_matrix
                , bool boundingbox
+               , opengl::primitives::wire_box const& wire_box
                , math::frustum const& frustum
                , const float& cull_distance
                , const math::vector_3d& camera
@@ -336,8 +682,18 @@ void WMO::draw ( int doodadset
   else
     gl.disable(GL_FOG);
 
-  for (auto& group : groups)
+  std::vector<bool> const visible (visible_groups (model_matrix, frustum, camera));
+
+  for (size_t i (0); i < groups.size(); ++i)
   {
+    WMOGroup& group (groups[i]);
+
+    if (!visible[i])
+    {
+      group.visible = false;
+      continue;
+    }
+
     group.draw ( ofs
                , angle
                , frustum
@@ -384,12 +740,13 @@ void WMO::draw ( int doodadset
     gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     for (auto& group : groups)
-      opengl::primitives::wire_box (group.BoundingBoxMin, group.BoundingBoxMax)
-        .draw ({1.0f, 1.0f, 1.0f, 1.0f}, 1.0f);
+      wire_box.draw (group.BoundingBoxMin, group.BoundingBoxMax, {1.0f, 1.0f, 1.0f, 1.0f}, 1.0f);
 
-    opengl::primitives::wire_box ( math::vector_3d(extents[0].x, extents[0].z, -extents[0].y)
-                                 , math::vector_3d(extents[1].x, extents[1].z, -extents[1].y)
-                                 ).draw ({1.0f, 0.0f, 0.0f, 1.0f}, 2.0f);
+    wire_box.draw ( math::vector_3d(extents[0].x, extents[0].z, -extents[0].y)
+                  , math::vector_3d(extents[1].x, extents[1].z, -extents[1].y)
+                  , {1.0f, 0.0f, 0.0f, 1.0f}
+                  , 2.0f
+                  );
 
     /*gl.color4fv( math::vector_4d( 1.0f, 0.0f, 0.0f, 1.0f ) );
     gl.begin( GL_LINES );
@@ -418,21 +775,23 @@ void WMO::draw ( int doodadset
   }
 }
 
-std::vector<float> WMO::intersect (math::ray const& ray) const
+boost::optional<float> WMO::intersect (math::ray const& ray, float max_distance) const
 {
-  std::vector<float> results;
+  boost::optional<float> nearest;
 
   if (!finishedLoading ())
-    return results;
+    return nearest;
 
   for (auto& group : groups)
   {
-    group.intersect (ray, &results);
+    if (auto distance = group.intersect (ray, max_distance))
+    {
+      max_distance = *distance;
+      nearest = distance;
+    }
   }
 
-  std::cout << _filename << " " << results.size() << "\n";
-
-  return results;
+  return nearest;
 }
 
 bool WMO::drawSkybox ( math::vector_3d pCamera
@@ -538,6 +897,8 @@ WMOGroup::WMOGroup(WMO *_wmo, MPQFile* f, int _num, char const* names)
   : wmo(_wmo)
   , num(_num)
 {
+  portal_start = portal_count = 0;
+
   // extract group info from f
   f->read(&flags, 4);
   float ff[3];
@@ -673,6 +1034,23 @@ void WMOGroup::upload()
                                  );
 }
 
+noggit::resource_memory WMOGroup::memory_usage (bool uploaded) const
+{
+  std::size_t const vertex_data ( _vertices.size() * sizeof (*_vertices.data())
+                                + _normals.size() * sizeof (*_normals.data())
+                                + _texcoords.size() * sizeof (*_texcoords.data())
+                                + _vertex_colors.size() * sizeof (*_vertex_colors.data())
+                                );
+
+  noggit::resource_memory memory;
+  memory.cpu = sizeof (*this)
+             + vertex_data
+             + _indices.size() * sizeof (*_indices.data())
+             + _batches.size() * sizeof (*_batches.data());
+  memory.gpu = uploaded ? vertex_data : 0;
+  return memory;
+}
+
 void WMOGroup::load()
 {
   // open group file
@@ -722,6 +1100,9 @@ void WMOGroup::load()
   if (wf.r2 <= 0) fog = -1; // default outdoor fog..?
   else fog = header.fogs[0];
 
+  portal_start = header.portalStart;
+  portal_count = header.portalCount;
+
   BoundingBoxMin = ::math::vector_3d (header.box1[0], header.box1[2], -header.box1[1]);
   BoundingBoxMax = ::math::vector_3d (header.box2[0], header.box2[2], -header.box2[1]);
 
@@ -810,6 +1191,18 @@ void WMOGroup::load()
   _batches.resize (size / sizeof (wmo_batch));
   f.read (_batches.data (), size);
 
+  {
+    std::vector<::math::vector_3d> triangles;
+    for (auto&& batch : _batches)
+    {
+      for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; ++i)
+      {
+        triangles.emplace_back (_vertices[_indices[i]]);
+      }
+    }
+    _bvh = ::math::bounding_volume_hierarchy (std::move (triangles));
+  }
+
   // - MOLR ----------------------------------------------
   if (header.flags & 0x200)
   {
@@ -1029,6 +1422,7 @@ void WMOGroup::draw( const math::vector_3d& ofs
   float dist = (pos - camera).length() - rad;
   if (dist >= cull_distance) return;
   visible = true;
+  ++statistics.groups;
   setupFog (draw_fog, setup_fog);
 
   gl.vertexPointer (_vertices_buffer, 3, GL_FLOAT, 0, nullptr);
@@ -1078,29 +1472,10 @@ void WMOGroup::draw( const math::vector_3d& ofs
   }
 }
 
-void WMOGroup::intersect (math::ray const& ray, std::vector<float>* results) const
+boost::optional<float> WMOGroup::intersect (math::ray const& ray, float max_distance) const
 {
-  if (!ray.intersect_bounds (VertexBoxMin, VertexBoxMax))
-  {
-    return;
-  }
-
   //! \todo Also allow clicking on doodads and liquids.
-  for (auto&& batch : _batches)
-  {
-    for (size_t i (batch.index_start); i < batch.index_start + batch.index_count; i += 3)
-    {
-      if ( auto&& distance
-         = ray.intersect_triangle ( _vertices[_indices[i + 0]]
-                                  , _vertices[_indices[i + 1]]
-                                  , _vertices[_indices[i + 2]]
-                                  )
-         )
-      {
-        results->emplace_back (*distance);
-      }
-    }
-  }
+  return _bvh.intersect_nearest (ray, max_distance);
 }
 
 void WMOGroup::drawDoodads ( unsigned int doodadset
@@ -1142,7 +1517,10 @@ void WMOGroup::drawDoodads ( unsigned int doodadset
         WMOLight::setupOnce(GL_LIGHT2, wmo->model_nearest_light_vector[dd], mi.lcol);
       }
       setupFog (draw_fog, setup_fog);
-      wmo->modelis[dd].draw_wmo (ofs, angle, frustum, draw_fog, animtime);
+      if (wmo->modelis[dd].draw_wmo (ofs, angle, frustum, draw_fog, animtime))
+      {
+        ++statistics.doodads;
+      }
     }
   }
 
@@ -1223,7 +1601,10 @@ void WMOFog::setup()
   gl.disable(GL_FOG);
 }
 
-decltype (WMOManager::_) WMOManager::_;
+decltype (WMOManager::_) WMOManager::_
+  { &noggit::mpq::normalized_filename
+  , [] { return Settings::getInstance()->unusedWMOBudget << 20; }
+  };
 
 void WMOManager::report()
 {
@@ -1234,4 +1615,10 @@ void WMOManager::report()
             }
           );
   LogDebug << output;
+  LogDebug << "WMOs: " << _.statistics() << std::endl;
+}
+
+void WMOManager::purge_unused()
+{
+  _.purge_unused();
 }
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <math/bounding_volume_hierarchy.hpp>
+#include <math/frustum.hpp>
+#include <math/matrix_4x4.hpp>
 #include <math/quaternion.hpp>
 #include <math/ray.hpp>
 #include <math/vector_3d.hpp>
@@ -9,7 +12,7 @@
 #include <noggit/ModelInstance.h> // ModelInstance
 #include <noggit/ModelManager.h>
 #include <noggit/TextureManager.h>
-#include <noggit/multimap_with_normalized_key.hpp>
+#include <noggit/resource_registry.hpp>
 #include <noggit/wmo_liquid.hpp>
 
 #include <boost/optional.hpp>
@@ -77,7 +80,10 @@ public:
 
   void setupFog (bool draw_fog, std::function<void (bool)> setup_fog);
 
-  void intersect (math::ray const&, std::vector<float>* results) const;
+  //! nearest hit closer than max_distance
+  boost::optional<float> intersect (math::ray const&, float max_distance) const;
+
+  noggit::resource_memory memory_usage (bool uploaded) const;
 
   math::vector_3d BoundingBoxMin;
   math::vector_3d BoundingBoxMax;
@@ -90,6 +96,10 @@ public:
   bool outdoorLights;
   std::string name;
 
+  //! range of this group's references in WMO::portal_refs
+  uint16_t portal_start;
+  uint16_t portal_count;
+
 private:
   WMO *wmo;
   uint32_t flags;
@@ -109,6 +119,9 @@ private:
   std::vector<::math::vector_2d> _texcoords;
   std::vector<::math::vector_4d> _vertex_colors;
   std::vector<uint16_t> _indices;
+
+  //! built on load, group geometry is never modified
+  ::math::bounding_volume_hierarchy _bvh;
 };
 
 struct WMOLight {
@@ -160,10 +173,22 @@ class WMO : public AsyncObject
 public:
   explicit WMO(const std::string& name);
 
+  //! summed over all WMOs drawn since the last reset
+  struct draw_statistics
+  {
+    std::size_t groups;
+    std::size_t doodads;
+  };
+
+  static draw_statistics current_draw_statistics();
+  static void reset_draw_statistics();
+
   void draw ( int doodadset
             , const math::vector_3d& ofs
             , math::degrees const
+            , math::matrix_4x4 const& model_matrix
             , bool boundingbox
+            , opengl::primitives::wire_box const&
             , math::frustum const& frustum
             , const float& cull_distance
             , const math::vector_3d& camera
@@ -184,12 +209,25 @@ public:
                   ) const;
   //void drawPortals();
 
-  std::vector<float> intersect (math::ray const&) const;
+  //! groups seen from \a camera: the group containing the camera and
+  //! everything reachable through portals inside the frustum clipped by
+  //! them, or all outdoor groups and what their portals show when the
+  //! camera is outside
+  std::vector<bool> visible_groups ( math::matrix_4x4 const& model_matrix
+                                   , math::frustum const& frustum
+                                   , math::vector_3d const& camera
+                                   ) const;
+
+  boost::optional<float> intersect (math::ray const&, float max_distance) const;
 
   void finishLoading();
 
   void upload();
 
+  //! including the textures, doodad models and skybox it references,
+  //! which stay loaded as long as the WMO does, pooled or not
+  noggit::resource_memory memory_usage() const;
+
   const std::string& filename() const;
 
   bool draw_group_boundingboxes;
@@ -209,6 +247,10 @@ public:
 
   std::vector<WMOFog> fogs;
 
+  //! polygons of MOPT, in the same space as the group vertices
+  std::vector<std::vector<math::vector_3d>> portals;
+  std::vector<WMOPR> portal_refs;
+
   std::vector<WMODoodadSet> doodadsets;
 
   boost::optional<scoped_model_reference> skybox;
@@ -218,46 +260,53 @@ class WMOManager
 {
 public:
   static void report();
+  //! frees unused WMOs, to be called while their context is current
+  static void purge_unused();
 
 private:
   friend struct scoped_wmo_reference;
-  static noggit::multimap_with_normalized_key<WMO> _;
+  static noggit::resource_registry<WMO> _;
 };
 
 struct scoped_wmo_reference
 {
   scoped_wmo_reference (std::string const& filename)
     : _valid (true)
-    , _filename (filename)
-    , _wmo (WMOManager::_.emplace (_filename))
+    , _id (WMOManager::_.intern (filename))
+    , _wmo (WMOManager::_.acquire (_id))
   {}
 
   scoped_wmo_reference (scoped_wmo_reference const& other)
     : _valid (other._valid)
-    , _filename (other._filename)
-    , _wmo (WMOManager::_.emplace (_filename))
-  {}
+    , _id (other._id)
+    , _wmo (other._wmo)
+  {
+    if (_valid)
+    {
+      WMOManager::_.add_reference (_id);
+    }
+  }
   scoped_wmo_reference& operator= (scoped_wmo_reference const& other)
   {
-    _valid = other._valid;
-    _filename = other._filename;
-    _wmo = WMOManager::_.emplace (_filename);
+    scoped_wmo_reference copy (other);
+    std::swap (_valid, copy._valid);
+    std::swap (_id, copy._id);
+    std::swap (_wmo, copy._wmo);
     return *this;
   }
 
   scoped_wmo_reference (scoped_wmo_reference&& other)
     : _valid (other._valid)
-    , _filename (other._filename)
+    , _id (other._id)
     , _wmo (other._wmo)
   {
     other._valid = false;
   }
   scoped_wmo_reference& operator= (scoped_wmo_reference&& other)
   {
-    std::swap(_valid, other._valid);
-    std::swap(_filename, other._filename);
-    std::swap(_wmo, other._wmo);
-    other._valid = false;
+    std::swap (_valid, other._valid);
+    std::swap (_id, other._id);
+    std::swap (_wmo, other._wmo);
     return *this;
   }
 
@@ -265,7 +314,7 @@ struct scoped_wmo_reference
   {
     if (_valid)
     {
-      WMOManager::_.erase (_filename);
+      WMOManager::_.release (_id);
     }
   }
 
@@ -280,7 +329,6 @@ struct scoped_wmo_reference
 
 private:
   bool _valid;
-
-  std::string _filename;
+  noggit::resource_registry<WMO>::id_type _id;
   WMO* _wmo;
 };
@@ -50,6 +50,7 @@ void WMOInstance::draw ( math::frustum const& frustum
                        , const float& cull_distance
                        , const math::vector_3d& camera
                        , bool force_box
+                       , opengl::primitives::wire_box const& wire_box
                        , bool draw_doodads
                        , bool draw_fog
                        , math::vector_3d water_color_light
@@ -80,7 +81,15 @@ void WMOInstance::draw ( math::frustum const& frustum
     wmo->draw ( doodadset
               , pos
               , math::degrees (roty)
+              , math::matrix_4x4 (math::matrix_4x4::translation, pos)
+              * math::matrix_4x4 ( math::matrix_4x4::rotation_yzx
+                                 , { math::degrees (-dir.z)
+                                   , math::degrees (dir.y - 90.0f)
+                                   , math::degrees (dir.x)
+                                   }
+                                 )
               , is_selected
+              , wire_box
               , frustum
               , cull_distance
               , camera
@@ -108,7 +117,7 @@ void WMOInstance::draw ( math::frustum const& frustum
     gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     math::vector_4d color = force_box ? math::vector_4d(0.0f, 0.0f, 1.0f, 1.0f) : math::vector_4d(0.0f, 1.0f, 0.0f, 1.0f);
-    opengl::primitives::wire_box (extents[0], extents[1]).draw (color, 1.0f);
+    wire_box.draw (extents[0], extents[1], color, 1.0f);
 
     opengl::texture::set_active_texture (1);
     opengl::texture::disable_texture();
@@ -119,9 +128,12 @@ void WMOInstance::draw ( math::frustum const& frustum
   }
 }
 
-void WMOInstance::intersect (math::ray const& ray, selection_result* results)
+void WMOInstance::intersect ( math::ray const& ray
+                            , selection_result* results
+                            , float& nearest
+                            )
 {
-  if (!ray.intersect_bounds (extents[0], extents[1]))
+  if (!ray.intersect_bounds_before (extents[0], extents[1], nearest))
   {
     return;
   }
@@ -136,9 +148,10 @@ void WMOInstance::intersect (math::ray const& ray, selection_result* results)
                        )
     );
 
-  for (auto&& result : wmo->intersect ({model_matrix.inverted(), ray}))
+  if (auto distance = wmo->intersect ({model_matrix.inverted(), ray}, nearest))
   {
-    results->emplace_back (result, selected_wmo_type (this));
+    nearest = *distance;
+    results->emplace_back (nearest, selected_wmo_type (this));
   }
 }
 
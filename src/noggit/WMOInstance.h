@@ -67,6 +67,7 @@ public:
             , const float&
             , const math::vector_3d&
             , bool force_box
+            , opengl::primitives::wire_box const&
             , bool draw_doodads
             , bool draw_fog
             , math::vector_3d water_color_light
@@ -77,7 +78,8 @@ public:
             , bool world_has_skies
             , std::function<void (bool)> setup_fog
             );
-  void intersect (math::ray const&, selection_result*);
+  //! only reports a hit if it is closer than \a nearest, which is updated
+  void intersect (math::ray const&, selection_result*, float& nearest);
 
   void recalcExtents();
   void resetDirection();
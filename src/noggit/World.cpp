@@ -4,6 +4,7 @@
 #include <noggit/World.h>
 
 #include <math/frustum.hpp>
+#include <math/quantized_set.hpp>
 #include <noggit/Brush.h> // brush
 #include <noggit/ChunkWater.hpp>
 #include <noggit/ConfigFile.h>
@@ -19,6 +20,8 @@
 #include <noggit/TileWater.hpp>// tile water
 #include <noggit/WMOInstance.h> // WMOInstance
 #include <noggit/map_index.hpp>
+#include <noggit/map_maintenance.hpp>
+#include <noggit/model_render_queue.hpp>
 #include <noggit/texture_set.hpp>
 #include <noggit/tool_enums.hpp>
 #include <noggit/ui/ObjectEditor.h>
@@ -32,149 +35,68 @@
 #include <boost/thread/thread.hpp>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <ctime>
 #include <forward_list>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace
 {
-  void render_line (math::vector_3d const& p1, math::vector_3d const& p2)
+  void render_lines ( opengl::primitives::vertex_stream const& stream
+                    , std::vector<math::vector_3d> const& lines
+                    , math::vector_4d const& color
+                    )
   {
     opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth_test;
-    opengl::scoped::bool_setter<GL_LIGHTING, GL_FALSE> lighting;
 
     gl.lineWidth(2.5);
 
-    gl.begin(GL_LINES);
-    gl.vertex3fv (p1);
-    gl.vertex3fv (p2);
-    gl.end();
+    stream.draw (GL_LINES, lines, color);
   }
 
-  void draw_square(math::vector_3d const& pos, float size, float orientation)
+  void render_square ( opengl::primitives::square const& square
+                     , math::vector_3d const& pos
+                     , float radius
+                     , float orientation
+                     , math::vector_4d const& color
+                     , float inner_radius = 0.0f
+                     , bool useInnerRadius = true
+                     )
   {
-    float dx1 = size*cos(orientation) - size*sin(orientation);
-    float dx2 = size*cos(orientation + math::constants::pi / 2) - size*sin(orientation + math::constants::pi / 2);
-    float dz1 = size*sin(orientation) + size*cos(orientation);
-    float dz2 = size*sin(orientation + math::constants::pi / 2) + size*cos(orientation + math::constants::pi / 2);
-
     opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth_test;
 
-    gl.begin(GL_QUADS);
-    gl.vertex3f(pos.x + dx1, pos.y, pos.z + dz1);
-    gl.vertex3f(pos.x + dx2, pos.y, pos.z + dz2);
-    gl.vertex3f(pos.x - dx1, pos.y, pos.z - dz1);
-    gl.vertex3f(pos.x - dx2, pos.y, pos.z - dz2);
-    gl.vertex3f(pos.x + dx1, pos.y, pos.z + dz1);
-    gl.end();
-  }
-
-  void render_square(math::vector_3d const& pos, float radius, float orientation, float inner_radius = 0.0f, bool useInnerRadius = true)
-  {
-    draw_square(pos, radius, orientation);
+    square.draw (pos, radius, math::radians (orientation), color);
 
     if (useInnerRadius)
     {
-      draw_square(pos, inner_radius, orientation);
+      square.draw (pos, inner_radius, math::radians (orientation), color);
     }
   }
 
-
-  std::size_t const sphere_segments (15);
-  void draw_sphere_point (int i, int j, float radius)
-  {
-    static math::radians const drho (math::constants::pi / sphere_segments);
-    static math::radians const dtheta (2.0f * drho._);
-
-    math::radians const rho (i * drho._);
-    math::radians const theta (j * dtheta._);
-    gl.vertex3f ( math::cos (theta) * math::sin (rho) * radius
-                , math::sin (theta) * math::sin (rho) * radius
-                , math::cos (rho) * radius
-                );
-  }
-  void draw_sphere (float radius)
-  {
-    for (int i = 1; i < sphere_segments; i++)
-    {
-      gl.begin (GL_LINE_LOOP);
-      for (int j = 0; j < sphere_segments; j++)
-      {
-        draw_sphere_point (i, j, radius);
-      }
-      gl.end();
-    }
-
-    for (int j = 0; j < sphere_segments; j++)
-    {
-      gl.begin(GL_LINE_STRIP);
-      for (int i = 0; i <= sphere_segments; i++)
-      {
-        draw_sphere_point (i, j, radius);
-      }
-      gl.end();
-    }
-  }
-  void render_sphere (::math::vector_3d const& position, float radius, math::vector_4d const& color)
+  void render_sphere ( opengl::primitives::sphere const& sphere
+                     , ::math::vector_3d const& position
+                     , float radius
+                     , math::vector_4d const& color
+                     )
   {
     opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth_test;
-    opengl::scoped::bool_setter<GL_LIGHTING, GL_FALSE> lighting;
-
-    gl.color4f(color.x, color.y, color.z, color.w);
 
-    opengl::scoped::matrix_pusher matrix;
-
-    gl.multMatrixf (math::matrix_4x4 (math::matrix_4x4::translation, position).transposed());
-
-    draw_sphere (0.3f);
-    draw_sphere (radius);
-  }
-
-  void draw_disk_point (float radius, math::radians& arc, math::radians const& angle, math::radians const& orientation)
-  {
-    float x = radius * math::sin(arc);
-    float y = radius * math::cos(arc);
-    float z = (y * math::cos(orientation) + x * math::sin(orientation)) * math::tan(angle);;
-    gl.vertex3f (x, y, z);
+    sphere.draw (position, 0.3f, color);
+    sphere.draw (position, radius, color);
   }
-  void draw_disk (float radius, bool stipple, math::radians const& angle, math::radians const& orientation)
-  {
-    int const slices (std::max (35.0f, radius * 1.5f));
-    static math::radians const max (2.0f * math::constants::pi);
 
-    float const stride (max._ / slices);
-
-    if (stipple)
-    {
-      gl.enable(GL_LINE_STIPPLE);
-      gl.lineStipple(10, 0xAAAA);
-    }
-
-	  gl.lineWidth(3.0f);
-
-      gl.begin (GL_LINE_LOOP);
-      for (math::radians arc (0.0f); arc._ < max._; arc._ += stride)
-      {
-        draw_disk_point (radius, arc, angle, orientation);
-      }
-      gl.end();
-
-	  gl.lineWidth(1.0f);
-
-    if (stipple)
-    {
-      gl.disable(GL_LINE_STIPPLE);
-    }
-  }
-
-  void render_disk( ::math::vector_3d const& position
+  void render_disk( opengl::primitives::disk const& disk
+                  , opengl::primitives::sphere const& sphere
+                  , ::math::vector_3d const& position
                   , float radius
                   , math::vector_4d const& color
                   , bool stipple = false
@@ -182,30 +104,28 @@ namespace
                   , math::radians const& orientation = math::radians(0.0f)
                   )
   {
-    opengl::scoped::bool_setter<GL_LIGHTING, GL_FALSE> lighting;
-
     {
-      opengl::scoped::matrix_pusher matrix;
       opengl::scoped::bool_setter<GL_DEPTH_TEST, GL_FALSE> depth_test;
-      gl.colorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
-      opengl::scoped::bool_setter<GL_COLOR_MATERIAL, GL_TRUE> color_material;
-
-      gl.multMatrixf (math::matrix_4x4 (math::matrix_4x4::translation, position).transposed());
-      gl.multMatrixf (math::matrix_4x4 (math::matrix_4x4::rotation_xyz, math::degrees::vec3 {math::degrees (90.0f), math::degrees (0.0f), math::degrees (0.0f)}).transposed());
 
-      gl.color4f(color.x, color.y, color.z, color.w);
+      if (stipple)
+      {
+        gl.enable(GL_LINE_STIPPLE);
+        gl.lineStipple(10, 0xAAAA);
+      }
 
-      draw_disk (radius, stipple, angle, orientation);
-    }
+      gl.lineWidth(3.0f);
 
-    {
-      opengl::scoped::matrix_pusher matrix;
+      disk.draw (position, radius, color, angle, orientation);
 
-      gl.multMatrixf(math::matrix_4x4(math::matrix_4x4::translation, position).transposed());
+      gl.lineWidth(1.0f);
 
-      draw_sphere(0.3f);
+      if (stipple)
+      {
+        gl.disable(GL_LINE_STIPPLE);
+      }
     }
 
+    sphere.draw (position, 0.3f, color);
   }
 }
 
@@ -215,9 +135,9 @@ bool World::IsEditableWorld(int pMapId)
   try
   {
     DBCFile::Record map = gMapDB.getByID((unsigned int)pMapId);
-    lMapName = map.getString(MapDB::InternalName);
+    lMapName = map.get<MapDB::InternalName>();
   }
-  catch (int)
+  catch (MapDB::NotFound)
   {
     LogError << "Did not find map with id " << pMapId << ". This is NOT editable.." << std::endl;
     return false;
@@ -272,6 +192,7 @@ World::World(const std::string& name, int map_id)
   , culldistance(fogdistance)
   , skies(nullptr)
   , outdoorLightStats(OutdoorLightStats())
+  , _undo ([] { return Settings::getInstance()->undoMemoryLimit << 20; })
 {
   LogDebug << "Loading world \"" << name << "\"." << std::endl;
 }
@@ -334,8 +255,23 @@ void World::initGlobalVBOs(GLuint* pDetailTexCoords, GLuint* pAlphaTexCoords)
 
 void World::initDisplay()
 {
+  if (_display_initialized)
+  {
+    return;
+  }
+  _display_initialized = true;
+
   initGlobalVBOs(&detailtexcoords, &alphatexcoords);
 
+  _wire_box = std::make_unique<opengl::primitives::wire_box>();
+  _sphere = std::make_unique<opengl::primitives::sphere>();
+  _disk = std::make_unique<opengl::primitives::disk>();
+  _square = std::make_unique<opengl::primitives::square>();
+  _vertex_stream = std::make_unique<opengl::primitives::vertex_stream>();
+
+  _chunk_texture_quads = std::make_unique<opengl::scoped::buffers<1>>();
+  MapChunk::upload_texture_quads ((*_chunk_texture_quads)[0]);
+
   mapIndex.setAdt(false);
 
   if (mapIndex.hasAGlobalWMO())
@@ -467,15 +403,13 @@ void World::draw ( math::vector_3d const& cursor_pos
                  , int water_layer
                  )
 {
-  if (!_display_initialized)
-  {
-    initDisplay();
-    _display_initialized = true;
-  }
+  initDisplay();
 
   math::frustum const frustum
     (::opengl::matrix::model_view() * ::opengl::matrix::projection());
 
+  update_visible_terrain (frustum, culldistance, camera_pos);
+
   bool hadSky = false;
   if (draw_wmo || mapIndex.hasAGlobalWMO())
   {
@@ -526,8 +460,14 @@ void World::draw ( math::vector_3d const& cursor_pos
   setupFog (draw_fog);
 
   // Draw verylowres heightmap
+  if (_horizon_render && _horizon_render_outdated)
+  {
+    _horizon_render = std::make_unique<noggit::map_horizon::render> (horizon);
+    _horizon_render_outdated = false;
+  }
+
   if (draw_fog && draw_terrain) {
-    _horizon_render->draw (&mapIndex, skies->colorSet[FOG_COLOR], culldistance, frustum, camera_pos);
+    _horizon_render->draw (skies->colorSet[FOG_COLOR], _visible_chunks, camera_pos);
   }
 
   // Draw height map
@@ -564,23 +504,22 @@ void World::draw ( math::vector_3d const& cursor_pos
   // height map w/ a zillion texture passes
   if (draw_terrain)
   {
-    for (MapTile* tile : mapIndex.loaded_tiles())
+    gl.color4f(1, 1, 1, 1);
+
+    for (MapChunk* chunk : _visible_chunks)
     {
-      tile->draw ( frustum
-                 , culldistance
-                 , camera_pos
-                 , show_unpaintable_chunks
-                 , draw_contour
-                 , draw_paintability_overlay
-                 , draw_chunk_flag_overlay
-                 , draw_areaid_overlay
-                 , draw_wireframe
-                 , cursor_type
-                 , area_id_colors
-                 , math::vector_4d {skies->colorSet[WATER_COLOR_DARK] * 0.3f, 1.f}
-                 , mCurrentSelection
-                 , animtime
-                 );
+      chunk->draw ( show_unpaintable_chunks
+                  , draw_contour
+                  , draw_paintability_overlay
+                  , draw_chunk_flag_overlay
+                  , draw_areaid_overlay
+                  , draw_wireframe
+                  , cursor_type
+                  , area_id_colors
+                  , math::vector_4d {skies->colorSet[WATER_COLOR_DARK] * 0.3f, 1.f}
+                  , mCurrentSelection
+                  , animtime
+                  );
     }
   }
 
@@ -594,27 +533,30 @@ void World::draw ( math::vector_3d const& cursor_pos
     //gl.depthMask(false);
     //gl.disable(GL_DEPTH_TEST);
 
+    // drawn in one go after the shapes
+    std::vector<math::vector_3d> cursor_lines;
+
     if (terrainMode == editing_mode::ground && ground_editing_brush == eTerrainType_Quadra)
     {
-      render_square(cursor_pos, brushRadius / 2.0f, 0.0f, brushRadius / 2.0f * innerRadius, true);
+      render_square(*_square, cursor_pos, brushRadius / 2.0f, 0.0f, {1.0f, 1.0f, 1.0f, 1.0f}, brushRadius / 2.0f * innerRadius, true);
     }
     else
     {
       if (cursor_type == 1)
       {
-        render_disk(cursor_pos, brushRadius, cursor_color);
+        render_disk(*_disk, *_sphere, cursor_pos, brushRadius, cursor_color);
         if (innerRadius >= 0.01f)
         {
-          render_disk(cursor_pos, brushRadius * innerRadius, cursor_color, true);
+          render_disk(*_disk, *_sphere, cursor_pos, brushRadius * innerRadius, cursor_color, true);
         }
         if (hardness >= 0.01f)
         {
-          render_disk(cursor_pos, brushRadius * hardness, cursor_color, true);
+          render_disk(*_disk, *_sphere, cursor_pos, brushRadius * hardness, cursor_color, true);
         }
       }
       else if (cursor_type == 2)
       {
-        render_sphere(cursor_pos, brushRadius, cursor_color);
+        render_sphere(*_sphere, cursor_pos, brushRadius, cursor_color);
       }
     }
     if (angled_mode && !use_ref_pos)
@@ -625,14 +567,12 @@ void World::draw ( math::vector_3d const& cursor_pos
       float h = brushRadius * tan(math::degrees(angle));
       math::vector_3d const dest1 = cursor_pos + math::vector_3d(x, 0.f, z);
       math::vector_3d const dest2 = cursor_pos + math::vector_3d(x, h, z);
-      render_line(cursor_pos, dest1);
-      render_line(cursor_pos, dest2);
-      render_line(dest1, dest2);
+      cursor_lines.insert (cursor_lines.end(), {cursor_pos, dest1, cursor_pos, dest2, dest1, dest2});
     }
 
     if (use_ref_pos)
     {
-      render_sphere(ref_pos, 1.0f, cursor_color);
+      render_sphere(*_sphere, ref_pos, 1.0f, cursor_color);
 
       math::vector_3d pos = cursor_pos;
 
@@ -641,19 +581,19 @@ void World::draw ( math::vector_3d const& cursor_pos
         // orient + 90.0f because of the rotation done in render_disk
         math::degrees a(angle), o(orientation+90.0f);
         pos.y = misc::angledHeight(ref_pos, pos, a, math::degrees(orientation));
-        render_disk(pos, brushRadius, cursor_color, false, a, o);
-        render_line(ref_pos, cursor_pos);
-        render_line(ref_pos, pos);
+        render_disk(*_disk, *_sphere, pos, brushRadius, cursor_color, false, a, o);
+        cursor_lines.insert (cursor_lines.end(), {ref_pos, cursor_pos, ref_pos, pos});
       }
       else
       {
         pos.y = ref_pos.y;
-        render_disk(pos, brushRadius, cursor_color);
+        render_disk(*_disk, *_sphere, pos, brushRadius, cursor_color);
       }
 
-      render_line(cursor_pos, pos);
+      cursor_lines.insert (cursor_lines.end(), {cursor_pos, pos});
     }
 
+    render_lines (*_vertex_stream, cursor_lines, cursor_color);
 
     gl.enable(GL_CULL_FACE);
     gl.enable(GL_DEPTH_TEST);
@@ -666,18 +606,23 @@ void World::draw ( math::vector_3d const& cursor_pos
   {
     float size = (vertexCenter() - camera_pos).length();
     gl.pointSize(std::max(0.001f, 10.0f - (1.25f * size / CHUNKSIZE)));
-    gl.color3f(1.0f, 0.0f, 0.0f);
-    gl.begin(GL_POINTS);
 
-    for (math::vector_3d const* pos : _vertices_selected)
+    std::vector<math::vector_3d> points;
+    points.reserve (_vertex_count);
+    for (auto const& selected : _vertices_selected)
     {
-      gl.vertex3f(pos->x, pos->y + 0.1f, pos->z);
+      for (int i = 0; i < mapbufsize; ++i)
+      {
+        if (selected.second[i])
+        {
+          math::vector_3d const pos (selected.first->vertex (i));
+          points.emplace_back (pos.x, pos.y + 0.1f, pos.z);
+        }
+      }
     }
-    gl.end();
+    _vertex_stream->draw (GL_POINTS, points, {1.0f, 0.0f, 0.0f, 1.0f});
 
-    gl.color3f(0.0f, 0.0f, 1.0f);
-    render_sphere(vertexCenter(), 2.0f, cursor_color);
-    gl.color3f(1.0f, 1.0f, 1.0f);
+    render_sphere(*_sphere, vertexCenter(), 2.0f, cursor_color);
   }
 
 
@@ -719,9 +664,9 @@ void main()
     line_shader.uniform ("projection", opengl::matrix::projection());
 
     setupFog (draw_fog);
-    for (MapTile* tile : mapIndex.loaded_tiles())
+    for (MapChunk* chunk : _visible_chunks)
     {
-      tile->drawLines (line_shader, frustum, culldistance, camera_pos, draw_hole_lines);
+      chunk->drawLines (line_shader, draw_hole_lines);
     }
   }
 
@@ -804,22 +749,39 @@ void main()
       ModelManager::resetAnim();
 
     gl.enable(GL_LIGHTING);  //! \todo  Is this needed? Or does this fuck something up?
+
+    boost::optional<unsigned int> const selected_uid
+      ( IsSelection (eEntry_Model)
+      ? boost::optional<unsigned int> (boost::get<selected_model_type> (*GetCurrentSelection())->uid)
+      : boost::none
+      );
+
+    std::vector<ModelInstance*> visible_models;
+    noggit::model_render_queue queue (opengl::matrix::model_view());
+
     for (std::map<int, ModelInstance>::iterator it = mModelInstances.begin(); it != mModelInstances.end(); ++it)
     {
-      bool const is_hidden (hidden_models.count (it->second.model.get()));
-      if (!is_hidden)
+      if ( !hidden_models.count (it->second.model.get())
+        && it->second.is_visible (frustum, culldistance, camera_pos)
+         )
       {
-        it->second.draw ( frustum
-                        , culldistance
-                        , camera_pos
-                        , is_hidden
-                        , draw_models_with_box
-                        , draw_fog
-                        , IsSelection (eEntry_Model) && boost::get<selected_model_type> (*GetCurrentSelection())->uid == it->second.uid
-                        , animtime
-                        );
+        queue.add (it->second, (it->second.pos - camera_pos).length());
+        visible_models.emplace_back (&it->second);
       }
     }
+
+    queue.draw (draw_fog, animtime);
+    model_draw_statistics = queue.current_statistics();
+
+    for (ModelInstance* instance : visible_models)
+    {
+      instance->draw_box ( *_wire_box
+                         , false
+                         , draw_models_with_box
+                         , draw_fog
+                         , selected_uid && *selected_uid == instance->uid
+                         );
+    }
   }
 
 
@@ -842,6 +804,7 @@ void main()
                         , culldistance
                         , camera_pos
                         , is_hidden
+                        , *_wire_box
                         , draw_wmo_doodads
                         , draw_fog
                         , skies->colorSet[WATER_COLOR_LIGHT]
@@ -874,15 +837,78 @@ void main()
     water_shader.uniform ("model_view", opengl::matrix::model_view());
     water_shader.uniform ("projection", opengl::matrix::projection());
 
-    for (MapTile* tile : mapIndex.loaded_tiles())
+    gl.disable(GL_COLOR_MATERIAL);
+    gl.disable(GL_LIGHTING);
+
+    for (ChunkWater* water : _visible_water_chunks)
+    {
+      water->draw ( water_shader
+                  , skies->colorSet[WATER_COLOR_LIGHT]
+                  , skies->colorSet[WATER_COLOR_DARK]
+                  , animtime
+                  , water_layer
+                  );
+    }
+
+    gl.enable(GL_LIGHTING);
+    gl.enable(GL_COLOR_MATERIAL);
+  }
+}
+
+void World::update_visible_terrain ( math::frustum const& frustum
+                                   , float cull_distance
+                                   , math::vector_3d const& camera
+                                   )
+{
+  _visible_chunks.clear();
+  _visible_water_chunks.clear();
+
+  for (MapTile* tile : mapIndex.loaded_tiles())
+  {
+    tile->collect_visible_chunks
+      (frustum, cull_distance, camera, _visible_chunks, _visible_water_chunks);
+  }
+
+  // neighbours are looked up even if culled, both sides of an edge have
+  // to agree on its resolution. unloaded ones are covered by the horizon.
+  auto const neighbour_level
+    ( [&] (MapChunk const* chunk, float dx, float dz)
+      {
+        math::vector_3d const pos ( chunk->xbase + CHUNKSIZE * (0.5f + dx)
+                                  , 0.0f
+                                  , chunk->zbase + CHUNKSIZE * (0.5f + dz)
+                                  );
+        tile_index const index (pos);
+        if (!mapIndex.tileLoaded (index))
+        {
+          return MapChunk::lod_levels - 1;
+        }
+
+        MapTile* tile (mapIndex.getTile (index));
+        MapChunk const* neighbour
+          (tile->getChunk ((pos.x - tile->xbase) / CHUNKSIZE, (pos.z - tile->zbase) / CHUNKSIZE));
+        return neighbour->lod_level (cull_distance, camera);
+      }
+    );
+
+  for (MapChunk* chunk : _visible_chunks)
+  {
+    int const level (chunk->lod_level (cull_distance, camera));
+    int const neighbour_levels[4] = { neighbour_level (chunk, 0.0f, -1.0f)
+                                    , neighbour_level (chunk, 0.0f, 1.0f)
+                                    , neighbour_level (chunk, -1.0f, 0.0f)
+                                    , neighbour_level (chunk, 1.0f, 0.0f)
+                                    };
+
+    std::array<int, 4> edge_steps;
+    for (int edge (0); edge < 4; ++edge)
     {
-      tile->drawWater ( water_shader
-                      , skies->colorSet[WATER_COLOR_LIGHT]
-                      , skies->colorSet[WATER_COLOR_DARK]
-                      , animtime
-                      , water_layer
-                      );
+      edge_steps[edge] = std::max ( MapChunk::lod_edge_step (level)
+                                  , MapChunk::lod_edge_step (neighbour_levels[edge])
+                                  );
     }
+
+    chunk->set_lod (level, edge_steps);
   }
 }
 
@@ -897,17 +923,24 @@ selection_result World::intersect ( math::ray const& ray
                                   )
 {
   selection_result results;
+  float nearest (std::numeric_limits<float>::max());
 
+  // terrain first: it is cheap and gives a good bound to skip most objects
   if (draw_terrain)
   {
     for (auto&& tile : mapIndex.loaded_tiles())
     {
-      tile->intersect (ray, &results);
+      tile->intersect (ray, &results, nearest);
     }
   }
 
   if (!pOnlyMap && do_objects)
   {
+    // test instances front to back so that the ones behind the nearest hit
+    // so far don't need to transform the ray at all
+    std::vector<std::pair<float, ModelInstance*>> models;
+    std::vector<std::pair<float, WMOInstance*>> wmos;
+
     if (draw_models)
     {
       for (auto&& model_instance : mModelInstances)
@@ -915,7 +948,14 @@ selection_result World::intersect ( math::ray const& ray
         bool const is_hidden (hidden_models.count (model_instance.second.model.get()));
         if (!is_hidden)
         {
-          model_instance.second.intersect (ray, &results, animtime);
+          if ( auto distance = ray.intersect_bounds_before ( model_instance.second.extents[0]
+                                                           , model_instance.second.extents[1]
+                                                           , nearest
+                                                           )
+             )
+          {
+            models.emplace_back (*distance, &model_instance.second);
+          }
         }
       }
     }
@@ -927,10 +967,39 @@ selection_result World::intersect ( math::ray const& ray
         bool const is_hidden (hidden_map_objects.count (wmo_instance.second.wmo.get()));
         if (!is_hidden)
         {
-          wmo_instance.second.intersect (ray, &results);
+          if ( auto distance = ray.intersect_bounds_before ( wmo_instance.second.extents[0]
+                                                           , wmo_instance.second.extents[1]
+                                                           , nearest
+                                                           )
+             )
+          {
+            wmos.emplace_back (*distance, &wmo_instance.second);
+          }
         }
       }
     }
+
+    auto const by_distance
+      ( [] (auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+    std::sort (models.begin(), models.end(), by_distance);
+    std::sort (wmos.begin(), wmos.end(), by_distance);
+
+    auto model (models.begin());
+    auto wmo (wmos.begin());
+
+    while ( (model != models.end() && model->first < nearest)
+         || (wmo != wmos.end() && wmo->first < nearest)
+          )
+    {
+      if (wmo == wmos.end() || (model != models.end() && model->first < wmo->first))
+      {
+        (model++)->second->intersect (ray, &results, nearest, animtime);
+      }
+      else
+      {
+        (wmo++)->second->intersect (ray, &results, nearest);
+      }
+    }
   }
 
   return results;
@@ -956,7 +1025,7 @@ void World::clearHeight(math::vector_3d const& pos)
     chunk->clearHeight();
   });
   for_all_chunks_on_tile(pos, [this] (MapChunk* chunk) {
-      recalc_norms (chunk);
+      heights_changed (chunk);
   });
 }
 
@@ -1014,6 +1083,8 @@ void World::drawTileMode ( float /*ah*/
                          , float aspect_ratio
                          )
 {
+  initDisplay();
+
   gl.clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
   gl.enable(GL_BLEND);
 
@@ -1039,7 +1110,7 @@ void World::drawTileMode ( float /*ah*/
 
     for (MapTile* tile : mapIndex.loaded_tiles())
     {
-      tile->drawTextures (minX, minY, maxX, maxY, animtime);
+      tile->drawTextures (minX, minY, maxX, maxY, animtime, (*_chunk_texture_quads)[0]);
     }
 
     gl.disableClientState(GL_COLOR_ARRAY);
@@ -1101,6 +1172,7 @@ template<typename Fun>
   {
     for (MapChunk* chunk : tile->chunks_in_range (pos, radius))
     {
+      _undo.record (chunk);
       if (fun (chunk))
       {
         changed = true;
@@ -1160,7 +1232,7 @@ void World::changeTerrain(math::vector_3d const& pos, float change, float radius
       }
     , [this] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        heights_changed (chunk);
       }
     );
 }
@@ -1175,7 +1247,7 @@ void World::flattenTerrain(math::vector_3d const& pos, float remain, float radiu
       }
     , [this] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        heights_changed (chunk);
       }
     );
 }
@@ -1200,11 +1272,21 @@ void World::blurTerrain(math::vector_3d const& pos, float remain, float radius,
       }
     , [this] (MapChunk* chunk)
       {
-        recalc_norms (chunk);
+        heights_changed (chunk);
       }
     );
 }
 
+void World::heights_changed (MapChunk* chunk)
+{
+  recalc_norms (chunk);
+
+  if (_vertices_selected.count (chunk))
+  {
+    _vertex_sum_outdated = true;
+  }
+}
+
 void World::recalc_norms (MapChunk* chunk) const
 {
   chunk->recalcNorms ( [this] (float x, float z) -> boost::optional<float>
@@ -1277,7 +1359,9 @@ template<typename Fun>
   {
     for (size_t tx = 0; tx < 16; ++tx)
     {
-      fun (tile->getChunk (ty, tx));
+      MapChunk* chunk (tile->getChunk (ty, tx));
+      _undo.record (chunk);
+      fun (chunk);
     }
   }
 }
@@ -1288,7 +1372,9 @@ template<typename Fun>
     MapTile* tile(mapIndex.getTile(pos));
     mapIndex.setChanged(tile);
 
-    return fun(tile->getChunk((pos.x - tile->xbase) / CHUNKSIZE, (pos.z - tile->zbase) / CHUNKSIZE));
+    MapChunk* chunk (tile->getChunk((pos.x - tile->xbase) / CHUNKSIZE, (pos.z - tile->zbase) / CHUNKSIZE));
+    _undo.record (chunk);
+    return fun(chunk);
   }
 
 template<typename Fun>
@@ -1323,90 +1409,69 @@ void World::convert_alphamap(bool to_big_alpha)
     return;
   }
 
+  // the tiles are converted as saved, without loading them
+  mapIndex.saveChanged (this);
+
+  std::vector<tile_index> tiles;
   for (size_t z = 0; z < 64; z++)
   {
     for (size_t x = 0; x < 64; x++)
     {
-      tile_index tile(x, z);
-
-      bool unload = !mapIndex.tileLoaded(tile);
-
-      MapTile* mTile = mapIndex.loadTile(tile);
-
-      if (mTile)
+      if (mapIndex.hasTile (tile_index (x, z)))
       {
-        mTile->convert_alphamap(to_big_alpha);
-        mTile->saveTile (false, this);
-        mapIndex.markOnDisc (tile, true);
-        mapIndex.unsetChanged(tile);
-
-        if (unload)
-        {
-          mapIndex.unloadTile(tile);
-        }
+        tiles.emplace_back (x, z);
       }
     }
   }
 
-  mapIndex.convert_alphamap(to_big_alpha);
-  mapIndex.save();
-}
-
-void World::saveMap (int width, int height)
-{
-  //! \todo  Output as BLP.
-  unsigned char image[256 * 256 * 3];
-  MapTile *ATile;
-  FILE *fid;
-  gl.enable(GL_BLEND);
-  gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  gl.readBuffer(GL_BACK);
-
-  float minX = -64 * 16;
-  float maxX = 64 * 16;
-  float minY = -64 * 16;
-  float maxY = 64 * 16;
-
-  gl.enableClientState(GL_COLOR_ARRAY);
-  gl.disableClientState(GL_NORMAL_ARRAY);
-  gl.disableClientState(GL_TEXTURE_COORD_ARRAY);
-
-  for (int y = 0; y<64; y++)
+  bool failed (false);
+  for ( noggit::tile_maintenance_result const& result
+      : noggit::map_maintenance::convert_alphamaps (basename, tiles, mapIndex.hasBigAlpha(), to_big_alpha, 0)
+      )
   {
-    for (int x = 0; x<64; x++)
+    if (!result.error.empty())
     {
-      tile_index tile(x, y);
-
-      if (!mapIndex.hasTile(tile))
-      {
-        continue;
-      }
-
-      ATile = mapIndex.loadTile(tile);
-      gl.clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+      LogError << "convert_alphamap: tile " << result.tile.x << "_" << result.tile.z
+               << " " << result.error << "." << std::endl;
+      failed = true;
+    }
+  }
 
-      opengl::scoped::matrix_pusher const matrix;
-      gl.scalef(0.08333333f, 0.08333333f, 1.0f);
+  if (failed)
+  {
+    LogError << "convert_alphamap: the map is left as it was." << std::endl;
+    return;
+  }
 
-      //gl.translatef(-camera_pos.x/CHUNKSIZE,-camera_pos.z/CHUNKSIZE,0);
-      gl.translatef(x * -16.0f - 8.0f, y * -16.0f - 8.0f, 0.0f);
+  mapIndex.convert_alphamap(to_big_alpha);
+  mapIndex.save();
 
+  // read the loaded tiles again in the new format
+  std::vector<tile_index> loaded;
+  for (MapTile* tile : mapIndex.loaded_tiles())
+  {
+    loaded.emplace_back (tile->index);
+  }
 
-      ATile->drawTextures (minX, minY, maxX, maxY, animtime);
-      gl.readPixels(width / 2 - 128, height / 2 - 128, 256, 256, GL_RGB, GL_UNSIGNED_BYTE, image);
+  for (tile_index const& tile : loaded)
+  {
+    mapIndex.unloadTile (tile);
+    mapIndex.loadTile (tile);
+  }
+}
 
-      std::stringstream ss;
-      ss << basename.c_str() << "_map_" << x << "_" << y << ".raw";
-      fid = fopen(ss.str().c_str(), "wb");
-      fwrite(image, 256 * 3, 256, fid);
-      fclose(fid);
-    }
+void World::update_horizon (std::vector<tile_index> const& tiles)
+{
+  if (tiles.empty())
+  {
+    return;
   }
 
-  gl.disableClientState(GL_COLOR_ARRAY);
+  horizon.update_tiles (tiles);
+  horizon.save();
 
-  gl.enableClientState(GL_NORMAL_ARRAY);
-  gl.enableClientState(GL_TEXTURE_COORD_ARRAY);
+  // no context here, the render is recreated on the next draw
+  _horizon_render_outdated = true;
 }
 
 void World::deleteModelInstance(int pUniqueID)
@@ -1415,6 +1480,10 @@ void World::deleteModelInstance(int pUniqueID)
   if (it == mModelInstances.end()) return;
 
   updateTilesModel(&it->second);
+  if (_journal)
+  {
+    _journal->removed (it->second);
+  }
   mModelInstances.erase(it);
   ResetSelection();
 }
@@ -1425,6 +1494,10 @@ void World::deleteWMOInstance(int pUniqueID)
   if (it == mWMOInstances.end()) return;
 
   updateTilesWMO(&it->second);
+  if (_journal)
+  {
+    _journal->removed (it->second);
+  }
   mWMOInstances.erase(it);
   ResetSelection();
 }
@@ -1434,35 +1507,42 @@ void World::delete_duplicate_model_and_wmo_instances()
   std::unordered_set<int> wmos_to_remove;
   std::unordered_set<int> models_to_remove;
 
-  for (auto lhs(mWMOInstances.begin()); lhs != mWMOInstances.end(); ++lhs)
+  // same tolerance as MapIndex::fixUIDs
+  float const epsilon (0.0001f);
+  float const cell_size (1.0f);
+
   {
-    for (auto rhs(std::next(lhs)); rhs != mWMOInstances.end(); ++rhs)
+    math::quantized_set<6, std::string> wmos (epsilon, cell_size);
+    wmos.reserve (mWMOInstances.size());
+
+    for (auto&& instance : mWMOInstances)
     {
-      assert(lhs->first != rhs->first);
+      WMOInstance const& wmo (instance.second);
 
-      if ( lhs->second.pos == rhs->second.pos
-        && lhs->second.dir == rhs->second.dir
-        && lhs->second.wmo->_filename == rhs->second.wmo->_filename
+      if (!wmos.insert ( wmo.wmo->_filename
+                       , {{wmo.pos.x, wmo.pos.y, wmo.pos.z, wmo.dir.x, wmo.dir.y, wmo.dir.z}}
+                       )
          )
       {
-        wmos_to_remove.emplace(rhs->second.mUniqueID);
+        wmos_to_remove.emplace (wmo.mUniqueID);
       }
     }
   }
 
-  for (auto lhs(mModelInstances.begin()); lhs != mModelInstances.end(); ++lhs)
   {
-    for (auto rhs(std::next(lhs)); rhs != mModelInstances.end(); ++rhs)
+    math::quantized_set<6, std::pair<std::string, float>> models (epsilon, cell_size);
+    models.reserve (mModelInstances.size());
+
+    for (auto&& instance : mModelInstances)
     {
-      assert(lhs->first != rhs->first);
+      ModelInstance const& model (instance.second);
 
-      if ( lhs->second.pos == rhs->second.pos
-        && lhs->second.dir == rhs->second.dir
-        && lhs->second.scale == rhs->second.scale
-        && lhs->second.model->_filename == rhs->second.model->_filename
-        )
+      if (!models.insert ( {model.model->_filename, model.scale}
+                         , {{model.pos.x, model.pos.y, model.pos.z, model.dir.x, model.dir.y, model.dir.z}}
+                         )
+         )
       {
-        models_to_remove.emplace(rhs->second.uid);
+        models_to_remove.emplace (model.uid);
       }
     }
   }
@@ -1518,6 +1598,10 @@ void World::addM2 ( std::string const& filename
 
   newModelis.recalcExtents();
   updateTilesModel(&newModelis);
+  if (_journal)
+  {
+    _journal->placed (newModelis, newModelis.pos);
+  }
   mModelInstances.emplace(newModelis.uid, newModelis);
 }
 
@@ -1535,6 +1619,10 @@ void World::addWMO ( std::string const& filename
   // recalc the extends
   newWMOis.recalcExtents();
   updateTilesWMO(&newWMOis);
+  if (_journal)
+  {
+    _journal->placed (newWMOis, newWMOis.pos);
+  }
 
   mWMOInstances.emplace(newWMOis.mUniqueID, newWMOis);
 }
@@ -1545,6 +1633,10 @@ void World::reload_tile(tile_index const& tile)
   // to remove the new models and reload the old ones
   clearAllModelsOnADT(tile);
   mapIndex.reloadTile(tile);
+  if (_journal)
+  {
+    _journal->tile_reloaded (tile);
+  }
 }
 
 void World::updateTilesEntry(selection_type const& entry)
@@ -1561,24 +1653,28 @@ void World::updateTilesEntry(selection_type const& entry)
 
 void World::updateTilesWMO(WMOInstance* wmo)
 {
+  _undo.record (wmo);
+
   tile_index start(wmo->extents[0]), end(wmo->extents[1]);
   for (int z = start.z; z <= end.z; ++z)
   {
     for (int x = start.x; x <= end.x; ++x)
     {
-      mapIndex.setChanged(tile_index(x, z));
+      mapIndex.setChanged(tile_index(x, z), tile_objects);
     }
   }
 }
 
 void World::updateTilesModel(ModelInstance* m2)
 {
+  _undo.record (m2);
+
   tile_index start(m2->extents[0]), end(m2->extents[1]);
   for (int z = start.z; z <= end.z; ++z)
   {
     for (int x = start.x; x <= end.x; ++x)
     {
-      mapIndex.setChanged(tile_index(x, z));
+      mapIndex.setChanged(tile_index(x, z), tile_objects);
     }
   }
 }
@@ -1747,13 +1843,13 @@ void World::fixAllGaps()
     }
     if (tileChanged)
     {
-      mapIndex.setChanged(tile);
+      mapIndex.setChanged(tile, tile_terrain);
     }
   }
 
   for (MapChunk* chunk : chunks)
   {
-    recalc_norms (chunk);
+    heights_changed (chunk);
   }
 }
 
@@ -1775,48 +1871,67 @@ bool World::isUnderMap(math::vector_3d const& pos)
 
 void World::selectVertices(math::vector_3d const& pos, float radius)
 {
-  _vertex_center_updated = false;
   _vertex_border_updated = false;
 
   for_all_chunks_in_range(pos, radius, [&](MapChunk* chunk){
-    _vertex_chunks.emplace(chunk);
+    vertex_selection const added
+      (chunk->vertices_in_range (pos, radius, true) & ~_vertices_selected[chunk]);
+
+    if (added.none())
+    {
+      if (_vertices_selected[chunk].none())
+      {
+        _vertices_selected.erase (chunk);
+      }
+      return true;
+    }
+
+    _vertices_selected[chunk] |= added;
     _vertex_tiles.emplace(chunk->mt);
-    chunk->selectVertex(pos, radius, _vertices_selected);
+    _vertex_sum += chunk->sum_of_vertices (added);
+    _vertex_count += added.count();
     return true;
   });
+
+  updateVertexCenter();
 }
 
 bool World::deselectVertices(math::vector_3d const& pos, float radius)
 {
-  _vertex_center_updated = false;
   _vertex_border_updated = false;
-  std::set<math::vector_3d*> inRange;
 
-  for (math::vector_3d* v : _vertices_selected)
+  for (auto it (_vertices_selected.begin()); it != _vertices_selected.end();)
   {
-    if (misc::dist(*v, pos) <= radius)
+    vertex_selection const removed
+      (it->first->vertices_in_range (pos, radius, false) & it->second);
+
+    _vertex_sum -= it->first->sum_of_vertices (removed);
+    _vertex_count -= removed.count();
+    it->second &= ~removed;
+
+    if (it->second.none())
+    {
+      it = _vertices_selected.erase (it);
+    }
+    else
     {
-      inRange.emplace(v);
+      ++it;
     }
   }
 
-  for (math::vector_3d* v : inRange)
-  {
-    _vertices_selected.erase(v);
-  }
+  updateVertexCenter();
 
   return _vertices_selected.empty();
 }
 
 void World::moveVertices(float h)
 {
-  _vertex_center_updated = false;
-  for (math::vector_3d* v : _vertices_selected)
+  for (auto const& selected : _vertices_selected)
   {
-    v->y += h;
+    _undo.record (selected.first);
+    _vertex_sum.y += selected.first->move_vertices (selected.second, h);
   }
 
-  updateVertexCenter();
   updateSelectedVertices();
 }
 
@@ -1824,20 +1939,22 @@ void World::updateSelectedVertices()
 {
   for (MapTile* tile : _vertex_tiles)
   {
-    mapIndex.setChanged(tile);
+    mapIndex.setChanged(tile, tile_terrain);
   }
 
   // fix only the border chunks to be more efficient
   for (MapChunk* chunk : vertexBorderChunks())
   {
-    chunk->fixVertices(_vertices_selected);
+    _vertex_sum.y += chunk->fixVertices(_vertices_selected.at (chunk));
   }
 
-  for (MapChunk* chunk : _vertex_chunks)
+  for (auto const& selected : _vertices_selected)
   {
-    chunk->updateVerticesData();
-    recalc_norms (chunk);
+    selected.first->updateVerticesData();
+    recalc_norms (selected.first);
   }
+
+  updateVertexCenter();
 }
 
 void World::orientVertices ( math::vector_3d const& ref_pos
@@ -1845,18 +1962,21 @@ void World::orientVertices ( math::vector_3d const& ref_pos
                            , math::degrees vertex_orientation
                            )
 {
-  for (math::vector_3d* v : _vertices_selected)
+  for (auto const& selected : _vertices_selected)
   {
-    v->y = misc::angledHeight(ref_pos, *v, vertex_angle, vertex_orientation);
+    _undo.record (selected.first);
+    _vertex_sum.y += selected.first->orient_vertices
+      (selected.second, ref_pos, vertex_angle, vertex_orientation);
   }
   updateSelectedVertices();
 }
 
 void World::flattenVertices (float height)
 {
-  for (math::vector_3d* v : _vertices_selected)
+  for (auto const& selected : _vertices_selected)
   {
-    v->y = height;
+    _undo.record (selected.first);
+    _vertex_sum.y += selected.first->set_heights (selected.second, height);
   }
   updateSelectedVertices();
 }
@@ -1864,45 +1984,121 @@ void World::flattenVertices (float height)
 void World::clearVertexSelection()
 {
   _vertex_border_updated = false;
-  _vertex_center_updated = false;
   _vertices_selected.clear();
-  _vertex_chunks.clear();
   _vertex_tiles.clear();
+  _vertex_sum = {0.0, 0.0, 0.0};
+  _vertex_sum_outdated = false;
+  _vertex_count = 0;
+  updateVertexCenter();
+}
+
+void World::end_undo_stroke()
+{
+  _undo.end_stroke (this);
+}
+
+void World::undo()
+{
+  if (_undo.undo (this))
+  {
+    recalculate_vertex_sum();
+  }
+}
+
+void World::redo()
+{
+  if (_undo.redo (this))
+  {
+    recalculate_vertex_sum();
+  }
+}
+
+void World::start_journal (bool objects)
+{
+  std::string const& directory (Settings::getInstance()->journalPath);
+  if (directory.empty())
+  {
+    return;
+  }
+
+  std::string const filename
+    ((boost::filesystem::path (directory) / (basename + ".journal")).string());
+  std::string const& project (Settings::getInstance()->projectPath);
+
+  if (noggit::edit_journal::replay (filename, project, this, objects))
+  {
+    // recovered edits are no step of the history
+    _undo.clear();
+    recalculate_vertex_sum();
+  }
+
+  try
+  {
+    _journal = std::make_unique<noggit::edit_journal> (filename, project);
+    _undo.journal_to (_journal.get());
+  }
+  catch (std::exception const& e)
+  {
+    LogError << "journal: " << e.what() << ", edits aren't journaled." << std::endl;
+  }
+}
+
+void World::checkpoint_journal()
+{
+  if (_journal)
+  {
+    _journal->checkpoint();
+  }
+}
+
+void World::recalculate_vertex_sum()
+{
+  _vertex_sum_outdated = false;
+  _vertex_sum = {0.0, 0.0, 0.0};
+  for (auto const& selected : _vertices_selected)
+  {
+    _vertex_sum += selected.first->sum_of_vertices (selected.second);
+  }
+  updateVertexCenter();
 }
 
 void World::updateVertexCenter()
 {
-  _vertex_center_updated = true;
-  _vertex_center = { 0,0,0 };
-  float f = 1.0f / _vertices_selected.size();
-  for (math::vector_3d* v : _vertices_selected)
+  if (!_vertex_count)
   {
-    _vertex_center += (*v) * f;
+    _vertex_center = {0.0f, 0.0f, 0.0f};
+    return;
   }
+
+  _vertex_center = { static_cast<float> (_vertex_sum.x / _vertex_count)
+                   , static_cast<float> (_vertex_sum.y / _vertex_count)
+                   , static_cast<float> (_vertex_sum.z / _vertex_count)
+                   };
 }
 
 math::vector_3d const& World::vertexCenter()
 {
-  if (!_vertex_center_updated)
+  if (_vertex_sum_outdated)
   {
-    updateVertexCenter();
+    recalculate_vertex_sum();
   }
 
   return _vertex_center;
 }
 
-std::set<MapChunk*>& World::vertexBorderChunks()
+std::vector<MapChunk*> const& World::vertexBorderChunks()
 {
   if (!_vertex_border_updated)
   {
     _vertex_border_updated = true;
     _vertex_border_chunks.clear();
 
-    for (MapChunk* chunk : _vertex_chunks)
+    for (auto const& selected : _vertices_selected)
     {
-      if (chunk->isBorderChunk(_vertices_selected))
+      // border chunk if at least a vertex isn't selected
+      if (!selected.second.all())
       {
-        _vertex_border_chunks.emplace(chunk);
+        _vertex_border_chunks.emplace_back(selected.first);
       }
     }
   }
@@ -9,14 +9,21 @@
 #include <noggit/Selection.h>
 #include <noggit/Sky.h> // Skies, OutdoorLighting, OutdoorLightStats
 #include <noggit/WMO.h> // WMOManager
+#include <noggit/edit_journal.hpp>
 #include <noggit/map_horizon.h>
 #include <noggit/map_index.hpp>
+#include <noggit/model_render_queue.hpp>
 #include <noggit/tile_index.hpp>
 #include <noggit/tool_enums.hpp>
+#include <noggit/undo_stack.hpp>
+#include <opengl/primitives.hpp>
+#include <opengl/scoped.hpp>
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace opengl
 {
@@ -29,6 +36,7 @@ namespace noggit
 }
 
 class Brush;
+class ChunkWater;
 class MapTile;
 
 static const float detail_size = 8.0f;
@@ -75,6 +83,9 @@ public:
 
   std::unique_ptr<Skies> skies;
 
+  //! M2 instances and draw calls of the last draw()
+  noggit::model_render_queue::statistics model_draw_statistics = {0, 0};
+
   //! \todo  Get these managed? ._.
   std::map<int, ModelInstance> mModelInstances;
   std::map<int, WMOInstance> mWMOInstances;
@@ -130,6 +141,8 @@ public:
   unsigned int getAreaID (math::vector_3d const&);
   void setAreaID(math::vector_3d const& pos, int id, bool adt);
 
+  //! \note a hit is only added when it is nearer than all previous ones,
+  //! so the last entry is the nearest one.
   selection_result intersect ( math::ray const&
                              , bool only_map
                              , bool do_objects
@@ -213,11 +226,13 @@ public:
 
   void reload_tile(tile_index const& tile);
 
+  //! regenerates and saves the WDL for \a tiles after their ADTs were saved
+  void update_horizon (std::vector<tile_index> const& tiles);
+
   void updateTilesEntry(selection_type const& entry);
   void updateTilesWMO(WMOInstance* wmo);
   void updateTilesModel(ModelInstance* m2);
 
-  void saveMap (int width, int height);
 
   void deleteModelInstance(int pUniqueID);
   void deleteWMOInstance(int pUniqueID);
@@ -271,20 +286,64 @@ public:
 
   void recalc_norms (MapChunk*) const;
 
+  //! edits until then are one step of the history, e.g. a brush stroke
+  void end_undo_stroke();
+  void undo();
+  void redo();
+
+  //! recovers the edits a crash left in the journal of this map and
+  //! journals the ones to come, if a journal path is set.
+  //! \a objects is false if the uids were rewritten since
+  void start_journal (bool objects);
+  //! all changes are saved
+  void checkpoint_journal();
+
 private:
   void getSelection();
 
-  std::set<MapChunk*>& vertexBorderChunks();
+  std::vector<MapChunk*> const& vertexBorderChunks();
+  //! after heights changed by something else than the vertex tool
+  void recalculate_vertex_sum();
+  //! recalculates the normals of \a chunk after a brush changed its
+  //! heights, and the vertex sum the next time it's needed if it has
+  //! selected vertices
+  void heights_changed (MapChunk* chunk);
 
   std::set<MapTile*> _vertex_tiles;
-  std::set<MapChunk*> _vertex_chunks;
-  std::set<MapChunk*> _vertex_border_chunks;
-  std::set<math::vector_3d*> _vertices_selected;
+  //! only chunks with at least one selected vertex
+  std::unordered_map<MapChunk*, vertex_selection> _vertices_selected;
+  std::vector<MapChunk*> _vertex_border_chunks;
+  //! of the selected vertices, kept up to date by the vertex tool
+  math::vector_3d_base<double> _vertex_sum;
+  //! a brush changed selected vertices since the sum was calculated
+  bool _vertex_sum_outdated = false;
+  std::size_t _vertex_count = 0;
   math::vector_3d _vertex_center;
-  bool _vertex_center_updated = false;
   bool _vertex_border_updated = false;
 
+  noggit::undo_stack _undo;
+  std::unique_ptr<noggit::edit_journal> _journal;
+
   std::unique_ptr<noggit::map_horizon::render> _horizon_render;
+  bool _horizon_render_outdated = false;
+
+  // overlay geometry, uploaded once in initDisplay()
+  std::unique_ptr<opengl::primitives::wire_box> _wire_box;
+  std::unique_ptr<opengl::primitives::sphere> _sphere;
+  std::unique_ptr<opengl::primitives::disk> _disk;
+  std::unique_ptr<opengl::primitives::square> _square;
+  std::unique_ptr<opengl::primitives::vertex_stream> _vertex_stream;
+  //! see MapChunk::upload_texture_quads
+  std::unique_ptr<opengl::scoped::buffers<1>> _chunk_texture_quads;
+
+  //! fills the lists below, once per frame before any terrain pass
+  void update_visible_terrain ( math::frustum const&
+                              , float cull_distance
+                              , math::vector_3d const& camera
+                              );
+
+  std::vector<MapChunk*> _visible_chunks;
+  std::vector<ChunkWater*> _visible_water_chunks;
 
   bool _display_initialized = false;
 };
@@ -0,0 +1,495 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/matrix_4x4.hpp>
+#include <noggit/Misc.h>
+#include <noggit/ModelHeaders.h>
+#include <noggit/adt_object_patch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+namespace noggit
+{
+  namespace
+  {
+    // offsets in MHDR are relative to the end of the MHDR chunk header
+    constexpr std::uint32_t const mhdr_data_offset = 0x14;
+
+    template<typename T>
+      T read (char const* data)
+    {
+      T value;
+      std::memcpy (&value, data, sizeof (T));
+      return value;
+    }
+
+    //! model space to the coordinates of the world, see ModelInstance
+    math::vector_3d model_to_world (math::vector_3d const& v)
+    {
+      return {v.x, v.z, -v.y};
+    }
+
+    void append (std::vector<char>& out, void const* data, std::size_t size)
+    {
+      char const* begin (static_cast<char const*> (data));
+      out.insert (out.end(), begin, begin + size);
+    }
+
+    void append_chunk_header (std::vector<char>& out, std::uint32_t fourcc, std::uint32_t size)
+    {
+      append (out, &fourcc, 4);
+      append (out, &size, 4);
+    }
+
+    template<typename T>
+      void append_chunk (std::vector<char>& out, std::uint32_t fourcc, std::vector<T> const& elements)
+    {
+      append_chunk_header (out, fourcc, elements.size() * sizeof (T));
+      append (out, elements.data(), elements.size() * sizeof (T));
+    }
+
+    void append_filenames ( std::vector<char>& out
+                          , std::uint32_t names_fourcc
+                          , std::uint32_t offsets_fourcc
+                          , std::vector<std::string> const& filenames
+                          )
+    {
+      std::vector<std::uint32_t> offsets;
+      std::uint32_t size (0);
+      for (std::string const& filename : filenames)
+      {
+        offsets.emplace_back (size);
+        size += filename.size() + 1;
+      }
+
+      append_chunk_header (out, names_fourcc, size);
+      for (std::string const& filename : filenames)
+      {
+        append (out, filename.c_str(), filename.size() + 1);
+      }
+
+      append_chunk (out, offsets_fourcc, offsets);
+    }
+
+    //! copies a MCNK with its MCRF replaced by the objects overlapping it
+    bool append_patched_mcnk ( std::vector<char>& out
+                             , char const* chunk
+                             , std::uint32_t chunk_size
+                             , adt_objects const& objects
+                             )
+    {
+      if (chunk_size < sizeof (MapChunkHeader))
+      {
+        return false;
+      }
+
+      MapChunkHeader header (read<MapChunkHeader> (chunk + 8));
+
+      // same conversion as in MapChunk
+      float const xbase (-header.xpos + ZEROPOINT);
+      float const zbase (-header.zpos + ZEROPOINT);
+      math::vector_3d const chunk_extents[2] = { {xbase, 0.0f, zbase}
+                                               , {xbase + CHUNKSIZE, 0.0f, zbase + CHUNKSIZE}
+                                               };
+
+      std::vector<std::uint32_t> refs;
+      for (std::uint32_t i (0); i < objects.model_extents.size(); ++i)
+      {
+        if (misc::rectOverlap (objects.model_extents[i].data(), chunk_extents))
+        {
+          refs.emplace_back (i);
+        }
+      }
+      header.nDoodadRefs = refs.size();
+
+      for (std::uint32_t i (0); i < objects.wmos.size(); ++i)
+      {
+        math::vector_3d const wmo_extents[2] =
+          { { objects.wmos[i].extents[0][0], objects.wmos[i].extents[0][1], objects.wmos[i].extents[0][2] }
+          , { objects.wmos[i].extents[1][0], objects.wmos[i].extents[1][1], objects.wmos[i].extents[1][2] }
+          };
+        if (misc::rectOverlap (wmo_extents, chunk_extents))
+        {
+          refs.emplace_back (i);
+        }
+      }
+      header.nMapObjRefs = refs.size() - header.nDoodadRefs;
+
+      return append_mcnk_with_sub_chunk
+        (out, chunk, chunk_size, header, &MapChunkHeader::ofsRefs, 'MCRF', refs.data(), refs.size() * 4);
+    }
+
+    struct moved_chunk
+    {
+      std::uint32_t old_offset;
+      std::uint32_t new_offset;
+      std::int64_t growth;
+    };
+
+    //! copies all top level chunks of an ADT to \a out, letting \a rewrite
+    //! append a replacement. \a rewrite returns false if the chunk couldn't
+    //! be rewritten, boost::none to have it copied as it is.
+    //! \returns the chunks ordered by their old offset
+    boost::optional<std::vector<moved_chunk>> rebuild_adt
+      ( char const* data
+      , std::size_t size
+      , std::vector<char>& out
+      , std::function<boost::optional<bool> (std::uint32_t fourcc, char const* chunk, std::uint32_t size)> const& rewrite
+      )
+    {
+      std::vector<moved_chunk> moved;
+
+      for (std::size_t position (0); position < size;)
+      {
+        if (position + 8 > size)
+        {
+          return boost::none;
+        }
+
+        std::uint32_t const fourcc (read<std::uint32_t> (data + position));
+        std::uint32_t const chunk_size (read<std::uint32_t> (data + position + 4));
+
+        if (position + 8 + chunk_size > size)
+        {
+          return boost::none;
+        }
+
+        std::uint32_t const new_position (out.size());
+
+        boost::optional<bool> const rewritten (rewrite (fourcc, data + position, chunk_size));
+        if (rewritten && !*rewritten)
+        {
+          return boost::none;
+        }
+        else if (!rewritten)
+        {
+          append (out, data + position, 8 + chunk_size);
+        }
+
+        moved.push_back ({ std::uint32_t (position)
+                         , new_position
+                         , std::int64_t (out.size() - new_position) - (8 + chunk_size)
+                         }
+                        );
+
+        position += 8 + chunk_size;
+      }
+
+      return moved;
+    }
+
+    moved_chunk const* find_moved (std::vector<moved_chunk> const& moved, std::uint32_t old_offset)
+    {
+      auto const it
+        ( std::lower_bound ( moved.begin(), moved.end(), old_offset
+                           , [] (moved_chunk const& chunk, std::uint32_t offset)
+                             {
+                               return chunk.old_offset < offset;
+                             }
+                           )
+        );
+      return it == moved.end() || it->old_offset != old_offset ? nullptr : &*it;
+    }
+
+    //! moves the given MHDR offsets and all of MCIN along with their chunks
+    bool move_offsets ( std::vector<char>& out
+                      , std::vector<moved_chunk> const& moved
+                      , std::uint32_t mhdr
+                      , std::uint32_t mcin
+                      , std::initializer_list<std::uint32_t MHDR::*> mhdr_offsets
+                      )
+    {
+      MHDR header (read<MHDR> (out.data() + mhdr + 8));
+
+      for (std::uint32_t MHDR::* offset : mhdr_offsets)
+      {
+        if (header.*offset)
+        {
+          moved_chunk const* chunk (find_moved (moved, header.*offset + mhdr_data_offset));
+          if (!chunk)
+          {
+            return false;
+          }
+          header.*offset = chunk->new_offset - mhdr_data_offset;
+        }
+      }
+
+      std::memcpy (out.data() + mhdr + 8, &header, sizeof (MHDR));
+
+      MCIN entries (read<MCIN> (out.data() + mcin + 8));
+
+      for (ENTRY_MCIN& entry : entries.mEntries)
+      {
+        moved_chunk const* chunk (find_moved (moved, entry.offset));
+        if (!chunk)
+        {
+          return false;
+        }
+
+        entry.offset = chunk->new_offset;
+        entry.size += chunk->growth;
+      }
+
+      std::memcpy (out.data() + mcin + 8, &entries, sizeof (MCIN));
+
+      return true;
+    }
+  }
+
+  bool append_mcnk_with_sub_chunk ( std::vector<char>& out
+                                  , char const* chunk
+                                  , std::uint32_t chunk_size
+                                  , MapChunkHeader header
+                                  , std::uint32_t MapChunkHeader::* offset
+                                  , std::uint32_t fourcc
+                                  , void const* payload
+                                  , std::uint32_t payload_size
+                                  )
+  {
+    if (chunk_size < sizeof (MapChunkHeader))
+    {
+      return false;
+    }
+
+    std::uint32_t const old_position (header.*offset);
+    if (old_position < 8 + sizeof (MapChunkHeader) || old_position + 8 > chunk_size + 8)
+    {
+      return false;
+    }
+
+    std::uint32_t const old_size (read<std::uint32_t> (chunk + old_position + 4));
+    if (read<std::uint32_t> (chunk + old_position) != fourcc || old_position + 8 + old_size > chunk_size + 8)
+    {
+      return false;
+    }
+
+    std::int64_t const delta (std::int64_t (payload_size) - old_size);
+
+    // every sub chunk behind the replaced one moves by delta
+    for (std::uint32_t* sub_chunk : { &header.ofsHeight, &header.ofsNormal, &header.ofsLayer
+                                    , &header.ofsRefs, &header.ofsAlpha, &header.ofsShadow
+                                    , &header.ofsSndEmitters, &header.ofsLiquid, &header.ofsMCCV
+                                    }
+        )
+    {
+      if (*sub_chunk > old_position)
+      {
+        *sub_chunk += delta;
+      }
+    }
+
+    append_chunk_header (out, 'MCNK', chunk_size + delta);
+    append (out, &header, sizeof (MapChunkHeader));
+    append ( out
+           , chunk + 8 + sizeof (MapChunkHeader)
+           , old_position - 8 - sizeof (MapChunkHeader)
+           );
+
+    append_chunk_header (out, fourcc, payload_size);
+    append (out, payload, payload_size);
+
+    std::uint32_t const tail (old_position + 8 + old_size);
+    append (out, chunk + tail, chunk_size + 8 - tail);
+
+    return true;
+  }
+
+  boost::optional<std::vector<char>> patch_adt_objects
+    (char const* data, std::size_t size, adt_objects const& objects)
+  {
+    std::vector<char> out;
+    out.reserve (size + objects.models.size() * sizeof (ENTRY_MDDF) + objects.wmos.size() * sizeof (ENTRY_MODF));
+
+    boost::optional<std::uint32_t> mhdr, mcin, mmdx, mwmo, mddf, modf;
+    int id_chunks (0);
+
+    auto const moved
+      ( rebuild_adt
+          ( data, size, out
+          , [&] (std::uint32_t fourcc, char const* chunk, std::uint32_t chunk_size) -> boost::optional<bool>
+            {
+              std::uint32_t const new_position (out.size());
+
+              switch (fourcc)
+              {
+              case 'MMDX':
+                mmdx = new_position;
+                append_filenames (out, 'MMDX', 'MMID', objects.model_filenames);
+                return true;
+              case 'MWMO':
+                mwmo = new_position;
+                append_filenames (out, 'MWMO', 'MWID', objects.wmo_filenames);
+                return true;
+              case 'MMID':
+              case 'MWID':
+                // written together with their filenames
+                ++id_chunks;
+                return true;
+              case 'MDDF':
+                mddf = new_position;
+                append_chunk (out, 'MDDF', objects.models);
+                return true;
+              case 'MODF':
+                modf = new_position;
+                append_chunk (out, 'MODF', objects.wmos);
+                return true;
+              case 'MCNK':
+                return append_patched_mcnk (out, chunk, chunk_size, objects);
+              case 'MHDR':
+                if (chunk_size >= sizeof (MHDR))
+                {
+                  mhdr = new_position;
+                }
+                return boost::none;
+              case 'MCIN':
+                if (chunk_size >= sizeof (MCIN))
+                {
+                  mcin = new_position;
+                }
+                return boost::none;
+              default:
+                return boost::none;
+              }
+            }
+          )
+      );
+
+    if (!moved || !mhdr || !mcin || !mmdx || !mwmo || !mddf || !modf || id_chunks != 2)
+    {
+      return boost::none;
+    }
+
+    if (!move_offsets ( out, *moved, *mhdr, *mcin
+                      , {&MHDR::mcin, &MHDR::mtex, &MHDR::mh2o, &MHDR::mfbo, &MHDR::mtfx}
+                      )
+       )
+    {
+      return boost::none;
+    }
+
+    MHDR header (read<MHDR> (out.data() + *mhdr + 8));
+
+    header.mmdx = *mmdx - mhdr_data_offset;
+    header.mmid = *mmdx + 8 + read<std::uint32_t> (out.data() + *mmdx + 4) - mhdr_data_offset;
+    header.mwmo = *mwmo - mhdr_data_offset;
+    header.mwid = *mwmo + 8 + read<std::uint32_t> (out.data() + *mwmo + 4) - mhdr_data_offset;
+    header.mddf = *mddf - mhdr_data_offset;
+    header.modf = *modf - mhdr_data_offset;
+
+    std::memcpy (out.data() + *mhdr + 8, &header, sizeof (MHDR));
+
+    return out;
+  }
+
+  boost::optional<std::vector<char>> patch_adt_mcnks
+    ( char const* data
+    , std::size_t size
+    , std::function<bool (char const* mcnk, std::uint32_t size, std::vector<char>& out)> const& patch_mcnk
+    )
+  {
+    std::vector<char> out;
+    out.reserve (size);
+
+    boost::optional<std::uint32_t> mhdr, mcin;
+
+    auto const moved
+      ( rebuild_adt
+          ( data, size, out
+          , [&] (std::uint32_t fourcc, char const* chunk, std::uint32_t chunk_size) -> boost::optional<bool>
+            {
+              if (fourcc == 'MCNK')
+              {
+                return patch_mcnk (chunk, chunk_size, out);
+              }
+              else if (fourcc == 'MHDR' && chunk_size >= sizeof (MHDR))
+              {
+                mhdr = out.size();
+              }
+              else if (fourcc == 'MCIN' && chunk_size >= sizeof (MCIN))
+              {
+                mcin = out.size();
+              }
+              return boost::none;
+            }
+          )
+      );
+
+    if ( !moved || !mhdr || !mcin
+      || !move_offsets ( out, *moved, *mhdr, *mcin
+                       , { &MHDR::mcin, &MHDR::mtex, &MHDR::mmdx, &MHDR::mmid
+                         , &MHDR::mwmo, &MHDR::mwid, &MHDR::mddf, &MHDR::modf
+                         , &MHDR::mfbo, &MHDR::mh2o, &MHDR::mtfx
+                         }
+                       )
+       )
+    {
+      return boost::none;
+    }
+
+    return out;
+  }
+
+  void model_extents ( ModelHeader const& header
+                     , math::vector_3d const& pos
+                     , math::vector_3d const& dir
+                     , float scale
+                     , math::vector_3d* extents
+                     , float& size_cat
+                     )
+  {
+    math::vector_3d min (math::vector_3d::max()), vertex_box_min (min);
+    math::vector_3d max (math::vector_3d::min()), vertex_box_max (max);
+    math::matrix_4x4 rot
+      ( math::matrix_4x4 (math::matrix_4x4::translation, pos)
+      * math::matrix_4x4 ( math::matrix_4x4::rotation_yzx
+                         , { math::degrees (-dir.z)
+                           , math::degrees (dir.y - 90.0f)
+                           , math::degrees (dir.x)
+                           }
+                         )
+      * math::matrix_4x4 (math::matrix_4x4::scale, scale)
+      );
+
+    math::vector_3d bounds[8 * 2];
+    math::vector_3d *ptr = bounds;
+
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMax.x, header.BoundingBoxMax.y, header.BoundingBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMin.x, header.BoundingBoxMax.y, header.BoundingBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMin.x, header.BoundingBoxMin.y, header.BoundingBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMax.x, header.BoundingBoxMin.y, header.BoundingBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMax.x, header.BoundingBoxMin.y, header.BoundingBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMax.x, header.BoundingBoxMax.y, header.BoundingBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMin.x, header.BoundingBoxMax.y, header.BoundingBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.BoundingBoxMin.x, header.BoundingBoxMin.y, header.BoundingBoxMax.z));
+
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMax.x, header.VertexBoxMax.y, header.VertexBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMin.x, header.VertexBoxMax.y, header.VertexBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMin.x, header.VertexBoxMin.y, header.VertexBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMax.x, header.VertexBoxMin.y, header.VertexBoxMin.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMax.x, header.VertexBoxMin.y, header.VertexBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMax.x, header.VertexBoxMax.y, header.VertexBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMin.x, header.VertexBoxMax.y, header.VertexBoxMax.z));
+    *ptr++ = rot * model_to_world (math::vector_3d(header.VertexBoxMin.x, header.VertexBoxMin.y, header.VertexBoxMax.z));
+
+    for (int i = 0; i < 8 * 2; ++i)
+    {
+      misc::extract_v3d_min_max (bounds[i], min, max);
+      // vertex box only for size_cat
+      if (i >= 8)
+      {
+        misc::extract_v3d_min_max (bounds[i], vertex_box_min, vertex_box_max);
+      }
+    }
+
+    extents[0] = min;
+    extents[1] = max;
+
+    size_cat = std::max( vertex_box_max.x - vertex_box_min.x
+                       , std::max( vertex_box_max.y - vertex_box_min.y
+                                 , vertex_box_max.z - vertex_box_min.z
+                                 )
+                       );
+  }
+}
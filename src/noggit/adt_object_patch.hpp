@@ -0,0 +1,75 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+#include <noggit/MapHeaders.h>
+
+#include <boost/optional/optional.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ModelHeader;
+
+namespace noggit
+{
+  //! Object placements of a single ADT in the form they are written to the
+  //! object chunks. The name ids of the entries index the filename lists.
+  struct adt_objects
+  {
+    std::vector<std::string> model_filenames;
+    std::vector<std::string> wmo_filenames;
+    std::vector<ENTRY_MDDF> models;
+    std::vector<ENTRY_MODF> wmos;
+    //! world space extents of models, parallel to models. WMO extents are
+    //! stored in their MODF entries.
+    std::vector<std::array<math::vector_3d, 2>> model_extents;
+  };
+
+  //! Rebuilds an ADT image with MMDX, MMID, MWMO, MWID, MDDF, MODF and the
+  //! MCRF of every MCNK replaced by the given objects. Everything else is
+  //! copied byte by byte, only the offsets in MHDR, MCIN and the MCNK headers
+  //! are moved along, so the terrain never has to be parsed.
+  //! \returns boost::none if the image isn't a well formed ADT.
+  boost::optional<std::vector<char>> patch_adt_objects
+    (char const* data, std::size_t size, adt_objects const& objects);
+
+  //! Rebuilds an ADT image with every MCNK replaced by what \a patch_mcnk
+  //! appends to \a out for it, the chunk being passed with its header.
+  //! Offsets in MHDR and MCIN are moved along as above.
+  //! \returns boost::none if the image isn't a well formed ADT or a MCNK
+  //! couldn't be patched.
+  boost::optional<std::vector<char>> patch_adt_mcnks
+    ( char const* data
+    , std::size_t size
+    , std::function<bool (char const* mcnk, std::uint32_t size, std::vector<char>& out)> const& patch_mcnk
+    );
+
+  //! appends the MCNK \a chunk with \a header and the sub chunk \a fourcc
+  //! at \a offset replaced by \a payload. Sub chunks behind it are moved.
+  //! \returns false if the sub chunk isn't where the header says.
+  bool append_mcnk_with_sub_chunk ( std::vector<char>& out
+                                  , char const* chunk
+                                  , std::uint32_t chunk_size
+                                  , MapChunkHeader header
+                                  , std::uint32_t MapChunkHeader::* offset
+                                  , std::uint32_t fourcc
+                                  , void const* payload
+                                  , std::uint32_t payload_size
+                                  );
+
+  //! world space extents and size class of a model with the given header
+  //! placed at \a pos, without loading the model itself
+  void model_extents ( ModelHeader const& header
+                     , math::vector_3d const& pos
+                     , math::vector_3d const& dir
+                     , float scale
+                     , math::vector_3d* extents
+                     , float& size_cat
+                     );
+}
@@ -3,6 +3,8 @@
 #include <noggit/alphamap.hpp>
 #include <opengl/context.hpp>
 
+#include <cstring>
+
 Alphamap::Alphamap()
 {
   createNew();
@@ -13,75 +15,21 @@ Alphamap::Alphamap(MPQFile *f, unsigned int flags, bool mBigAlpha, bool doNotFix
 {
   createNew();
 
-  if(flags & 0x200 )
-    readCompressed(f);
-  else if(mBigAlpha)
-    readBigAlpha(f);
-  else
-    readNotCompressed(f, doNotFixAlpha);
-
-  genTexture();
-}
-
-void Alphamap::readCompressed(MPQFile *f)
-{
-  // compressed
-  char const* input = f->getPointer();
-
-  for (std::size_t offset_output(0); offset_output < 4096;)
-  {
-    bool const fill(*input & 0x80);
-    std::size_t const n(*input & 0x7F);
-    ++input;
-
-    if (fill)
-    {
-      memset(&amap[offset_output], *input, n);
-      ++input;
-    }
-    else
-    {
-      memcpy(&amap[offset_output], input, n);
-      input += n;
-    }
-
-    offset_output += n;
-  }
-}
-
-void Alphamap::readBigAlpha(MPQFile *f)
-{
-  memcpy(amap, f->getPointer(), 64 * 64);
-  f->seekRelative(0x1000);
-}
+  noggit::decode_alphamap ( f->getPointer()
+                          , f->getBuffer() + f->getSize()
+                          , flags
+                          , mBigAlpha
+                          , doNotFixAlpha
+                          , amap
+                          );
 
-void Alphamap::readNotCompressed(MPQFile *f, bool doNotFixAlpha)
-{
-  // not compressed
-  unsigned char *p;
-  char const* abuf = f->getPointer();
-  p = amap;
-
-  for (std::size_t x(0); x < 64; ++x)
+  // compressed layers are always seeked to by their offset
+  if (!(flags & 0x200))
   {
-    for (std::size_t y(0); y < 64; y += 2)
-    {
-      amap[x * 64 + y + 0] = ((*abuf & 0x0f) << 4) | (*abuf & 0x0f);
-      amap[x * 64 + y + 1] = ((*abuf & 0xf0) >> 4) | (*abuf & 0xf0);
-      ++abuf;
-    }
+    f->seekRelative(mBigAlpha ? 0x1000 : 0x800);
   }
 
-  if (doNotFixAlpha)
-  {
-    for (std::size_t i(0); i < 64; ++i)
-    {
-      amap[i * 64 + 63] = amap[i * 64 + 62];
-      amap[63 * 64 + i] = amap[62 * 64 + i];
-    }
-    amap[63 * 64 + 63] = amap[62 * 64 + 62];
-  }
-  f->seekRelative(0x800);
+  genTexture();
 }
 
 void Alphamap::createNew()
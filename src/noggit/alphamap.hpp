@@ -4,6 +4,7 @@
 
 #include <noggit/Log.h>
 #include <noggit/MPQ.h>
+#include <noggit/alphamap_codec.hpp>
 #include <opengl/texture.hpp>
 
 class Alphamap
@@ -23,10 +24,6 @@ public:
   const unsigned char *getAlpha();
 
 private:
-  void readCompressed(MPQFile *f);
-  void readBigAlpha(MPQFile *f);
-  void readNotCompressed(MPQFile *f, bool doNotFixAlpha);
-
   void createNew();
 
   void genTexture();
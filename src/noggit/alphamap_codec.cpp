@@ -0,0 +1,262 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/alphamap_codec.hpp>
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace noggit
+{
+  bool decode_alphamap ( char const* input
+                       , char const* end
+                       , unsigned int flags
+                       , bool big_alpha
+                       , bool do_not_fix_alpha
+                       , unsigned char* amap
+                       )
+  {
+    if (flags & 0x200)
+    {
+      // compressed
+      for (std::size_t offset_output(0); offset_output < 4096;)
+      {
+        if (input >= end)
+        {
+          return false;
+        }
+
+        bool const fill(*input & 0x80);
+        std::size_t const n(std::min<std::size_t> (*input & 0x7F, 4096 - offset_output));
+        ++input;
+
+        if (input + (fill ? 1 : n) > end)
+        {
+          return false;
+        }
+
+        if (fill)
+        {
+          memset(&amap[offset_output], *input, n);
+          ++input;
+        }
+        else
+        {
+          memcpy(&amap[offset_output], input, n);
+          input += n;
+        }
+
+        offset_output += n;
+      }
+    }
+    else if (big_alpha)
+    {
+      if (end - input < 64 * 64)
+      {
+        return false;
+      }
+
+      memcpy(amap, input, 64 * 64);
+    }
+    else
+    {
+      // not compressed
+      if (end - input < 64 * 32)
+      {
+        return false;
+      }
+
+      char const* abuf = input;
+
+      for (std::size_t x(0); x < 64; ++x)
+      {
+        for (std::size_t y(0); y < 64; y += 2)
+        {
+          amap[x * 64 + y + 0] = ((*abuf & 0x0f) << 4) | (*abuf & 0x0f);
+          amap[x * 64 + y + 1] = ((*abuf & 0xf0) >> 4) | (*abuf & 0xf0);
+          ++abuf;
+        }
+      }
+
+      if (do_not_fix_alpha)
+      {
+        for (std::size_t i(0); i < 64; ++i)
+        {
+          amap[i * 64 + 63] = amap[i * 64 + 62];
+          amap[63 * 64 + i] = amap[62 * 64 + i];
+        }
+        amap[63 * 64 + 63] = amap[62 * 64 + 62];
+      }
+    }
+
+    return true;
+  }
+
+  void old_to_big_alpha (unsigned char* alphas, std::size_t layers)
+  {
+    float values[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 64 * 64; ++i)
+    {
+      for (std::size_t k = 0; k < layers; k++)
+      {
+        float f = static_cast<float>(alphas[4096 * k + i]);
+        values[k] = f;
+        for (std::size_t n = 0; n < k; n++)
+          values[n] = (values[n] * ((255.0f - f)) / 255.0f);
+      }
+
+      for (std::size_t k = 0; k < layers; k++)
+      {
+        alphas[4096 * k + i] = static_cast<unsigned char>(std::min(std::max(std::round(values[k]), 0.0f), 255.0f));
+      }
+    }
+  }
+
+  void big_to_old_alpha (unsigned char* alphas, std::size_t layers)
+  {
+    float values[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 64 * 64; ++i)
+    {
+      for (std::size_t k = 0; k < layers; k++)
+      {
+        values[k] = static_cast<float>(alphas[4096 * k + i]);
+      }
+
+      for (int k = int (layers) - 1; k >= 0; k--)
+      {
+        for (int n = int (layers) - 1; n > k; n--)
+        {
+          // prevent 0 division
+          if (values[n] == 255.0f)
+          {
+            values[k] = 0.0f;
+            break;
+          }
+          else
+            values[k] = (values[k] / (255.0f - values[n])) * 255.0f;
+        }
+      }
+
+      for (std::size_t k = 0; k < layers; k++)
+      {
+        alphas[4096 * k + i] = static_cast<unsigned char>(std::min(std::max(std::round(values[k]), 0.0f), 255.0f));
+      }
+    }
+  }
+
+  std::vector<char> encode_old_alphamap (unsigned char const* alpha)
+  {
+    std::vector<char> result (2048);
+    for (int k = 0; k < 2048; k++)
+    {
+      unsigned char const lowerNibble = (alpha[k * 2 + 0] & 0xF0);
+      unsigned char const upperNibble = (alpha[k * 2 + 1] & 0xF0);
+      result[k] = (upperNibble)+(lowerNibble >> 4);
+    }
+    return result;
+  }
+
+  std::vector<char> compress_alphamap (unsigned char const* alpha)
+  {
+    struct entry
+    {
+      enum mode_t
+      {
+        copy = 0,              // append value[0..count - 1]
+        fill = 1,              // append value[0] count times
+      };    
+      uint8_t count : 7;
+      uint8_t mode : 1;
+    
+      uint8_t value[];
+    };
+
+    std::vector<char> data(alpha, alpha+4096);
+    auto current (data.begin());
+    auto const end (data.end());
+    int column_pos = 0;
+
+    auto const consume_fill
+    ( 
+      [&]
+      {
+        int8_t count (0);
+        column_pos %= 64;
+      
+        while ((current + 1 < end) && *current == *(current + 1) && column_pos < 63)
+        {
+          ++current;
+          ++count;
+          ++column_pos;
+        }
+
+        // include current (current is incremented in the for loop)
+        if (count)
+        {
+          ++count;
+          ++column_pos;
+        }
+
+        return count;
+      }
+    );
+
+    std::vector<char> result;
+    boost::optional<std::size_t> current_copy_entry_offset (boost::none);
+    auto const current_copy_entry
+    ( 
+      [&]
+      {
+        return reinterpret_cast<entry*> (&*(result.begin() + *current_copy_entry_offset));
+      }
+    );
+
+    for (; current != end; ++current)
+    {
+      auto const fill (consume_fill());
+      if (fill)
+      {
+        current_copy_entry_offset = boost::none;
+
+        result.emplace_back();
+        result.emplace_back(*current);
+
+        entry* e (reinterpret_cast<entry*> (&*(result.rbegin() + 1)));
+        e->mode = entry::fill;
+        e->count = fill;
+
+        column_pos %= 64;
+      }
+      else
+      {
+        if ( current_copy_entry_offset == boost::none
+          || column_pos == 64
+           )
+        {
+          current_copy_entry_offset = result.size();
+          result.emplace_back();
+          result.emplace_back(*current);
+          current_copy_entry()->mode = entry::copy;
+          current_copy_entry()->count = 1;
+        
+          column_pos %= 64;
+        }
+        else
+        {
+          result.emplace_back(*current);
+          current_copy_entry()->count++;
+        }
+
+        column_pos++;
+      }
+    }
+
+    return result;
+  }
+}
@@ -0,0 +1,32 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//! Reading and writing MCAL layers without GL, shared by the Alphamap
+//! textures, the map maintenance and the headless minimap baker
+namespace noggit
+{
+  //! decodes one MCAL layer into 64 rows of 64 alpha values
+  //! \returns false if the layer runs past \a end
+  bool decode_alphamap ( char const* data
+                       , char const* end
+                       , unsigned int flags
+                       , bool big_alpha
+                       , bool do_not_fix_alpha
+                       , unsigned char* amap
+                       );
+
+  //! \a alphas are \a layers maps of 64 * 64 values, converted in place
+  //! between the layered blending noggit edits with and the final weights
+  //! stored with big alpha
+  void old_to_big_alpha (unsigned char* alphas, std::size_t layers);
+  void big_to_old_alpha (unsigned char* alphas, std::size_t layers);
+
+  //! 2048 bytes of 4 bit values, as written without big alpha
+  std::vector<char> encode_old_alphamap (unsigned char const* amap);
+  //! run length encoded with rows never crossed, flag 0x200
+  std::vector<char> compress_alphamap (unsigned char const* amap);
+}
@@ -107,89 +107,7 @@ void Noggit::loadMPQs()
   asyncLoader = std::make_unique<AsyncLoader>();
   asyncLoader->start(1);
 
-  std::vector<std::string> archiveNames;
-  archiveNames.push_back("common.MPQ");
-  archiveNames.push_back("common-2.MPQ");
-  archiveNames.push_back("expansion.MPQ");
-  archiveNames.push_back("lichking.MPQ");
-  archiveNames.push_back("patch.MPQ");
-  archiveNames.push_back("patch-{number}.MPQ");
-  archiveNames.push_back("patch-{character}.MPQ");
-
-  //archiveNames.push_back( "{locale}/backup-{locale}.MPQ" );
-  //archiveNames.push_back( "{locale}/base-{locale}.MPQ" );
-  archiveNames.push_back("{locale}/locale-{locale}.MPQ");
-  //archiveNames.push_back( "{locale}/speech-{locale}.MPQ" );
-  archiveNames.push_back("{locale}/expansion-locale-{locale}.MPQ");
-  //archiveNames.push_back( "{locale}/expansion-speech-{locale}.MPQ" );
-  archiveNames.push_back("{locale}/lichking-locale-{locale}.MPQ");
-  //archiveNames.push_back( "{locale}/lichking-speech-{locale}.MPQ" );
-  archiveNames.push_back("{locale}/patch-{locale}.MPQ");
-  archiveNames.push_back("{locale}/patch-{locale}-{number}.MPQ");
-  archiveNames.push_back("{locale}/patch-{locale}-{character}.MPQ");
-
-  archiveNames.push_back("development.MPQ");
-
-  const char * locales[] = { "enGB", "enUS", "deDE", "koKR", "frFR", "zhCN", "zhTW", "esES", "esMX", "ruRU" };
-  const char * locale("****");
-
-  // Find locale, take first one.
-  for (int i(0); i < 10; ++i)
-  {
-    if (boost::filesystem::exists (wowpath / "Data" / locales[i] / "realmlist.wtf"))
-    {
-      locale = locales[i];
-      Log << "Locale: " << locale << std::endl;
-      break;
-    }
-  }
-  if (!strcmp(locale, "****"))
-  {
-    LogError << "Could not find locale directory. Be sure, that there is one containing the file \"realmlist.wtf\"." << std::endl;
-    //return -1;
-  }
-
-  //! \todo  This may be done faster. Maybe.
-  for (size_t i(0); i < archiveNames.size(); ++i)
-  {
-    std::string path((wowpath / "Data" / archiveNames[i]).string());
-    std::string::size_type location(std::string::npos);
-
-    do
-    {
-      location = path.find("{locale}");
-      if (location != std::string::npos)
-      {
-        path.replace(location, 8, locale);
-      }
-    } while (location != std::string::npos);
-
-    if (path.find("{number}") != std::string::npos)
-    {
-      location = path.find("{number}");
-      path.replace(location, 8, " ");
-      for (char j = '2'; j <= '9'; j++)
-      {
-        path.replace(location, 1, std::string(&j, 1));
-        if (boost::filesystem::exists(path))
-          MPQArchive::loadMPQ (asyncLoader.get(), path, true);
-      }
-    }
-    else if (path.find("{character}") != std::string::npos)
-    {
-      location = path.find("{character}");
-      path.replace(location, 11, " ");
-      for (char c = 'a'; c <= 'z'; c++)
-      {
-        path.replace(location, 1, std::string(&c, 1));
-        if (boost::filesystem::exists(path))
-          MPQArchive::loadMPQ (asyncLoader.get(), path, true);
-      }
-    }
-    else
-      if (boost::filesystem::exists(path))
-        MPQArchive::loadMPQ (asyncLoader.get(), path, true);
-  }
+  MPQArchive::loadGameArchives (asyncLoader.get(), wowpath.string());
 }
 
 Noggit::Noggit(int argc, char *argv[])
@@ -234,6 +152,24 @@ Noggit::Noggit(int argc, char *argv[])
     throw std::runtime_error ("Your system does not support OpenGL. Sorry, this application can't run without it.");
   }
 
+  std::string const& opengl_checks (Settings::getInstance()->openglChecks);
+  if (opengl_checks == "full")
+  {
+    gl._check_mode = opengl::context::check_mode::full;
+  }
+  else if (opengl_checks == "sampled")
+  {
+    gl._check_mode = opengl::context::check_mode::sampled;
+  }
+  else if (opengl_checks == "release")
+  {
+    gl._check_mode = opengl::context::check_mode::release;
+  }
+  else if (!opengl_checks.empty())
+  {
+    LogError << "Unknown OpenGLChecks mode \"" << opengl_checks << "\", keeping the default." << std::endl;
+  }
+
   QSurfaceFormat format;
 
   format.setRenderableType(QSurfaceFormat::OpenGL);
@@ -0,0 +1,174 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/Misc.h>
+#include <noggit/byte_delta.hpp>
+
+#include <algorithm>
+
+namespace noggit
+{
+  namespace
+  {
+    // runs of unchanged bytes shorter than this are stored with the
+    // changed ones around them, as two counts would take about as much
+    std::size_t const minimum_gap (4);
+
+    void write_count (std::vector<std::uint8_t>& runs, std::size_t count)
+    {
+      while (count >= 0x80)
+      {
+        runs.push_back (static_cast<std::uint8_t> (count | 0x80));
+        count >>= 7;
+      }
+      runs.push_back (static_cast<std::uint8_t> (count));
+    }
+
+    std::size_t read_count (std::vector<std::uint8_t> const& runs, std::size_t& position)
+    {
+      std::size_t count (0);
+      for (int shift (0); ; shift += 7)
+      {
+        std::uint8_t const byte (runs.at (position++));
+        count |= std::size_t (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+          return count;
+        }
+      }
+    }
+
+    std::uint64_t hash (std::vector<std::uint8_t> const& state)
+    {
+      return misc::fnv1a (reinterpret_cast<char const*> (state.data()), state.size());
+    }
+  }
+
+  byte_delta::byte_delta ( std::vector<std::uint8_t> const& before
+                         , std::vector<std::uint8_t> const& after
+                         )
+    : _size_before (before.size())
+    , _size_after (after.size())
+    , _hash_before (hash (before))
+    , _hash_after (hash (after))
+  {
+    std::size_t const size (std::max (before.size(), after.size()));
+    auto const difference
+      ( [&] (std::size_t i) -> std::uint8_t
+        {
+          return (i < before.size() ? before[i] : 0) ^ (i < after.size() ? after[i] : 0);
+        }
+      );
+
+    std::size_t i (0);
+    while (i < size)
+    {
+      std::size_t const unchanged_begin (i);
+      while (i < size && !difference (i))
+      {
+        ++i;
+      }
+      if (i == size)
+      {
+        break;
+      }
+
+      std::size_t changed_end (i);
+      while (changed_end < size)
+      {
+        std::size_t gap (0);
+        while (changed_end + gap < size && !difference (changed_end + gap) && gap < minimum_gap)
+        {
+          ++gap;
+        }
+        if (gap == minimum_gap || changed_end + gap == size)
+        {
+          break;
+        }
+        changed_end += std::max (gap, std::size_t (1));
+      }
+
+      write_count (_runs, i - unchanged_begin);
+      write_count (_runs, changed_end - i);
+      for (; i < changed_end; ++i)
+      {
+        _runs.push_back (difference (i));
+      }
+    }
+
+    _runs.shrink_to_fit();
+  }
+
+  bool byte_delta::empty() const
+  {
+    return _runs.empty() && _size_before == _size_after;
+  }
+
+  bool byte_delta::apply_from (side from, std::vector<std::uint8_t>& state) const
+  {
+    bool const after (from == side::after);
+    if ( state.size() != (after ? _size_after : _size_before)
+      || hash (state) != (after ? _hash_after : _hash_before)
+       )
+    {
+      return false;
+    }
+
+    flip (state, after ? _size_before : _size_after);
+    return true;
+  }
+
+  void byte_delta::flip (std::vector<std::uint8_t>& state, std::size_t target_size) const
+  {
+    state.resize (std::max (_size_before, _size_after), 0);
+
+    std::size_t position (0);
+    std::size_t run (0);
+    while (run < _runs.size())
+    {
+      position += read_count (_runs, run);
+      std::size_t const changed (read_count (_runs, run));
+      for (std::size_t i (0); i < changed; ++i)
+      {
+        state.at (position++) ^= _runs[run++];
+      }
+    }
+
+    state.resize (target_size);
+  }
+
+  std::size_t byte_delta::memory_usage() const
+  {
+    return sizeof (*this) + _runs.capacity();
+  }
+
+  void byte_delta::write (std::vector<std::uint8_t>& data) const
+  {
+    undo::write (data, std::uint64_t (_size_before));
+    undo::write (data, std::uint64_t (_size_after));
+    undo::write (data, _hash_before);
+    undo::write (data, _hash_after);
+    undo::write (data, std::uint64_t (_runs.size()));
+    undo::write (data, _runs.data(), _runs.size());
+  }
+
+  byte_delta byte_delta::read (undo::reader& data)
+  {
+    std::uint64_t size_before, size_after, runs;
+    byte_delta delta;
+    data.read (size_before);
+    data.read (size_after);
+    data.read (delta._hash_before);
+    data.read (delta._hash_after);
+    data.read (runs);
+    delta._size_before = size_before;
+    delta._size_after = size_after;
+    // checked before allocating, the size may come from a damaged file
+    if (data.remaining() < runs)
+    {
+      throw std::logic_error ("edit state is shorter than expected");
+    }
+    delta._runs.resize (runs);
+    data.read (delta._runs.data(), runs);
+    return delta;
+  }
+}
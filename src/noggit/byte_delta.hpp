@@ -0,0 +1,105 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace noggit
+{
+  namespace undo
+  {
+    //! appends the bytes of a trivially copyable value to an edit state
+    template<typename T>
+      void write (std::vector<std::uint8_t>& state, T const& value)
+    {
+      static_assert (std::is_trivially_copyable<T>::value, "written bytewise");
+      std::uint8_t const* bytes (reinterpret_cast<std::uint8_t const*> (&value));
+      state.insert (state.end(), bytes, bytes + sizeof (T));
+    }
+    inline void write (std::vector<std::uint8_t>& state, void const* data, std::size_t size)
+    {
+      std::uint8_t const* bytes (static_cast<std::uint8_t const*> (data));
+      state.insert (state.end(), bytes, bytes + size);
+    }
+
+    class reader
+    {
+    public:
+      reader (std::vector<std::uint8_t> const& state)
+        : _position (state.data())
+        , _end (state.data() + state.size())
+      {}
+
+      template<typename T>
+        void read (T& value)
+      {
+        static_assert (std::is_trivially_copyable<T>::value, "read bytewise");
+        read (&value, sizeof (T));
+      }
+      void read (void* data, std::size_t size)
+      {
+        if (std::size_t (_end - _position) < size)
+        {
+          throw std::logic_error ("edit state is shorter than expected");
+        }
+        std::memcpy (data, _position, size);
+        _position += size;
+      }
+
+      std::size_t remaining() const
+      {
+        return _end - _position;
+      }
+
+    private:
+      std::uint8_t const* _position;
+      std::uint8_t const* _end;
+    };
+  }
+
+  //! The difference between two edit states as the runs of bytes that
+  //! changed, XORed. Applying it to either state gives the other one, so
+  //! the same delta serves undo and redo. Each side is identified by its
+  //! hash, so a state that was changed by something not recorded is left
+  //! alone instead of being garbled.
+  class byte_delta
+  {
+  public:
+    enum class side
+    {
+      before,
+      after,
+    };
+
+    byte_delta ( std::vector<std::uint8_t> const& before
+               , std::vector<std::uint8_t> const& after
+               );
+
+    bool empty() const;
+    //! only turns side \a from into the other one
+    //! \returns false if \a state isn't side \a from
+    bool apply_from (side from, std::vector<std::uint8_t>& state) const;
+    std::size_t memory_usage() const;
+
+    void write (std::vector<std::uint8_t>& data) const;
+    static byte_delta read (undo::reader& data);
+
+  private:
+    byte_delta() = default;
+
+    void flip (std::vector<std::uint8_t>& state, std::size_t target_size) const;
+
+    std::size_t _size_before;
+    std::size_t _size_after;
+    std::uint64_t _hash_before;
+    std::uint64_t _hash_after;
+    //! pairs of a varint count of unchanged bytes and a varint count of
+    //! changed ones followed by those, XORed
+    std::vector<std::uint8_t> _runs;
+  };
+}
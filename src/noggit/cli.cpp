@@ -0,0 +1,534 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/AsyncLoader.h>
+#include <noggit/DBC.h>
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+#include <noggit/Project.h>
+#include <noggit/Settings.h>
+#include <noggit/errorHandling.h>
+#include <noggit/map_horizon.h>
+#include <noggit/map_maintenance.hpp>
+#include <noggit/minimap_baker.hpp>
+#include <noggit/uid_storage.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include <QtCore/QCoreApplication>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//! Runs the map maintenance of the editor on whole maps without a window or
+//! GL context, e.g. from a build script. Every operation writes the tiles it
+//! changes directly, so there is nothing left to save afterwards.
+namespace
+{
+  struct options
+  {
+    std::vector<int> maps;
+    tile_index first = {0, 0};
+    tile_index last = {63, 63};
+    std::size_t threads = 0;
+    std::string report;
+
+    boost::optional<bool> convert_to_big_alpha;
+    bool fix_uids = false;
+    bool delete_duplicates = false;
+    bool fix_gaps = false;
+    bool update_wdl = false;
+    //! output directory of the minimaps, empty to not bake them
+    std::string bake_minimaps;
+    noggit::minimap_format minimap_format = noggit::minimap_format::png;
+  };
+
+  void usage (char const* name)
+  {
+    std::cerr
+      << "usage: " << name << " --map <id> [--map <id> ...] [options] <operations>\n"
+      << "\n"
+      << "operations, run in this order:\n"
+      << "  --convert-alphamaps big|old  rewrite all tiles and the WDT to the given format\n"
+      << "  --fix-uids                   assign unique ids and drop duplicate placements\n"
+      << "  --delete-duplicates          drop duplicate placements, keeping the ids\n"
+      << "  --fix-gaps                   close the gaps between chunks\n"
+      << "  --update-wdl                 regenerate the WDL from the tiles\n"
+      << "  --bake-minimaps <dir>        write the minimap tiles below the directory\n"
+      << "\n"
+      << "options:\n"
+      << "  --format png|blp             file format of the minimaps, defaults to png\n"
+      << "  --tiles <x0> <z0> <x1> <z1>  limit gaps, WDL and minimaps to a range of tiles,\n"
+      << "                               the other operations always need the whole map\n"
+      << "  --threads <n>                worker threads, defaults to one per core\n"
+      << "  --report <file>              write what was done per tile as JSON\n";
+  }
+
+  boost::optional<options> parse (int argc, char* argv[])
+  {
+    options result;
+
+    auto const number
+      ( [&] (int& i) -> boost::optional<long>
+        {
+          if (++i >= argc)
+          {
+            return boost::none;
+          }
+
+          char* end;
+          long const value (std::strtol (argv[i], &end, 10));
+          return *end || value < 0 ? boost::none : boost::make_optional (value);
+        }
+      );
+
+    for (int i (1); i < argc; ++i)
+    {
+      std::string const argument (argv[i]);
+
+      if (argument == "--map")
+      {
+        auto const id (number (i));
+        if (!id)
+        {
+          return boost::none;
+        }
+        result.maps.emplace_back (*id);
+      }
+      else if (argument == "--tiles")
+      {
+        long range[4];
+        for (long& value : range)
+        {
+          auto const parsed (number (i));
+          if (!parsed || *parsed > 63)
+          {
+            return boost::none;
+          }
+          value = *parsed;
+        }
+        result.first = {std::size_t (std::min (range[0], range[2])), std::size_t (std::min (range[1], range[3]))};
+        result.last = {std::size_t (std::max (range[0], range[2])), std::size_t (std::max (range[1], range[3]))};
+      }
+      else if (argument == "--threads")
+      {
+        auto const threads (number (i));
+        if (!threads)
+        {
+          return boost::none;
+        }
+        result.threads = *threads;
+      }
+      else if (argument == "--report" && i + 1 < argc)
+      {
+        result.report = argv[++i];
+      }
+      else if (argument == "--convert-alphamaps" && i + 1 < argc)
+      {
+        std::string const format (argv[++i]);
+        if (format != "big" && format != "old")
+        {
+          return boost::none;
+        }
+        result.convert_to_big_alpha = format == "big";
+      }
+      else if (argument == "--fix-uids")
+      {
+        result.fix_uids = true;
+      }
+      else if (argument == "--delete-duplicates")
+      {
+        result.delete_duplicates = true;
+      }
+      else if (argument == "--fix-gaps")
+      {
+        result.fix_gaps = true;
+      }
+      else if (argument == "--update-wdl")
+      {
+        result.update_wdl = true;
+      }
+      else if (argument == "--bake-minimaps" && i + 1 < argc)
+      {
+        result.bake_minimaps = argv[++i];
+      }
+      else if (argument == "--format" && i + 1 < argc)
+      {
+        std::string const format (argv[++i]);
+        if (format != "png" && format != "blp")
+        {
+          return boost::none;
+        }
+        result.minimap_format = format == "png" ? noggit::minimap_format::png : noggit::minimap_format::blp;
+      }
+      else
+      {
+        return boost::none;
+      }
+    }
+
+    bool const any_operation
+      ( result.convert_to_big_alpha || result.fix_uids || result.delete_duplicates
+      || result.fix_gaps || result.update_wdl || !result.bake_minimaps.empty()
+      );
+
+    if (result.maps.empty() || !any_operation)
+    {
+      return boost::none;
+    }
+
+    return result;
+  }
+
+  struct operation_report
+  {
+    std::string name;
+    float seconds;
+    std::vector<noggit::tile_maintenance_result> tiles;
+    //! set if the operation didn't run at all
+    std::string error;
+  };
+
+  struct map_report
+  {
+    int id;
+    std::string name;
+    std::vector<operation_report> operations;
+  };
+
+  std::string json_string (std::string const& value)
+  {
+    std::string result ("\"");
+    for (char c : value)
+    {
+      switch (c)
+      {
+      case '"': result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\n': result += "\\n"; break;
+      case '\t': result += "\\t"; break;
+      default:
+        if (static_cast<unsigned char> (c) < 0x20)
+        {
+          char escaped[8];
+          std::snprintf (escaped, sizeof (escaped), "\\u%04x", c);
+          result += escaped;
+        }
+        else
+        {
+          result += c;
+        }
+      }
+    }
+    return result + "\"";
+  }
+
+  void write_report (std::ostream& out, std::vector<map_report> const& maps)
+  {
+    out << "{\n  \"maps\": [";
+    for (std::size_t m (0); m < maps.size(); ++m)
+    {
+      out << (m ? "," : "") << "\n    { \"id\": " << maps[m].id
+          << ", \"name\": " << json_string (maps[m].name)
+          << ", \"operations\": [";
+
+      for (std::size_t o (0); o < maps[m].operations.size(); ++o)
+      {
+        operation_report const& operation (maps[m].operations[o]);
+        out << (o ? "," : "") << "\n        { \"name\": " << json_string (operation.name)
+            << ", \"seconds\": " << operation.seconds;
+        if (!operation.error.empty())
+        {
+          out << ", \"error\": " << json_string (operation.error);
+        }
+        out << ", \"tiles\": [";
+
+        for (std::size_t t (0); t < operation.tiles.size(); ++t)
+        {
+          noggit::tile_maintenance_result const& tile (operation.tiles[t]);
+          out << (t ? "," : "") << "\n            { \"x\": " << tile.tile.x << ", \"z\": " << tile.tile.z
+              << ", \"written\": " << (tile.written ? "true" : "false")
+              << ", \"changed_chunks\": " << tile.changed_chunks;
+          if (!tile.error.empty())
+          {
+            out << ", \"error\": " << json_string (tile.error);
+          }
+          out << " }";
+        }
+
+        out << (operation.tiles.empty() ? "" : "\n        ") << "] }";
+      }
+
+      out << (maps[m].operations.empty() ? "" : "\n    ") << "] }";
+    }
+    out << (maps.empty() ? "" : "\n  ") << "]\n}\n";
+  }
+
+  bool run (options const& options, int map_id, map_report& report)
+  {
+    report.id = map_id;
+
+    try
+    {
+      report.name = gMapDB.getByID (map_id).get<MapDB::InternalName>();
+    }
+    catch (MapDB::NotFound)
+    {
+      std::cerr << "map " << map_id << " not found in Map.dbc" << std::endl;
+      return false;
+    }
+
+    boost::optional<noggit::map_maintenance::wdt_info> const wdt
+      (noggit::map_maintenance::read_wdt (report.name));
+    if (!wdt)
+    {
+      std::cerr << "could not read the WDT of " << report.name << std::endl;
+      return false;
+    }
+
+    std::vector<tile_index> const& all_tiles (wdt->tiles);
+    std::vector<tile_index> range;
+    for (tile_index const& tile : all_tiles)
+    {
+      if ( tile.x >= options.first.x && tile.x <= options.last.x
+        && tile.z >= options.first.z && tile.z <= options.last.z
+         )
+      {
+        range.emplace_back (tile);
+      }
+    }
+
+    // what the tiles hold, which the conversion changes
+    bool big_alpha (wdt->big_alpha);
+    bool success (true);
+
+    auto const operation
+      ( [&] (std::string const& name, std::function<void (operation_report&)> const& work)
+        {
+          auto const start (std::chrono::steady_clock::now());
+
+          operation_report result;
+          result.name = name;
+          work (result);
+
+          std::chrono::duration<float> const elapsed (std::chrono::steady_clock::now() - start);
+          result.seconds = elapsed.count();
+
+          std::size_t written (0);
+          std::size_t failed (0);
+          for (noggit::tile_maintenance_result const& tile : result.tiles)
+          {
+            written += tile.written;
+            failed += !tile.error.empty();
+          }
+
+          std::cout << report.name << ": " << name << ": " << written << " of " << result.tiles.size()
+                    << " tiles written, " << failed << " failed in " << result.seconds << " s"
+                    << (result.error.empty() ? "" : " (" + result.error + ")") << std::endl;
+
+          success = success && !failed && result.error.empty();
+          report.operations.emplace_back (std::move (result));
+        }
+      );
+
+    if (options.convert_to_big_alpha)
+    {
+      operation ( "convert-alphamaps"
+                , [&] (operation_report& result)
+                  {
+                    bool const from (big_alpha);
+                    bool const to (*options.convert_to_big_alpha);
+
+                    if (from == to)
+                    {
+                      result.error = "already in this format";
+                      return;
+                    }
+
+                    result.tiles = noggit::map_maintenance::convert_alphamaps
+                      (report.name, all_tiles, from, to, options.threads);
+
+                    // no tile is written if one failed, the flag has to
+                    // keep matching them
+                    if (std::none_of ( result.tiles.begin(), result.tiles.end()
+                                     , [] (noggit::tile_maintenance_result const& tile) { return !tile.error.empty(); }
+                                     )
+                       )
+                    {
+                      big_alpha = to;
+                      if (!noggit::map_maintenance::set_big_alpha (report.name, to))
+                      {
+                        result.error = "could not write the WDT";
+                      }
+                    }
+                  }
+                );
+    }
+
+    // fixing the uids drops the duplicates as well
+    if (options.fix_uids)
+    {
+      operation ( "fix-uids"
+                , [&] (operation_report& result)
+                  {
+                    auto const rewritten
+                      ( noggit::map_maintenance::rewrite_objects
+                          (report.name, all_tiles, true, wdt->sort_models_by_size_class, nullptr, nullptr)
+                      );
+                    result.tiles = rewritten.tiles;
+                    noggit::store_max_uid (map_id, rewritten.highest_uid);
+                  }
+                );
+    }
+    else if (options.delete_duplicates)
+    {
+      operation ( "delete-duplicates"
+                , [&] (operation_report& result)
+                  {
+                    result.tiles = noggit::map_maintenance::rewrite_objects
+                      (report.name, all_tiles, false, wdt->sort_models_by_size_class, nullptr, nullptr).tiles;
+                  }
+                );
+    }
+
+    if (options.fix_gaps)
+    {
+      operation ( "fix-gaps"
+                , [&] (operation_report& result)
+                  {
+                    result.tiles = noggit::map_maintenance::fix_gaps (report.name, range, options.threads);
+                  }
+                );
+    }
+
+    if (options.update_wdl)
+    {
+      operation ( "update-wdl"
+                , [&] (operation_report& result)
+                  {
+                    noggit::map_horizon horizon (report.name);
+                    result.tiles = horizon.update_tiles (range);
+                    horizon.save();
+                  }
+                );
+    }
+
+    // last, so the minimaps show what the other operations did
+    if (!options.bake_minimaps.empty())
+    {
+      operation ( "bake-minimaps"
+                , [&] (operation_report& result)
+                  {
+                    noggit::minimap_bake_settings settings;
+                    settings.output_directory = options.bake_minimaps;
+                    settings.format = options.minimap_format;
+                    settings.threads = options.threads;
+                    settings.texture_cache_directory = Settings::getInstance()->textureCachePath;
+
+                    noggit::minimap_baker baker (report.name, big_alpha);
+                    noggit::minimap_bake_result const baked (baker.bake_all (range, settings));
+
+                    for (tile_index const& tile : range)
+                    {
+                      auto const failed
+                        ( std::find_if ( baked.failed.begin(), baked.failed.end()
+                                       , [&] (std::pair<tile_index, std::string> const& failure)
+                                         {
+                                           return failure.first == tile;
+                                         }
+                                       )
+                        );
+                      result.tiles.push_back ( { tile, failed == baked.failed.end(), 0
+                                               , failed == baked.failed.end() ? "" : failed->second
+                                               }
+                                             );
+                    }
+                  }
+                );
+    }
+
+    return success;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  noggit::RegisterErrorHandlers();
+
+  // for the settings, no event loop is ever run
+  QCoreApplication qapp (argc, argv);
+
+  boost::optional<options> const parsed (parse (argc, argv));
+  if (!parsed)
+  {
+    usage (argv[0]);
+    return 2;
+  }
+
+  // the settings are read relative to the executable, as in the editor
+  try
+  {
+    boost::filesystem::path startup_path (argv[0]);
+    startup_path.remove_filename();
+    if (!startup_path.empty())
+    {
+      boost::filesystem::current_path (boost::filesystem::absolute (startup_path));
+    }
+  }
+  catch (boost::filesystem::filesystem_error const& ex)
+  {
+    std::cerr << ex.what() << std::endl;
+  }
+
+  // the log stays on the console next to the summary
+  boost::filesystem::path const game_path (Settings::getInstance()->gamePath);
+  if (game_path.empty() || !boost::filesystem::exists (game_path / "Data"))
+  {
+    std::cerr << "could not find the data directory of \"" << game_path.string()
+              << "\", see Path in noggit.conf" << std::endl;
+    return 1;
+  }
+
+  if (Project::getInstance()->getPath() == "")
+  {
+    Project::getInstance()->setPath (game_path.string());
+  }
+
+  // the listfiles are read right away instead of on a loader thread
+  AsyncLoader loader;
+  MPQArchive::loadGameArchives (&loader, game_path.string());
+  MPQArchive::allFinishLoading();
+  OpenDBs();
+
+  std::vector<map_report> reports;
+  bool success (true);
+
+  for (int map_id : parsed->maps)
+  {
+    reports.emplace_back();
+    success = run (*parsed, map_id, reports.back()) && success;
+  }
+
+  if (!parsed->report.empty())
+  {
+    std::ofstream report (parsed->report);
+    write_report (report, reports);
+
+    if (!report)
+    {
+      std::cerr << "could not write the report to \"" << parsed->report << "\"" << std::endl;
+      success = false;
+    }
+  }
+
+  MPQArchive::unloadAllMPQs();
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,532 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/Log.h>
+#include <noggit/MapChunk.h>
+#include <noggit/MapTile.h>
+#include <noggit/Misc.h>
+#include <noggit/Model.h>
+#include <noggit/ModelInstance.h>
+#include <noggit/WMO.h>
+#include <noggit/WMOInstance.h>
+#include <noggit/World.h>
+#include <noggit/edit_journal.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+namespace noggit
+{
+  namespace
+  {
+    std::uint32_t const journal_magic (0x4e4a524e); // NJRN
+    std::uint32_t const journal_version (2);
+
+    void write_string (std::vector<std::uint8_t>& data, std::string const& value)
+    {
+      undo::write (data, std::uint32_t (value.size()));
+      undo::write (data, value.data(), value.size());
+    }
+    std::string read_string (undo::reader& data)
+    {
+      std::uint32_t size;
+      data.read (size);
+      if (data.remaining() < size)
+      {
+        throw std::logic_error ("journal record is shorter than expected");
+      }
+      std::string value (size, '\0');
+      data.read (&value[0], size);
+      return value;
+    }
+
+    void write_vector (std::vector<std::uint8_t>& data, math::vector_3d const& value)
+    {
+      undo::write (data, value.x);
+      undo::write (data, value.y);
+      undo::write (data, value.z);
+    }
+    math::vector_3d read_vector (undo::reader& data)
+    {
+      math::vector_3d value;
+      data.read (value.x);
+      data.read (value.y);
+      data.read (value.z);
+      return value;
+    }
+
+    void write_tile (std::vector<std::uint8_t>& data, tile_index const& tile)
+    {
+      undo::write (data, std::uint32_t (tile.x));
+      undo::write (data, std::uint32_t (tile.z));
+    }
+    tile_index read_tile (undo::reader& data)
+    {
+      std::uint32_t x, z;
+      data.read (x);
+      data.read (z);
+      return {x, z};
+    }
+
+    std::uint64_t checksum (std::vector<std::uint8_t> const& data, std::size_t begin, std::size_t end)
+    {
+      return misc::fnv1a (reinterpret_cast<char const*> (data.data() + begin), end - begin);
+    }
+
+    struct journal_record
+    {
+      std::uint32_t type;
+      std::vector<std::uint8_t> payload;
+    };
+
+    //! the records up to the first damaged one and the bytes they take
+    std::vector<journal_record> read_records (std::string const& filename, std::size_t& valid_size)
+    {
+      std::vector<journal_record> records;
+      valid_size = 0;
+
+      std::ifstream file (filename, std::ios::binary);
+      if (!file)
+      {
+        return records;
+      }
+      std::vector<std::uint8_t> const data
+        ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char>());
+
+      // [size of type and payload][type][payload][checksum of type and payload]
+      std::size_t position (0);
+      while (data.size() - position >= 2 * sizeof (std::uint32_t) + sizeof (std::uint64_t))
+      {
+        std::uint32_t size;
+        std::memcpy (&size, data.data() + position, sizeof (size));
+        std::size_t const begin (position + sizeof (size));
+        if (size < sizeof (std::uint32_t) || data.size() - begin < size + sizeof (std::uint64_t))
+        {
+          break;
+        }
+
+        std::uint64_t stored;
+        std::memcpy (&stored, data.data() + begin + size, sizeof (stored));
+        if (stored != checksum (data, begin, begin + size))
+        {
+          break;
+        }
+
+        journal_record record;
+        std::memcpy (&record.type, data.data() + begin, sizeof (record.type));
+        record.payload.assign ( data.begin() + begin + sizeof (record.type)
+                              , data.begin() + begin + size
+                              );
+        records.emplace_back (std::move (record));
+
+        position = begin + size + sizeof (std::uint64_t);
+        valid_size = position;
+      }
+
+      return records;
+    }
+
+    bool is_header_of (journal_record const& record, std::string const& project_path)
+    {
+      if (record.type != 0) // record_type::header
+      {
+        return false;
+      }
+
+      undo::reader data (record.payload);
+      std::uint32_t magic, version;
+      data.read (magic);
+      data.read (version);
+      return magic == journal_magic && version == journal_version
+        && read_string (data) == project_path;
+    }
+
+    template<typename Instance>
+      void place ( World* world
+                 , std::map<int, Instance>& instances
+                 , unsigned int uid
+                 , std::string const& filename
+                 , math::vector_3d const& from
+                 , math::vector_3d const& pos
+                 , math::vector_3d const& dir
+                 , std::function<void (Instance&)> set_uid_and_scale
+                 , std::function<void (Instance*)> update_tiles
+                 )
+    {
+      // the saved instance has to be there to be moved, and its tile has
+      // to be saved without it if it moved to another one
+      world->mapIndex.loadTile (tile_index (pos));
+      world->mapIndex.setChanged (tile_index (from), tile_objects);
+
+      auto instance (instances.find (uid));
+      if (instance == instances.end())
+      {
+        Instance added (filename);
+        set_uid_and_scale (added);
+        instance = instances.emplace (uid, std::move (added)).first;
+      }
+      else
+      {
+        update_tiles (&instance->second);
+        set_uid_and_scale (instance->second);
+      }
+
+      instance->second.pos = pos;
+      instance->second.dir = dir;
+      instance->second.recalcExtents();
+      update_tiles (&instance->second);
+      world->mapIndex.reserve_uid (uid);
+    }
+  }
+
+  edit_journal::edit_journal (std::string filename, std::string const& project_path)
+    : _filename (std::move (filename))
+    , _project_path (project_path)
+  {
+    boost::filesystem::create_directories (boost::filesystem::path (_filename).parent_path());
+
+    std::size_t valid_size;
+    std::vector<journal_record> const records (read_records (_filename, valid_size));
+
+    if (!records.empty() && is_header_of (records.front(), _project_path))
+    {
+      // a torn record would hide everything appended after it
+      boost::filesystem::resize_file (_filename, valid_size);
+      _file = std::fopen (_filename.c_str(), "ab");
+    }
+    else
+    {
+      _file = std::fopen (_filename.c_str(), "wb");
+      if (_file)
+      {
+        std::vector<std::uint8_t> header;
+        write_header (header);
+        std::fwrite (header.data(), 1, header.size(), _file);
+        std::fflush (_file);
+      }
+    }
+
+    if (!_file)
+    {
+      throw std::runtime_error ("unable to open the edit journal " + _filename);
+    }
+
+    _writer = boost::thread (&edit_journal::write_queued, this);
+  }
+
+  edit_journal::~edit_journal()
+  {
+    {
+      boost::mutex::scoped_lock const lock (_mutex);
+      _stop = true;
+    }
+    _condition.notify_one();
+    _writer.join();
+
+    if (_file)
+    {
+      std::fclose (_file);
+    }
+
+    boost::system::error_code ignored;
+    boost::filesystem::remove (_filename, ignored);
+  }
+
+  void edit_journal::chunk_changed ( tile_index const& tile, int x, int z
+                                   , byte_delta const& delta, byte_delta::side from
+                                   )
+  {
+    std::vector<std::uint8_t> payload;
+    write_tile (payload, tile);
+    undo::write (payload, std::int32_t (x));
+    undo::write (payload, std::int32_t (z));
+    undo::write (payload, std::uint8_t (from == byte_delta::side::after));
+    delta.write (payload);
+    append (record_type::chunk_changed, payload);
+  }
+
+  void edit_journal::placed (ModelInstance const& instance, math::vector_3d const& from)
+  {
+    std::vector<std::uint8_t> payload;
+    undo::write (payload, std::uint32_t (instance.uid));
+    write_vector (payload, from);
+    write_vector (payload, instance.pos);
+    write_vector (payload, instance.dir);
+    undo::write (payload, instance.scale);
+    write_string (payload, instance.model->_filename);
+    append (record_type::model_placed, payload);
+  }
+
+  void edit_journal::placed (WMOInstance const& instance, math::vector_3d const& from)
+  {
+    std::vector<std::uint8_t> payload;
+    undo::write (payload, std::uint32_t (instance.mUniqueID));
+    write_vector (payload, from);
+    write_vector (payload, instance.pos);
+    write_vector (payload, instance.dir);
+    write_string (payload, instance.wmo->_filename);
+    append (record_type::wmo_placed, payload);
+  }
+
+  void edit_journal::removed (ModelInstance const& instance)
+  {
+    std::vector<std::uint8_t> payload;
+    undo::write (payload, std::uint32_t (instance.uid));
+    write_vector (payload, instance.pos);
+    append (record_type::model_removed, payload);
+  }
+
+  void edit_journal::removed (WMOInstance const& instance)
+  {
+    std::vector<std::uint8_t> payload;
+    undo::write (payload, std::uint32_t (instance.mUniqueID));
+    write_vector (payload, instance.pos);
+    append (record_type::wmo_removed, payload);
+  }
+
+  void edit_journal::tile_reloaded (tile_index const& tile)
+  {
+    std::vector<std::uint8_t> payload;
+    write_tile (payload, tile);
+    append (record_type::tile_reloaded, payload);
+  }
+
+  void edit_journal::checkpoint()
+  {
+    {
+      boost::mutex::scoped_lock const lock (_mutex);
+      _queued.clear();
+      _truncate = !_stop;
+    }
+    _condition.notify_one();
+  }
+
+  void edit_journal::append (record_type type, std::vector<std::uint8_t> const& payload)
+  {
+    {
+      boost::mutex::scoped_lock const lock (_mutex);
+      if (_stop)
+      {
+        return;
+      }
+      undo::write (_queued, std::uint32_t (sizeof (type) + payload.size()));
+      std::size_t const begin (_queued.size());
+      undo::write (_queued, type);
+      undo::write (_queued, payload.data(), payload.size());
+      undo::write (_queued, checksum (_queued, begin, _queued.size()));
+    }
+    _condition.notify_one();
+  }
+
+  void edit_journal::write_header (std::vector<std::uint8_t>& output) const
+  {
+    std::vector<std::uint8_t> payload;
+    undo::write (payload, journal_magic);
+    undo::write (payload, journal_version);
+    write_string (payload, _project_path);
+
+    undo::write (output, std::uint32_t (sizeof (record_type) + payload.size()));
+    std::size_t const begin (output.size());
+    undo::write (output, record_type::header);
+    undo::write (output, payload.data(), payload.size());
+    undo::write (output, checksum (output, begin, output.size()));
+  }
+
+  void edit_journal::write_queued()
+  {
+    std::vector<std::uint8_t> batch;
+
+    for (;;)
+    {
+      bool truncate;
+      {
+        boost::mutex::scoped_lock lock (_mutex);
+        while (_queued.empty() && !_truncate && !_stop)
+        {
+          _condition.wait (lock);
+        }
+        if (_queued.empty() && !_truncate)
+        {
+          return;
+        }
+
+        // everything queued while the last batch was written goes at once
+        batch.swap (_queued);
+        truncate = _truncate;
+        _truncate = false;
+      }
+
+      if (truncate)
+      {
+        std::vector<std::uint8_t> header;
+        write_header (header);
+        batch.insert (batch.begin(), header.begin(), header.end());
+
+        if (!(_file = std::freopen (_filename.c_str(), "wb", _file)))
+        {
+          LogError << "journal: unable to reopen " << _filename << ", edits aren't journaled anymore." << std::endl;
+          boost::mutex::scoped_lock const lock (_mutex);
+          _queued.clear();
+          _stop = true;
+          return;
+        }
+      }
+
+      if ( std::fwrite (batch.data(), 1, batch.size(), _file) != batch.size()
+        || std::fflush (_file)
+         )
+      {
+        LogError << "journal: writing to " << _filename << " failed." << std::endl;
+      }
+      batch.clear();
+    }
+  }
+
+  std::size_t edit_journal::replay ( std::string const& filename
+                                   , std::string const& project_path
+                                   , World* world
+                                   , bool objects
+                                   )
+  {
+    std::size_t valid_size;
+    std::vector<journal_record> const records (read_records (filename, valid_size));
+
+    if (records.empty())
+    {
+      return 0;
+    }
+    if (!is_header_of (records.front(), project_path))
+    {
+      LogError << "journal: " << filename << " was written for another project, ignored." << std::endl;
+      return 0;
+    }
+
+    std::size_t applied (0);
+    std::size_t skipped (0);
+
+    for (std::size_t i (1); i < records.size(); ++i)
+    {
+      undo::reader data (records[i].payload);
+
+      switch (static_cast<record_type> (records[i].type))
+      {
+      case record_type::chunk_changed:
+        {
+          tile_index const index (read_tile (data));
+          std::int32_t x, z;
+          std::uint8_t after;
+          data.read (x);
+          data.read (z);
+          data.read (after);
+          byte_delta const delta (byte_delta::read (data));
+
+          MapTile* tile (world->mapIndex.loadTile (index));
+          if (!tile || x < 0 || x >= 16 || z < 0 || z >= 16)
+          {
+            ++skipped;
+            break;
+          }
+
+          MapChunk* chunk (tile->getChunk (x, z));
+          std::vector<std::uint8_t> state (chunk->edit_state());
+          // chunks saved after the record are already past it
+          if (!delta.apply_from (after ? byte_delta::side::after : byte_delta::side::before, state))
+          {
+            ++skipped;
+            break;
+          }
+
+          chunk->restore_edit_state (state);
+          world->mapIndex.setChanged (tile);
+          ++applied;
+        }
+        break;
+
+      case record_type::model_placed:
+      case record_type::wmo_placed:
+        if (objects)
+        {
+          bool const wmo (records[i].type == std::uint32_t (record_type::wmo_placed));
+          std::uint32_t uid;
+          data.read (uid);
+          math::vector_3d const from (read_vector (data));
+          math::vector_3d const pos (read_vector (data));
+          math::vector_3d const dir (read_vector (data));
+          float scale (1.0f);
+          if (!wmo)
+          {
+            data.read (scale);
+          }
+          std::string const model (read_string (data));
+
+          if (wmo)
+          {
+            place<WMOInstance> ( world, world->mWMOInstances, uid, model, from, pos, dir
+                               , [&] (WMOInstance& instance) { instance.mUniqueID = uid; }
+                               , [&] (WMOInstance* instance) { world->updateTilesWMO (instance); }
+                               );
+          }
+          else
+          {
+            place<ModelInstance> ( world, world->mModelInstances, uid, model, from, pos, dir
+                                 , [&] (ModelInstance& instance)
+                                   {
+                                     instance.uid = uid;
+                                     instance.scale = scale;
+                                   }
+                                 , [&] (ModelInstance* instance) { world->updateTilesModel (instance); }
+                                 );
+          }
+          ++applied;
+        }
+        break;
+
+      case record_type::model_removed:
+      case record_type::wmo_removed:
+        if (objects)
+        {
+          std::uint32_t uid;
+          data.read (uid);
+          // loaded first, or the saved instance would come back with its tile
+          world->mapIndex.loadTile (tile_index (read_vector (data)));
+
+          if (records[i].type == std::uint32_t (record_type::wmo_removed))
+          {
+            world->deleteWMOInstance (uid);
+          }
+          else
+          {
+            world->deleteModelInstance (uid);
+          }
+          ++applied;
+        }
+        break;
+
+      case record_type::tile_reloaded:
+        {
+          tile_index const tile (read_tile (data));
+          if (world->mapIndex.tileLoaded (tile))
+          {
+            world->reload_tile (tile);
+          }
+          ++applied;
+        }
+        break;
+
+      default:
+        ++skipped;
+        break;
+      }
+    }
+
+    Log << "journal: recovered " << applied << " unsaved edits from " << filename
+        << ", skipped " << skipped << " of chunks saved since or not found." << std::endl;
+
+    return applied;
+  }
+}
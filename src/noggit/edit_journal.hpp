@@ -0,0 +1,93 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/tile_index.hpp>
+#include <noggit/undo_stack.hpp>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class ModelInstance;
+class WMOInstance;
+class World;
+
+namespace noggit
+{
+  //! Append-only log of the edits since the last save, so they survive a
+  //! crash: the changed bytes of chunks as recorded by the undo stack and
+  //! the objects placed, moved and removed. Records are queued by the
+  //! editing thread and written by a worker, which writes everything
+  //! queued in the meantime at once and flushes it, so saving costs about
+  //! as much as the bytes edited.
+  //! Every record carries a checksum, so a record torn by a crash ends the
+  //! replay instead of being applied. A journal that is destroyed normally
+  //! is removed, only a crash leaves one behind.
+  class edit_journal
+  {
+  public:
+    //! appends to \a filename unless it was written for another project
+    edit_journal (std::string filename, std::string const& project_path);
+    ~edit_journal();
+
+    void chunk_changed ( tile_index const& tile, int x, int z
+                       , byte_delta const& delta, byte_delta::side from
+                       );
+    //! added or moved, \a from is the position before the move so replay
+    //! saves its old tile too, added instances pass their own position
+    void placed (ModelInstance const& instance, math::vector_3d const& from);
+    void placed (WMOInstance const& instance, math::vector_3d const& from);
+    void removed (ModelInstance const& instance);
+    void removed (WMOInstance const& instance);
+    void tile_reloaded (tile_index const& tile);
+
+    //! everything is saved, the records so far are dropped
+    void checkpoint();
+
+    //! applies the records of \a filename to \a world on top of the saved
+    //! tiles, loading the tiles they touch and marking them changed.
+    //! Chunks saved after their record was written are left alone. Object
+    //! records are skipped if \a objects is false, e.g. after the uids
+    //! were rewritten.
+    //! \returns the number of records applied
+    static std::size_t replay ( std::string const& filename
+                              , std::string const& project_path
+                              , World* world
+                              , bool objects
+                              );
+
+  private:
+    enum class record_type : std::uint32_t
+    {
+      header,
+      chunk_changed,
+      model_placed,
+      wmo_placed,
+      model_removed,
+      wmo_removed,
+      tile_reloaded,
+    };
+
+    void append (record_type type, std::vector<std::uint8_t> const& payload);
+    void write_header (std::vector<std::uint8_t>& output) const;
+    void write_queued();
+
+    std::string _filename;
+    std::string _project_path;
+    std::FILE* _file;
+
+    boost::mutex _mutex;
+    boost::condition_variable _condition;
+    //! serialized records not yet written
+    std::vector<std::uint8_t> _queued;
+    bool _truncate = false;
+    bool _stop = false;
+    boost::thread _writer;
+  };
+}
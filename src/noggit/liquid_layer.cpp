@@ -203,10 +203,10 @@ void liquid_layer::changeLiquidID(int id)
   try
   {
     DBCFile::Record lLiquidTypeRow = gLiquidTypeDB.getByID(_liquid_id);
-    _render.setTextures(lLiquidTypeRow.getString(LiquidTypeDB::TextureFilenames - 1));
+    _render.setTextures(lLiquidTypeRow.get<LiquidTypeDB::TextureFilenames>());
 
     // !\ todo: handle lava (type == 2) that use uv_mapping
-    switch (lLiquidTypeRow.getInt(LiquidTypeDB::Type))
+    switch (lLiquidTypeRow.get<LiquidTypeDB::Type>())
     {
     case 1: // ocean
       _liquid_vertex_format = 2;
@@ -311,10 +311,10 @@ void liquid_layer::crop(MapChunk* chunk)
         {
           int water_index = 9 * z + x, terrain_index = 17 * z + x;
 
-          if (_vertices[water_index].y < chunk->mVertices[terrain_index].y
-            && _vertices[water_index + 1].y < chunk->mVertices[terrain_index + 1].y
-            && _vertices[water_index + 9].y < chunk->mVertices[terrain_index + 17].y
-            && _vertices[water_index + 10].y < chunk->mVertices[terrain_index + 18].y
+          if (_vertices[water_index].y < chunk->height (terrain_index)
+            && _vertices[water_index + 1].y < chunk->height (terrain_index + 1)
+            && _vertices[water_index + 9].y < chunk->height (terrain_index + 17)
+            && _vertices[water_index + 10].y < chunk->height (terrain_index + 18)
             )
           {
             setSubchunk(x, z, false);
@@ -466,6 +466,6 @@ void liquid_layer::copy_subchunk_height(int x, int z, liquid_layer const& from)
 
 void liquid_layer::update_vertex_opacity(int x, int z, MapChunk* chunk, float factor)
 {
-  float diff = _vertices[z * 9 + x].y - chunk->mVertices[z * 17 + x].y;
+  float diff = _vertices[z * 9 + x].y - chunk->height (z * 17 + x);
   _depth[z * 9 + x] = diff < 0.0f ? 0.0f : (std::min(1.0f, std::max(0.0f, (diff + 1.0f) * factor)));
 }
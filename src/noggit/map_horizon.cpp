@@ -4,12 +4,16 @@
 
 #include <noggit/MPQ.h>
 #include <noggit/Log.h>
-#include <noggit/map_index.hpp>
-#include <noggit/World.h>
-#include <opengl/context.hpp>
-#include <opengl/matrix.hpp>
-
+#include <noggit/MapHeaders.h>
+#include <noggit/Misc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <sstream>
+#include <thread>
 
 struct color
 {
@@ -53,7 +57,7 @@ static inline color lerp_color(const color& start, const color& end, float t)
                );
 }
 
-static inline uint32_t color_for_height (int16_t height)
+uint32_t noggit::map_horizon::color_for_height (int16_t height)
 {
   static const ranged_color colors[] =
     { ranged_color (color (20, 149, 7), 0, 600)
@@ -87,15 +91,102 @@ static inline uint32_t color_for_height (int16_t height)
 
   return lerp_color(colors[correct_color]._color, colors[correct_color + 1]._color, t);
 }
+
+//! the WDL resolution is one height per chunk corner and chunk center
+static std::unique_ptr<noggit::map_horizon_tile> horizon_tile_from_adt (std::string const& filename)
+{
+  MPQFile adt (filename);
+  if (adt.isEof())
+  {
+    LogError << "horizon: can't open \"" << filename << "\"." << std::endl;
+    return nullptr;
+  }
+
+  auto tile (std::make_unique<noggit::map_horizon_tile>());
+
+  auto const clamped
+    ( [] (float height)
+      {
+        return static_cast<int16_t> (std::max (-32768.0f, std::min (32767.0f, std::round (height))));
+      }
+    );
+
+  char const* const end (adt.getBuffer() + adt.getSize());
+
+  for (char const* position (adt.getBuffer()); position + 8 <= end;)
+  {
+    uint32_t fourcc;
+    uint32_t size;
+    std::memcpy (&fourcc, position, 4);
+    std::memcpy (&size, position + 4, 4);
+
+    if (fourcc == 'MCNK' && position + 8 + sizeof (MapChunkHeader) <= end)
+    {
+      MapChunkHeader header;
+      std::memcpy (&header, position + 8, sizeof (MapChunkHeader));
+
+      // MCVT is 9 outer and 8 inner heights per row, relative to ypos
+      char const* const mcvt (position + header.ofsHeight);
+      float heights[145];
+
+      if ( header.ix < 16 && header.iy < 16
+        && mcvt + 8 + sizeof (heights) <= end
+        && *reinterpret_cast<uint32_t const*> (mcvt) == 'MCVT'
+         )
+      {
+        std::memcpy (heights, mcvt + 8, sizeof (heights));
+
+        auto const outer
+          ( [&] (int row, int column)
+            {
+              return clamped (header.ypos + heights[row * 17 + column]);
+            }
+          );
+
+        tile->height_17[header.iy][header.ix] = outer (0, 0);
+        tile->height_16[header.iy][header.ix] = outer (4, 4);
+
+        // the last row and column of corners come from the border chunks
+        if (header.ix == 15)
+        {
+          tile->height_17[header.iy][16] = outer (0, 8);
+        }
+        if (header.iy == 15)
+        {
+          tile->height_17[16][header.ix] = outer (8, 0);
+        }
+        if (header.ix == 15 && header.iy == 15)
+        {
+          tile->height_17[16][16] = outer (8, 8);
+        }
+
+        // only chunks which are holes entirely are left out of the horizon
+        if ((header.holes & 0xFFFF) == 0xFFFF)
+        {
+          tile->holes[header.iy] |= 1 << header.ix;
+        }
+      }
+    }
+
+    position += 8 + size;
+  }
+
+  return tile;
+}
+
 namespace noggit
 {
 
 map_horizon::map_horizon(const std::string& basename)
+  : _basename (basename)
 {
   std::stringstream filename;
   filename << "World\\Maps\\" << basename << "\\" << basename << ".wdl";
   _filename = filename.str();
 
+  _qt_minimap = QImage (16 * 64, 16 * 64, QImage::Format_ARGB32);
+  _qt_minimap.fill (Qt::transparent);
+
   MPQFile wdl_file (_filename);
   if (wdl_file.isEof())
   {
@@ -116,35 +207,24 @@ map_horizon::map_horizon(const std::string& basename)
 
   assert (fourcc == 'MVER' && size == 4 && version == 18);
 
-  // - MWMO ----------------------------------------------
-
-  wdl_file.read (&fourcc, 4);
-  wdl_file.read (&size, 4);
-
-  assert (fourcc == 'MWMO');
-      // Filenames for WMO that appear in the low resolution map. Zero terminated strings.
-
-  wdl_file.seekRelative (size);
-
-  // - MWID ----------------------------------------------
+  // - MWMO, MWID, MODF ----------------------------------
+  // Filenames, indexes into them and placement information of the WMOs
+  // appearing in the low resolution map. Not used by noggit but kept for
+  // writing the file again.
 
-  wdl_file.read (&fourcc, 4);
-  wdl_file.read (&size, 4);
-
-  assert (fourcc == 'MWID');
-      // List of indexes into the MWMO tile.
-
-  wdl_file.seekRelative (size);
-
-  // - MODF ----------------------------------------------
-
-  wdl_file.read (&fourcc, 4);
-  wdl_file.read (&size, 4);
+  for (uint32_t expected : {'MWMO', 'MWID', 'MODF'})
+  {
+    wdl_file.read (&fourcc, 4);
+    wdl_file.read (&size, 4);
 
-  assert (fourcc == 'MODF');
-      // Placement information for the WMO. Appears to be the same 64 byte structure used in the WDT and ADT MODF tiles.
+    assert (fourcc == expected);
 
-  wdl_file.seekRelative (size);
+    std::size_t const position (_wmo_chunks.size());
+    _wmo_chunks.resize (position + 8 + size);
+    std::memcpy (_wmo_chunks.data() + position, &fourcc, 4);
+    std::memcpy (_wmo_chunks.data() + position + 4, &size, 4);
+    wdl_file.read (_wmo_chunks.data() + position + 8, size);
+  }
 
   // - MAOF ----------------------------------------------
 
@@ -173,218 +253,151 @@ map_horizon::map_horizon(const std::string& basename)
 
       _tiles[y][x] = std::make_unique<map_horizon_tile>();
 
-      //! \todo There also is MAHO giving holes into this heightmap.
       wdl_file.read(_tiles[y][x]->height_17, 17 * 17 * sizeof(int16_t));
       wdl_file.read(_tiles[y][x]->height_16, 16 * 16 * sizeof(int16_t));
-    }
-  }
-
-  wdl_file.close();
 
-  _qt_minimap = QImage (16 * 64, 16 * 64, QImage::Format_ARGB32);
-  _qt_minimap.fill (Qt::transparent);
-
-  for (size_t y (0); y < 64; ++y)
-  {
-    for (size_t x (0); x < 64; ++x)
-    {
-      if (_tiles[y][x])
+      // MAHO is optional and directly follows its MARE
+      if (!wdl_file.isEof())
       {
-        //! \todo There also is a second heightmap appended which has additional 16*16 pixels.
-        //! \todo There also is MAHO giving holes into this heightmap.
+        wdl_file.read (&fourcc, 4);
+        wdl_file.read (&size, 4);
 
-        for (size_t j (0); j < 16; ++j)
+        if (fourcc == 'MAHO' && size == sizeof (_tiles[y][x]->holes))
         {
-          for (size_t i (0); i < 16; ++i)
-          {
-            //! \todo R and B are inverted here
-            _qt_minimap.setPixel (x * 16 + i, y * 16 + j, color_for_height (_tiles[y][x]->height_17[j][i]));
-          }
+          wdl_file.read (_tiles[y][x]->holes, sizeof (_tiles[y][x]->holes));
         }
       }
+
+      update_minimap (x, y);
     }
   }
+
+  wdl_file.close();
 }
 
-map_horizon::minimap::minimap(const map_horizon& horizon)
+void map_horizon::update_minimap (std::size_t x, std::size_t y)
 {
-  std::vector<uint32_t> texture(1024 * 1024);
-
-  for (size_t y (0); y < 64; ++y)
+  //! \todo There also is a second heightmap appended which has additional 16*16 pixels.
+  for (size_t j (0); j < 16; ++j)
   {
-    for (size_t x (0); x < 64; ++x)
+    for (size_t i (0); i < 16; ++i)
     {
-      if (!horizon._tiles[y][x])
-        continue;
-
-      //! \todo There also is a second heightmap appended which has additional 16*16 pixels.
-
-      // use the (nearly) full resolution available to us.
-      // the data is layed out as a triangle fans with with 17 outer values
-      // and 16 midpoints per tile. which in turn means:
-      //      _tiles[y][x]->height_17[16][16] == _tiles[y][x + 1]->height_17[0][0]
-      for (size_t j (0); j < 16; ++j)
-      {
-        for (size_t i (0); i < 16; ++i)
-        {
-          texture[(y * 16 + j) * 1024 + x * 16 + i] = color_for_height (horizon._tiles[y][x]->height_17[j][i]);
-        }
-      }
+      //! \todo R and B are inverted here
+      _qt_minimap.setPixel ( x * 16 + i, y * 16 + j
+                           , !_tiles[y][x] || _tiles[y][x]->holes[j] & (1 << i)
+                           ? 0u
+                           : color_for_height (_tiles[y][x]->height_17[j][i])
+                           );
     }
   }
-
-  bind();
-  gl.texImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1024, 1024, 0, GL_BGRA, GL_UNSIGNED_BYTE, texture.data());
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  gl.texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 }
 
-map_horizon::render::render(const map_horizon& horizon)
+std::vector<tile_maintenance_result> map_horizon::update_tiles (std::vector<tile_index> const& tiles)
 {
-  std::vector<math::vector_3d> vertices;
-
-  for (size_t y (0); y < 64; ++y)
+  std::vector<tile_maintenance_result> results;
+  for (tile_index const& tile : tiles)
   {
-    for (size_t x (0); x < 64; ++x)
-    {
-      if (!horizon._tiles[y][x])
-        continue;
+    results.push_back ({tile, false, 0, "could not be read, the previous horizon is kept"});
+  }
 
-      _batches[y][x] = map_horizon_batch (vertices.size(), 17 * 17 + 16 * 16);
+  std::atomic<std::size_t> next (0);
 
-      for (size_t j (0); j < 17; ++j)
+  auto const worker
+    ( [&]
       {
-        for (size_t i (0); i < 17; ++i)
+        for (std::size_t i; (i = next++) < tiles.size();)
         {
-          vertices.emplace_back ( TILESIZE * (x + i / 16.0f)
-                                , horizon._tiles[y][x]->height_17[j][i]
-                                , TILESIZE * (y + j / 16.0f)
-                                );
+          tile_index const& tile (tiles[i]);
+          std::stringstream filename;
+          filename << "World\\Maps\\" << _basename << "\\" << _basename
+                   << "_" << tile.x << "_" << tile.z << ".adt";
+
+          // every tile is written by one worker only. A tile that can't be
+          // read keeps the horizon it had instead of punching a hole in it.
+          auto updated (horizon_tile_from_adt (filename.str()));
+          if (updated)
+          {
+            _tiles[tile.z][tile.x] = std::move (updated);
+            results[i].written = true;
+            results[i].error.clear();
+          }
         }
       }
+    );
 
-      for (size_t j (0); j < 16; ++j)
-      {
-        for (size_t i (0); i < 16; ++i)
-        {
-          vertices.emplace_back ( TILESIZE * (x + (i + 0.5f) / 16.0f)
-                                , horizon._tiles[y][x]->height_16[j][i]
-                                , TILESIZE * (y + (j + 0.5f) / 16.0f)
-                                );
-        }
-      }
-    }
+  unsigned int const thread_count
+    (std::max (1u, std::min<unsigned int> (std::thread::hardware_concurrency(), tiles.size())));
+
+  std::vector<std::thread> threads;
+  for (unsigned int i (1); i < thread_count; ++i)
+  {
+    threads.emplace_back (worker);
   }
+  worker();
 
-  gl.bufferData<GL_ARRAY_BUFFER> (_vertex_buffer, vertices.size() * sizeof (math::vector_3d), vertices.data(), GL_STATIC_DRAW);
-}
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
 
-static inline uint32_t outer_index(const map_horizon_batch &batch, int y, int x)
-{
-  return batch.vertex_start + y * 17 + x;
-};
+  for (tile_index const& tile : tiles)
+  {
+    update_minimap (tile.x, tile.z);
+  }
 
-static inline uint32_t inner_index(const map_horizon_batch &batch, int y, int x)
-{
-  return batch.vertex_start + 17 * 17 + y * 16 + x;
-};
+  return results;
+}
 
-void map_horizon::render::draw( MapIndex *index
-                              , const math::vector_3d& color
-                              , const float& cull_distance
-                              , const math::frustum& frustum
-                              , const math::vector_3d& camera )
+void map_horizon::save() const
 {
-  std::vector<uint32_t> indices;
+  sExtendableArray wdl_file;
 
-  const tile_index current_index(camera);
-  const int lrr = 2;
+  wdl_file.Extend (8 + 4);
+  SetChunkHeader (wdl_file, 0, 'MVER', 4);
+  *wdl_file.GetPointer<uint32_t> (8) = 18;
 
-  for (size_t y (current_index.z - lrr); y <= current_index.z + lrr; ++y)
+  if (_wmo_chunks.empty())
   {
-    for (size_t x (current_index.x - lrr); x < current_index.x + lrr; ++x)
+    for (int fourcc : {'MWMO', 'MWID', 'MODF'})
     {
-      // x and y are unsigned so negative signed int value are positive and > 63
-      if (x > 63 || y > 63)
-      {
-        continue;
-      }
+      wdl_file.Extend (8);
+      SetChunkHeader (wdl_file, wdl_file.data.size() - 8, fourcc, 0);
+    }
+  }
+  else
+  {
+    wdl_file.Insert (wdl_file.data.size(), _wmo_chunks.size(), _wmo_chunks.data());
+  }
 
-      map_horizon_batch const& batch = _batches[y][x];
+  std::size_t const maof_position (wdl_file.data.size());
+  wdl_file.Extend (8 + 64 * 64 * sizeof (uint32_t));
+  SetChunkHeader (wdl_file, maof_position, 'MAOF', 64 * 64 * sizeof (uint32_t));
 
-      if (batch.vertex_count == 0)
+  for (size_t y (0); y < 64; ++y)
+  {
+    for (size_t x (0); x < 64; ++x)
+    {
+      if (!_tiles[y][x])
         continue;
 
-      for (size_t j (0); j < 16; ++j)
-      {
-        for (size_t i (0); i < 16; ++i)
-        {
-          // do not draw over visible chunks
-          if (index->tileLoaded ({y, x}) && index->getTile ({y, x})->getChunk (j, i)->is_visible (cull_distance, frustum, camera))
-            continue;
-
-          indices.push_back (inner_index (batch, j, i));
-          indices.push_back (outer_index (batch, j, i));
-          indices.push_back (outer_index (batch, j + 1, i));
-
-          indices.push_back (inner_index (batch, j, i));
-          indices.push_back (outer_index (batch, j + 1, i));
-          indices.push_back (outer_index (batch, j + 1, i + 1));
-
-          indices.push_back (inner_index (batch, j, i));
-          indices.push_back (outer_index (batch, j + 1, i + 1));
-          indices.push_back (outer_index (batch, j, i + 1));
-
-          indices.push_back (inner_index (batch, j, i));
-          indices.push_back (outer_index (batch, j, i + 1));
-          indices.push_back (outer_index (batch, j, i));
-        }
-      }
+      std::size_t const position (wdl_file.data.size());
+      wdl_file.GetPointer<uint32_t> (maof_position + 8)[y * 64 + x] = position;
+
+      wdl_file.Extend (8 + 0x442 + 8 + sizeof (_tiles[y][x]->holes));
+      SetChunkHeader (wdl_file, position, 'MARE', 0x442);
+      std::memcpy (wdl_file.GetPointer<char> (position + 8), _tiles[y][x]->height_17, 0x442);
+      SetChunkHeader (wdl_file, position + 8 + 0x442, 'MAHO', sizeof (_tiles[y][x]->holes));
+      std::memcpy ( wdl_file.GetPointer<char> (position + 8 + 0x442 + 8)
+                  , _tiles[y][x]->holes
+                  , sizeof (_tiles[y][x]->holes)
+                  );
     }
   }
 
-  static opengl::program const program
-      { { GL_VERTEX_SHADER
-        , R"code(
-#version 110
-
-attribute vec4 position;
-
-uniform mat4 model_view;
-uniform mat4 projection;
-
-void main()
-{
-  gl_Position = projection * model_view * position;
-}
-)code"
-        }
-      , { GL_FRAGMENT_SHADER
-        , R"code(
-#version 110
-
-uniform vec3 color;
-
-void main()
-{
-  gl_FragColor = vec4(color, 1.0);
-}
-)code"
-        }
-      };
-
-  opengl::scoped::use_program shader {program};
-
-  shader.uniform ("model_view", opengl::matrix::model_view());
-  shader.uniform ("projection", opengl::matrix::projection());
-  shader.uniform ("color", color);
-
-  shader.attrib ("position", _vertex_buffer, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-  opengl::scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> _ (_index_buffer);
-
-  gl.bufferData (GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof (uint32_t), indices.data(), GL_STATIC_DRAW);
-  gl.drawElements (GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
+  MPQFile f (_filename);
+  f.setBuffer (wdl_file.data);
+  f.SaveFile();
+  f.close();
 }
 
 }
@@ -3,6 +3,8 @@
 #pragma once
 
 #include <math/frustum.hpp>
+#include <noggit/map_maintenance.hpp>
+#include <noggit/tile_index.hpp>
 
 #include <opengl/texture.hpp>
 #include <opengl/scoped.hpp>
@@ -10,8 +12,10 @@
 #include <QtGui/QImage>
 
 #include <memory>
+#include <string>
+#include <vector>
 
-class MapIndex;
+class MapChunk;
 
 namespace noggit
 {
@@ -20,6 +24,8 @@ struct map_horizon_tile
 {
     int16_t height_17[17][17];
     int16_t height_16[16][16];
+    //! MAHO, bit i of row j is set where chunk (i, j) is a hole
+    uint16_t holes[16];
 };
 
 struct map_horizon_batch
@@ -36,6 +42,7 @@ struct map_horizon_batch
 
   uint32_t vertex_start;
   uint32_t vertex_count;
+  uint16_t holes[16] = {};
 };
 
 class map_horizon
@@ -45,10 +52,9 @@ public:
   {
     render(const map_horizon& horizon);
 
-    void draw( MapIndex *index
-             , const math::vector_3d& color
-             , const float& cull_distance
-             , const math::frustum& frustum
+    //! draws around the camera where none of \a visible_chunks covers
+    void draw( const math::vector_3d& color
+             , std::vector<MapChunk*> const& visible_chunks
              , const math::vector_3d& camera );
 
     map_horizon_batch _batches[64][64];
@@ -66,11 +72,28 @@ public:
 
   map_horizon(const std::string& basename);
 
+  //! downsamples the terrain of \a tiles from their ADTs as saved, on a
+  //! pool of threads and without loading anything but the MCNKs. renders
+  //! created before need to be recreated to show the change. Tiles that
+  //! can't be read are left as they were.
+  //! \returns whether each tile was updated, in the order of \a tiles
+  std::vector<tile_maintenance_result> update_tiles (std::vector<tile_index> const& tiles);
+  //! writes the WDL, the low resolution WMO chunks are kept as read
+  void save() const;
+
   QImage _qt_minimap;
 
 private:
+  static uint32_t color_for_height (int16_t height);
+
+  void update_minimap (std::size_t x, std::size_t y);
+
+  std::string _basename;
   std::string _filename;
 
+  //! MWMO, MWID and MODF including their headers
+  std::vector<char> _wmo_chunks;
+
   std::unique_ptr<map_horizon_tile> _tiles[64][64];
 };
 
@@ -5,7 +5,10 @@
 #include <noggit/MapChunk.h>
 #include <noggit/MapTile.h>
 #include <noggit/Misc.h>
+#include <noggit/ModelInstance.h>
 #include <noggit/Project.h>
+#include <noggit/Settings.h>
+#include <noggit/WMOInstance.h>
 #include <noggit/World.h>
 #ifdef USE_MYSQL_UID_STORAGE
   #include <mysql/mysql.h>
@@ -15,7 +18,9 @@
 
 #include <boost/range/adaptor/map.hpp>
 
-#include <forward_list>
+#include <algorithm>
+#include <cmath>
+#include <map>
 
 MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world)
   : basename(pBasename)
@@ -136,11 +141,17 @@ MapIndex::MapIndex (const std::string &pBasename, int map_id, World* world)
 
 void MapIndex::saveall (World* world)
 {
+  std::vector<tile_index> saved;
+
   for (MapTile* tile : loaded_tiles())
   {
     tile->saveTile (false, world);
     tile->changed = 0;
+    saved.emplace_back (tile->index);
   }
+
+  world->checkpoint_journal();
+  world->update_horizon (saved);
 }
 
 void MapIndex::save()
@@ -243,19 +254,19 @@ void MapIndex::enterTile(const tile_index& tile)
   }
 }
 
-void MapIndex::setChanged(const tile_index& tile)
+void MapIndex::setChanged(const tile_index& tile, int families)
 {
   MapTile* mTile = loadTile(tile);
 
   if (!!mTile)
   {
-    mTile->changed = 1;
+    mTile->changed |= families;
   }
 }
 
-void MapIndex::setChanged(MapTile* tile)
+void MapIndex::setChanged(MapTile* tile, int families)
 {
-  setChanged(tile->index);
+  setChanged(tile->index, families);
 }
 
 void MapIndex::unsetChanged(const tile_index& tile)
@@ -379,6 +390,7 @@ void MapIndex::saveTile(const tile_index& tile, World* world)
 	{
     saveMaxUID();
 		mTiles[tile.z][tile.x].tile->saveTile (false, world);
+    world->update_horizon ({tile});
 	}
 }
 
@@ -389,14 +401,28 @@ void MapIndex::saveChanged (World* world)
 
   saveMaxUID();
 
+  std::vector<tile_index> terrain_changed;
+
   for (MapTile* tile : loaded_tiles())
   {
     if (tile->changed)
     {
-      tile->saveTile (false, world);
+      if (tile->changed & tile_terrain)
+      {
+        terrain_changed.emplace_back (tile->index);
+      }
+
+      // object only edits don't need the terrain to be serialized again
+      if (tile->changed != tile_objects || !tile->saveObjects (world))
+      {
+        tile->saveTile (false, world);
+      }
       tile->changed = 0;
     }
   }
+
+  world->checkpoint_journal();
+  world->update_horizon (terrain_changed);
 }
 
 bool MapIndex::hasAGlobalWMO()
@@ -566,287 +592,97 @@ uint32_t MapIndex::newGUID()
 #endif
 }
 
-inline bool floatEqual(float const& a, float const& b)
+void MapIndex::reserve_uid (uint32_t uid)
 {
-  return std::abs(a - b) < 0.0001f;
+  highestGUID = std::max (highestGUID, uid);
 }
 
-void MapIndex::fixUIDs (World* world)
+std::vector<tile_index> MapIndex::fixUIDs
+  (World* world, std::function<void (uid_fix_progress const&)> progress)
 {
-  // pre-cond: mTiles[z][x].flags are set
+  return rewrite_objects (world, true, progress);
+}
+
+std::vector<tile_index> MapIndex::delete_duplicates
+  (World* world, std::function<void (uid_fix_progress const&)> progress)
+{
+  return rewrite_objects (world, false, progress);
+}
 
-  std::forward_list<ModelInstance> models;
-  std::forward_list<WMOInstance> wmos;
+std::vector<tile_index> MapIndex::rewrite_objects
+  (World* world, bool assign_uids, std::function<void (uid_fix_progress const&)> progress)
+{
+  // pre-cond: mTiles[z][x].flags are set
 
-  for (int z = 0; z < 64; ++z)
+  std::vector<tile_index> tiles;
+  for (std::size_t z = 0; z < 64; ++z)
   {
-    for (int x = 0; x < 64; ++x)
+    for (std::size_t x = 0; x < 64; ++x)
     {
-      if (!(mTiles[z][x].flags & 1))
-      {
-        continue;
-      }
-
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
-      MPQFile file(filename.str());
-
-      if (file.isEof())
-      {
-        continue;
-      }
-
-      math::vector_3d tileExtents[2];
-      tileExtents[0] = { x*TILESIZE, 0, z*TILESIZE };
-      tileExtents[1] = { (x+1)*TILESIZE, 0, (z+1)*TILESIZE };
-
-      std::forward_list<ENTRY_MDDF> modelEntries;
-      std::forward_list<ENTRY_MODF> wmoEntries;
-      std::vector<std::string> modelFilenames;
-      std::vector<std::string> wmoFilenames;
-
-      uint32_t fourcc;
-      uint32_t size;
-
-      MHDR Header;
-
-      // - MVER ----------------------------------------------
-      uint32_t version;
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      file.read(&version, 4);
-      assert(fourcc == 'MVER' && version == 18);
-
-      // - MHDR ----------------------------------------------
-      file.read(&fourcc, 4);
-      file.seekRelative(4);
-      assert(fourcc == 'MHDR');
-      file.read(&Header, sizeof(MHDR));
-
-      // - MDDF ----------------------------------------------
-      file.seek(Header.mddf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MDDF');
-
-      ENTRY_MDDF const* mddf_ptr = reinterpret_cast<ENTRY_MDDF const*>(file.getPointer());
-
-      for (unsigned int i = 0; i < size / sizeof(ENTRY_MDDF); ++i)
+      if (mTiles[z][x].flags & 1)
       {
-        bool add = true;
-        ENTRY_MDDF const& mddf = mddf_ptr[i];
-
-        if (!pointInside({ mddf.pos[0], 0, mddf.pos[2] }, tileExtents))
-        {
-          continue;
-        }
-
-        // check for duplicates
-        for (ENTRY_MDDF& entry : modelEntries)
-        {
-          if ( mddf.nameID == entry.nameID
-            && floatEqual(mddf.pos[0], entry.pos[0])
-            && floatEqual(mddf.pos[1], entry.pos[1])
-            && floatEqual(mddf.pos[2], entry.pos[2])
-            && floatEqual(mddf.rot[0], entry.rot[0])
-            && floatEqual(mddf.rot[1], entry.rot[1])
-            && floatEqual(mddf.rot[2], entry.rot[2])
-            && mddf.scale == entry.scale
-            )
-          {
-            add = false;
-            break;
-          }
-        }
-
-        if (add)
-        {
-          modelEntries.emplace_front(mddf);
-        }
+        tiles.emplace_back (x, z);
       }
+    }
+  }
 
-      // - MODF ----------------------------------------------
-      file.seek(Header.modf + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MODF');
-
-      ENTRY_MODF const* modf_ptr = reinterpret_cast<ENTRY_MODF const*>(file.getPointer());
-
-      for (unsigned int i = 0; i < size / sizeof(ENTRY_MODF); ++i)
+  // the tiles that can't be patched are loaded without their models and
+  // saved with the ones selected for them
+  auto const save_fully
+    ( [&] (tile_index const& tile, noggit::adt_objects& objects)
       {
-        bool add = true;
-        ENTRY_MODF const& modf = modf_ptr[i];
-
-        if (!pointInside({ modf.pos[0], 0, modf.pos[2] }, tileExtents))
-        {
-          continue;
-        }
-
-        // check for duplicates
-        for (ENTRY_MODF& entry : wmoEntries)
-        {
-          if (modf.nameID == entry.nameID
-            && floatEqual(modf.pos[0], entry.pos[0])
-            && floatEqual(modf.pos[1], entry.pos[1])
-            && floatEqual(modf.pos[2], entry.pos[2])
-            && floatEqual(modf.rot[0], entry.rot[0])
-            && floatEqual(modf.rot[1], entry.rot[1])
-            && floatEqual(modf.rot[2], entry.rot[2])
-            )
-          {
-            add = false;
-            break;
-          }
-        }
-
-        if (add)
-        {
-          wmoEntries.emplace_front(modf);
-        }
-      }
+        std::stringstream filename;
+        filename << "World\\Maps\\" << basename << "\\" << basename << "_" << tile.x << "_" << tile.z << ".adt";
 
-      // - MMDX ----------------------------------------------
-      file.seek(Header.mmdx + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MMDX');
+        MapTile mapTile (tile.x, tile.z, filename.str(), mBigAlpha, false, world);
 
-      {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
+        std::map<int, ModelInstance> modelInst;
+        std::map<int, WMOInstance> wmoInst;
 
-        while (lCurPos < lEnd)
+        for (ENTRY_MDDF const& entry : objects.models)
         {
-          modelFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
+          modelInst.emplace (entry.uniqueID, ModelInstance (objects.model_filenames[entry.nameID], &entry));
         }
-      }
-
-      // - MWMO ----------------------------------------------
-      file.seek(Header.mwmo + 0x14);
-      file.read(&fourcc, 4);
-      file.read(&size, 4);
-      assert(fourcc == 'MWMO');
 
-      {
-        char const* lCurPos = reinterpret_cast<char const*>(file.getPointer());
-        char const* lEnd = lCurPos + size;
-
-        while (lCurPos < lEnd)
+        for (ENTRY_MODF const& entry : objects.wmos)
         {
-          wmoFilenames.push_back(std::string(lCurPos));
-          lCurPos += strlen(lCurPos) + 1;
+          wmoInst.emplace (entry.uniqueID, WMOInstance (objects.wmo_filenames[entry.nameID], &entry));
         }
-      }
 
-      file.close();
-
-      for (ENTRY_MDDF& entry : modelEntries)
-      {
-        models.emplace_front(modelFilenames[entry.nameID], &entry);
-      }
-      for (ENTRY_MODF& entry : wmoEntries)
-      {
-        wmos.emplace_front(wmoFilenames[entry.nameID], &entry);
+        // save using the models selected beforehand
+        std::swap (world->mModelInstances, modelInst);
+        std::swap (world->mWMOInstances, wmoInst);
+        mapTile.saveTile (true, world);
+        // restore the original map in World
+        std::swap (world->mModelInstances, modelInst);
+        std::swap (world->mWMOInstances, wmoInst);
       }
-    }
-  }
+    );
 
-  // set all uids
-  // for each tile save the m2/wmo present inside
-  uint32_t uid{ 0 };
-  std::map<std::size_t, std::map<std::size_t, std::forward_list<ModelInstance*>>> modelPerTile;
-  std::map<std::size_t, std::map<std::size_t, std::forward_list<WMOInstance*>>> wmoPerTile;
+  auto const result
+    ( noggit::map_maintenance::rewrite_objects
+        ( basename, tiles, assign_uids, _sort_models_by_size_class, progress
+        , world ? save_fully : std::function<void (tile_index const&, noggit::adt_objects&)>()
+        )
+    );
 
-  for (ModelInstance& instance : models)
+  if (assign_uids)
   {
-    instance.uid = uid++;
-
-    // to avoid going outside of bound
-    std::size_t sx = std::max((std::size_t)(instance.extents[0].x / TILESIZE), (std::size_t)0);
-    std::size_t sz = std::max((std::size_t)(instance.extents[0].z / TILESIZE), (std::size_t)0);
-    std::size_t ex = std::min((std::size_t)(instance.extents[1].x / TILESIZE), (std::size_t)63);
-    std::size_t ez = std::min((std::size_t)(instance.extents[1].z / TILESIZE), (std::size_t)63);
-
-
-    for (std::size_t z = sz; z <= ez; ++z)
-    {
-      for (std::size_t x = sx; x <= ex; ++x)
-      {
-        modelPerTile[z][x].push_front(&instance);
-      }
-    }
-  }
-
-  for (WMOInstance& instance : wmos)
-  {
-    instance.mUniqueID = uid++;
-
-    // to avoid going outside of bound
-    std::size_t sx = std::max((std::size_t)(instance.extents[0].x / TILESIZE), (std::size_t)0);
-    std::size_t sz = std::max((std::size_t)(instance.extents[0].z / TILESIZE), (std::size_t)0);
-    std::size_t ex = std::min((std::size_t)(instance.extents[1].x / TILESIZE), (std::size_t)63);
-    std::size_t ez = std::min((std::size_t)(instance.extents[1].z / TILESIZE), (std::size_t)63);
-
-    for (std::size_t z = sz; z <= ez; ++z)
-    {
-      for (std::size_t x = sx; x <= ex; ++x)
-      {
-        wmoPerTile[z][x].push_front(&instance);
-      }
-    }
+    // save the current highest guid
+    highestGUID = result.highest_uid;
+    saveMaxUID();
   }
 
-  // save the current highest guid
-  highestGUID = uid - 1;
-
-  // load each tile without the models and
-  // save them with the models from modelPerTile / wmoPerTile
-  for (int z = 0; z < 64; ++z)
+  std::vector<tile_index> not_written;
+  for (noggit::tile_maintenance_result const& tile : result.tiles)
   {
-    for (int x = 0; x < 64; ++x)
+    if (!tile.written)
     {
-      if (!mTiles[z][x].flags & 1)
-      {
-        continue;
-      }
-
-      // load even the tiles without models in case there are old ones
-      // that shouldn't be there to avoid creating new duplicates
-
-      std::stringstream filename;
-      filename << "World\\Maps\\" << basename << "\\" << basename << "_" << x << "_" << z << ".adt";
-
-      // load the tile without the models
-      MapTile tile(x, z, filename.str(), mBigAlpha, false, world);
-
-      std::map<int, ModelInstance> modelInst;
-      std::map<int, WMOInstance> wmoInst;
-
-      for (ModelInstance* instance : modelPerTile[z][x])
-      {
-        modelInst.emplace(instance->uid, *instance);
-      }
-      modelPerTile[z][x].clear();
-
-      for (WMOInstance* instance : wmoPerTile[z][x])
-      {
-        wmoInst.emplace(instance->mUniqueID, *instance);
-      }
-      wmoPerTile[z][x].clear();
-
-      // save using the models selected beforehand
-      std::swap(world->mModelInstances, modelInst);
-      std::swap(world->mWMOInstances, wmoInst);
-      tile.saveTile(true, world);
-      // restore the original map in World
-      std::swap(world->mModelInstances, modelInst);
-      std::swap(world->mWMOInstances, wmoInst);
+      not_written.emplace_back (tile.tile);
     }
   }
 
-  saveMaxUID();
+  return not_written;
 }
 
 void MapIndex::searchMaxUID()
@@ -870,39 +706,10 @@ void MapIndex::searchMaxUID()
 
 void MapIndex::saveMaxUID()
 {
-#ifdef USE_MYSQL_UID_STORAGE
-  if (Settings::getInstance()->mysql) {
-  if (mysql::hasMaxUIDStoredDB(*Settings::getInstance()->mysql, _map_id))
-  {
-	  mysql::updateUIDinDB(*Settings::getInstance()->mysql, _map_id, highestGUID);
-  }
-  else
-  {
-	  mysql::insertUIDinDB(*Settings::getInstance()->mysql, _map_id, highestGUID);
-  }
-  }
-  else
-  {
-    // save the max UID on the disc
-    uid_storage::getInstance()->saveMaxUID (_map_id, highestGUID);
-  }
-#else
-  // save the max UID on the disc
-  uid_storage::getInstance()->saveMaxUID (_map_id, highestGUID);
-#endif
+  noggit::store_max_uid (_map_id, highestGUID);
 }
 
 void MapIndex::loadMaxUID()
 {
-#ifdef USE_MYSQL_UID_STORAGE
-if (Settings::getInstance()->mysql) {
-  highestGUID = mysql::getGUIDFromDB(*Settings::getInstance()->mysql, _map_id);
-}
-else
-{
-  highestGUID = uid_storage::getInstance()->getMaxUID (_map_id);
-}
-#else
-  highestGUID = uid_storage::getInstance()->getMaxUID (_map_id);
-#endif
+  highestGUID = noggit::load_max_uid (_map_id);
 }
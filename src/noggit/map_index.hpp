@@ -5,6 +5,7 @@
 #include <noggit/MapHeaders.h>
 #include <noggit/MapTile.h>
 #include <noggit/Misc.h>
+#include <noggit/map_maintenance.hpp>
 #include <noggit/tile_index.hpp>
 
 #include <boost/range/iterator_range.hpp>
@@ -13,8 +14,10 @@
 #include <cstdint>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 /*!
 \brief This class is only a holder to have easier access to MapTiles and their flags for easier WDT parsing. This is private and for the class World only.
@@ -143,8 +146,8 @@ public:
   void enterTile(const tile_index& tile);
   MapTile *loadTile(const tile_index& tile);
 
-  void setChanged(const tile_index& tile);
-  void setChanged(MapTile* tile);
+  void setChanged(const tile_index& tile, int families = tile_all);
+  void setChanged(MapTile* tile, int families = tile_all);
 
   void unsetChanged(const tile_index& tile);
   void setFlag(bool to, math::vector_3d const& pos, uint32_t flag);
@@ -179,13 +182,27 @@ public:
   bool sort_models_by_size_class() const { return _sort_models_by_size_class; }
 
   uint32_t newGUID();
-
-  void fixUIDs (World*);
+  //! newGUID() won't return \a uid or below, e.g. for recovered objects
+  void reserve_uid (uint32_t uid);
+
+  //! rewrites the objects of all tiles with fresh uids and without
+  //! duplicates. If world is null, tiles that have to be loaded to be
+  //! saved are skipped.
+  //! \returns the tiles that weren't written
+  //! \note progress is called from the calling thread only
+  std::vector<tile_index> fixUIDs
+    (World*, std::function<void (uid_fix_progress const&)> progress = nullptr);
+  //! same as fixUIDs, keeping the uids
+  std::vector<tile_index> delete_duplicates
+    (World*, std::function<void (uid_fix_progress const&)> progress = nullptr);
   void searchMaxUID();
   void saveMaxUID();
   void loadMaxUID();
 
 private:
+  std::vector<tile_index> rewrite_objects
+    (World*, bool assign_uids, std::function<void (uid_fix_progress const&)> progress);
+
 	uint32_t getHighestGUIDFromFile(const std::string& pFilename) const;
 #ifdef USE_MYSQL_UID_STORAGE
   uint32_t getHighestGUIDFromDB() const;
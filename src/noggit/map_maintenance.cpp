@@ -0,0 +1,1341 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/quantized_set.hpp>
+#include <math/vector_3d.hpp>
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/Misc.h>
+#include <noggit/ModelHeaders.h>
+#include <noggit/Settings.h>
+#include <noggit/adt_object_patch.hpp>
+#include <noggit/alphamap_codec.hpp>
+#include <noggit/map_maintenance.hpp>
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace noggit
+{
+  namespace map_maintenance
+  {
+    namespace
+    {
+      // offsets in MHDR are relative to the end of the MHDR chunk header
+      constexpr std::uint32_t const mhdr_data_offset = 0x14;
+      constexpr std::size_t const chunk_vertices = 145;
+      // MVER is followed by MPHD and MAIN in every WDT
+      constexpr std::size_t const mphd_offset = 8 + 4;
+      constexpr std::size_t const main_offset = mphd_offset + 8 + sizeof (MPHD);
+
+      template<typename T>
+        T read (char const* data)
+      {
+        T value;
+        std::memcpy (&value, data, sizeof (T));
+        return value;
+      }
+
+      std::string adt_filename (std::string const& basename, tile_index const& tile)
+      {
+        std::stringstream filename;
+        filename << "World\\Maps\\" << basename << "\\" << basename
+                 << "_" << tile.x << "_" << tile.z << ".adt";
+        return filename.str();
+      }
+
+      std::string wdt_filename (std::string const& basename)
+      {
+        return "World\\Maps\\" + basename + "\\" + basename + ".wdt";
+      }
+
+      //! calls work (i) for every i < count on \a threads threads
+      template<typename Work>
+        void parallel_for (std::size_t count, std::size_t threads, Work const& work)
+      {
+        std::atomic<std::size_t> next (0);
+
+        auto const worker
+          ( [&]
+            {
+              for (std::size_t i; (i = next++) < count;)
+              {
+                work (i);
+              }
+            }
+          );
+
+        std::size_t const thread_count
+          ( std::max<std::size_t>
+              (1, std::min<std::size_t> (threads ? threads : std::thread::hardware_concurrency(), count))
+          );
+
+        std::vector<std::thread> pool;
+        for (std::size_t i (1); i < thread_count; ++i)
+        {
+          pool.emplace_back (worker);
+        }
+        worker();
+
+        for (std::thread& thread : pool)
+        {
+          thread.join();
+        }
+      }
+
+      //! \returns the payload of the MCNK sub chunk at \a offset, writable
+      //! if \a mcnk is
+      template<typename Char>
+        boost::optional<std::pair<Char*, std::uint32_t>> sub_chunk
+          (Char* mcnk, std::uint32_t mcnk_size, std::uint32_t offset, std::uint32_t fourcc)
+      {
+        if (!offset || std::size_t (offset) + 8 > mcnk_size + 8)
+        {
+          return boost::none;
+        }
+
+        std::uint32_t const size (read<std::uint32_t> (mcnk + offset + 4));
+        if (read<std::uint32_t> (mcnk + offset) != fourcc || std::size_t (offset) + 8 + size > mcnk_size + 8)
+        {
+          return boost::none;
+        }
+
+        return std::make_pair (mcnk + offset + 8, size);
+      }
+
+      //! \returns the file offsets of the 256 MCNKs, indexed by y * 16 + x
+      boost::optional<std::array<std::uint32_t, 256>> mcnk_offsets (std::vector<char> const& file)
+      {
+        if (file.size() < mhdr_data_offset + sizeof (MHDR))
+        {
+          return boost::none;
+        }
+
+        MHDR const header (read<MHDR> (file.data() + mhdr_data_offset));
+        std::size_t const mcin (header.mcin + mhdr_data_offset);
+
+        if ( !header.mcin || mcin + 8 + sizeof (MCIN) > file.size()
+          || read<std::uint32_t> (file.data() + mcin) != 'MCIN'
+           )
+        {
+          return boost::none;
+        }
+
+        MCIN const entries (read<MCIN> (file.data() + mcin + 8));
+        std::array<std::uint32_t, 256> offsets;
+
+        for (std::size_t i (0); i < 256; ++i)
+        {
+          std::uint32_t const offset (entries.mEntries[i].offset);
+          if ( std::size_t (offset) + 8 + sizeof (MapChunkHeader) > file.size()
+            || read<std::uint32_t> (file.data() + offset) != 'MCNK'
+            || std::size_t (offset) + 8 + read<std::uint32_t> (file.data() + offset + 4) > file.size()
+             )
+          {
+            return boost::none;
+          }
+          offsets[i] = offset;
+        }
+
+        return offsets;
+      }
+
+      boost::optional<std::vector<char>> read_adt (std::string const& filename)
+      {
+        MPQFile file (filename);
+        if (file.isEof())
+        {
+          return boost::none;
+        }
+        return std::vector<char> (file.getBuffer(), file.getBuffer() + file.getSize());
+      }
+
+      //! saving logs, which isn't thread safe
+      void save_adt (std::string const& filename, std::vector<char> const& data, std::mutex& save_mutex)
+      {
+        std::lock_guard<std::mutex> const lock (save_mutex);
+        MPQFile file (filename);
+        file.setBuffer (data);
+        file.SaveFile();
+        file.close();
+      }
+
+      //! appends \a mcnk with its alphamaps converted, see MapChunk::save
+      //! for the format written
+      bool append_converted_mcnk ( char const* mcnk
+                                 , std::uint32_t size
+                                 , bool from_big_alpha
+                                 , bool to_big_alpha
+                                 , std::vector<char>& out
+                                 , bool& changed
+                                 )
+      {
+        changed = false;
+
+        if (size < sizeof (MapChunkHeader))
+        {
+          return false;
+        }
+
+        MapChunkHeader header (read<MapChunkHeader> (mcnk + 8));
+        std::size_t const layers (header.nLayers);
+
+        auto const mcly (sub_chunk (mcnk, size, header.ofsLayer, 'MCLY'));
+        auto const mcal (sub_chunk (mcnk, size, header.ofsAlpha, 'MCAL'));
+
+        if (layers < 2 || layers > 4 || !mcly || mcly->second < layers * sizeof (ENTRY_MCLY) || !mcal)
+        {
+          // nothing to convert, or nothing the game would read either
+          out.insert (out.end(), mcnk, mcnk + 8 + size);
+          return layers < 2 || layers > 4 || (mcly && mcal);
+        }
+
+        std::vector<ENTRY_MCLY> entries (layers);
+        std::memcpy (entries.data(), mcly->first, layers * sizeof (ENTRY_MCLY));
+
+        std::vector<unsigned char> alphas (4096 * (layers - 1), 0);
+        for (std::size_t i (1); i < layers; ++i)
+        {
+          if ( entries[i].flags & FLAG_USE_ALPHA
+            && ( entries[i].ofsAlpha > mcal->second
+              || !decode_alphamap ( mcal->first + entries[i].ofsAlpha
+                                  , mcal->first + mcal->second
+                                  , entries[i].flags
+                                  , from_big_alpha
+                                  , (header.flags & FLAG_do_not_fix_alpha_map) == 0
+                                  , alphas.data() + 4096 * (i - 1)
+                                  )
+               )
+             )
+          {
+            return false;
+          }
+        }
+
+        if (from_big_alpha)
+        {
+          big_to_old_alpha (alphas.data(), layers - 1);
+        }
+        if (to_big_alpha)
+        {
+          old_to_big_alpha (alphas.data(), layers - 1);
+        }
+
+        std::vector<char> converted;
+        entries[0].flags &= ~(FLAG_USE_ALPHA | FLAG_ALPHA_COMPRESSED);
+        entries[0].ofsAlpha = 0;
+
+        for (std::size_t i (1); i < layers; ++i)
+        {
+          std::vector<char> const layer
+            ( to_big_alpha
+            ? compress_alphamap (alphas.data() + 4096 * (i - 1))
+            : encode_old_alphamap (alphas.data() + 4096 * (i - 1))
+            );
+
+          entries[i].ofsAlpha = converted.size();
+          entries[i].flags |= FLAG_USE_ALPHA;
+          // always compress big alpha
+          if (to_big_alpha)
+          {
+            entries[i].flags |= FLAG_ALPHA_COMPRESSED;
+          }
+          else
+          {
+            entries[i].flags &= ~FLAG_ALPHA_COMPRESSED;
+          }
+
+          converted.insert (converted.end(), layer.begin(), layer.end());
+        }
+
+        header.flags |= FLAG_do_not_fix_alpha_map;
+        header.sizeAlpha = 8 + converted.size();
+
+        std::size_t const position (out.size());
+        if (!append_mcnk_with_sub_chunk
+              ( out, mcnk, size, header, &MapChunkHeader::ofsAlpha, 'MCAL'
+              , converted.data(), converted.size()
+              )
+           )
+        {
+          return false;
+        }
+
+        // MCLY keeps its size but may have moved behind MCAL
+        MapChunkHeader const written (read<MapChunkHeader> (out.data() + position + 8));
+        std::memcpy ( out.data() + position + written.ofsLayer + 8
+                    , entries.data()
+                    , layers * sizeof (ENTRY_MCLY)
+                    );
+
+        changed = true;
+        return true;
+      }
+
+      //! world space heights of a tile, 145 per chunk as in MCVT
+      struct tile_heights
+      {
+        std::array<std::array<float, chunk_vertices>, 256> chunks;
+
+        //! \a hz, \a hx in half units from the tile corner, one of the
+        //! vertices there or none if outside the tile
+        boost::optional<float> at (int hz, int hx) const
+        {
+          if (hz < 0 || hx < 0 || hz > 256 || hx > 256)
+          {
+            return boost::none;
+          }
+
+          if (hz % 2 == 0)
+          {
+            int const row (hz / 2);
+            int const column (hx / 2);
+            int const y (std::min (row / 8, 15));
+            int const x (std::min (column / 8, 15));
+            return chunks[y * 16 + x][(row - y * 8) * 17 + column - x * 8];
+          }
+
+          int const row ((hz - 1) / 2);
+          int const column ((hx - 1) / 2);
+          return chunks[(row / 8) * 16 + column / 8][(row % 8) * 17 + 9 + column % 8];
+        }
+      };
+
+      //! the edges the neighbours of a tile fix their gaps with, as read
+      struct tile_edges
+      {
+        //! outer right column of the chunks (15, y)
+        std::array<std::array<float, 9>, 16> right;
+        //! outer bottom row of the chunks (x, 15)
+        std::array<std::array<float, 9>, 16> bottom;
+      };
+
+      //! \returns the MCVT heights of all chunks, relative to their base
+      boost::optional<std::array<char*, 256>> mcvts
+        (std::vector<char>& file, std::array<std::uint32_t, 256> const& offsets)
+      {
+        std::array<char*, 256> heights;
+
+        for (std::size_t i (0); i < 256; ++i)
+        {
+          char* mcnk (file.data() + offsets[i]);
+          std::uint32_t const size (read<std::uint32_t> (mcnk + 4));
+          MapChunkHeader const header (read<MapChunkHeader> (mcnk + 8));
+
+          auto const mcvt (sub_chunk (mcnk, size, header.ofsHeight, 'MCVT'));
+          if (!mcvt || mcvt->second < chunk_vertices * sizeof (float))
+          {
+            return boost::none;
+          }
+
+          heights[i] = mcvt->first;
+        }
+
+        return heights;
+      }
+
+      boost::optional<tile_heights> read_heights
+        (std::vector<char>& file, std::array<std::uint32_t, 256> const& offsets)
+      {
+        auto const heights (mcvts (file, offsets));
+        if (!heights)
+        {
+          return boost::none;
+        }
+
+        tile_heights result;
+        for (std::size_t i (0); i < 256; ++i)
+        {
+          float const base (read<MapChunkHeader> (file.data() + offsets[i] + 8).ypos);
+          for (std::size_t v (0); v < chunk_vertices; ++v)
+          {
+            result.chunks[i][v] = base + read<float> ((*heights)[i] + v * sizeof (float));
+          }
+        }
+
+        return result;
+      }
+
+      bool fix_gap_left (std::array<float, chunk_vertices>& chunk, std::array<float, 9> const& edge)
+      {
+        bool changed (false);
+        for (std::size_t k (0); k < 9; ++k)
+        {
+          changed |= chunk[k * 17] != edge[k];
+          chunk[k * 17] = edge[k];
+        }
+        return changed;
+      }
+
+      bool fix_gap_above (std::array<float, chunk_vertices>& chunk, std::array<float, 9> const& edge)
+      {
+        bool changed (false);
+        for (std::size_t k (0); k < 9; ++k)
+        {
+          changed |= chunk[k] != edge[k];
+          chunk[k] = edge[k];
+        }
+        return changed;
+      }
+
+      std::array<float, 9> right_edge (std::array<float, chunk_vertices> const& chunk)
+      {
+        std::array<float, 9> edge;
+        for (std::size_t k (0); k < 9; ++k)
+        {
+          edge[k] = chunk[k * 17 + 8];
+        }
+        return edge;
+      }
+
+      std::array<float, 9> bottom_edge (std::array<float, chunk_vertices> const& chunk)
+      {
+        std::array<float, 9> edge;
+        std::copy (chunk.begin() + 136, chunk.end(), edge.begin());
+        return edge;
+      }
+
+      //! same as MapChunk::recalcNorms. The surrounding points are always
+      //! vertices, so no interpolation is needed. Outside of the tile the
+      //! vertex itself is used.
+      void write_normals (tile_heights const& heights, std::size_t chunk, char* normals)
+      {
+        int const chunk_z (int (chunk / 16) * 16);
+        int const chunk_x (int (chunk % 16) * 16);
+        float const half_unit (UNITSIZE / 2.f);
+
+        for (std::size_t i (0); i < chunk_vertices; ++i)
+        {
+          std::size_t const row (i / 17);
+          std::size_t const column (i % 17);
+          int const hz (chunk_z + int (row) * 2 + (column < 9 ? 0 : 1));
+          int const hx (chunk_x + int (column < 9 ? column : column - 9) * 2 + (column < 9 ? 0 : 1));
+
+          math::vector_3d const vertex (hx * half_unit, heights.chunks[chunk][i], hz * half_unit);
+
+          auto const point
+            ( [&] (int dz, int dx)
+              {
+                return math::vector_3d ( vertex.x + dx * half_unit
+                                       , heights.at (hz + dz, hx + dx).get_value_or (vertex.y)
+                                       , vertex.z + dz * half_unit
+                                       );
+              }
+            );
+
+          math::vector_3d const P1 (point (-1, -1));
+          math::vector_3d const P2 (point (-1,  1));
+          math::vector_3d const P3 (point ( 1,  1));
+          math::vector_3d const P4 (point ( 1, -1));
+
+          math::vector_3d const N1 ((P2 - vertex) % (P1 - vertex));
+          math::vector_3d const N2 ((P3 - vertex) % (P2 - vertex));
+          math::vector_3d const N3 ((P4 - vertex) % (P3 - vertex));
+          math::vector_3d const N4 ((P1 - vertex) % (P4 - vertex));
+
+          math::vector_3d Norm (N1 + N2 + N3 + N4);
+          Norm.normalize();
+
+          Norm.x = std::floor(Norm.x * 127) / 127;
+          Norm.y = std::floor(Norm.y * 127) / 127;
+          Norm.z = std::floor(Norm.z * 127) / 127;
+
+          math::vector_3d const normal (-Norm.z, Norm.y, -Norm.x);
+          normals[i * 3 + 0] = static_cast<char> (normal.x * 127);
+          normals[i * 3 + 1] = static_cast<char> (normal.z * 127);
+          normals[i * 3 + 2] = static_cast<char> (normal.y * 127);
+        }
+      }
+
+      // two placements closer than this are considered duplicates, see also
+      // World::delete_duplicate_model_and_wmo_instances
+      float const duplicate_epsilon = 0.0001f;
+      float const duplicate_cell_size = 1.0f;
+
+      //! unique placements inside a single ADT, name ids index its own lists
+      struct scanned_tile
+      {
+        std::vector<std::string> model_filenames;
+        std::vector<std::string> wmo_filenames;
+        std::vector<ENTRY_MDDF> models;
+        std::vector<ENTRY_MODF> wmos;
+      };
+
+      //! placements of the whole map with names shared by all tiles
+      struct model_placement
+      {
+        std::uint32_t name;
+        ENTRY_MDDF entry;
+        std::array<math::vector_3d, 2> extents;
+        float size_cat;
+      };
+
+      struct wmo_placement
+      {
+        std::uint32_t name;
+        ENTRY_MODF entry;
+      };
+
+      //! \returns the payload of the chunk at the given MHDR offset
+      boost::optional<std::pair<char const*, std::uint32_t>> mhdr_chunk
+        (MPQFile const& file, std::uint32_t offset, std::uint32_t fourcc)
+      {
+        std::size_t const position (offset + mhdr_data_offset);
+        if (!offset || position + 8 > file.getSize())
+        {
+          return boost::none;
+        }
+
+        std::uint32_t header[2];
+        std::memcpy (header, file.getBuffer() + position, 8);
+
+        if (header[0] != fourcc || position + 8 + header[1] > file.getSize())
+        {
+          return boost::none;
+        }
+
+        return std::make_pair (file.getBuffer() + position + 8, header[1]);
+      }
+
+      std::vector<std::string> read_filenames
+        (std::pair<char const*, std::uint32_t> chunk, std::function<std::string (std::string)> normalize)
+      {
+        std::vector<std::string> filenames;
+        char const* position (chunk.first);
+        char const* end (chunk.first + chunk.second);
+
+        while (position < end)
+        {
+          std::size_t const length (strnlen (position, end - position));
+          filenames.emplace_back (normalize (std::string (position, length)));
+          position += length + 1;
+        }
+
+        return filenames;
+      }
+
+      //! reads the placements starting inside the tile, dropping duplicates
+      boost::optional<scanned_tile> scan_tile (std::string const& filename, tile_index const& tile)
+      {
+        MPQFile file (filename);
+
+        if (file.isEof() || file.getSize() < mhdr_data_offset + sizeof (MHDR))
+        {
+          return boost::none;
+        }
+
+        MHDR header;
+        std::memcpy (&header, file.getBuffer() + mhdr_data_offset, sizeof (MHDR));
+
+        auto const mmdx (mhdr_chunk (file, header.mmdx, 'MMDX'));
+        auto const mwmo (mhdr_chunk (file, header.mwmo, 'MWMO'));
+        auto const mddf (mhdr_chunk (file, header.mddf, 'MDDF'));
+        auto const modf (mhdr_chunk (file, header.modf, 'MODF'));
+
+        if (!mmdx || !mwmo || !mddf || !modf)
+        {
+          return boost::none;
+        }
+
+        scanned_tile scanned;
+        scanned.model_filenames = read_filenames (*mmdx, &mpq::normalized_model_filename);
+        scanned.wmo_filenames = read_filenames (*mwmo, &mpq::normalized_filename);
+
+        math::vector_3d tileExtents[2];
+        tileExtents[0] = { tile.x * TILESIZE, 0, tile.z * TILESIZE };
+        tileExtents[1] = { (tile.x + 1) * TILESIZE, 0, (tile.z + 1) * TILESIZE };
+
+        std::size_t const model_count (mddf->second / sizeof (ENTRY_MDDF));
+        math::quantized_set<6, std::pair<uint32_t, uint16_t>> modelSet (duplicate_epsilon, duplicate_cell_size);
+        modelSet.reserve (model_count);
+
+        for (std::size_t i = 0; i < model_count; ++i)
+        {
+          ENTRY_MDDF mddf_entry;
+          std::memcpy (&mddf_entry, mddf->first + i * sizeof (ENTRY_MDDF), sizeof (ENTRY_MDDF));
+
+          if ( mddf_entry.nameID >= scanned.model_filenames.size()
+            || !pointInside ({ mddf_entry.pos[0], 0, mddf_entry.pos[2] }, tileExtents)
+             )
+          {
+            continue;
+          }
+
+          // check for duplicates
+          if (modelSet.insert ( {mddf_entry.nameID, mddf_entry.scale}
+                              , {{ mddf_entry.pos[0], mddf_entry.pos[1], mddf_entry.pos[2]
+                                 , mddf_entry.rot[0], mddf_entry.rot[1], mddf_entry.rot[2]
+                                }}
+                              )
+             )
+          {
+            scanned.models.emplace_back (mddf_entry);
+          }
+        }
+
+        std::size_t const wmo_count (modf->second / sizeof (ENTRY_MODF));
+        math::quantized_set<6, uint32_t> wmoSet (duplicate_epsilon, duplicate_cell_size);
+        wmoSet.reserve (wmo_count);
+
+        for (std::size_t i = 0; i < wmo_count; ++i)
+        {
+          ENTRY_MODF modf_entry;
+          std::memcpy (&modf_entry, modf->first + i * sizeof (ENTRY_MODF), sizeof (ENTRY_MODF));
+
+          if ( modf_entry.nameID >= scanned.wmo_filenames.size()
+            || !pointInside ({ modf_entry.pos[0], 0, modf_entry.pos[2] }, tileExtents)
+             )
+          {
+            continue;
+          }
+
+          // check for duplicates
+          if (wmoSet.insert ( modf_entry.nameID
+                            , {{ modf_entry.pos[0], modf_entry.pos[1], modf_entry.pos[2]
+                               , modf_entry.rot[0], modf_entry.rot[1], modf_entry.rot[2]
+                              }}
+                            )
+             )
+          {
+            scanned.wmos.emplace_back (modf_entry);
+          }
+        }
+
+        return scanned;
+      }
+
+      //! calls work (i) for every i < count on all cores, like parallel_for.
+      //! The progress is only ever reported from the calling thread.
+      template<typename Work>
+        void parallel_for_reporting ( std::size_t count
+                                    , Work const& work
+                                    , uid_fix_progress::stage stage
+                                    , std::function<void (uid_fix_progress const&)> const& progress
+                                    )
+      {
+        std::atomic<std::size_t> next (0);
+        std::atomic<std::size_t> done (0);
+
+        auto const start (std::chrono::steady_clock::now());
+        auto const report
+          ( [&]
+            {
+              if (progress)
+              {
+                std::chrono::duration<float> const elapsed (std::chrono::steady_clock::now() - start);
+                progress ({stage, done, count, elapsed.count()});
+              }
+            }
+          );
+
+        std::size_t const thread_count
+          (std::min<std::size_t> (count, std::max (1u, std::thread::hardware_concurrency())));
+
+        std::vector<std::thread> workers;
+        for (std::size_t i (0); i < thread_count; ++i)
+        {
+          workers.emplace_back ( [&]
+                                 {
+                                   for (std::size_t index (next++); index < count; index = next++)
+                                   {
+                                     work (index);
+                                     ++done;
+                                   }
+                                 }
+                               );
+        }
+
+        while (done < count)
+        {
+          report();
+          std::this_thread::sleep_for (std::chrono::milliseconds (50));
+        }
+
+        for (std::thread& worker : workers)
+        {
+          worker.join();
+        }
+        report();
+      }
+
+      //! objects of a tile in the order MapTile::saveTile would write them
+      adt_objects objects_of_tile ( std::vector<std::uint32_t> const& model_indices
+                                          , std::vector<std::uint32_t> const& wmo_indices
+                                          , std::vector<model_placement> const& models
+                                          , std::vector<wmo_placement> const& wmos
+                                          , std::vector<std::string> const& model_names
+                                          , std::vector<std::string> const& wmo_names
+                                          , bool sort_models_by_size_class
+                                          )
+      {
+        adt_objects objects;
+
+        std::map<std::uint32_t, std::uint32_t> model_ids;
+        std::map<std::string, std::uint32_t> model_names_sorted;
+        for (std::uint32_t index : model_indices)
+        {
+          model_names_sorted.emplace (model_names[models[index].name], models[index].name);
+        }
+        for (auto const& name : model_names_sorted)
+        {
+          model_ids[name.second] = objects.model_filenames.size();
+          objects.model_filenames.emplace_back (name.first);
+        }
+
+        std::map<std::uint32_t, std::uint32_t> wmo_ids;
+        std::map<std::string, std::uint32_t> wmo_names_sorted;
+        for (std::uint32_t index : wmo_indices)
+        {
+          wmo_names_sorted.emplace (wmo_names[wmos[index].name], wmos[index].name);
+        }
+        for (auto const& name : wmo_names_sorted)
+        {
+          wmo_ids[name.second] = objects.wmo_filenames.size();
+          objects.wmo_filenames.emplace_back (name.first);
+        }
+
+        std::vector<std::uint32_t> model_order (model_indices);
+        if (sort_models_by_size_class)
+        {
+          std::stable_sort ( model_order.begin(), model_order.end()
+                           , [&] (std::uint32_t lhs, std::uint32_t rhs)
+                             {
+                               return models[lhs].size_cat > models[rhs].size_cat;
+                             }
+                           );
+        }
+
+        for (std::uint32_t index : model_order)
+        {
+          ENTRY_MDDF entry (models[index].entry);
+          entry.nameID = model_ids.at (models[index].name);
+          entry.flags = 0;
+          objects.models.emplace_back (entry);
+          objects.model_extents.emplace_back (models[index].extents);
+        }
+
+        for (std::uint32_t index : wmo_indices)
+        {
+          ENTRY_MODF entry (wmos[index].entry);
+          entry.nameID = wmo_ids.at (wmos[index].name);
+          objects.wmos.emplace_back (entry);
+        }
+
+        return objects;
+      }
+
+      //! tiles covered by the given extents, clamped to the map
+      template<typename Function>
+        void for_each_covered_tile (math::vector_3d const& min, math::vector_3d const& max, Function fun)
+      {
+        auto const clamped
+          ( [] (float value)
+            {
+              return std::size_t (std::min (63.0f, std::max (0.0f, std::floor (value / TILESIZE))));
+            }
+          );
+
+        for (std::size_t z (clamped (min.z)); z <= clamped (max.z); ++z)
+        {
+          for (std::size_t x (clamped (min.x)); x <= clamped (max.x); ++x)
+          {
+            fun (z * 64 + x);
+          }
+        }
+      }
+    }
+
+    std::vector<tile_maintenance_result> convert_alphamaps
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , bool from_big_alpha
+      , bool to_big_alpha
+      , std::size_t threads
+      )
+    {
+      std::vector<tile_maintenance_result> results;
+      for (tile_index const& tile : tiles)
+      {
+        results.push_back ({tile, false, 0, {}});
+      }
+
+      if (from_big_alpha == to_big_alpha)
+      {
+        return results;
+      }
+
+      // a tile is only read right with the WDT flag matching its format,
+      // so either all tiles are converted or none is
+      std::vector<boost::optional<std::vector<char>>> converted (tiles.size());
+
+      parallel_for
+        ( tiles.size(), threads
+        , [&] (std::size_t i)
+          {
+            tile_maintenance_result& result (results[i]);
+
+            auto const file (read_adt (adt_filename (basename, tiles[i])));
+            if (!file)
+            {
+              result.error = "could not be read";
+              return;
+            }
+
+            converted[i] = patch_adt_mcnks
+              ( file->data(), file->size()
+              , [&] (char const* mcnk, std::uint32_t size, std::vector<char>& out)
+                {
+                  bool changed;
+                  bool const success
+                    (append_converted_mcnk (mcnk, size, from_big_alpha, to_big_alpha, out, changed));
+                  result.changed_chunks += changed;
+                  return success;
+                }
+              );
+
+            if (!converted[i])
+            {
+              result.changed_chunks = 0;
+              result.error = "has malformed chunks";
+            }
+          }
+        );
+
+      bool const failed
+        ( std::any_of ( results.begin(), results.end()
+                      , [] (tile_maintenance_result const& result) { return !result.error.empty(); }
+                      )
+        );
+
+      std::mutex save_mutex;
+
+      for (std::size_t i (0); i < tiles.size(); ++i)
+      {
+        tile_maintenance_result& result (results[i]);
+
+        if (failed)
+        {
+          if (result.error.empty())
+          {
+            result.changed_chunks = 0;
+            result.error = "not converted as other tiles failed";
+          }
+        }
+        else if (result.changed_chunks)
+        {
+          save_adt (adt_filename (basename, tiles[i]), *converted[i], save_mutex);
+          result.written = true;
+        }
+      }
+
+      return results;
+    }
+
+    std::vector<tile_maintenance_result> fix_gaps
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , std::size_t threads
+      )
+    {
+      std::vector<tile_maintenance_result> results;
+      for (tile_index const& tile : tiles)
+      {
+        results.push_back ({tile, false, 0, {}});
+      }
+
+      // the edges of the neighbours are read before any tile is fixed, so
+      // the tiles don't depend on the order they are written in
+      std::unique_ptr<tile_edges> edges[64][64];
+
+      parallel_for
+        ( tiles.size(), threads
+        , [&] (std::size_t i)
+          {
+            auto file (read_adt (adt_filename (basename, tiles[i])));
+            auto const offsets (file ? mcnk_offsets (*file) : boost::none);
+            auto const heights (offsets ? read_heights (*file, *offsets) : boost::none);
+
+            if (!heights)
+            {
+              results[i].error = "could not be read";
+              return;
+            }
+
+            std::unique_ptr<tile_edges> tile (new tile_edges);
+            for (std::size_t k (0); k < 16; ++k)
+            {
+              tile->right[k] = right_edge (heights->chunks[k * 16 + 15]);
+              tile->bottom[k] = bottom_edge (heights->chunks[15 * 16 + k]);
+            }
+
+            // every tile is written by one worker only
+            edges[tiles[i].z][tiles[i].x] = std::move (tile);
+          }
+        );
+
+      auto const neighbour
+        ( [&] (tile_index const& tile, int dx, int dz) -> tile_edges const*
+          {
+            int const x (int (tile.x) + dx);
+            int const z (int (tile.z) + dz);
+            return x < 0 || z < 0 ? nullptr : edges[z][x].get();
+          }
+        );
+
+      std::mutex save_mutex;
+
+      parallel_for
+        ( tiles.size(), threads
+        , [&] (std::size_t i)
+          {
+            tile_maintenance_result& result (results[i]);
+            if (!result.error.empty())
+            {
+              return;
+            }
+
+            std::string const filename (adt_filename (basename, tiles[i]));
+            auto file (read_adt (filename));
+            auto const offsets (file ? mcnk_offsets (*file) : boost::none);
+            auto const mcvt (offsets ? mcvts (*file, *offsets) : boost::none);
+            auto heights (offsets ? read_heights (*file, *offsets) : boost::none);
+
+            if (!mcvt || !heights)
+            {
+              result.error = "could not be read";
+              return;
+            }
+
+            tile_edges const* left (neighbour (tiles[i], -1, 0));
+            tile_edges const* above (neighbour (tiles[i], 0, -1));
+            tile_edges const* above_left (neighbour (tiles[i], -1, -1));
+
+            std::array<bool, 256> changed;
+            changed.fill (false);
+
+            // fix the gaps with the adt at the left of the current one. Its
+            // top right corners were already fixed with the chunks above.
+            if (left)
+            {
+              for (std::size_t y (0); y < 16; ++y)
+              {
+                std::array<float, 9> edge (left->right[y]);
+                if (y)
+                {
+                  edge[0] = left->right[y - 1][8];
+                }
+                else if (above_left)
+                {
+                  edge[0] = above_left->right[15][8];
+                }
+
+                changed[y * 16] |= fix_gap_left (heights->chunks[y * 16], edge);
+              }
+            }
+
+            // fix the gaps with the adt above the current one, whose bottom
+            // left corners were fixed with the chunks at their left
+            if (above)
+            {
+              for (std::size_t x (0); x < 16; ++x)
+              {
+                std::array<float, 9> edge (above->bottom[x]);
+                if (x)
+                {
+                  edge[0] = above->bottom[x - 1][8];
+                }
+                else if (above_left)
+                {
+                  edge[0] = above_left->bottom[15][8];
+                }
+
+                changed[x] |= fix_gap_above (heights->chunks[x], edge);
+              }
+            }
+
+            // fix gaps within the adt
+            for (std::size_t y (0); y < 16; ++y)
+            {
+              for (std::size_t x (0); x < 16; ++x)
+              {
+                std::size_t const chunk (y * 16 + x);
+
+                if (x)
+                {
+                  changed[chunk] |= fix_gap_left
+                    (heights->chunks[chunk], right_edge (heights->chunks[chunk - 1]));
+                }
+                if (y)
+                {
+                  changed[chunk] |= fix_gap_above
+                    (heights->chunks[chunk], bottom_edge (heights->chunks[chunk - 16]));
+                }
+              }
+            }
+
+            // the border normals of the chunks around a changed one are
+            // computed from its edge as well
+            std::array<bool, 256> normals_changed;
+            normals_changed.fill (false);
+            for (int y (0); y < 16; ++y)
+            {
+              for (int x (0); x < 16; ++x)
+              {
+                if (!changed[y * 16 + x])
+                {
+                  continue;
+                }
+
+                for (int ny (std::max (y - 1, 0)); ny <= std::min (y + 1, 15); ++ny)
+                {
+                  for (int nx (std::max (x - 1, 0)); nx <= std::min (x + 1, 15); ++nx)
+                  {
+                    normals_changed[ny * 16 + nx] = true;
+                  }
+                }
+              }
+            }
+
+            for (std::size_t chunk (0); chunk < 256; ++chunk)
+            {
+              if (!normals_changed[chunk])
+              {
+                continue;
+              }
+
+              char* mcnk (file->data() + (*offsets)[chunk]);
+              MapChunkHeader const header (read<MapChunkHeader> (mcnk + 8));
+
+              if (changed[chunk])
+              {
+                for (std::size_t v (0); v < chunk_vertices; ++v)
+                {
+                  float const height (heights->chunks[chunk][v] - header.ypos);
+                  std::memcpy ((*mcvt)[chunk] + v * sizeof (float), &height, sizeof (float));
+                }
+
+                ++result.changed_chunks;
+              }
+
+              auto const mcnr
+                (sub_chunk (mcnk, read<std::uint32_t> (mcnk + 4), header.ofsNormal, 'MCNR'));
+              if (mcnr && mcnr->second >= chunk_vertices * 3)
+              {
+                write_normals (*heights, chunk, mcnr->first);
+              }
+            }
+
+            if (result.changed_chunks)
+            {
+              save_adt (filename, *file, save_mutex);
+              result.written = true;
+            }
+          }
+        );
+
+      return results;
+    }
+
+    object_rewrite_result rewrite_objects
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , bool assign_uids
+      , bool sort_models_by_size_class
+      , std::function<void (uid_fix_progress const&)> const& progress
+      , std::function<void (tile_index const&, adt_objects&)> const& save_fully
+      )
+    {
+      auto const start (std::chrono::steady_clock::now());
+
+      object_rewrite_result result;
+      result.highest_uid = 0;
+      for (tile_index const& tile : tiles)
+      {
+        result.tiles.push_back ({tile, false, 0, {}});
+      }
+
+      // scan all tiles for their placements
+      std::vector<boost::optional<scanned_tile>> scanned (tiles.size());
+
+      parallel_for_reporting ( tiles.size()
+                             , [&] (std::size_t i)
+                               {
+                                 scanned[i] = scan_tile (adt_filename (basename, tiles[i]), tiles[i]);
+                               }
+                             , uid_fix_progress::stage::scan
+                             , progress
+                             );
+
+      // merge them into flat lists with shared names, releasing the scans
+      std::vector<std::string> model_names;
+      std::vector<std::string> wmo_names;
+      std::unordered_map<std::string, std::uint32_t> model_name_ids;
+      std::unordered_map<std::string, std::uint32_t> wmo_name_ids;
+
+      auto const intern
+        ( [] ( std::string const& name
+             , std::vector<std::string>& names
+             , std::unordered_map<std::string, std::uint32_t>& ids
+             )
+          {
+            auto const inserted (ids.emplace (name, names.size()));
+            if (inserted.second)
+            {
+              names.emplace_back (name);
+            }
+            return inserted.first->second;
+          }
+        );
+
+      std::vector<model_placement> models;
+      std::vector<wmo_placement> wmos;
+
+      for (std::size_t i (0); i < tiles.size(); ++i)
+      {
+        if (!scanned[i])
+        {
+          LogError << "fixUIDs: could not read the objects of \"" << adt_filename (basename, tiles[i]) << "\"." << std::endl;
+          continue;
+        }
+
+        for (ENTRY_MDDF const& entry : scanned[i]->models)
+        {
+          models.push_back
+            ({intern (scanned[i]->model_filenames[entry.nameID], model_names, model_name_ids), entry, {}, 0.0f});
+        }
+        for (ENTRY_MODF const& entry : scanned[i]->wmos)
+        {
+          wmos.push_back
+            ({intern (scanned[i]->wmo_filenames[entry.nameID], wmo_names, wmo_name_ids), entry});
+        }
+
+        scanned[i].reset();
+      }
+
+      scanned = {};
+
+      // only the bounding boxes of the model headers are needed for the
+      // extents, so models are never fully loaded
+      std::vector<ModelHeader> headers (model_names.size());
+
+      parallel_for_reporting ( model_names.size()
+                             , [&] (std::size_t i)
+                               {
+                                 std::memset (&headers[i], 0, sizeof (ModelHeader));
+
+                                 MPQFile file (model_names[i]);
+                                 if (!file.isEof() && file.getSize() >= sizeof (ModelHeader))
+                                 {
+                                   std::memcpy (&headers[i], file.getBuffer(), sizeof (ModelHeader));
+                                 }
+                               }
+                             , uid_fix_progress::stage::assign
+                             , progress
+                             );
+
+      // set all uids, unless only the duplicates dropped by the scan go
+      // for each tile save the m2/wmo present inside
+      std::uint32_t uid (0);
+      std::vector<std::vector<std::uint32_t>> modelPerTile (64 * 64);
+      std::vector<std::vector<std::uint32_t>> wmoPerTile (64 * 64);
+
+      for (std::uint32_t i (0); i < models.size(); ++i)
+      {
+        model_placement& model (models[i]);
+        if (assign_uids)
+        {
+          model.entry.uniqueID = uid++;
+        }
+
+        model_extents ( headers[model.name]
+                      , {model.entry.pos[0], model.entry.pos[1], model.entry.pos[2]}
+                      , {model.entry.rot[0], model.entry.rot[1], model.entry.rot[2]}
+                      , model.entry.scale / 1024.0f
+                      , model.extents.data()
+                      , model.size_cat
+                      );
+
+        for_each_covered_tile ( model.extents[0], model.extents[1]
+                              , [&] (std::size_t tile) { modelPerTile[tile].emplace_back (i); }
+                              );
+      }
+
+      headers = {};
+
+      for (std::uint32_t i (0); i < wmos.size(); ++i)
+      {
+        ENTRY_MODF& entry (wmos[i].entry);
+        if (assign_uids)
+        {
+          entry.uniqueID = uid++;
+        }
+
+        for_each_covered_tile ( {entry.extents[0][0], entry.extents[0][1], entry.extents[0][2]}
+                              , {entry.extents[1][0], entry.extents[1][1], entry.extents[1][2]}
+                              , [&] (std::size_t tile) { wmoPerTile[tile].emplace_back (i); }
+                              );
+      }
+
+      if (assign_uids && uid)
+      {
+        result.highest_uid = uid - 1;
+      }
+
+      auto const objects
+        ( [&] (tile_index const& tile)
+          {
+            std::size_t const index (tile.z * 64 + tile.x);
+            return objects_of_tile ( modelPerTile[index], wmoPerTile[index]
+                                   , models, wmos, model_names, wmo_names
+                                   , sort_models_by_size_class
+                                   );
+          }
+        );
+
+      // rewrite every tile, even the ones without models in case there are
+      // old ones that shouldn't be there to avoid creating new duplicates.
+      // Only the object chunks are replaced, the terrain is copied as is.
+      // The wod split files are only written by MapTile::saveTile, so these
+      // tiles go the slow way, as do the ones that can't be patched.
+      bool const wod_save (!Settings::getInstance()->wodSavePath.empty());
+      std::vector<char> needs_full_save (tiles.size(), wod_save);
+      std::mutex save_mutex;
+
+      parallel_for_reporting ( tiles.size()
+                             , [&] (std::size_t i)
+                               {
+                                 if (wod_save)
+                                 {
+                                   return;
+                                 }
+
+                                 std::string const filename (adt_filename (basename, tiles[i]));
+                                 auto const file (read_adt (filename));
+                                 if (!file)
+                                 {
+                                   result.tiles[i].error = "could not be read";
+                                   return;
+                                 }
+
+                                 auto const patched
+                                   (patch_adt_objects (file->data(), file->size(), objects (tiles[i])));
+
+                                 if (!patched)
+                                 {
+                                   needs_full_save[i] = true;
+                                   return;
+                                 }
+
+                                 save_adt (filename, *patched, save_mutex);
+                                 result.tiles[i].written = true;
+                               }
+                             , uid_fix_progress::stage::rewrite
+                             , progress
+                             );
+
+      for (std::size_t i (0); i < tiles.size(); ++i)
+      {
+        if (!needs_full_save[i])
+        {
+          continue;
+        }
+        else if (!save_fully)
+        {
+          result.tiles[i].error = "has to be saved from the editor";
+          continue;
+        }
+
+        adt_objects tile_objects (objects (tiles[i]));
+        save_fully (tiles[i], tile_objects);
+        result.tiles[i].written = true;
+      }
+
+      std::chrono::duration<float> const elapsed (std::chrono::steady_clock::now() - start);
+
+      Log << (assign_uids ? "fixUIDs: " : "delete_duplicates: ") << models.size() << " models and " << wmos.size() << " wmos on "
+          << tiles.size() << " tiles in " << elapsed.count() << " s." << std::endl;
+
+      if (progress)
+      {
+        progress ({uid_fix_progress::stage::finished, tiles.size(), tiles.size(), elapsed.count()});
+      }
+
+      return result;
+    }
+
+    boost::optional<wdt_info> read_wdt (std::string const& basename)
+    {
+      MPQFile file (wdt_filename (basename));
+      if (file.isEof() || file.getSize() < main_offset + 8 + 64 * 64 * 8)
+      {
+        return boost::none;
+      }
+
+      char const* data (file.getBuffer());
+      if ( read<std::uint32_t> (data) != 'MVER'
+        || read<std::uint32_t> (data + mphd_offset) != 'MPHD'
+        || read<std::uint32_t> (data + main_offset) != 'MAIN'
+         )
+      {
+        return boost::none;
+      }
+
+      wdt_info info;
+      MPHD const header (read<MPHD> (data + mphd_offset + 8));
+      info.big_alpha = header.flags & 4;
+      info.sort_models_by_size_class = header.flags & 0x8;
+
+      for (std::size_t z (0); z < 64; ++z)
+      {
+        for (std::size_t x (0); x < 64; ++x)
+        {
+          tile_index const tile (x, z);
+          std::uint32_t const flags (read<std::uint32_t> (data + main_offset + 8 + (z * 64 + x) * 8));
+
+          if ((flags & 1) || MPQFile::existsOnDisk (adt_filename (basename, tile)))
+          {
+            info.tiles.emplace_back (tile);
+          }
+        }
+      }
+
+      return info;
+    }
+
+    bool set_big_alpha (std::string const& basename, bool big_alpha)
+    {
+      MPQFile file (wdt_filename (basename));
+      if (file.isEof() || file.getSize() < mphd_offset + 8 + sizeof (MPHD))
+      {
+        return false;
+      }
+
+      std::vector<char> data (file.getBuffer(), file.getBuffer() + file.getSize());
+      if (read<std::uint32_t> (data.data() + mphd_offset) != 'MPHD')
+      {
+        return false;
+      }
+
+      MPHD header (read<MPHD> (data.data() + mphd_offset + 8));
+      header.flags = big_alpha ? header.flags | 4 : header.flags & ~4u;
+      std::memcpy (data.data() + mphd_offset + 8, &header, sizeof (MPHD));
+
+      file.setBuffer (data);
+      file.SaveFile();
+      return true;
+    }
+  }
+}
@@ -0,0 +1,115 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/adt_object_patch.hpp>
+#include <noggit/tile_index.hpp>
+
+#include <boost/optional/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//! reported by map_maintenance::rewrite_objects and MapIndex::fixUIDs while it works through its stages
+struct uid_fix_progress
+{
+  enum class stage
+  {
+    scan,
+    assign,
+    rewrite,
+    finished
+  };
+
+  stage current;
+  std::size_t done;
+  std::size_t total;
+  //! time spent in the current stage
+  float seconds;
+};
+
+namespace noggit
+{
+  struct tile_maintenance_result
+  {
+    tile_index tile;
+    bool written;
+    //! number of MCNKs that were changed
+    std::size_t changed_chunks;
+    //! empty unless the tile couldn't be read or rewritten
+    std::string error;
+  };
+
+  //! Terrain maintenance working on the ADTs as saved, without loading them
+  //! into a World. Nothing touches GL, so these run without a context, each
+  //! on a pool of \a threads (0 for one per core). Tiles are only written if
+  //! something changed.
+  namespace map_maintenance
+  {
+    //! rewrites MCAL and MCLY of all chunks from one alphamap format to the
+    //! other. The tiles are converted in memory first and only written if
+    //! all of them could be, otherwise every tile reports an error and none
+    //! is touched. The WDT flag has to be changed by the caller, only if no
+    //! tile failed.
+    std::vector<tile_maintenance_result> convert_alphamaps
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , bool from_big_alpha
+      , bool to_big_alpha
+      , std::size_t threads
+      );
+
+    //! same as World::fixAllGaps with \a tiles loaded: left and top edges
+    //! of every chunk take the heights of their neighbours and the normals
+    //! of changed chunks are recalculated
+    std::vector<tile_maintenance_result> fix_gaps
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , std::size_t threads
+      );
+
+    struct object_rewrite_result
+    {
+      //! changed_chunks is always 0, the terrain isn't touched
+      std::vector<tile_maintenance_result> tiles;
+      //! highest uid given out, 0 unless uids were assigned
+      std::uint32_t highest_uid;
+    };
+
+    //! rewrites the objects of \a tiles without duplicates, each tile
+    //! getting every placement covering it, with fresh uids if
+    //! \a assign_uids. Only the object chunks are replaced. Tiles that
+    //! can't be patched that way, and all of them if the wod save path is
+    //! set, are passed to \a save_fully with their objects. Without it they
+    //! are reported as not written.
+    //! \note progress and save_fully are called from the calling thread only
+    object_rewrite_result rewrite_objects
+      ( std::string const& basename
+      , std::vector<tile_index> const& tiles
+      , bool assign_uids
+      , bool sort_models_by_size_class
+      , std::function<void (uid_fix_progress const&)> const& progress
+      , std::function<void (tile_index const&, adt_objects&)> const& save_fully
+      );
+
+    //! what the maintenance needs from a WDT
+    struct wdt_info
+    {
+      //! flagged in MAIN or present on disk, as MapIndex loads them
+      std::vector<tile_index> tiles;
+      bool big_alpha;
+      bool sort_models_by_size_class;
+    };
+
+    //! \returns boost::none if the WDT can't be read
+    boost::optional<wdt_info> read_wdt (std::string const& basename);
+
+    //! sets or clears the big alpha flag in MPHD, the rest of the WDT is
+    //! written as read
+    //! \returns false if the WDT can't be read
+    bool set_big_alpha (std::string const& basename, bool big_alpha);
+  }
+}
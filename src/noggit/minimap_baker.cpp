@@ -0,0 +1,663 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <math/vector_3d.hpp>
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+#include <noggit/MapHeaders.h>
+#include <noggit/alphamap_codec.hpp>
+#include <noggit/minimap_baker.hpp>
+#include <noggit/texture_cache.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace noggit
+{
+  namespace
+  {
+    // every layer texture repeats this often across a chunk, as in MapChunk
+    constexpr float const texture_repeats = 8.0f;
+    // MCSH texels are drawn with this alpha over the (black) shadow color
+    constexpr float const shadow_intensity = 85.0f / 255.0f;
+
+    template<typename T>
+      T read (char const* data)
+    {
+      T value;
+      std::memcpy (&value, data, sizeof (T));
+      return value;
+    }
+
+    std::uint32_t rgba (int r, int g, int b, int a)
+    {
+      return std::uint32_t (r) | std::uint32_t (g) << 8 | std::uint32_t (b) << 16 | std::uint32_t (a) << 24;
+    }
+
+    //! expands the two 565 endpoints and the four indexed colors of a block
+    void decode_color_block ( char const* block
+                            , bool allow_transparency
+                            , std::array<std::uint32_t, 16>& out
+                            )
+    {
+      std::uint16_t const c0 (read<std::uint16_t> (block));
+      std::uint16_t const c1 (read<std::uint16_t> (block + 2));
+      std::uint32_t const indices (read<std::uint32_t> (block + 4));
+
+      auto const expand
+        ( [] (std::uint16_t c, int& r, int& g, int& b)
+          {
+            r = ((c >> 11) & 0x1f) * 255 / 31;
+            g = ((c >> 5) & 0x3f) * 255 / 63;
+            b = (c & 0x1f) * 255 / 31;
+          }
+        );
+
+      int r[4], g[4], b[4], a[4] = {255, 255, 255, 255};
+      expand (c0, r[0], g[0], b[0]);
+      expand (c1, r[1], g[1], b[1]);
+
+      if (c0 > c1 || !allow_transparency)
+      {
+        r[2] = (2 * r[0] + r[1]) / 3; g[2] = (2 * g[0] + g[1]) / 3; b[2] = (2 * b[0] + b[1]) / 3;
+        r[3] = (r[0] + 2 * r[1]) / 3; g[3] = (g[0] + 2 * g[1]) / 3; b[3] = (b[0] + 2 * b[1]) / 3;
+      }
+      else
+      {
+        r[2] = (r[0] + r[1]) / 2; g[2] = (g[0] + g[1]) / 2; b[2] = (b[0] + b[1]) / 2;
+        r[3] = g[3] = b[3] = a[3] = 0;
+      }
+
+      for (int i (0); i < 16; ++i)
+      {
+        int const index ((indices >> (2 * i)) & 3);
+        out[i] = rgba (r[index], g[index], b[index], a[index]);
+      }
+    }
+
+    void decode_dxt3_alpha (char const* block, std::array<std::uint32_t, 16>& out)
+    {
+      std::uint64_t const alphas (read<std::uint64_t> (block));
+      for (int i (0); i < 16; ++i)
+      {
+        std::uint32_t const alpha (((alphas >> (4 * i)) & 0xf) * 17);
+        out[i] = (out[i] & 0x00ffffff) | alpha << 24;
+      }
+    }
+
+    void decode_dxt5_alpha (char const* block, std::array<std::uint32_t, 16>& out)
+    {
+      int const a0 (static_cast<unsigned char> (block[0]));
+      int const a1 (static_cast<unsigned char> (block[1]));
+
+      int alpha[8] = {a0, a1};
+      for (int i (1); i < 7; ++i)
+      {
+        alpha[i + 1] = a0 > a1 ? ((7 - i) * a0 + i * a1) / 7
+                     : i < 5 ? ((5 - i) * a0 + i * a1) / 5
+                     : i == 5 ? 0 : 255;
+      }
+
+      std::uint64_t indices (0);
+      std::memcpy (&indices, block + 2, 6);
+      for (int i (0); i < 16; ++i)
+      {
+        out[i] = (out[i] & 0x00ffffff) | std::uint32_t (alpha[(indices >> (3 * i)) & 7]) << 24;
+      }
+    }
+
+    minimap_baker::texture::level decode_s3tc (blp_image::level const& level, GLenum format)
+    {
+      minimap_baker::texture::level out {level.width, level.height, {}};
+      out.pixels.resize (level.width * level.height);
+
+      bool const dxt1 ( format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                     || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+                      );
+      std::size_t const block_size (dxt1 ? 8 : 16);
+
+      char const* block (level.data);
+      std::array<std::uint32_t, 16> texels;
+
+      for (int y (0); y < level.height; y += 4)
+      {
+        for (int x (0); x < level.width; x += 4, block += block_size)
+        {
+          decode_color_block (block + block_size - 8, dxt1, texels);
+
+          if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)
+          {
+            decode_dxt3_alpha (block, texels);
+          }
+          else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+          {
+            decode_dxt5_alpha (block, texels);
+          }
+
+          for (int j (0); j < 4 && y + j < level.height; ++j)
+          {
+            for (int i (0); i < 4 && x + i < level.width; ++i)
+            {
+              out.pixels[(y + j) * level.width + x + i] = texels[j * 4 + i];
+            }
+          }
+        }
+      }
+
+      return out;
+    }
+
+    //! what the baker needs of a MCNK
+    struct chunk
+    {
+      int x;
+      int z;
+      std::vector<std::string const*> textures;
+      std::array<std::array<unsigned char, 64 * 64>, 3> alphas;
+      bool has_shadow = false;
+      std::array<unsigned char, 0x200> shadow;
+      bool has_vertex_colors = false;
+      std::array<math::vector_3d, 145> vertex_colors;
+    };
+
+    std::vector<chunk> read_chunks ( char const* data
+                                   , std::size_t size
+                                   , bool big_alpha
+                                   , std::vector<std::string>& texture_filenames
+                                   )
+    {
+      std::vector<chunk> chunks;
+      char const* const end (data + size);
+
+      // sub chunk offsets in MCNK are relative to its header
+      auto const sub_chunk
+        ( [&] (char const* mcnk, std::uint32_t offset, std::uint32_t fourcc) -> char const*
+          {
+            if (!offset || mcnk + offset + 8 > end || read<std::uint32_t> (mcnk + offset) != fourcc)
+            {
+              return nullptr;
+            }
+            return mcnk + offset + 8;
+          }
+        );
+
+      for (char const* position (data); position + 8 <= end;)
+      {
+        std::uint32_t const fourcc (read<std::uint32_t> (position));
+        std::uint32_t const chunk_size (read<std::uint32_t> (position + 4));
+        char const* const content (position + 8);
+
+        if (content + chunk_size > end)
+        {
+          throw std::runtime_error ("truncated chunk");
+        }
+
+        if (fourcc == 'MTEX')
+        {
+          for (char const* name (content); name < content + chunk_size;)
+          {
+            std::size_t const length (strnlen (name, content + chunk_size - name));
+            texture_filenames.emplace_back (name, length);
+            name += length + 1;
+          }
+        }
+        else if (fourcc == 'MCNK' && chunk_size >= sizeof (MapChunkHeader))
+        {
+          MapChunkHeader const header (read<MapChunkHeader> (content));
+
+          chunks.emplace_back();
+          chunk& out (chunks.back());
+          out.x = header.ix;
+          out.z = header.iy;
+
+          char const* const layers (sub_chunk (position, header.ofsLayer, 'MCLY'));
+          std::size_t const layer_count
+            (layers ? std::min<std::size_t> (4, read<std::uint32_t> (layers - 4) / sizeof (ENTRY_MCLY)) : 0);
+
+          char const* const alpha (sub_chunk (position, header.ofsAlpha, 'MCAL'));
+
+          for (std::size_t i (0); i < layer_count; ++i)
+          {
+            ENTRY_MCLY const layer (read<ENTRY_MCLY> (layers + i * sizeof (ENTRY_MCLY)));
+
+            out.textures.emplace_back
+              (layer.textureID < texture_filenames.size() ? &texture_filenames[layer.textureID] : nullptr);
+
+            if (i == 0)
+            {
+              continue;
+            }
+
+            out.alphas[i - 1].fill (0);
+            if (alpha && layer.flags & 0x100)
+            {
+              // same flag as MapChunk passes
+              noggit::decode_alphamap ( alpha + layer.ofsAlpha
+                                      , end
+                                      , layer.flags
+                                      , big_alpha
+                                      , (header.flags & FLAG_do_not_fix_alpha_map) == 0
+                                      , out.alphas[i - 1].data()
+                                      );
+            }
+          }
+
+          if (char const* shadow = sub_chunk (position, header.sizeShadow ? header.ofsShadow : 0, 'MCSH'))
+          {
+            if (shadow + 0x200 <= end)
+            {
+              out.has_shadow = true;
+              std::memcpy (out.shadow.data(), shadow, 0x200);
+            }
+          }
+
+          if (char const* colors = sub_chunk (position, header.ofsMCCV, 'MCCV'))
+          {
+            if (colors + 145 * 4 <= end)
+            {
+              out.has_vertex_colors = true;
+              for (std::size_t i (0); i < 145; ++i)
+              {
+                unsigned char const* t (reinterpret_cast<unsigned char const*> (colors + i * 4));
+                out.vertex_colors[i] = {t[2] / 127.0f, t[1] / 127.0f, t[0] / 127.0f};
+              }
+            }
+          }
+        }
+
+        position = content + chunk_size;
+      }
+
+      return chunks;
+    }
+
+    //! vertex color on the 9x9 outer grid at \a x, \a z in [0, 8]
+    math::vector_3d vertex_color (chunk const& c, float x, float z)
+    {
+      int const x0 (std::min (7, static_cast<int> (x)));
+      int const z0 (std::min (7, static_cast<int> (z)));
+      float const fx (x - x0);
+      float const fz (z - z0);
+
+      auto const at ([&] (int r, int col) { return c.vertex_colors[r * 17 + col]; });
+
+      return (at (z0, x0) * (1.0f - fx) + at (z0, x0 + 1) * fx) * (1.0f - fz)
+           + (at (z0 + 1, x0) * (1.0f - fx) + at (z0 + 1, x0 + 1) * fx) * fz;
+    }
+
+    std::uint32_t sample (minimap_baker::texture const* texture, float u, float v, float texels_per_pixel)
+    {
+      if (!texture || texture->levels.empty())
+      {
+        return rgba (128, 128, 128, 255);
+      }
+
+      // the level whose texels are closest to one per output pixel
+      std::size_t const level_index
+        ( std::min<std::size_t> ( texture->levels.size() - 1
+                                , std::max (0.0f, std::floor (std::log2 (texels_per_pixel * texture->levels[0].width)))
+                                )
+        );
+      minimap_baker::texture::level const& level (texture->levels[level_index]);
+
+      int const x (std::min (level.width - 1, static_cast<int> ((u - std::floor (u)) * level.width)));
+      int const y (std::min (level.height - 1, static_cast<int> ((v - std::floor (v)) * level.height)));
+
+      return level.pixels[y * level.width + x];
+    }
+
+    std::vector<std::uint32_t> downsample (std::vector<std::uint32_t> const& pixels, int width, int height)
+    {
+      int const w (std::max (1, width / 2));
+      int const h (std::max (1, height / 2));
+      std::vector<std::uint32_t> out (w * h);
+
+      for (int y (0); y < h; ++y)
+      {
+        for (int x (0); x < w; ++x)
+        {
+          std::uint32_t sum[4] = {0, 0, 0, 0};
+          for (int j (0); j < 2; ++j)
+          {
+            for (int i (0); i < 2; ++i)
+            {
+              std::uint32_t const p
+                (pixels[std::min (height - 1, 2 * y + j) * width + std::min (width - 1, 2 * x + i)]);
+              for (int c (0); c < 4; ++c)
+              {
+                sum[c] += (p >> (8 * c)) & 0xff;
+              }
+            }
+          }
+          out[y * w + x] = sum[0] / 4 | (sum[1] / 4) << 8 | (sum[2] / 4) << 16 | (sum[3] / 4) << 24;
+        }
+      }
+
+      return out;
+    }
+
+    //! BLP2 with uncompressed BGRA pixels and a full mip chain
+    void write_blp (QImage const& image, std::string const& filename)
+    {
+#pragma pack(push,1)
+      struct
+      {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint8_t compression;
+        std::uint8_t alpha_depth;
+        std::uint8_t alpha_type;
+        std::uint8_t has_mipmaps;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t offsets[16];
+        std::uint32_t sizes[16];
+        std::uint32_t palette[256];
+      } header;
+#pragma pack(pop)
+
+      std::memset (&header, 0, sizeof (header));
+      std::memcpy (&header.magic, "BLP2", 4);
+      header.version = 1;
+      header.compression = 3;
+      header.alpha_depth = 8;
+      header.alpha_type = 8;
+      header.has_mipmaps = 1;
+      header.width = image.width();
+      header.height = image.height();
+
+      // ARGB32 words are BGRA in memory on little endian machines
+      std::vector<std::vector<std::uint32_t>> levels (1);
+      for (int y (0); y < image.height(); ++y)
+      {
+        std::uint32_t const* line (reinterpret_cast<std::uint32_t const*> (image.constScanLine (y)));
+        levels[0].insert (levels[0].end(), line, line + image.width());
+      }
+
+      for (int width (image.width()), height (image.height()); (width > 1 || height > 1) && levels.size() < 16;)
+      {
+        levels.emplace_back (downsample (levels.back(), width, height));
+        width = std::max (1, width / 2);
+        height = std::max (1, height / 2);
+      }
+
+      std::uint32_t offset (sizeof (header));
+      for (std::size_t i (0); i < levels.size(); ++i)
+      {
+        header.offsets[i] = offset;
+        header.sizes[i] = levels[i].size() * 4;
+        offset += header.sizes[i];
+      }
+
+      std::ofstream stream (filename, std::ios::binary);
+      stream.write (reinterpret_cast<char const*> (&header), sizeof (header));
+      for (auto const& level : levels)
+      {
+        stream.write (reinterpret_cast<char const*> (level.data()), level.size() * 4);
+      }
+
+      if (!stream)
+      {
+        throw std::runtime_error ("writing '" + filename + "' failed");
+      }
+    }
+  }
+
+  minimap_baker::minimap_baker (std::string basename, bool big_alpha)
+    : _basename (std::move (basename))
+    , _big_alpha (big_alpha)
+  {}
+
+  std::shared_ptr<minimap_baker::texture const> minimap_baker::load_texture
+    (std::string const& filename, std::string const& cache_directory)
+  {
+    {
+      std::lock_guard<std::mutex> const lock (_textures_mutex);
+      auto const it (_textures.find (filename));
+      if (it != _textures.end())
+      {
+        return it->second;
+      }
+    }
+
+    // decoded outside the lock, a texture racing on two threads is merely
+    // decoded twice
+    std::shared_ptr<texture> decoded;
+    try
+    {
+      blp_image const image (texture_cache::load (filename, cache_directory));
+
+      decoded = std::make_shared<texture>();
+      for (blp_image::level const& level : image.levels())
+      {
+        if (image.compressed())
+        {
+          decoded->levels.emplace_back (decode_s3tc (level, image.format()));
+        }
+        else
+        {
+          texture::level out {level.width, level.height, std::vector<std::uint32_t> (level.width * level.height)};
+          std::memcpy (out.pixels.data(), level.data, std::min (level.size, out.pixels.size() * 4));
+          decoded->levels.emplace_back (std::move (out));
+        }
+      }
+    }
+    catch (std::exception const& e)
+    {
+      LogError << "minimap: can't load '" << filename << "': " << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> const lock (_textures_mutex);
+    return _textures.emplace (filename, std::move (decoded)).first->second;
+  }
+
+  QImage minimap_baker::bake (tile_index const& tile, minimap_bake_settings const& settings)
+  {
+    std::stringstream filename;
+    filename << "World\\Maps\\" << _basename << "\\" << _basename << "_" << tile.x << "_" << tile.z << ".adt";
+
+    MPQFile file (filename.str());
+    if (file.isEof())
+    {
+      throw std::runtime_error ("can't open '" + filename.str() + "'");
+    }
+
+    std::vector<std::string> texture_filenames;
+    std::vector<chunk> const chunks
+      (read_chunks (file.getBuffer(), file.getSize(), _big_alpha, texture_filenames));
+
+    int const chunk_pixels (std::max (1, settings.tile_size / 16));
+    // texels of the finest layer level per output pixel
+    float const texels_per_pixel (texture_repeats / chunk_pixels);
+
+    QImage image (16 * chunk_pixels, 16 * chunk_pixels, QImage::Format_ARGB32);
+    image.fill (Qt::black);
+
+    for (chunk const& c : chunks)
+    {
+      if (c.x >= 16 || c.z >= 16)
+      {
+        continue;
+      }
+
+      std::vector<std::shared_ptr<texture const>> textures;
+      for (std::string const* name : c.textures)
+      {
+        textures.emplace_back (name ? load_texture (*name, settings.texture_cache_directory) : nullptr);
+      }
+
+      for (int pz (0); pz < chunk_pixels; ++pz)
+      {
+        std::uint32_t* line (reinterpret_cast<std::uint32_t*> (image.scanLine (c.z * chunk_pixels + pz)));
+
+        for (int px (0); px < chunk_pixels; ++px)
+        {
+          // pixel center and footprint in chunk space, [0, 1)
+          float const fx ((px + 0.5f) / chunk_pixels);
+          float const fz ((pz + 0.5f) / chunk_pixels);
+
+          int const ax0 (px * 64 / chunk_pixels);
+          int const az0 (pz * 64 / chunk_pixels);
+          int const ax1 (std::max (ax0 + 1, (px + 1) * 64 / chunk_pixels));
+          int const az1 (std::max (az0 + 1, (pz + 1) * 64 / chunk_pixels));
+
+          float weights[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+          for (std::size_t k (1); k < textures.size(); ++k)
+          {
+            float alpha (0.0f);
+            for (int z (az0); z < az1; ++z)
+            {
+              for (int x (ax0); x < ax1; ++x)
+              {
+                alpha += c.alphas[k - 1][z * 64 + x];
+              }
+            }
+            alpha /= 255.0f * (ax1 - ax0) * (az1 - az0);
+
+            if (_big_alpha)
+            {
+              // big alphas are the final weights, see TextureSet::convertToOldAlpha
+              weights[k] = alpha;
+              weights[0] = std::max (0.0f, weights[0] - alpha);
+            }
+            else
+            {
+              for (std::size_t n (0); n < k; ++n)
+              {
+                weights[n] *= 1.0f - alpha;
+              }
+              weights[k] = alpha;
+            }
+          }
+
+          math::vector_3d color (0.0f, 0.0f, 0.0f);
+          for (std::size_t k (0); k < textures.size(); ++k)
+          {
+            std::uint32_t const texel
+              (sample (textures[k].get(), fx * texture_repeats, fz * texture_repeats, texels_per_pixel));
+            color += math::vector_3d ( texel & 0xff
+                                     , (texel >> 8) & 0xff
+                                     , (texel >> 16) & 0xff
+                                     ) * weights[k];
+          }
+
+          if (settings.vertex_colors && c.has_vertex_colors)
+          {
+            math::vector_3d const shade (vertex_color (c, fx * 8.0f, fz * 8.0f));
+            color = {color.x * shade.x, color.y * shade.y, color.z * shade.z};
+          }
+
+          if (settings.shadows && c.has_shadow)
+          {
+            int const sx (std::min (63, static_cast<int> (fx * 64)));
+            int const sz (std::min (63, static_cast<int> (fz * 64)));
+            if (c.shadow[sz * 8 + sx / 8] & (1 << (sx % 8)))
+            {
+              color *= 1.0f - shadow_intensity;
+            }
+          }
+
+          line[c.x * chunk_pixels + px] = qRgb ( std::min (255, static_cast<int> (color.x))
+                                               , std::min (255, static_cast<int> (color.y))
+                                               , std::min (255, static_cast<int> (color.z))
+                                               );
+        }
+      }
+    }
+
+    return image;
+  }
+
+  std::string minimap_baker::output_filename (tile_index const& tile, minimap_bake_settings const& settings) const
+  {
+    std::stringstream name;
+    name << "map" << std::setw (2) << std::setfill ('0') << tile.x
+         << "_" << std::setw (2) << std::setfill ('0') << tile.z
+         << (settings.format == minimap_format::png ? ".png" : ".blp");
+
+    // the unhashed names md5translate.trs maps the client's files to
+    return ( boost::filesystem::path (settings.output_directory)
+           / "World" / "Minimaps" / _basename / name.str()
+           ).string();
+  }
+
+  minimap_bake_result minimap_baker::bake_all ( std::vector<tile_index> const& tiles
+                                              , minimap_bake_settings const& settings
+                                              , std::function<void (std::size_t)> progress
+                                              )
+  {
+    minimap_bake_result result;
+    std::mutex result_mutex;
+
+    std::atomic<std::size_t> next (0);
+    std::atomic<std::size_t> done (0);
+
+    auto const worker
+      ( [&]
+        {
+          for (std::size_t i; (i = next++) < tiles.size();)
+          {
+            try
+            {
+              QImage const image (bake (tiles[i], settings));
+              std::string const filename (output_filename (tiles[i], settings));
+
+              boost::filesystem::create_directories (boost::filesystem::path (filename).parent_path());
+
+              if (settings.format == minimap_format::blp)
+              {
+                write_blp (image, filename);
+              }
+              else if (!image.save (QString::fromStdString (filename), "PNG"))
+              {
+                throw std::runtime_error ("writing '" + filename + "' failed");
+              }
+
+              std::lock_guard<std::mutex> const lock (result_mutex);
+              ++result.written;
+            }
+            catch (std::exception const& e)
+            {
+              std::lock_guard<std::mutex> const lock (result_mutex);
+              result.failed.emplace_back (tiles[i], e.what());
+            }
+
+            if (progress)
+            {
+              progress (++done);
+            }
+          }
+        }
+      );
+
+    unsigned int const thread_count
+      ( std::max (1u, std::min<unsigned int> ( settings.threads ? settings.threads : std::thread::hardware_concurrency()
+                                             , tiles.size()
+                                             )
+                 )
+      );
+
+    std::vector<std::thread> threads;
+    for (unsigned int i (1); i < thread_count; ++i)
+    {
+      threads.emplace_back (worker);
+    }
+    worker();
+
+    for (std::thread& thread : threads)
+    {
+      thread.join();
+    }
+
+    return result;
+  }
+}
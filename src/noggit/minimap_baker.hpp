@@ -0,0 +1,91 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/tile_index.hpp>
+
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace noggit
+{
+  enum class minimap_format
+  {
+    png,
+    //! uncompressed BLP2 with mipmaps
+    blp,
+  };
+
+  struct minimap_bake_settings
+  {
+    //! tiles go to <output_directory>/World/Minimaps/<map>/mapXX_YY.<ext>
+    std::string output_directory;
+    minimap_format format = minimap_format::png;
+    //! edge length of a tile in pixels, a multiple of 16
+    int tile_size = 256;
+    bool vertex_colors = true;
+    bool shadows = true;
+    //! 0 uses one thread per core
+    unsigned int threads = 0;
+    //! decoded BLPs, as in texture_cache::load. empty to disable.
+    std::string texture_cache_directory;
+  };
+
+  struct minimap_bake_result
+  {
+    std::size_t written = 0;
+    //! tile and reason
+    std::vector<std::pair<tile_index, std::string>> failed;
+  };
+
+  //! Composites minimap tiles on the CPU straight from the ADTs: texture
+  //! layers are blended through their alphamaps and shaded with vertex
+  //! colors and the baked shadow map. Needs the archives but no GL
+  //! context, so it also runs on headless machines.
+  class minimap_baker
+  {
+  public:
+    minimap_baker (std::string basename, bool big_alpha);
+
+    //! throws if the ADT can't be read
+    QImage bake (tile_index const&, minimap_bake_settings const&);
+
+    //! bakes and writes all \a tiles on a pool of threads. \a progress is
+    //! called from the workers with the number of tiles done so far.
+    minimap_bake_result bake_all ( std::vector<tile_index> const& tiles
+                                 , minimap_bake_settings const&
+                                 , std::function<void (std::size_t)> progress = nullptr
+                                 );
+
+    std::string output_filename (tile_index const&, minimap_bake_settings const&) const;
+
+    //! RGBA8 mip chain of a layer texture
+    struct texture
+    {
+      struct level
+      {
+        int width;
+        int height;
+        std::vector<std::uint32_t> pixels;
+      };
+      std::vector<level> levels;
+    };
+
+  private:
+    std::shared_ptr<texture const> load_texture (std::string const& filename, std::string const& cache_directory);
+
+    std::string const _basename;
+    bool const _big_alpha;
+
+    std::mutex _textures_mutex;
+    std::map<std::string, std::shared_ptr<texture const>> _textures;
+  };
+}
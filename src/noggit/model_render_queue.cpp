@@ -0,0 +1,83 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/Model.h>
+#include <noggit/ModelInstance.h>
+#include <noggit/model_render_queue.hpp>
+#include <opengl/context.hpp>
+
+#include <algorithm>
+
+namespace noggit
+{
+  model_render_queue::model_render_queue (math::matrix_4x4 const& view)
+    : _view (view)
+    , _statistics {0, 0}
+  {}
+
+  void model_render_queue::add (ModelInstance& instance, float distance)
+  {
+    Model* model (instance.model.get());
+    math::matrix_4x4 const model_view (_view * instance.transform_matrix());
+
+    ++_statistics.instances;
+
+    if (model->needs_single_draw())
+    {
+      _blended.push_back ({model, model_view, distance});
+      return;
+    }
+
+    _opaque[model].emplace_back (model_view);
+
+    if (model->has_blended_passes())
+    {
+      _blended.push_back ({model, model_view, distance});
+    }
+  }
+
+  void model_render_queue::draw (bool draw_fog, int animtime)
+  {
+    std::vector<std::pair<Model*, std::vector<math::matrix_4x4>*>> batches;
+    for (auto& batch : _opaque)
+    {
+      batches.emplace_back (batch.first, &batch.second);
+    }
+
+    // keep models sharing a texture next to each other
+    std::sort ( batches.begin(), batches.end()
+              , [] (auto const& lhs, auto const& rhs)
+                {
+                  return lhs.first->first_texture() < rhs.first->first_texture();
+                }
+              );
+
+    for (auto const& batch : batches)
+    {
+      _statistics.draw_calls += batch.first->draw_instances (*batch.second, false, draw_fog, animtime);
+    }
+
+    std::sort ( _blended.begin(), _blended.end()
+              , [] (instance const& lhs, instance const& rhs)
+                {
+                  return lhs.distance > rhs.distance;
+                }
+              );
+
+    for (instance const& blended : _blended)
+    {
+      if (blended.model->needs_single_draw())
+      {
+        gl.loadMatrixf (blended.model_view.transposed());
+        blended.model->draw (draw_fog, animtime);
+        ++_statistics.draw_calls;
+      }
+      else
+      {
+        _statistics.draw_calls += blended.model->draw_instances
+          ({blended.model_view}, true, draw_fog, animtime);
+      }
+    }
+
+    gl.loadMatrixf (_view.transposed());
+  }
+}
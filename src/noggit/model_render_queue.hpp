@@ -0,0 +1,51 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/matrix_4x4.hpp>
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class Model;
+class ModelInstance;
+
+namespace noggit
+{
+  //! Collects the visible M2 instances of a frame and draws them grouped by
+  //! model, so render pass state is set up once per model and pass instead
+  //! of once per instance. Opaque passes are drawn first, ordered by
+  //! texture, blended passes follow per instance from back to front.
+  class model_render_queue
+  {
+  public:
+    struct statistics
+    {
+      std::size_t instances;
+      std::size_t draw_calls;
+    };
+
+    //! \a view is the camera's model view matrix the instances are drawn with
+    explicit model_render_queue (math::matrix_4x4 const& view);
+
+    void add (ModelInstance& instance, float distance);
+    //! leaves the model view matrix as it was on construction
+    void draw (bool draw_fog, int animtime);
+
+    statistics const& current_statistics() const { return _statistics; }
+
+  private:
+    struct instance
+    {
+      Model* model;
+      math::matrix_4x4 model_view;
+      float distance;
+    };
+
+    math::matrix_4x4 _view;
+    std::unordered_map<Model*, std::vector<math::matrix_4x4>> _opaque;
+    std::vector<instance> _blended;
+    statistics _statistics;
+  };
+}
@@ -0,0 +1,201 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/path_index.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <utility>
+
+namespace noggit
+{
+  namespace
+  {
+    std::string extension_of (std::string const& path)
+    {
+      std::size_t const dot (path.rfind ('.'));
+      std::size_t const slash (path.rfind ('/'));
+      if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      {
+        return {};
+      }
+      return path.substr (dot);
+    }
+
+    std::uint32_t trigram (std::string const& text, std::size_t position)
+    {
+      return std::uint32_t (static_cast<unsigned char> (text[position])) << 16
+           | std::uint32_t (static_cast<unsigned char> (text[position + 1])) << 8
+           | std::uint32_t (static_cast<unsigned char> (text[position + 2]));
+    }
+  }
+
+  path_index::path_index (std::vector<std::string> paths)
+    : _paths (std::move (paths))
+  {
+    std::sort (_paths.begin(), _paths.end());
+    _paths.erase (std::unique (_paths.begin(), _paths.end()), _paths.end());
+
+    _sorted.resize (_paths.size());
+    std::iota (_sorted.begin(), _sorted.end(), id_type (0));
+
+    for (id_type id (0); id < _paths.size(); ++id)
+    {
+      add_to_buckets (id);
+    }
+  }
+
+  bool path_index::insert (std::string path)
+  {
+    auto const position
+      ( std::lower_bound ( _sorted.begin(), _sorted.end(), path
+                         , [&] (id_type id, std::string const& value)
+                           {
+                             return _paths[id] < value;
+                           }
+                         )
+      );
+    if (position != _sorted.end() && _paths[*position] == path)
+    {
+      return false;
+    }
+
+    id_type const id (_paths.size());
+    _paths.emplace_back (std::move (path));
+    _sorted.insert (position, id);
+    add_to_buckets (id);
+    return true;
+  }
+
+  std::size_t path_index::size() const
+  {
+    return _paths.size();
+  }
+
+  std::string const& path_index::path (id_type id) const
+  {
+    return _paths[id];
+  }
+
+  std::vector<path_index::id_type> path_index::with_prefix (std::string const& prefix) const
+  {
+    auto const begin
+      ( std::lower_bound ( _sorted.begin(), _sorted.end(), prefix
+                         , [&] (id_type id, std::string const& value)
+                           {
+                             return _paths[id] < value;
+                           }
+                         )
+      );
+    auto const end
+      ( std::find_if ( begin, _sorted.end()
+                     , [&] (id_type id)
+                       {
+                         return _paths[id].compare (0, prefix.size(), prefix) != 0;
+                       }
+                     )
+      );
+    return {begin, end};
+  }
+
+  std::vector<path_index::id_type> const& path_index::with_extension (std::string const& extension) const
+  {
+    static std::vector<id_type> const none;
+
+    auto const bucket (_by_extension.find (extension));
+    return bucket == _by_extension.end() ? none : bucket->second;
+  }
+
+  void path_index::add_to_buckets (id_type id)
+  {
+    _by_extension[extension_of (_paths[id])].emplace_back (id);
+  }
+
+  substring_search::substring_search ( path_index const& index
+                                     , std::vector<path_index::id_type> candidates
+                                     )
+    : _index (index)
+  {
+    for (path_index::id_type id : candidates)
+    {
+      add (id);
+    }
+  }
+
+  void substring_search::add (path_index::id_type id)
+  {
+    std::uint32_t const position (_candidates.size());
+    _candidates.emplace_back (id);
+
+    std::string const& path (_index.path (id));
+    for (std::size_t i (0); i + 3 <= path.size(); ++i)
+    {
+      std::vector<std::uint32_t>& positions (_trigrams[trigram (path, i)]);
+      if (positions.empty() || positions.back() != position)
+      {
+        positions.emplace_back (position);
+      }
+    }
+
+    _last_valid = false;
+  }
+
+  std::vector<path_index::id_type> const& substring_search::find (std::string const& query)
+  {
+    if (_last_valid && query == _last_query)
+    {
+      return _last_result;
+    }
+
+    auto const contains
+      ( [&] (path_index::id_type id)
+        {
+          return _index.path (id).find (query) != std::string::npos;
+        }
+      );
+
+    std::vector<path_index::id_type> result;
+
+    if (_last_valid && query.find (_last_query) != std::string::npos)
+    {
+      std::copy_if (_last_result.begin(), _last_result.end(), std::back_inserter (result), contains);
+    }
+    else if (query.size() < 3)
+    {
+      std::copy_if (_candidates.begin(), _candidates.end(), std::back_inserter (result), contains);
+    }
+    else
+    {
+      std::vector<std::uint32_t> const* rarest (nullptr);
+      for (std::size_t i (0); i + 3 <= query.size(); ++i)
+      {
+        auto const positions (_trigrams.find (trigram (query, i)));
+        if (positions == _trigrams.end())
+        {
+          rarest = nullptr;
+          break;
+        }
+        if (!rarest || positions->second.size() < rarest->size())
+        {
+          rarest = &positions->second;
+        }
+      }
+
+      if (rarest)
+      {
+        for (std::uint32_t position : *rarest)
+        {
+          if (contains (_candidates[position]))
+          {
+            result.emplace_back (_candidates[position]);
+          }
+        }
+      }
+    }
+
+    _last_query = query;
+    _last_result = std::move (result);
+    _last_valid = true;
+    return _last_result;
+  }
+}
@@ -0,0 +1,67 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace noggit
+{
+  //! Normalized file paths with a sorted view for prefix queries and
+  //! buckets per extension. Ids are indices in insertion order and stay
+  //! valid when paths are added later.
+  class path_index
+  {
+  public:
+    using id_type = std::uint32_t;
+
+    path_index() = default;
+    //! bulk construction, sorting once instead of per insertion
+    path_index (std::vector<std::string> paths);
+
+    //! \returns false if \a path is already known
+    bool insert (std::string path);
+
+    std::size_t size() const;
+    std::string const& path (id_type id) const;
+
+    //! ids of the paths starting with \a prefix, in lexicographic order
+    std::vector<id_type> with_prefix (std::string const& prefix) const;
+    //! ids of the paths ending in \a extension, e.g. ".blp", in id order
+    std::vector<id_type> const& with_extension (std::string const& extension) const;
+
+  private:
+    void add_to_buckets (id_type id);
+
+    std::vector<std::string> _paths;
+    std::vector<id_type> _sorted;
+    std::unordered_map<std::string, std::vector<id_type>> _by_extension;
+  };
+
+  //! Substring search as you type over a subset of a path_index: every
+  //! candidate is listed under the trigrams of its path, so a query only
+  //! checks the candidates sharing its rarest trigram. Queries extending
+  //! the previous one only check its results.
+  class substring_search
+  {
+  public:
+    substring_search (path_index const& index, std::vector<path_index::id_type> candidates);
+
+    void add (path_index::id_type id);
+
+    //! candidates containing \a query, in the order they were added
+    std::vector<path_index::id_type> const& find (std::string const& query);
+
+  private:
+    path_index const& _index;
+    std::vector<path_index::id_type> _candidates;
+    //! trigram to positions in _candidates, ascending
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> _trigrams;
+
+    std::string _last_query;
+    std::vector<path_index::id_type> _last_result;
+    bool _last_valid = false;
+  };
+}
@@ -0,0 +1,257 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <noggit/Log.h>
+#include <noggit/MPQ.h>
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace noggit
+{
+  //! bytes a resource holds, as reported by its memory_usage()
+  struct resource_memory
+  {
+    std::size_t cpu = 0;
+    std::size_t gpu = 0;
+
+    std::size_t total() const
+    {
+      return cpu + gpu;
+    }
+  };
+
+  struct resource_statistics
+  {
+    std::size_t referenced = 0;
+    resource_memory referenced_memory;
+    std::size_t unused = 0;
+    std::size_t unused_bytes = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+  };
+
+  inline std::ostream& operator<< (std::ostream& os, resource_statistics const& statistics)
+  {
+    std::size_t const acquired (statistics.hits + statistics.misses);
+    return os << statistics.referenced << " referenced ("
+              << statistics.referenced_memory.cpu / 1024 << " KiB cpu, "
+              << statistics.referenced_memory.gpu / 1024 << " KiB gpu), "
+              << statistics.unused << " unused (" << statistics.unused_bytes / 1024 << " KiB), "
+              << statistics.hits << " hits, " << statistics.misses << " misses ("
+              << (acquired ? 100 * statistics.hits / acquired : 0) << "% hit rate), "
+              << statistics.evictions << " evicted";
+  }
+
+  //! Shared resources by filename. Every filename is normalized only the
+  //! first time it is seen and interned to an id which indexes a slot with
+  //! the resource and its reference count, so references can be copied by
+  //! incrementing that count. Ids stay valid for the lifetime of the
+  //! registry.
+  //! Resources losing their last reference are kept in a least recently
+  //! used pool of unused ones as long as they fit into the byte budget,
+  //! so going back and forth doesn't load them again. T provides
+  //! resource_memory memory_usage() const for that.
+  template<typename T>
+    class resource_registry
+  {
+  public:
+    using id_type = std::uint32_t;
+
+    //! \a unused_budget is asked whenever a resource becomes unused
+    resource_registry ( std::function<std::string (std::string)> normalize = &mpq::normalized_filename
+                      , std::function<std::size_t()> unused_budget = [] { return 0; }
+                      )
+      : _normalize (std::move (normalize))
+      , _unused_budget (std::move (unused_budget))
+    {}
+
+    ~resource_registry()
+    {
+      apply ( [&] (std::string const& key, T const&)
+              {
+                LogDebug << key << ": " << _slots[_ids.at (key)].references << "\n";
+              }
+            );
+    }
+
+    id_type intern (std::string const& filename)
+    {
+      auto const spelling (_ids_by_spelling.find (filename));
+      if (spelling != _ids_by_spelling.end())
+      {
+        return spelling->second;
+      }
+
+      auto const normalized (_ids.emplace (_normalize (filename), _slots.size()));
+      if (normalized.second)
+      {
+        _slots.emplace_back (&normalized.first->first);
+      }
+
+      return _ids_by_spelling.emplace (filename, normalized.first->second).first->second;
+    }
+
+    //! \returns the resource of an interned id, reviving an unused one or
+    //! creating it with \a args if there is none
+    template<typename... Args>
+      T* acquire (id_type id, Args&&... args)
+    {
+      slot& element (_slots[id]);
+      if (element.references == 0)
+      {
+        if (element.element)
+        {
+          _unused.erase (element.unused_position);
+          _unused_bytes -= element.unused_bytes;
+          ++_hits;
+        }
+        else
+        {
+          element.element = std::make_unique<T> (*element.path, std::forward<Args> (args)...);
+          ++_misses;
+        }
+      }
+
+      ++element.references;
+      return element.element.get();
+    }
+    //! for copies of a reference to an acquired id
+    void add_reference (id_type id)
+    {
+      assert (_slots[id].references);
+      ++_slots[id].references;
+    }
+    void release (id_type id)
+    {
+      slot& element (_slots[id]);
+      assert (element.references);
+      if (--element.references)
+      {
+        return;
+      }
+
+      std::size_t const budget (_unused_budget());
+      element.unused_bytes = element.element->memory_usage().total();
+
+      if (element.unused_bytes > budget)
+      {
+        element.element.reset();
+        ++_evictions;
+        return;
+      }
+
+      element.unused_position = _unused.insert (_unused.end(), id);
+      _unused_bytes += element.unused_bytes;
+
+      while (_unused_bytes > budget)
+      {
+        evict_least_recently_used();
+      }
+    }
+
+    //! frees all unused resources, e.g. before their GL context goes away
+    void purge_unused()
+    {
+      while (!_unused.empty())
+      {
+        evict_least_recently_used();
+      }
+    }
+
+    resource_statistics statistics() const
+    {
+      resource_statistics result;
+      apply ( [&] (std::string const&, T const& element)
+              {
+                resource_memory const memory (element.memory_usage());
+                ++result.referenced;
+                result.referenced_memory.cpu += memory.cpu;
+                result.referenced_memory.gpu += memory.gpu;
+              }
+            );
+      result.unused = _unused.size();
+      result.unused_bytes = _unused_bytes;
+      result.hits = _hits;
+      result.misses = _misses;
+      result.evictions = _evictions;
+      return result;
+    }
+
+    std::string const& path (id_type id) const
+    {
+      return *_slots[id].path;
+    }
+
+    //! calls \a fun for the referenced resources only
+    void apply (std::function<void (std::string const&, T&)> fun)
+    {
+      for (slot& element : _slots)
+      {
+        if (element.references)
+        {
+          fun (*element.path, *element.element);
+        }
+      }
+    }
+    void apply (std::function<void (std::string const&, T const&)> fun) const
+    {
+      for (slot const& element : _slots)
+      {
+        if (element.references)
+        {
+          fun (*element.path, *element.element);
+        }
+      }
+    }
+
+  private:
+    void evict_least_recently_used()
+    {
+      slot& element (_slots[_unused.front()]);
+      _unused.pop_front();
+      _unused_bytes -= element.unused_bytes;
+      element.element.reset();
+      ++_evictions;
+    }
+
+    struct slot
+    {
+      slot (std::string const* path_)
+        : path (path_)
+      {}
+
+      //! key in _ids, whose nodes never move
+      std::string const* path;
+      std::size_t references = 0;
+      std::unique_ptr<T> element;
+      //! only set while unused
+      typename std::list<id_type>::iterator unused_position;
+      std::size_t unused_bytes = 0;
+    };
+
+    std::unordered_map<std::string, id_type> _ids_by_spelling;
+    std::unordered_map<std::string, id_type> _ids;
+    std::vector<slot> _slots;
+    std::function<std::string (std::string)> _normalize;
+
+    //! least recently used first
+    std::list<id_type> _unused;
+    std::size_t _unused_bytes = 0;
+    std::function<std::size_t()> _unused_budget;
+
+    std::size_t _hits = 0;
+    std::size_t _misses = 0;
+    std::size_t _evictions = 0;
+  };
+}
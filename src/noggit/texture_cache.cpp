@@ -0,0 +1,711 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/MPQ.h>
+#include <noggit/Misc.h>
+#include <noggit/Settings.h>
+#include <noggit/texture_cache.hpp>
+
+#include <boost/thread.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace noggit
+{
+  namespace
+  {
+    //! \todo Cross-platform syntax for packed structs.
+#pragma pack(push,1)
+    struct BLPHeader
+    {
+      int32_t magix;
+      int32_t version;
+      uint8_t attr_0_compression;
+      uint8_t attr_1_alphadepth;
+      uint8_t attr_2_alphatype;
+      uint8_t attr_3_mipmaplevels;
+      int32_t resx;
+      int32_t resy;
+      int32_t offsets[16];
+      int32_t sizes[16];
+    };
+#pragma pack(pop)
+
+    //! entries are only ever read by the machine that wrote them, so the
+    //! header is stored in native byte order
+    struct cache_header
+    {
+      std::uint32_t magic;
+      std::uint32_t level_count;
+      //! MPQFile::content_stamp of the BLP
+      std::uint64_t source_stamp;
+      struct
+      {
+        std::int32_t width;
+        std::int32_t height;
+        std::uint32_t offset;
+        std::uint32_t size;
+      } levels[16];
+    };
+
+    std::uint32_t const cache_magic ('NTC2');
+
+    std::atomic<std::size_t> hits (0);
+    std::atomic<std::size_t> misses (0);
+    std::atomic<std::size_t> uncached (0);
+    std::atomic<std::size_t> failed_writes (0);
+    std::atomic<std::size_t> thumbnail_hits (0);
+    std::atomic<std::size_t> thumbnail_misses (0);
+
+    std::string cache_filename ( std::string const& directory
+                               , std::string const& filename
+                               , char const* extension
+                               )
+    {
+      std::string const normalized (mpq::normalized_filename (filename));
+
+      std::stringstream name;
+      name << directory << "/" << std::hex << std::setw (16) << std::setfill ('0')
+           << misc::fnv1a (normalized.data(), normalized.size()) << extension;
+      return name.str();
+    }
+
+    void compressed_levels ( BLPHeader const& header
+                           , char const* data
+                           , std::size_t size
+                           , GLenum& format
+                           , std::vector<blp_image::level>& levels
+                           )
+    {
+      //                         0 (0000) & 3 == 0                1 (0001) & 3 == 1                    7 (0111) & 3 == 3
+      const GLenum alphatypes[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+      const int blocksizes[] = { 8, 16, 0, 16 };
+
+      int const alphatype (header.attr_2_alphatype & 3);
+      int const blocksize (blocksizes[alphatype]);
+      format = alphatypes[alphatype];
+      if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.attr_1_alphadepth == 1)
+      {
+        format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+      }
+
+      if (!blocksize)
+      {
+        throw std::logic_error ("unimplemented BLP alpha type");
+      }
+
+      int width (header.resx);
+      int height (header.resy);
+
+      for (int i = 0; i < 16 && header.offsets[i] && header.sizes[i]; ++i)
+      {
+        width = std::max (1, width);
+        height = std::max (1, height);
+
+        std::size_t const level_size (((width + 3) / 4) * ((height + 3) / 4) * blocksize);
+        if (std::size_t (header.offsets[i]) + level_size > size)
+        {
+          break;
+        }
+
+        levels.push_back ({width, height, data + header.offsets[i], level_size});
+
+        width >>= 1;
+        height >>= 1;
+      }
+    }
+
+    //! expands the palette indices and alpha of every mip level to RGBA8
+    void decode_palettized ( BLPHeader const& header
+                           , char const* data
+                           , std::size_t size
+                           , std::vector<blp_image::level>& levels
+                           , std::vector<char>& pixels
+                           )
+    {
+      if (size < sizeof (BLPHeader) + 256 * 4)
+      {
+        throw std::runtime_error ("truncated BLP palette");
+      }
+
+      // swizzle the BGRA palette once instead of once per pixel
+      std::array<std::uint32_t, 256> palette;
+      std::memcpy (palette.data(), data + sizeof (BLPHeader), 256 * 4);
+      for (std::uint32_t& k : palette)
+      {
+        k = ((k & 0x00FF0000) >> 16) | ((k & 0x0000FF00)) | ((k & 0x000000FF) << 16);
+      }
+
+      int const alphabits (header.attr_1_alphadepth);
+
+      struct source
+      {
+        int width;
+        int height;
+        unsigned char const* indices;
+        std::size_t offset;
+      };
+      std::vector<source> sources;
+      std::size_t total (0);
+
+      int width (header.resx);
+      int height (header.resy);
+
+      for (int i = 0; i < 16 && header.offsets[i] && header.sizes[i]; ++i)
+      {
+        width = std::max (1, width);
+        height = std::max (1, height);
+
+        std::size_t const count (std::size_t (width) * height);
+        if (std::size_t (header.offsets[i]) + count + (count * alphabits + 7) / 8 > size)
+        {
+          break;
+        }
+
+        sources.push_back ( { width, height
+                            , reinterpret_cast<unsigned char const*> (data + header.offsets[i])
+                            , total
+                            }
+                          );
+        total += count * 4;
+
+        width >>= 1;
+        height >>= 1;
+      }
+
+      pixels.resize (total);
+
+      for (source const& level : sources)
+      {
+        std::size_t const count (std::size_t (level.width) * level.height);
+        unsigned char const* alpha (level.indices + count);
+        std::uint32_t* out (reinterpret_cast<std::uint32_t*> (pixels.data() + level.offset));
+
+        for (std::size_t i (0); i < count; ++i)
+        {
+          std::uint32_t a (0xFF);
+          if (alphabits == 8)
+          {
+            a = alpha[i];
+          }
+          else if (alphabits == 1)
+          {
+            a = (alpha[i >> 3] & (1 << (i & 7))) ? 0xFF : 0;
+          }
+
+          out[i] = palette[level.indices[i]] | (a << 24);
+        }
+
+        levels.push_back ({level.width, level.height, pixels.data() + level.offset, count * 4});
+      }
+    }
+
+    std::uint32_t rgb565_to_rgba (std::uint16_t color)
+    {
+      std::uint32_t const r ((color >> 11) & 0x1f);
+      std::uint32_t const g ((color >> 5) & 0x3f);
+      std::uint32_t const b (color & 0x1f);
+      return ((r << 3) | (r >> 2))
+           | (((g << 2) | (g >> 4)) << 8)
+           | (((b << 3) | (b >> 2)) << 16)
+           | 0xff000000u;
+    }
+
+    //! per channel (a * weight_a + b * weight_b) / divisor
+    std::uint32_t mix_rgba ( std::uint32_t a, std::uint32_t b
+                           , std::uint32_t weight_a, std::uint32_t weight_b
+                           , std::uint32_t divisor
+                           )
+    {
+      std::uint32_t result (0);
+      for (int shift (0); shift < 32; shift += 8)
+      {
+        std::uint32_t const channel
+          ((((a >> shift) & 0xff) * weight_a + ((b >> shift) & 0xff) * weight_b) / divisor);
+        result |= channel << shift;
+      }
+      return result;
+    }
+
+    //! expands one S3TC mip level to RGBA8, the same layout as palettized
+    //! levels are decoded to
+    std::vector<char> decode_s3tc (GLenum format, blp_image::level const& level)
+    {
+      bool const dxt1 ( format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                     || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+                      );
+      std::size_t const block_size (dxt1 ? 8 : 16);
+      int const blocks_x ((level.width + 3) / 4);
+      int const blocks_y ((level.height + 3) / 4);
+
+      std::vector<char> pixels (std::size_t (level.width) * level.height * 4);
+      std::uint32_t* out (reinterpret_cast<std::uint32_t*> (pixels.data()));
+      unsigned char const* block (reinterpret_cast<unsigned char const*> (level.data));
+
+      for (int block_y (0); block_y < blocks_y; ++block_y)
+      {
+        for (int block_x (0); block_x < blocks_x; ++block_x, block += block_size)
+        {
+          std::array<std::uint32_t, 16> alpha;
+          alpha.fill (0xff);
+
+          if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)
+          {
+            for (int i (0); i < 16; ++i)
+            {
+              alpha[i] = ((block[i / 2] >> ((i & 1) * 4)) & 0xf) * 17;
+            }
+          }
+          else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+          {
+            std::array<std::uint32_t, 8> values;
+            values[0] = block[0];
+            values[1] = block[1];
+            if (values[0] > values[1])
+            {
+              for (std::uint32_t i (2); i < 8; ++i)
+              {
+                values[i] = ((8 - i) * values[0] + (i - 1) * values[1]) / 7;
+              }
+            }
+            else
+            {
+              for (std::uint32_t i (2); i < 6; ++i)
+              {
+                values[i] = ((6 - i) * values[0] + (i - 1) * values[1]) / 5;
+              }
+              values[6] = 0;
+              values[7] = 0xff;
+            }
+
+            std::uint64_t indices (0);
+            for (int i (0); i < 6; ++i)
+            {
+              indices |= std::uint64_t (block[2 + i]) << (8 * i);
+            }
+            for (int i (0); i < 16; ++i)
+            {
+              alpha[i] = values[(indices >> (3 * i)) & 7];
+            }
+          }
+
+          unsigned char const* color_block (dxt1 ? block : block + 8);
+          std::uint16_t const color_0 (color_block[0] | (color_block[1] << 8));
+          std::uint16_t const color_1 (color_block[2] | (color_block[3] << 8));
+
+          std::array<std::uint32_t, 4> colors;
+          colors[0] = rgb565_to_rgba (color_0);
+          colors[1] = rgb565_to_rgba (color_1);
+          // only DXT1 has the three color mode with transparent black
+          if (!dxt1 || color_0 > color_1)
+          {
+            colors[2] = mix_rgba (colors[0], colors[1], 2, 1, 3);
+            colors[3] = mix_rgba (colors[0], colors[1], 1, 2, 3);
+          }
+          else
+          {
+            colors[2] = mix_rgba (colors[0], colors[1], 1, 1, 2);
+            colors[3] = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 0 : 0xff000000u;
+          }
+
+          std::uint32_t const color_indices ( color_block[4]
+                                            | (color_block[5] << 8)
+                                            | (color_block[6] << 16)
+                                            | (std::uint32_t (color_block[7]) << 24)
+                                            );
+
+          for (int i (0); i < 16; ++i)
+          {
+            int const x (block_x * 4 + i % 4);
+            int const y (block_y * 4 + i / 4);
+            if (x >= level.width || y >= level.height)
+            {
+              continue;
+            }
+
+            std::uint32_t const color (colors[(color_indices >> (2 * i)) & 3]);
+            out[std::size_t (y) * level.width + x] = dxt1 ? color : (color & 0x00ffffff) | (alpha[i] << 24);
+          }
+        }
+      }
+
+      return pixels;
+    }
+
+    bool map_cached ( std::string const& path
+                    , std::uint64_t source_stamp
+                    , std::unique_ptr<QFile>& mapping
+                    , std::vector<blp_image::level>& levels
+                    )
+    {
+      std::unique_ptr<QFile> file (new QFile (QString::fromStdString (path)));
+      if (!file->open (QFile::ReadOnly) || std::size_t (file->size()) < sizeof (cache_header))
+      {
+        return false;
+      }
+
+      std::size_t const size (file->size());
+      char const* data (reinterpret_cast<char const*> (file->map (0, size)));
+      if (!data)
+      {
+        return false;
+      }
+
+      cache_header header;
+      std::memcpy (&header, data, sizeof (cache_header));
+
+      if ( header.magic != cache_magic
+        || header.source_stamp != source_stamp
+        || header.level_count == 0
+        || header.level_count > 16
+         )
+      {
+        return false;
+      }
+
+      for (std::uint32_t i (0); i < header.level_count; ++i)
+      {
+        auto const& level (header.levels[i]);
+        if ( level.width <= 0 || level.height <= 0
+          || level.size != std::size_t (level.width) * level.height * 4
+          || std::size_t (level.offset) + level.size > size
+           )
+        {
+          levels.clear();
+          return false;
+        }
+
+        levels.push_back ({level.width, level.height, data + level.offset, level.size});
+      }
+
+      mapping = std::move (file);
+      return true;
+    }
+
+    bool write_cached ( std::string const& directory
+                      , std::string const& path
+                      , std::uint64_t source_stamp
+                      , std::vector<blp_image::level> const& levels
+                      , std::vector<char> const& pixels
+                      )
+    {
+      if (!QDir().mkpath (QString::fromStdString (directory)))
+      {
+        return false;
+      }
+
+      cache_header header;
+      std::memset (&header, 0, sizeof (cache_header));
+      header.magic = cache_magic;
+      header.level_count = levels.size();
+      header.source_stamp = source_stamp;
+
+      for (std::size_t i (0); i < levels.size(); ++i)
+      {
+        header.levels[i].width = levels[i].width;
+        header.levels[i].height = levels[i].height;
+        header.levels[i].offset = sizeof (cache_header) + (levels[i].data - pixels.data());
+        header.levels[i].size = levels[i].size;
+      }
+
+      // written to a temporary file and renamed, so concurrent readers never
+      // see a partial entry
+      QSaveFile file (QString::fromStdString (path));
+      return file.open (QFile::WriteOnly)
+          && file.write (reinterpret_cast<char const*> (&header), sizeof (cache_header)) == sizeof (cache_header)
+          && file.write (pixels.data(), pixels.size()) == qint64 (pixels.size())
+          && file.commit();
+    }
+
+    //! a few threads reading and decoding textures in request order
+    template<typename T>
+      class decode_queue
+    {
+    public:
+      decode_queue()
+      {
+        unsigned const count (std::max (1u, std::min (4u, boost::thread::hardware_concurrency())));
+        for (unsigned i (0); i < count; ++i)
+        {
+          _threads.create_thread ([this] { work(); });
+        }
+      }
+
+      ~decode_queue()
+      {
+        {
+          boost::mutex::scoped_lock const lock (_mutex);
+          _stop = true;
+        }
+        _condition.notify_all();
+        _threads.join_all();
+      }
+
+      std::future<T> push (std::function<T()> job)
+      {
+        std::packaged_task<T()> task (std::move (job));
+        std::future<T> result (task.get_future());
+
+        {
+          boost::mutex::scoped_lock const lock (_mutex);
+          _tasks.emplace_back (std::move (task));
+        }
+        _condition.notify_one();
+
+        return result;
+      }
+
+    private:
+      void work()
+      {
+        for (;;)
+        {
+          std::packaged_task<T()> task;
+
+          {
+            boost::mutex::scoped_lock lock (_mutex);
+            while (!_stop && _tasks.empty())
+            {
+              _condition.wait (lock);
+            }
+
+            if (_stop)
+            {
+              return;
+            }
+
+            task = std::move (_tasks.front());
+            _tasks.pop_front();
+          }
+
+          task();
+        }
+      }
+
+      boost::mutex _mutex;
+      boost::condition_variable _condition;
+      std::deque<std::packaged_task<T()>> _tasks;
+      bool _stop = false;
+      boost::thread_group _threads;
+    };
+  }
+
+  blp_image::blp_image()
+    : _width (0)
+    , _height (0)
+    , _compressed (false)
+    , _format (GL_RGBA8)
+  {}
+  blp_image::blp_image (blp_image&&) = default;
+  blp_image& blp_image::operator= (blp_image&&) = default;
+  blp_image::~blp_image() = default;
+
+  std::future<blp_image> texture_cache::load_async (std::string const& filename)
+  {
+    static decode_queue<blp_image> queue;
+
+    // settings are not thread safe, so the directory is taken here
+    std::string const directory (Settings::getInstance()->textureCachePath);
+
+    return queue.push ([filename, directory] { return load (filename, directory); });
+  }
+
+  blp_image texture_cache::load (std::string const& filename, std::string const& directory)
+  {
+    boost::optional<std::uint64_t> const source_stamp (MPQFile::content_stamp (filename));
+    if (!source_stamp)
+    {
+      throw std::runtime_error ("file not found: '" + filename + "'");
+    }
+
+    blp_image image;
+    std::string const path (directory.empty() ? "" : cache_filename (directory, filename, ".rgba"));
+
+    // a hit never touches the BLP
+    if (!path.empty() && map_cached (path, *source_stamp, image._mapping, image._levels))
+    {
+      ++hits;
+      image._width = image._levels.front().width;
+      image._height = image._levels.front().height;
+      return image;
+    }
+
+    std::unique_ptr<MPQFile> file (std::make_unique<MPQFile> (filename));
+    if (file->isEof() || file->getSize() < sizeof (BLPHeader))
+    {
+      throw std::runtime_error ("file not found: '" + filename + "'");
+    }
+
+    char const* data (file->getBuffer());
+    std::size_t const size (file->getSize());
+
+    BLPHeader header;
+    std::memcpy (&header, data, sizeof (BLPHeader));
+
+    image._width = header.resx;
+    image._height = header.resy;
+
+    if (header.attr_0_compression == 2)
+    {
+      ++uncached;
+
+      image._compressed = true;
+      compressed_levels (header, data, size, image._format, image._levels);
+      image._file = std::move (file);
+      return image;
+    }
+    else if (header.attr_0_compression != 1)
+    {
+      throw std::logic_error ("unimplemented BLP colorEncoding");
+    }
+
+    ++misses;
+
+    decode_palettized (header, data, size, image._levels, image._pixels);
+
+    if (!path.empty() && !write_cached (directory, path, *source_stamp, image._levels, image._pixels))
+    {
+      ++failed_writes;
+    }
+
+    return image;
+  }
+
+  std::future<QImage> texture_cache::load_thumbnail_async (std::string const& filename, int size)
+  {
+    static decode_queue<QImage> queue;
+
+    std::string const cache (Settings::getInstance()->textureCachePath);
+    std::string const directory (cache.empty() ? cache : cache + "/thumbnails");
+
+    return queue.push ([filename, directory, size] { return load_thumbnail (filename, directory, size); });
+  }
+
+  QImage texture_cache::load_thumbnail (std::string const& filename, std::string const& directory, int size)
+  {
+    boost::optional<std::uint64_t> const stamp (MPQFile::content_stamp (filename));
+    if (!stamp)
+    {
+      throw std::runtime_error ("file not found: '" + filename + "'");
+    }
+
+    QString const source_stamp (QString::number (*stamp));
+    QString const path ( directory.empty() ? QString()
+                       : QString::fromStdString (cache_filename (directory, filename, ".png"))
+                       );
+
+    if (!path.isEmpty())
+    {
+      QImage const cached (path);
+      if ( !cached.isNull() && cached.width() == size && cached.height() == size
+        && cached.text ("source_stamp") == source_stamp
+         )
+      {
+        ++thumbnail_hits;
+        return cached;
+      }
+    }
+
+    ++thumbnail_misses;
+
+    MPQFile file (filename);
+    if (file.isEof() || file.getSize() < sizeof (BLPHeader))
+    {
+      throw std::runtime_error ("file not found: '" + filename + "'");
+    }
+
+    char const* data (file.getBuffer());
+    std::size_t const data_size (file.getSize());
+
+    BLPHeader header;
+    std::memcpy (&header, data, sizeof (BLPHeader));
+
+    GLenum format (GL_RGBA8);
+    std::vector<blp_image::level> levels;
+    std::vector<char> pixels;
+
+    if (header.attr_0_compression == 2)
+    {
+      compressed_levels (header, data, data_size, format, levels);
+    }
+    else if (header.attr_0_compression == 1)
+    {
+      decode_palettized (header, data, data_size, levels, pixels);
+    }
+    else
+    {
+      throw std::logic_error ("unimplemented BLP colorEncoding");
+    }
+
+    if (levels.empty())
+    {
+      throw std::runtime_error ("no mip levels in '" + filename + "'");
+    }
+
+    auto const distance
+      ( [size] (blp_image::level const& level)
+        {
+          return std::abs (std::max (level.width, level.height) - size);
+        }
+      );
+    blp_image::level level
+      ( *std::min_element ( levels.begin(), levels.end()
+                          , [&] (blp_image::level const& lhs, blp_image::level const& rhs)
+                            {
+                              return distance (lhs) < distance (rhs);
+                            }
+                          )
+      );
+
+    std::vector<char> level_pixels;
+    if (format != GL_RGBA8)
+    {
+      level_pixels = decode_s3tc (format, level);
+      level.data = level_pixels.data();
+    }
+
+    // copied first as scaled() to the same size would share the buffer
+    // which is about to go away
+    QImage thumbnail
+      ( QImage ( reinterpret_cast<uchar const*> (level.data)
+               , level.width, level.height, QImage::Format_RGBA8888
+               ).copy().scaled (size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+      );
+    thumbnail.setText ("source_stamp", source_stamp);
+
+    if (!path.isEmpty())
+    {
+      QSaveFile cache_file (path);
+      if ( !QDir().mkpath (QString::fromStdString (directory))
+        || !cache_file.open (QFile::WriteOnly)
+        || !thumbnail.save (&cache_file, "PNG")
+        || !cache_file.commit()
+         )
+      {
+        ++failed_writes;
+      }
+    }
+
+    return thumbnail;
+  }
+
+  texture_cache::statistics texture_cache::current_statistics()
+  {
+    return {hits, misses, uncached, failed_writes, thumbnail_hits, thumbnail_misses};
+  }
+}
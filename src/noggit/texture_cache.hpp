@@ -0,0 +1,91 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <opengl/types.hpp>
+
+#include <QtGui/QImage>
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MPQFile;
+class QFile;
+
+namespace noggit
+{
+  //! Mip chain of a BLP in the form it is handed to OpenGL: S3TC blocks
+  //! straight from the archive, or RGBA8 pixels either mapped from the
+  //! texture cache or freshly decoded from the palette.
+  class blp_image
+  {
+  public:
+    struct level
+    {
+      int width;
+      int height;
+      char const* data;
+      std::size_t size;
+    };
+
+    blp_image();
+    blp_image (blp_image&&);
+    blp_image& operator= (blp_image&&);
+    ~blp_image();
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    bool compressed() const { return _compressed; }
+    //! internal format, GL_RGBA8 or one of the S3TC formats
+    GLenum format() const { return _format; }
+    std::vector<level> const& levels() const { return _levels; }
+
+  private:
+    friend class texture_cache;
+
+    int _width;
+    int _height;
+    bool _compressed;
+    GLenum _format;
+    std::vector<level> _levels;
+
+    // the levels point into exactly one of these
+    std::unique_ptr<MPQFile> _file;
+    std::unique_ptr<QFile> _mapping;
+    std::vector<char> _pixels;
+  };
+
+  //! On-disk cache of decoded palettized BLPs. Entries are named after the
+  //! archive path and tagged with MPQFile::content_stamp of the BLP, so a
+  //! hit doesn't read the BLP while patched files are decoded again. S3TC
+  //! textures are uploaded from the archive as they are and never cached.
+  class texture_cache
+  {
+  public:
+    struct statistics
+    {
+      std::size_t hits;
+      std::size_t misses;
+      //! S3TC textures, which bypass the cache
+      std::size_t uncached;
+      std::size_t failed_writes;
+      std::size_t thumbnail_hits;
+      std::size_t thumbnail_misses;
+    };
+
+    //! reads, decodes and caches \a filename on a worker thread
+    static std::future<blp_image> load_async (std::string const& filename);
+    static blp_image load (std::string const& filename, std::string const& directory);
+
+    //! \a size × \a size icon of \a filename scaled from the mip level
+    //! closest to it, S3TC included, so no GL context is needed. Cached as
+    //! PNG tagged with the content stamp in a subdirectory of the cache.
+    static std::future<QImage> load_thumbnail_async (std::string const& filename, int size);
+    static QImage load_thumbnail (std::string const& filename, std::string const& directory, int size);
+
+    static statistics current_statistics();
+  };
+}
@@ -604,151 +604,87 @@ std::vector<std::vector<char>> TextureSet::get_compressed_alphamaps()
     alphas_to_big_alpha(alpha);
     for (int i = 0; i < nTextures - 1; ++i)
     {
-      compressed.emplace_back(get_compressed_alpha(i, alpha));
+      compressed.emplace_back(noggit::compress_alphamap(alpha + 4096 * i));
     }
   }
 
   return compressed;
 }
 
-std::vector<char> TextureSet::get_compressed_alpha(std::size_t id, unsigned char* alphas)
+scoped_blp_texture_reference TextureSet::texture(size_t id)
 {
-  struct entry
-  {
-    enum mode_t
-    {
-      copy = 0,              // append value[0..count - 1]
-      fill = 1,              // append value[0] count times
-    };    
-    uint8_t count : 7;
-    uint8_t mode : 1;
-    
-    uint8_t value[];
-  };
-
-  const unsigned char* alpha = alphas + 4096*id;
-  std::vector<char> data(alpha, alpha+4096);
-  auto current (data.begin());
-  auto const end (data.end());
-  int column_pos = 0;
-
-  auto const consume_fill
-  ( 
-    [&]
-    {
-      int8_t count (0);
-      column_pos %= 64;
-      
-      while ((current + 1 < end) && *current == *(current + 1) && column_pos < 63)
-      {
-        ++current;
-        ++count;
-        ++column_pos;
-      }
+  return textures[id];
+}
 
-      // include current (current is incremented in the for loop)
-      if (count)
-      {
-        ++count;
-        ++column_pos;
-      }
+void TextureSet::write_edit_state (std::vector<std::uint8_t>& state)
+{
+  noggit::undo::write (state, static_cast<std::uint32_t> (nTextures));
 
-      return count;
-    }
-  );
+  for (size_t i = 0; i < nTextures; ++i)
+  {
+    std::string const& name (textures[i]->filename());
+    noggit::undo::write (state, texFlags[i]);
+    noggit::undo::write (state, effectID[i]);
+    noggit::undo::write (state, static_cast<std::uint32_t> (name.size()));
+    noggit::undo::write (state, name.data(), name.size());
+  }
 
-  std::vector<char> result;
-  boost::optional<std::size_t> current_copy_entry_offset (boost::none);
-  auto const current_copy_entry
-  ( 
-    [&]
-    {
-      return reinterpret_cast<entry*> (&*(result.begin() + *current_copy_entry_offset));
-    }
-  );
+  for (size_t i = 1; i < nTextures; ++i)
+  {
+    noggit::undo::write (state, alphamaps[i - 1]->getAlpha(), 64 * 64);
+  }
+}
+
+void TextureSet::read_edit_state (noggit::undo::reader& state)
+{
+  std::uint32_t count;
+  state.read (count);
 
-  for (; current != end; ++current)
+  std::vector<scoped_blp_texture_reference> restored;
+  for (size_t i = 0; i < count; ++i)
   {
-    auto const fill (consume_fill());
-    if (fill)
-    {
-      current_copy_entry_offset = boost::none;
+    std::uint32_t name_size;
+    state.read (texFlags[i]);
+    state.read (effectID[i]);
+    state.read (name_size);
 
-      result.emplace_back();
-      result.emplace_back(*current);
+    std::string name (name_size, '\0');
+    state.read (&name[0], name_size);
+    restored.emplace_back (name);
+  }
 
-      entry* e (reinterpret_cast<entry*> (&*(result.rbegin() + 1)));
-      e->mode = entry::fill;
-      e->count = fill;
+  textures = std::move (restored);
+  nTextures = count;
 
-      column_pos %= 64;
-    }
-    else
+  unsigned char amap[64 * 64];
+  for (size_t i = 1; i < 4; ++i)
+  {
+    if (i >= nTextures)
     {
-      if ( current_copy_entry_offset == boost::none
-        || column_pos == 64
-         )
-      {
-        current_copy_entry_offset = result.size();
-        result.emplace_back();
-        result.emplace_back(*current);
-        current_copy_entry()->mode = entry::copy;
-        current_copy_entry()->count = 1;
-        
-        column_pos %= 64;
-      }
-      else
-      {
-        result.emplace_back(*current);
-        current_copy_entry()->count++;
-      }
+      alphamaps[i - 1] = boost::none;
+      continue;
+    }
 
-      column_pos++;
+    state.read (amap, sizeof (amap));
+    if (!alphamaps[i - 1])
+    {
+      alphamaps[i - 1] = boost::in_place();
     }
+    alphamaps[i - 1]->setAlpha (amap);
+    alphamaps[i - 1]->loadTexture();
   }
-
-  return result;
-}
-
-scoped_blp_texture_reference TextureSet::texture(size_t id)
-{
-  return textures[id];
 }
 
 // dest = tab [4096 * (nTextures - 1)]
 // call only if nTextures > 1
 void TextureSet::alphas_to_big_alpha(unsigned char* dest)
 {
-  auto alpha 
-  ( 
-    [&] (int layer, int pos = 0)
-    {
-      return dest + layer * 4096 + pos;
-    }
-  );
-
   for (size_t k = 0; k < nTextures - 1; k++)
   {
-    memcpy(alpha(k), alphamaps[k]->getAlpha(), 64 * 64);
+    memcpy(dest + 4096 * k, alphamaps[k]->getAlpha(), 64 * 64);
   }
 
-  float alphas[3] = { 0.0f, 0.0f, 0.0f };
-
-  for (int i = 0; i < 64 * 64; ++i)
-  {
-    for (size_t k = 0; k < nTextures - 1; k++)
-    {
-      float f = static_cast<float>(*alpha(k, i));
-      alphas[k] = f;
-      for (size_t n = 0; n < k; n++)
-        alphas[n] = (alphas[n] * ((255.0f - f)) / 255.0f);
-    }
-
-    for (size_t k = 0; k < nTextures - 1; k++)
-    {
-      *alpha(k, i) = static_cast<unsigned char>(std::min(std::max(std::round(alphas[k]), 0.0f), 255.0f));
-    }
-  }
+  noggit::old_to_big_alpha(dest, nTextures - 1);
 }
 
 void TextureSet::convertToBigAlpha()
@@ -774,46 +710,18 @@ void TextureSet::convertToOldAlpha()
   if (nTextures < 2)
     return;
 
-  unsigned char tab[3][64 * 64];
+  unsigned char tab[3 * 64 * 64];
 
   for (size_t k = 0; k < nTextures - 1; k++)
   {
-    memcpy(tab[k], alphamaps[k]->getAlpha(), 64 * 64);
+    memcpy(tab + 4096 * k, alphamaps[k]->getAlpha(), 64 * 64);
   }
 
-  float alphas[3] = { 0.0f, 0.0f, 0.0f };
-
-  for (int i = 0; i < 64 * 64; ++i)
-  {
-    for (size_t k = 0; k < nTextures - 1; k++)
-    {
-      alphas[k] = static_cast<float>(tab[k][i]);
-    }
-
-    for (int k = nTextures - 2; k >= 0; k--)
-    {
-      for (int n = nTextures - 2; n > k; n--)
-      {
-        // prevent 0 division
-        if (alphas[n] == 255.0f)
-        {
-          alphas[k] = 0.0f;
-          break;
-        }
-        else
-          alphas[k] = (alphas[k] / (255.0f - alphas[n])) * 255.0f;
-      }
-    }
-
-    for (size_t k = 0; k < nTextures - 1; k++)
-    {
-      tab[k][i] = static_cast<unsigned char>(std::min(std::max(std::round(alphas[k]), 0.0f), 255.0f));
-    }
-  }
+  noggit::big_to_old_alpha(tab, nTextures - 1);
 
   for (size_t k = 0; k < nTextures - 1; k++)
   {
-    alphamaps[k]->setAlpha(tab[k]);
+    alphamaps[k]->setAlpha(tab + 4096 * k);
     alphamaps[k]->loadTexture();
   }
 }
@@ -4,9 +4,11 @@
 
 #include <noggit/MPQ.h>
 #include <noggit/alphamap.hpp>
+#include <noggit/undo_stack.hpp>
 
 #include <cstdint>
 #include <array>
+#include <vector>
 
 class Brush;
 class MapTile;
@@ -57,9 +59,12 @@ public:
 
   scoped_blp_texture_reference texture(size_t id);
 
+  //! layers, their flags and alphamaps for the undo history
+  void write_edit_state (std::vector<std::uint8_t>& state);
+  void read_edit_state (noggit::undo::reader& state);
+
 private:
   void alphas_to_big_alpha(unsigned char* dest);
-  std::vector<char> get_compressed_alpha(std::size_t id, unsigned char* alphas);
 
   std::vector<scoped_blp_texture_reference> textures;
   std::array<boost::optional<Alphamap>, 3> alphamaps;
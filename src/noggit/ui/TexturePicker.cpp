@@ -124,7 +124,7 @@ namespace noggit
     {
       if (set_changed)
       {
-        _chunk->mt->changed = true;
+        _chunk->mt->changed |= tile_textures;
       }
 
       _textures.clear();
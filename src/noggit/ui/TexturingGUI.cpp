@@ -3,6 +3,9 @@
 #include <noggit/ui/TexturingGUI.h>
 
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
 #include <list>
 #include <map>
 #include <sstream>
@@ -10,14 +13,18 @@
 #include <vector>
 
 #include <noggit/DBC.h>
+#include <noggit/Log.h>
 #include <noggit/Misc.h>
 #include <noggit/MPQ.h>
 #include <noggit/Project.h>
 #include <noggit/TextureManager.h> // TextureManager, Texture
+#include <noggit/texture_cache.hpp>
 
 #include <unordered_set>
 
 #include <QtCore/QSortFilterProxyModel>
+#include <QtCore/QStringList>
+#include <QtGui/QPixmap>
 #include <QtGui/QStandardItemModel>
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QListView>
@@ -32,125 +39,249 @@ namespace noggit
 {
   namespace ui
   {
+    namespace
+    {
+      constexpr int const has_specular_role = Qt::UserRole;
+      constexpr int const id_role = Qt::UserRole + 1;
+    }
+
+    class tileset_filter : public QSortFilterProxyModel
+    {
+    public:
+      using QSortFilterProxyModel::QSortFilterProxyModel;
+
+      void show_only (std::vector<path_index::id_type> const& ids)
+      {
+        _visible.assign (mpq::listfile_index().size(), false);
+        for (path_index::id_type id : ids)
+        {
+          _visible[id] = true;
+        }
+        invalidateFilter();
+      }
+
+    protected:
+      virtual bool filterAcceptsRow (int row, QModelIndex const& parent) const override
+      {
+        auto const id (sourceModel()->index (row, 0, parent).data (id_role).toUInt());
+        return id < _visible.size() && _visible[id];
+      }
+
+    private:
+      std::vector<bool> _visible;
+    };
+
     struct model_item : QStandardItem
     {
-      model_item (QString const& display_role)
+      model_item ( QString const& display_role
+                 , std::function<void (QStandardItem*, std::string const&)> request_thumbnail
+                 )
         : QStandardItem (display_role)
+        , _request_thumbnail (std::move (request_thumbnail))
       {}
 
       virtual QVariant data (int role) const
       {
-        if (role == Qt::DecorationRole)
+        if (role == Qt::DecorationRole && !_requested)
         {
-          if (!_rendered)
-          {
-            //! \note The one time Qt is const correct and we don't want that.
-            auto that (const_cast<model_item*> (this));
-            that->_rendered = true;
-            that->_pixmap = render_blp_to_pixmap (data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString(), 256, 256);
-          }
-          return QIcon(_pixmap);
+          //! \note The one time Qt is const correct and we don't want that.
+          auto that (const_cast<model_item*> (this));
+          that->_requested = true;
+          _request_thumbnail (that, data (Qt::DisplayRole).toString().prepend ("tileset/").toStdString());
         }
 
         return QStandardItem::data (role);
       }
 
-      bool _rendered = false;
-      QPixmap _pixmap;
+      bool _requested = false;
+      std::function<void (QStandardItem*, std::string const&)> _request_thumbnail;
     };
 
-    tileset_chooser::tileset_chooser (QWidget* parent)
-      : widget (parent)
+    void tileset_chooser::request_thumbnail (QStandardItem* item, std::string const& filename)
     {
-      setWindowTitle ("Texture palette");
-      setWindowIcon (QIcon (":/icon"));
+      _pending_thumbnails.emplace_back
+        (item, texture_cache::load_thumbnail_async (filename, 256));
 
-      while (!MPQArchive::allFinishedLoading())
+      if (!_thumbnail_poll.isActive())
       {
-        MPQArchive::allFinishLoading();
+        _thumbnail_poll.start();
       }
+    }
+
+    void tileset_chooser::set_finished_thumbnails()
+    {
+      auto const finished
+        ( std::partition ( _pending_thumbnails.begin(), _pending_thumbnails.end()
+                         , [] (std::pair<QStandardItem*, std::future<QImage>> const& pending)
+                           {
+                             return pending.second.wait_for (std::chrono::seconds (0))
+                               != std::future_status::ready;
+                           }
+                         )
+        );
+
+      // taken out first: setting an icon may make the view ask for more
+      std::vector<std::pair<QStandardItem*, std::future<QImage>>> ready
+        ( std::make_move_iterator (finished)
+        , std::make_move_iterator (_pending_thumbnails.end())
+        );
+      _pending_thumbnails.erase (finished, _pending_thumbnails.end());
+
+      for (auto& thumbnail : ready)
+      {
+        try
+        {
+          thumbnail.first->setIcon (QIcon (QPixmap::fromImage (thumbnail.second.get())));
+        }
+        catch (std::exception const& e)
+        {
+          LogError << "thumbnail of " << thumbnail.first->text().toStdString() << ": " << e.what() << std::endl;
+        }
+      }
+
+      if (_pending_thumbnails.empty())
+      {
+        _thumbnail_poll.stop();
+      }
+    }
+
+    void tileset_chooser::scan_project_directory (std::string const& directory, bool add_items)
+    {
+      if (!boost::filesystem::is_directory (directory))
+      {
+        return;
+      }
+
+      _project_watcher.addPath (QString::fromStdString (directory));
 
-      std::vector<std::string> tilesets;
-      std::unordered_set<std::string> tilesets_with_specular_variant;
+      path_index& index (mpq::listfile_index());
+      bool added (false);
 
-      for (auto const& entry : gListfile)
+      for ( auto const& entry
+          : boost::make_iterator_range (boost::filesystem::directory_iterator (directory), {})
+          )
       {
-        if ( entry.find ("tileset") != std::string::npos
-          && entry.find (".blp") != std::string::npos
-           )
+        std::string const absolute (entry.path().string());
+        if (absolute.size() <= _project_path.size())
         {
-          auto suffix_pos (entry.find ("_s.blp"));
-          if (suffix_pos == std::string::npos)
-          {
-            tilesets.emplace_back (entry);
-          }
-          else
+          continue;
+        }
+
+        std::string const relative (mpq::normalized_filename (absolute.substr (_project_path.size())));
+
+        // only the tileset directory is descended into and watched
+        if (boost::filesystem::is_directory (entry.path()))
+        {
+          if ( ( relative == "tileset" || relative.compare (0, 8, "tileset/") == 0)
+            && !_project_watcher.directories().contains (QString::fromStdString (absolute))
+             )
           {
-            std::string specular (entry);
-            specular.erase (suffix_pos, strlen ("_s"));
-            tilesets_with_specular_variant.emplace (specular);
+            scan_project_directory (absolute, add_items);
           }
         }
+        else if (relative.compare (0, 8, "tileset/") == 0 && index.insert (relative) && add_items)
+        {
+          add_tileset (index.size() - 1);
+          added = true;
+        }
       }
 
+      if (added)
       {
-        auto const prefix
-          (boost::filesystem::path (Project::getInstance()->getPath()));
-        auto const prefix_size (prefix.string().length());
+        search (_query);
+      }
+    }
 
-        if (boost::filesystem::exists (prefix))
-        {
-          for ( auto const& entry_abs
-              : boost::make_iterator_range
-                  (boost::filesystem::recursive_directory_iterator (prefix), {})
-              )
-          {
-            auto entry ( mpq::normalized_filename
-                          (entry_abs.path().string().substr (prefix_size))
-                       );
+    void tileset_chooser::add_tileset (path_index::id_type id)
+    {
+      std::string const& path (mpq::listfile_index().path (id));
+      std::string const extension (".blp");
+      std::string const specular_suffix ("_s.blp");
 
-            if ( entry.find ("tileset") != std::string::npos
-              && entry.find (".blp") != std::string::npos
-               )
-            {
-              auto suffix_pos (entry.find ("_s.blp"));
-              if (suffix_pos == std::string::npos)
-              {
-                tilesets.emplace_back (entry);
-              }
-              else
-              {
-                std::string specular (entry);
-                specular.erase (suffix_pos, strlen ("_s"));
-                tilesets_with_specular_variant.emplace (specular);
-              }
-            }
-          }
+      if ( path.size() < extension.size()
+        || path.compare (path.size() - extension.size(), extension.size(), extension) != 0
+         )
+      {
+        return;
+      }
+
+      if ( path.size() > specular_suffix.size()
+        && path.compare (path.size() - specular_suffix.size(), specular_suffix.size(), specular_suffix) == 0
+         )
+      {
+        std::string const texture (path.substr (0, path.size() - specular_suffix.size()) + extension);
+        _with_specular_variant.emplace (texture);
+
+        auto const item (_items.find (texture));
+        if (item != _items.end())
+        {
+          item->second->setData ("true", has_specular_role);
         }
+        return;
       }
 
+      auto item ( new model_item
+                    ( QString::fromStdString (path).remove ("tileset/")
+                    , [this] (QStandardItem* item, std::string const& filename)
+                      {
+                        request_thumbnail (item, filename);
+                      }
+                    )
+                );
+      item->setData (_with_specular_variant.count (path) ? "true" : "false", has_specular_role);
+      item->setData (id, id_role);
+
+      _items.emplace (path, item);
+      _model->appendRow (item);
+      _search->add (id);
+    }
 
-      auto model (new QStandardItemModel);
-      constexpr int const has_specular_role = Qt::UserRole;
+    void tileset_chooser::search (std::string const& query)
+    {
+      _query = query;
+      _search_filter->show_only (_search->find (query));
+    }
+
+    tileset_chooser::tileset_chooser (QWidget* parent)
+      : widget (parent)
+    {
+      _thumbnail_poll.setInterval (50);
+      connect (&_thumbnail_poll, &QTimer::timeout, [this] { set_finished_thumbnails(); });
+
+      setWindowTitle ("Texture palette");
+      setWindowIcon (QIcon (":/icon"));
+
+      while (!MPQArchive::allFinishedLoading())
+      {
+        MPQArchive::allFinishLoading();
+      }
+
+      // owned by the chooser as the items call back into it
+      _model = new QStandardItemModel (this);
+      _search = std::make_unique<substring_search> (mpq::listfile_index(), std::vector<path_index::id_type>());
+
+      _project_path = Project::getInstance()->getPath();
+      scan_project_directory (_project_path, false);
+      connect ( &_project_watcher, &QFileSystemWatcher::directoryChanged
+              , [this] (QString const& directory)
+                {
+                  scan_project_directory (directory.toStdString(), true);
+                }
+              );
 
-      for (auto const& texture : tilesets)
+      for (path_index::id_type id : mpq::listfile_index().with_prefix ("tileset/"))
       {
-        auto item ( new model_item
-                      (QString::fromStdString (texture).remove ("tileset/"))
-                  );
-        item->setData ( tilesets_with_specular_variant.count (texture) ? "true" : "false"
-                      , has_specular_role
-                      );
-        model->appendRow (item);
+        add_tileset (id);
       }
 
-      auto specular_filter (new QSortFilterProxyModel);
-      specular_filter->setSourceModel (model);
+      auto specular_filter (new QSortFilterProxyModel (this));
+      specular_filter->setSourceModel (_model);
       specular_filter->setFilterRole (has_specular_role);
 
-      auto search_filter (new QSortFilterProxyModel);
-      search_filter->setSourceModel (specular_filter);
-      search_filter->sort (0, Qt::AscendingOrder);
+      _search_filter = new tileset_filter (this);
+      _search_filter->setSourceModel (specular_filter);
+      _search_filter->sort (0, Qt::AscendingOrder);
+      search (_query);
 
 
       auto filter (new QComboBox);
@@ -165,9 +296,9 @@ namespace noggit
                          }
                        );
       connect ( filter, &QComboBox::currentTextChanged
-              , [=] (QString text)
+              , [this] (QString text)
                 {
-                  search_filter->setFilterRegExp (text);
+                  search (mpq::normalized_filename (text.toStdString()));
                 }
               );
 
@@ -191,7 +322,7 @@ namespace noggit
       list->setUniformItemSizes (true);
       list->setIconSize ({128, 128});
       list->setWrapping (true);
-      list->setModel (search_filter);
+      list->setModel (_search_filter);
 
       connect ( list, &QAbstractItemView::doubleClicked
               , [=] (QModelIndex const& index)
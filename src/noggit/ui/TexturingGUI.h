@@ -3,15 +3,32 @@
 #pragma once
 
 #include <noggit/TextureManager.h>
+#include <noggit/path_index.hpp>
 #include <noggit/ui/widget.hpp>
 
 #include <boost/optional.hpp>
 
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QTimer>
+#include <QtGui/QImage>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class QStandardItem;
+class QStandardItemModel;
+
 namespace noggit
 {
   namespace ui
   {
     class current_texture;
+    class tileset_filter;
 
     struct tileset_chooser : public widget
     {
@@ -22,6 +39,31 @@ namespace noggit
 
     signals:
       void selected (std::string);
+
+    private:
+      //! loose files in the project's tileset directory are added to the
+      //! listfile index and watched for new ones
+      void scan_project_directory (std::string const& directory, bool add_items);
+      void add_tileset (path_index::id_type id);
+      void search (std::string const& query);
+
+      QStandardItemModel* _model;
+      tileset_filter* _search_filter;
+      std::unique_ptr<substring_search> _search;
+      std::string _query;
+      std::unordered_map<std::string, QStandardItem*> _items;
+      std::unordered_set<std::string> _with_specular_variant;
+
+      std::string _project_path;
+      QFileSystemWatcher _project_watcher;
+
+      //! icons are decoded on worker threads once an item is first shown
+      //! and set as they finish
+      void request_thumbnail (QStandardItem* item, std::string const& filename);
+      void set_finished_thumbnails();
+
+      std::vector<std::pair<QStandardItem*, std::future<QImage>>> _pending_thumbnails;
+      QTimer _thumbnail_poll;
     };
 
     class selected_texture
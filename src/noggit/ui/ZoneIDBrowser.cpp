@@ -40,14 +40,15 @@ namespace noggit
     {
       mapID = id;
 
-      for (DBCFile::Iterator i = gMapDB.begin(); i != gMapDB.end(); ++i)
+      try
       {
-        if (i->getInt(MapDB::MapID) == id)
-        {
-          std::stringstream ss;
-          ss << id << "-" << i->getString(MapDB::InternalName);
-          _area_tree->setHeaderLabel(ss.str().c_str());
-        }
+        std::stringstream ss;
+        ss << id << "-" << gMapDB.getByID(id).get<MapDB::InternalName>();
+        _area_tree->setHeaderLabel(ss.str().c_str());
+      }
+      catch (MapDB::NotFound)
+      {
+        LogError << "Map with ID " << id << " not found." << std::endl;
       }
 
       buildAreaList();
@@ -81,10 +82,10 @@ namespace noggit
       //  Read out Area List.
       for (DBCFile::Iterator i = gAreaDB.begin(); i != gAreaDB.end(); ++i)
       {
-        if (i->getInt(AreaDB::Continent) == mapID)
+        if (i->get<AreaDB::Continent>() == mapID)
         {
-          int area = i->getInt(AreaDB::AreaID);
-          int parent = i->getInt(AreaDB::Region);
+          int area = i->get<AreaDB::AreaID>();
+          int parent = i->get<AreaDB::Region>();
 
           std::stringstream ss;
           ss << area << "-" << gAreaDB.getAreaName(area);
@@ -82,9 +82,13 @@ namespace noggit
                                  , math::degrees camera_pitch
                                  , math::degrees camera_yaw
                                  , uid_fix_mode uid_fix
+                                 , std::function<void (uid_fix_progress const&)> uid_fix_progress
                                  )
     {
-      auto mapview (new MapView (camera_yaw, camera_pitch, pos, this, std::move (_world), uid_fix));
+      auto mapview ( new MapView ( camera_yaw, camera_pitch, pos, this, std::move (_world)
+                                 , uid_fix, std::move (uid_fix_progress)
+                                 )
+                   );
       setCentralWidget (mapview);
     }
 
@@ -94,18 +98,19 @@ namespace noggit
 
       _world.reset();
 
-      for (DBCFile::Iterator it = gMapDB.begin(); it != gMapDB.end(); ++it)
+      std::string name;
+      try
       {
-        if (it->getInt(MapDB::MapID) == mapID)
-        {
-          _world = std::make_unique<World> (it->getString(MapDB::InternalName), mapID);
-          _minimap->world (_world.get());
-
-          return;
-        }
+        name = gMapDB.getByID (mapID).get<MapDB::InternalName>();
+      }
+      catch (MapDB::NotFound)
+      {
+        LogError << "Map with ID " << mapID << " not found. Failed loading." << std::endl;
+        return;
       }
 
-      LogError << "Map with ID " << mapID << " not found. Failed loading." << std::endl;
+      _world = std::make_unique<World> (name, mapID);
+      _minimap->world (_world.get());
     }
 
     void main_window::build_menu()
@@ -136,10 +141,10 @@ namespace noggit
       for (DBCFile::Iterator i = gMapDB.begin(); i != gMapDB.end(); ++i)
       {
         MapEntry e;
-        e.mapID = i->getInt(MapDB::MapID);
-        e.name = i->getLocalizedString(MapDB::Name);
-        e.areaType = i->getUInt(MapDB::AreaType);
-        if (e.areaType == 3) e.name = i->getString(MapDB::InternalName);
+        e.mapID = i->get<MapDB::MapID>();
+        e.name = i->get<MapDB::Name>();
+        e.areaType = i->get<MapDB::AreaType>();
+        if (e.areaType == 3) e.name = i->get<MapDB::InternalName>();
 
         if (e.areaType < 0 || e.areaType > 4 || !World::IsEditableWorld(e.mapID))
           continue;
@@ -172,19 +177,22 @@ namespace noggit
 
                            _world.reset();
 
-                           for (DBCFile::Iterator it = gMapDB.begin(); it != gMapDB.end(); ++it)
+                           std::string name;
+                           try
+                           {
+                             name = gMapDB.getByID (entry.mapID).get<MapDB::InternalName>();
+                           }
+                           catch (MapDB::NotFound)
                            {
-                             if (it->getInt(MapDB::MapID) == entry.mapID)
-                             {
-                               _world = std::make_unique<World> (it->getString(MapDB::InternalName), entry.mapID);
-                               enterMapAt ( entry.pos
-                                          , math::degrees (entry.camera_pitch)
-                                          , math::degrees (entry.camera_yaw)
-                                          );
-
-                               return;
-                             }
+                             LogError << "Map with ID " << entry.mapID << " not found. Failed loading." << std::endl;
+                             return;
                            }
+
+                           _world = std::make_unique<World> (name, entry.mapID);
+                           enterMapAt ( entry.pos
+                                      , math::degrees (entry.camera_pitch)
+                                      , math::degrees (entry.camera_yaw)
+                                      );
                          }
                        );
 
@@ -218,13 +226,25 @@ namespace noggit
 
               connect ( uidFixWindow
                       , &noggit::ui::uid_fix_window::fix_uid
-                      , [this] ( math::vector_3d pos
-                               , math::degrees camera_pitch
-                               , math::degrees camera_yaw
-                               , uid_fix_mode uid_fix
-                               )
+                      , [this, uidFixWindow] ( math::vector_3d pos
+                                             , math::degrees camera_pitch
+                                             , math::degrees camera_yaw
+                                             , uid_fix_mode uid_fix
+                                             )
                         {
-                          enterMapAt(pos, camera_pitch, camera_yaw, uid_fix);
+                          if (uid_fix == uid_fix_mode::fix_all)
+                          {
+                            enterMapAt ( pos, camera_pitch, camera_yaw, uid_fix
+                                       , [uidFixWindow] (uid_fix_progress const& progress)
+                                         {
+                                           uidFixWindow->show_progress (progress);
+                                         }
+                                       );
+                          }
+                          else
+                          {
+                            enterMapAt(pos, camera_pitch, camera_yaw, uid_fix);
+                          }
                         }
                       );
             }
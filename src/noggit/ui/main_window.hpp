@@ -7,6 +7,7 @@
 
 #include <QtWidgets/QMainWindow>
 
+#include <functional>
 #include <string>
 
 namespace noggit
@@ -27,6 +28,7 @@ namespace noggit
                       , math::degrees camera_pitch
                       , math::degrees camera_yaw
                       , uid_fix_mode uid_fix = uid_fix_mode::none
+                      , std::function<void (uid_fix_progress const&)> uid_fix_progress = nullptr
                       );
 
       void createBookmarkList();
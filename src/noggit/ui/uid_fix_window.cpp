@@ -4,9 +4,12 @@
 
 #include <QtWidgets/QDialogButtonBox>
 #include <QtWidgets/QLabel>
+#include <QtWidgets/QProgressBar>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QVBoxLayout>
 
+#include <algorithm>
+
 namespace noggit
 {
   namespace ui
@@ -16,6 +19,9 @@ namespace noggit
                                    , math::degrees camera_yaw
                                    )
       : QDialog (nullptr)
+      , _buttons (new QDialogButtonBox (this))
+      , _status (new QLabel (this))
+      , _progress (new QProgressBar (this))
     {
       new QVBoxLayout (this);
 
@@ -37,16 +43,17 @@ namespace noggit
                      )
         );
 
-      auto buttons (new QDialogButtonBox (this));
-      auto fix_all (buttons->addButton ("Fix All", QDialogButtonBox::AcceptRole));
-      auto get_max (buttons->addButton ("Get Max UID", QDialogButtonBox::YesRole));
+      auto fix_all (_buttons->addButton ("Fix All", QDialogButtonBox::AcceptRole));
+      auto get_max (_buttons->addButton ("Get Max UID", QDialogButtonBox::YesRole));
 
+      // the window stays open to show the progress until the fix is done
       connect ( fix_all, &QPushButton::clicked
               , [=]
                 {
-                  hide();
+                  _buttons->hide();
+                  _status->show();
+                  _progress->show();
                   emit fix_uid(pos, camera_pitch, camera_yaw, uid_fix_mode::fix_all);
-                  deleteLater();
                 }
               );
 
@@ -59,7 +66,45 @@ namespace noggit
                 }
               );
 
-      layout()->addWidget (buttons);
+      layout()->addWidget (_buttons);
+      layout()->addWidget (_status);
+      layout()->addWidget (_progress);
+
+      _status->hide();
+      _progress->hide();
+    }
+
+    void uid_fix_window::show_progress (uid_fix_progress const& progress)
+    {
+      if (progress.current == uid_fix_progress::stage::finished)
+      {
+        hide();
+        deleteLater();
+        return;
+      }
+
+      QString const stage
+        ( progress.current == uid_fix_progress::stage::scan ? "Scanning tiles"
+        : progress.current == uid_fix_progress::stage::assign ? "Reading model bounds"
+        : "Rewriting tiles"
+        );
+      QString const unit
+        (progress.current == uid_fix_progress::stage::assign ? "models" : "tiles");
+
+      _status->setText
+        ( QString ("%1: %2 / %3 %4 (%5 %4/s)")
+          .arg (stage)
+          .arg (progress.done)
+          .arg (progress.total)
+          .arg (unit)
+          .arg (progress.seconds > 0.0f ? progress.done / progress.seconds : 0.0f, 0, 'f', 1)
+        );
+      _progress->setMaximum (std::max<std::size_t> (progress.total, 1));
+      _progress->setValue (progress.done);
+
+      // the fix blocks the event loop, so paint right away instead of
+      // processing events, which could re-enter the map view
+      repaint();
     }
   }
 }
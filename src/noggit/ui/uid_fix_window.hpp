@@ -4,11 +4,15 @@
 
 #include <math/vector_3d.hpp>
 #include <math/trig.hpp>
+#include <noggit/map_index.hpp>
 
 #include <QtWidgets/QDialog>
 
 #include <functional>
 
+class QDialogButtonBox;
+class QLabel;
+class QProgressBar;
 class World;
 
 enum class uid_fix_mode
@@ -29,12 +33,20 @@ namespace noggit
     public:
       uid_fix_window (math::vector_3d pos, math::degrees camera_pitch, math::degrees camera_yaw);
 
+      //! closes the window once the fix is finished
+      void show_progress (uid_fix_progress const&);
+
     signals:
       void fix_uid  ( math::vector_3d pos
                     , math::degrees camera_pitch
                     , math::degrees camera_yaw
                     , uid_fix_mode uid_fix
                     );
+
+    private:
+      QDialogButtonBox* _buttons;
+      QLabel* _status;
+      QProgressBar* _progress;
     };
   }
 }
@@ -3,6 +3,10 @@
 #include <noggit/uid_storage.hpp>
 
 #include <noggit/Log.h>
+#include <noggit/Settings.h>
+#ifdef USE_MYSQL_UID_STORAGE
+  #include <mysql/mysql.h>
+#endif
 
 #include <boost/filesystem.hpp>
 
@@ -86,3 +90,37 @@ void uid_storage::save()
 
   fs.close();
 }
+
+namespace noggit
+{
+  std::uint32_t load_max_uid (std::size_t map_id)
+  {
+#ifdef USE_MYSQL_UID_STORAGE
+    if (Settings::getInstance()->mysql)
+    {
+      return mysql::getGUIDFromDB (*Settings::getInstance()->mysql, map_id);
+    }
+#endif
+    return uid_storage::getInstance()->getMaxUID (map_id);
+  }
+
+  void store_max_uid (std::size_t map_id, std::uint32_t uid)
+  {
+#ifdef USE_MYSQL_UID_STORAGE
+    if (Settings::getInstance()->mysql)
+    {
+      auto const& connection (*Settings::getInstance()->mysql);
+      if (mysql::hasMaxUIDStoredDB (connection, map_id))
+      {
+        mysql::updateUIDinDB (connection, map_id, uid);
+      }
+      else
+      {
+        mysql::insertUIDinDB (connection, map_id, uid);
+      }
+      return;
+    }
+#endif
+    uid_storage::getInstance()->saveMaxUID (map_id, uid);
+  }
+}
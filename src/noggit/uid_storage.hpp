@@ -4,6 +4,9 @@
 
 #include <noggit/ConfigFile.h>
 
+#include <cstddef>
+#include <cstdint>
+
 class uid_storage
 {
 public:
@@ -23,3 +26,11 @@ private:
 	uid_storage();
 	static uid_storage* instance;
 };
+
+namespace noggit
+{
+  //! the highest uid given out on the map, from the MySQL database if one
+  //! is configured, otherwise from uid.txt
+  std::uint32_t load_max_uid (std::size_t map_id);
+  void store_max_uid (std::size_t map_id, std::uint32_t uid);
+}
@@ -0,0 +1,287 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#include <noggit/Log.h>
+#include <noggit/MapChunk.h>
+#include <noggit/MapTile.h>
+#include <noggit/ModelInstance.h>
+#include <noggit/WMOInstance.h>
+#include <noggit/World.h>
+#include <noggit/edit_journal.hpp>
+#include <noggit/undo_stack.hpp>
+
+#include <boost/optional.hpp>
+
+namespace noggit
+{
+  namespace
+  {
+    MapChunk* loaded_chunk (World* world, tile_index const& tile, int x, int z)
+    {
+      if (!world->mapIndex.tileLoaded (tile))
+      {
+        return nullptr;
+      }
+      return world->mapIndex.getTile (tile)->getChunk (x, z);
+    }
+  }
+
+  undo_stack::undo_stack (std::function<std::size_t()> memory_limit)
+    : _memory_limit (std::move (memory_limit))
+  {}
+
+  void undo_stack::journal_to (edit_journal* journal)
+  {
+    _journal = journal;
+  }
+
+  void undo_stack::record (MapChunk* chunk)
+  {
+    if (_applying)
+    {
+      return;
+    }
+
+    chunk_key const key {chunk->mt->index, chunk->px, chunk->py};
+    if (!_stroke_chunks.count (key))
+    {
+      _stroke_chunks.emplace (key, chunk->edit_state());
+    }
+  }
+
+  void undo_stack::record (ModelInstance* instance)
+  {
+    if (!_applying)
+    {
+      _stroke_objects.emplace ( std::make_pair (false, instance->uid)
+                              , transform {instance->pos, instance->dir, instance->scale}
+                              );
+    }
+  }
+
+  void undo_stack::record (WMOInstance* instance)
+  {
+    if (!_applying)
+    {
+      _stroke_objects.emplace ( std::make_pair (true, instance->mUniqueID)
+                              , transform {instance->pos, instance->dir, 1.0f}
+                              );
+    }
+  }
+
+  bool undo_stack::end_stroke (World* world)
+  {
+    if (_stroke_chunks.empty() && _stroke_objects.empty())
+    {
+      return false;
+    }
+
+    step change;
+    change.memory_usage = sizeof (step);
+
+    for (auto const& recorded : _stroke_chunks)
+    {
+      chunk_key const& key (recorded.first);
+      if (MapChunk* chunk = loaded_chunk (world, key.tile, key.x, key.z))
+      {
+        byte_delta delta (recorded.second, chunk->edit_state());
+        if (!delta.empty())
+        {
+          if (_journal)
+          {
+            _journal->chunk_changed (key.tile, key.x, key.z, delta, byte_delta::side::before);
+          }
+          change.memory_usage += sizeof (chunk_key) + delta.memory_usage();
+          change.chunks.emplace_back (key, std::move (delta));
+        }
+      }
+    }
+
+    for (auto const& recorded : _stroke_objects)
+    {
+      bool const wmo (recorded.first.first);
+      unsigned int const uid (recorded.first.second);
+      boost::optional<transform> after;
+
+      if (wmo)
+      {
+        auto const instance (world->mWMOInstances.find (uid));
+        if (instance != world->mWMOInstances.end())
+        {
+          after = transform {instance->second.pos, instance->second.dir, 1.0f};
+          if (_journal && !(*after == recorded.second))
+          {
+            _journal->placed (instance->second, recorded.second.pos);
+          }
+        }
+      }
+      else
+      {
+        auto const instance (world->mModelInstances.find (uid));
+        if (instance != world->mModelInstances.end())
+        {
+          after = transform {instance->second.pos, instance->second.dir, instance->second.scale};
+          if (_journal && !(*after == recorded.second))
+          {
+            _journal->placed (instance->second, recorded.second.pos);
+          }
+        }
+      }
+
+      // deleted objects and those merely looked at are skipped
+      if (after && !(*after == recorded.second))
+      {
+        change.objects.push_back ({wmo, uid, recorded.second, *after});
+        change.memory_usage += sizeof (object_change);
+      }
+    }
+
+    _stroke_chunks.clear();
+    _stroke_objects.clear();
+
+    if (change.chunks.empty() && change.objects.empty())
+    {
+      return false;
+    }
+
+    for (step const& undone : _redo)
+    {
+      _memory_usage -= undone.memory_usage;
+    }
+    _redo.clear();
+
+    _memory_usage += change.memory_usage;
+    _undo.emplace_back (std::move (change));
+
+    std::size_t const limit (_memory_limit());
+    while (_memory_usage > limit && !_undo.empty())
+    {
+      _memory_usage -= _undo.front().memory_usage;
+      _undo.pop_front();
+    }
+
+    return true;
+  }
+
+  bool undo_stack::undo (World* world)
+  {
+    end_stroke (world);
+
+    if (_undo.empty())
+    {
+      return false;
+    }
+
+    apply (world, _undo.back(), true);
+    _redo.emplace_back (std::move (_undo.back()));
+    _undo.pop_back();
+    return true;
+  }
+
+  bool undo_stack::redo (World* world)
+  {
+    end_stroke (world);
+
+    if (_redo.empty())
+    {
+      return false;
+    }
+
+    apply (world, _redo.back(), false);
+    _undo.emplace_back (std::move (_redo.back()));
+    _redo.pop_back();
+    return true;
+  }
+
+  void undo_stack::apply (World* world, step const& change, bool undo)
+  {
+    _applying = true;
+
+    for (auto const& recorded : change.chunks)
+    {
+      chunk_key const& key (recorded.first);
+      MapChunk* chunk (loaded_chunk (world, key.tile, key.x, key.z));
+      if (!chunk)
+      {
+        LogError << "undo: chunk " << key.x << "_" << key.z << " of tile " << key.tile.x
+                 << "_" << key.tile.z << " isn't loaded, skipped." << std::endl;
+        continue;
+      }
+
+      // only the side this step expects is accepted, a chunk that is the
+      // other one already would otherwise be flipped back
+      byte_delta::side const from (undo ? byte_delta::side::after : byte_delta::side::before);
+      std::vector<std::uint8_t> state (chunk->edit_state());
+      if (!recorded.second.apply_from (from, state))
+      {
+        LogError << "undo: chunk " << key.x << "_" << key.z << " of tile " << key.tile.x
+                 << "_" << key.tile.z << " was changed by an edit without history, skipped." << std::endl;
+        continue;
+      }
+
+      chunk->restore_edit_state (state);
+      world->mapIndex.setChanged (chunk->mt);
+
+      if (_journal)
+      {
+        _journal->chunk_changed (key.tile, key.x, key.z, recorded.second, from);
+      }
+    }
+
+    for (object_change const& object : change.objects)
+    {
+      transform const& target (undo ? object.before : object.after);
+
+      if (object.wmo)
+      {
+        auto instance (world->mWMOInstances.find (object.uid));
+        if (instance != world->mWMOInstances.end())
+        {
+          math::vector_3d const from (instance->second.pos);
+          world->updateTilesWMO (&instance->second);
+          instance->second.pos = target.pos;
+          instance->second.dir = target.dir;
+          instance->second.recalcExtents();
+          world->updateTilesWMO (&instance->second);
+          if (_journal)
+          {
+            _journal->placed (instance->second, from);
+          }
+        }
+      }
+      else
+      {
+        auto instance (world->mModelInstances.find (object.uid));
+        if (instance != world->mModelInstances.end())
+        {
+          math::vector_3d const from (instance->second.pos);
+          world->updateTilesModel (&instance->second);
+          instance->second.pos = target.pos;
+          instance->second.dir = target.dir;
+          instance->second.scale = target.scale;
+          instance->second.recalcExtents();
+          world->updateTilesModel (&instance->second);
+          if (_journal)
+          {
+            _journal->placed (instance->second, from);
+          }
+        }
+      }
+    }
+
+    _applying = false;
+  }
+
+  void undo_stack::clear()
+  {
+    _stroke_chunks.clear();
+    _stroke_objects.clear();
+    _undo.clear();
+    _redo.clear();
+    _memory_usage = 0;
+  }
+
+  std::size_t undo_stack::memory_usage() const
+  {
+    return _memory_usage;
+  }
+}
@@ -0,0 +1,113 @@
+// This file is part of Noggit3, licensed under GNU General Public License (version 3).
+
+#pragma once
+
+#include <math/vector_3d.hpp>
+#include <noggit/byte_delta.hpp>
+#include <noggit/tile_index.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+class MapChunk;
+class ModelInstance;
+class WMOInstance;
+class World;
+
+namespace noggit
+{
+  class edit_journal;
+
+  //! Undo and redo of terrain, texture, hole and object edits. Everything
+  //! done between two calls to end_stroke() is one step: a chunk or object
+  //! is recorded the first time it is touched in a stroke, and when the
+  //! stroke ends only the changed bytes of the chunks and the changed
+  //! transforms of the objects are kept. Steps are dropped from the oldest
+  //! once the history takes more than its memory limit.
+  class undo_stack
+  {
+  public:
+    //! \a memory_limit in bytes, asked whenever a stroke ends
+    undo_stack (std::function<std::size_t()> memory_limit);
+
+    //! every ended stroke, undo and redo is also written to \a journal,
+    //! which may be null
+    void journal_to (edit_journal* journal);
+
+    void record (MapChunk* chunk);
+    void record (ModelInstance* instance);
+    void record (WMOInstance* instance);
+
+    //! \returns true if the stroke changed anything
+    bool end_stroke (World* world);
+
+    //! both end an open stroke first. \returns false if there is nothing
+    bool undo (World* world);
+    bool redo (World* world);
+
+    void clear();
+
+    std::size_t memory_usage() const;
+
+  private:
+    struct chunk_key
+    {
+      tile_index tile;
+      int x;
+      int z;
+
+      bool operator< (chunk_key const& other) const
+      {
+        return std::tie (tile.z, tile.x, z, x)
+          < std::tie (other.tile.z, other.tile.x, other.z, other.x);
+      }
+    };
+
+    struct transform
+    {
+      math::vector_3d pos;
+      math::vector_3d dir;
+      float scale;
+
+      bool operator== (transform const& other) const
+      {
+        return pos == other.pos && dir == other.dir && scale == other.scale;
+      }
+    };
+
+    struct object_change
+    {
+      bool wmo;
+      unsigned int uid;
+      transform before;
+      transform after;
+    };
+
+    struct step
+    {
+      std::vector<std::pair<chunk_key, byte_delta>> chunks;
+      std::vector<object_change> objects;
+      std::size_t memory_usage;
+    };
+
+    void apply (World* world, step const& change, bool undo);
+
+    std::function<std::size_t()> _memory_limit;
+    edit_journal* _journal = nullptr;
+    //! set while a step is applied, so nothing is recorded by it
+    bool _applying = false;
+
+    std::map<chunk_key, std::vector<std::uint8_t>> _stroke_chunks;
+    std::map<std::pair<bool, unsigned int>, transform> _stroke_objects;
+
+    std::deque<step> _undo;
+    std::deque<step> _redo;
+    std::size_t _memory_usage = 0;
+  };
+}
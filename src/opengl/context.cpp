@@ -15,9 +15,10 @@
 #include <QtGui/QOpenGLFunctions_1_5>
 #include <QtOpenGLExtensions/QOpenGLExtensions>
 
-#include <functional>
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 opengl::context gl;
@@ -34,101 +35,204 @@ namespace opengl
       static constexpr char const* const name = "GL_ARB_vertex_program";
     };
 
+    std::string drain_gl_errors()
+    {
+      std::string errors;
+      std::size_t error_count = 0;
+      for (GLenum error; error_count < 10 && (error = glGetError()) != GL_NO_ERROR; ++error_count)
+      {
+        switch (error)
+        {
+        case GL_INVALID_ENUM: errors += " GL_INVALID_ENUM"; break;
+        case GL_INVALID_FRAMEBUFFER_OPERATION: errors += " GL_INVALID_FRAMEBUFFER_OPERATION"; break;
+        case GL_INVALID_OPERATION: errors += " GL_INVALID_OPERATION"; break;
+        case GL_INVALID_VALUE: errors += " GL_INVALID_VALUE"; break;
+        case GL_OUT_OF_MEMORY: errors += " GL_OUT_OF_MEMORY"; break;
+        case GL_STACK_OVERFLOW: errors += " GL_STACK_OVERFLOW"; break;
+        case GL_STACK_UNDERFLOW: errors += " GL_STACK_UNDERFLOW"; break;
+        case GL_TABLE_TOO_LARGE: errors += " GL_TABLE_TOO_LARGE"; break;
+        default: errors += " UNKNOWN_ERROR"; break;
+        }
+      }
+
+      if (error_count == 10 && glGetError())
+      {
+        errors += " and more...";
+      }
+
+      return errors;
+    }
+
+    void report_gl_errors (context const& context_, char const* function, std::string errors)
+    {
+      if (context_._check_mode == context::check_mode::sampled)
+      {
+        // any call since the last check may have raised them
+        errors += " (sampled, latest calls:";
+        std::size_t const count (std::min (context_._call_count, context_._recent_calls.size()));
+        for (std::size_t i (context_._call_count - count); i < context_._call_count; ++i)
+        {
+          errors += std::string (" ") + context_._recent_calls[i % context_._recent_calls.size()];
+        }
+        errors += ")";
+      }
+
+#ifndef NOGGIT_DO_NOT_THROW_ON_OPENGL_ERRORS
+      LogError << function << ":" << errors << "\n";
+#else
+      throw std::runtime_error (function + (":" + errors));
+#endif
+    }
+  }
+
+  struct context::function_cache
+  {
+    QOpenGLContext* owner = nullptr;
+    QOpenGLFunctions* functions = nullptr;
+    std::tuple < QOpenGLFunctions_1_0*, QOpenGLFunctions_1_1*, QOpenGLFunctions_1_2*
+               , QOpenGLFunctions_1_3*, QOpenGLFunctions_1_4*, QOpenGLFunctions_1_5*
+               > version_functions;
+    std::unique_ptr<QOpenGLExtension_ARB_vertex_program> vertex_program;
+  };
+
+  context::context()
+    : _functions (std::make_unique<function_cache>())
+  {}
+  context::~context() = default;
+
+  void context::invalidate_function_cache()
+  {
+    *_functions = function_cache();
+  }
+
+  void context::check_for_errors (char const* where)
+  {
+    if (_check_mode == check_mode::release || !_current_context || inside_gl_begin_end)
+    {
+      return;
+    }
+
+    std::string const errors (drain_gl_errors());
+    if (!errors.empty())
+    {
+      report_gl_errors (*this, where, errors);
+    }
+  }
+
+  namespace
+  {
+    //! Verifies the context and checks for errors after the call as far
+    //! as the context's check_mode asks for. Holds no owning members, so
+    //! a call in release mode costs a comparison or two.
     struct verify_context_and_check_for_gl_errors
     {
+      verify_context_and_check_for_gl_errors (context& context_, char const* function)
+        : verify_context_and_check_for_gl_errors (context_, function, nullptr, nullptr)
+      {}
+      //! \note extra_info has to outlive this object
       template<typename ExtraInfo> verify_context_and_check_for_gl_errors
-          (QOpenGLContext* current_context, char const* function, ExtraInfo&& extra_info)
-        : _current_context (current_context)
+          (context& context_, char const* function, ExtraInfo const& extra_info)
+        : verify_context_and_check_for_gl_errors
+            ( context_
+            , function
+            , &extra_info
+            , [] (void const* info) -> std::string
+              {
+                return (*static_cast<ExtraInfo const*> (info))();
+              }
+            )
+      {}
+
+      verify_context_and_check_for_gl_errors ( context& context_
+                                             , char const* function
+                                             , void const* extra_info
+                                             , std::string (*format_extra_info) (void const*)
+                                             )
+        : _context (context_)
         , _function (function)
         , _extra_info (extra_info)
+        , _format_extra_info (format_extra_info)
+        , _check (_context._check_mode == context::check_mode::full)
       {
-        if (!_current_context)
+        if (!_context._current_context)
         {
-          throw std::runtime_error (_function + ": called without active OpenGL context: no context at all");
+          throw std::runtime_error (std::string (_function) + ": called without active OpenGL context: no context at all");
         }
-        if (!_current_context->isValid())
+
+        if (_context._check_mode == context::check_mode::sampled)
         {
-          throw std::runtime_error (_function + ": called without active OpenGL context: invalid");
+          _context._recent_calls[_context._call_count % _context._recent_calls.size()] = _function;
+          _check = ++_context._call_count % _context._sampled_check_interval == 0;
         }
-        if (QOpenGLContext::currentContext() != _current_context)
+
+        if (_check)
         {
-          throw std::runtime_error (_function + ": called without active OpenGL context: not current context");
+          if (!_context._current_context->isValid())
+          {
+            throw std::runtime_error (std::string (_function) + ": called without active OpenGL context: invalid");
+          }
+          if (QOpenGLContext::currentContext() != _context._current_context)
+          {
+            throw std::runtime_error (std::string (_function) + ": called without active OpenGL context: not current context");
+          }
+        }
+
+        if (_context._functions->owner != _context._current_context)
+        {
+          _context.invalidate_function_cache();
+          _context._functions->owner = _context._current_context;
         }
       }
-      verify_context_and_check_for_gl_errors (QOpenGLContext* current_context, char const* function)
-        : verify_context_and_check_for_gl_errors (current_context, function, &verify_context_and_check_for_gl_errors::no_extra_info)
-      {}
 
-      template<typename Functions>
-        Functions* version_functions() const
+      QOpenGLFunctions* functions() const
       {
-        Functions* f (_current_context->versionFunctions<Functions>());
+        QOpenGLFunctions*& f (_context._functions->functions);
         if (!f)
         {
-          throw std::runtime_error (_function + ": requires OpenGL functions for version " + typeid (Functions).name());
+          f = _context._current_context->functions();
         }
         return f;
       }
-      template<typename Extension>
-        std::unique_ptr<Extension> extension_functions() const
+
+      template<typename Functions>
+        Functions* version_functions() const
       {
-        if (!_current_context->hasExtension (extension_traits<Extension>::name))
+        Functions*& f (std::get<Functions*> (_context._functions->version_functions));
+        if (!f)
         {
-          throw std::runtime_error (_function + ": requires OpenGL extension " + extension_traits<Extension>::name);
+          f = _context._current_context->versionFunctions<Functions>();
+          if (!f)
+          {
+            throw std::runtime_error (std::string (_function) + ": requires OpenGL functions for version " + typeid (Functions).name());
+          }
         }
-        std::unique_ptr<Extension> functions (new Extension());
-        functions->initializeOpenGLFunctions();
-        return functions;
+        return f;
       }
+      template<typename Extension>
+        Extension* extension_functions() const;
 
-      QOpenGLContext* _current_context;
-      std::string _function;
-      static std::string no_extra_info() { return {}; }
-      std::function<std::string()> _extra_info;
+      context& _context;
+      char const* _function;
+      void const* _extra_info;
+      std::string (*_format_extra_info) (void const*);
+      bool _check;
 
       ~verify_context_and_check_for_gl_errors()
       {
-#ifndef NOGGIT_DO_NOT_CHECK_FOR_OPENGL_ERRORS
-        if (inside_gl_begin_end)
+        if (!_check || inside_gl_begin_end)
         {
           return;
         }
 
-        std::string errors;
-        std::size_t error_count = 0;
-        while (GLenum error = glGetError() && error_count < 10)
+        std::string errors (drain_gl_errors());
+        if (!errors.empty())
         {
-          switch (error)
+          if (_extra_info)
           {
-          case GL_INVALID_ENUM: errors += " GL_INVALID_ENUM"; break;
-          case GL_INVALID_FRAMEBUFFER_OPERATION: errors += " GL_INVALID_FRAMEBUFFER_OPERATION"; break;
-          case GL_INVALID_OPERATION: errors += " GL_INVALID_OPERATION"; break;
-          case GL_INVALID_VALUE: errors += " GL_INVALID_VALUE"; break;
-          case GL_OUT_OF_MEMORY: errors += " GL_OUT_OF_MEMORY"; break;
-          case GL_STACK_OVERFLOW: errors += " GL_STACK_OVERFLOW"; break;
-          case GL_STACK_UNDERFLOW: errors += " GL_STACK_UNDERFLOW"; break;
-          case GL_TABLE_TOO_LARGE: errors += " GL_TABLE_TOO_LARGE"; break;
-          default: errors += " UNKNOWN_ERROR"; break;
+            errors += _format_extra_info (_extra_info);
           }
-
-          ++error_count;
-        }
-
-        if (error_count == 10 && glGetError())
-        {
-          errors += " and more...";
+          report_gl_errors (_context, _function, errors);
         }
-
-        if (!errors.empty())
-        {
-          errors += _extra_info();
-#ifndef NOGGIT_DO_NOT_THROW_ON_OPENGL_ERRORS
-          LogError << _function + ":" + errors << "\n";
-#else
-          throw std::runtime_error (_function + ":" + errors);
-#endif
-        }
-#endif
       }
 
       verify_context_and_check_for_gl_errors (verify_context_and_check_for_gl_errors const&) = delete;
@@ -136,639 +240,667 @@ namespace opengl
       verify_context_and_check_for_gl_errors& operator= (verify_context_and_check_for_gl_errors const&) = delete;
       verify_context_and_check_for_gl_errors& operator= (verify_context_and_check_for_gl_errors&&) = delete;
     };
+
+    template<>
+      QOpenGLExtension_ARB_vertex_program*
+        verify_context_and_check_for_gl_errors::extension_functions<QOpenGLExtension_ARB_vertex_program>() const
+    {
+      using Extension = QOpenGLExtension_ARB_vertex_program;
+
+      std::unique_ptr<Extension>& functions (_context._functions->vertex_program);
+      if (!functions)
+      {
+        if (!_context._current_context->hasExtension (extension_traits<Extension>::name))
+        {
+          throw std::runtime_error (std::string (_function) + ": requires OpenGL extension " + extension_traits<Extension>::name);
+        }
+        functions = std::make_unique<Extension>();
+        functions->initializeOpenGLFunctions();
+      }
+      return functions.get();
+    }
   }
 
   void context::enable (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glEnable (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glEnable (target);
   }
   void context::disable (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDisable (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDisable (target);
   }
   GLboolean context::isEnabled (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glIsEnabled (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glIsEnabled (target);
   }
 
   void context::begin (GLenum target)
   {
     ++inside_gl_begin_end;
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glBegin (target);
   }
   void context::end()
   {
     --inside_gl_begin_end;
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glEnd();
   }
 
   void context::enableClientState (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glEnableClientState (target);
   }
   void context::disableClientState (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glDisableClientState (target);
   }
   void context::clientActiveTexture (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_3>()->glClientActiveTexture (target);
   }
 
   void context::normal3f (GLfloat x, GLfloat y, GLfloat z)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glNormal3f (x, y, z);
   }
   void context::normal3fv (GLfloat const data[3])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glNormal3fv (data);
   }
   void context::vertex2f (GLfloat x, GLfloat y)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glVertex2f (x, y);
   }
   void context::vertex3f (GLfloat x, GLfloat y, GLfloat z)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glVertex3f (x, y, z);
   }
   void context::vertex3fv (GLfloat const data[3])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glVertex3fv (data);
   }
   void context::color3f (GLfloat x, GLfloat y, GLfloat z)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColor3f (x, y, z);
   }
   void context::color4f (GLfloat x, GLfloat y, GLfloat z, GLfloat w)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColor4f (x, y, z, w);
   }
   void context::color4ub (GLubyte x, GLubyte y, GLubyte z, GLubyte w)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColor4ub (x, y, z, w);
   }
   void context::color3fv (GLfloat const data[3])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColor3fv (data);
   }
   void context::color4fv (GLfloat const data[4])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColor4fv (data);
   }
   void context::texCoord2f (GLfloat x, GLfloat y)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexCoord2f (x, y);
   }
   void context::texCoord2fv (GLfloat const data[2])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexCoord2fv (data);
   }
   void context::multiTexCoord2f (GLenum target, GLfloat x, GLfloat y)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_3>()->glMultiTexCoord2f (target, x, y);
   }
 
   void context::matrixMode (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMatrixMode (target);
   }
   void context::pushMatrix()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPushMatrix();
   }
   void context::popMatrix()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPopMatrix();
   }
   void context::loadIdentity()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLoadIdentity();
   }
   void context::translatef (GLfloat x, GLfloat y, GLfloat z)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTranslatef (x, y, z);
   }
   void context::scalef (GLfloat x, GLfloat y, GLfloat z)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glScalef (x, y, z);
   }
   void context::rotatef (GLfloat x, GLfloat y, GLfloat z, GLfloat w)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glRotatef (x, y, z, w);
   }
   void context::multMatrixf (GLfloat const data[4])
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMultMatrixf (data);
   }
+  void context::loadMatrixf (GLfloat const data[16])
+  {
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.version_functions<QOpenGLFunctions_1_0>()->glLoadMatrixf (data);
+  }
 
   void context::ortho (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble nearVal, GLdouble farVal)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glOrtho (left, right, bottom, top, nearVal, farVal);
   }
   void context::frustum (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble nearVal, GLdouble farVal)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glFrustum (left, right, bottom, top, nearVal, farVal);
   }
   void context::viewport (GLint x, GLint y, GLsizei width, GLsizei height)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glViewport (x, y, width, height);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glViewport (x, y, width, height);
   }
 
   void context::alphaFunc (GLenum func, GLfloat ref)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glAlphaFunc (func, ref);
   }
   void context::depthFunc (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDepthFunc (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDepthFunc (target);
   }
   void context::depthMask (GLboolean mask)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDepthMask (mask);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDepthMask (mask);
   }
   void context::blendFunc (GLenum sfactor, GLenum dfactor)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBlendFunc (sfactor, dfactor);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBlendFunc (sfactor, dfactor);
   }
   void context::shadeModel (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glShadeModel (target);
   }
 
   void context::clear (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glClear (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glClear (target);
   }
   void context::clearColor (GLfloat r, GLfloat g, GLfloat b, GLfloat a)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glClearColor (r, g, b, a);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glClearColor (r, g, b, a);
   }
 
   void context::readBuffer (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glReadBuffer (target);
   }
   void context::readPixels (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* data)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glReadPixels (x, y, width, height, format, type, data);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glReadPixels (x, y, width, height, format, type, data);
   }
 
   void context::lineWidth (GLfloat width)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glLineWidth (width);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glLineWidth (width);
   }
   void context::lineStipple (GLint factor, GLushort pattern)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLineStipple (factor, pattern);
   }
 
   void context::pointParameterf (GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_4>()->glPointParameterf (pname, param);
   }
   void context::pointParameteri (GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_4>()->glPointParameteri (pname, param);
   }
   void context::pointParameterfv (GLenum pname, GLfloat const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_4>()->glPointParameterfv (pname, param);
   }
   void context::pointParameteriv (GLenum pname, GLint const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_4>()->glPointParameteriv (pname, param);
   }
   void context::pointSize (GLfloat size)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPointSize (size);
   }
 
   void context::hint (GLenum target, GLenum mode)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glHint (target, mode);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glHint (target, mode);
   }
   void context::polygonMode (GLenum face, GLenum mode)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPolygonMode (face, mode);
   }
   GLint context::renderMode (GLenum mode)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glRenderMode (mode);
   }
 
   void context::genTextures (GLuint count, GLuint* textures)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGenTextures (count, textures);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGenTextures (count, textures);
   }
   void context::deleteTextures (GLuint count, GLuint* textures)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDeleteTextures (count, textures);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDeleteTextures (count, textures);
   }
   void context::bindTexture (GLenum target, GLuint texture)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBindTexture (target, texture);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBindTexture (target, texture);
   }
   void context::texImage2D (GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, GLvoid const* data)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glTexImage2D (target, level, internal_format, width, height, border, format, type, data);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glTexImage2D (target, level, internal_format, width, height, border, format, type, data);
   }
   void context::compressedTexImage2D (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, GLvoid const* data)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glCompressedTexImage2D (target, level, internalformat, width, height, border, imageSize, data);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glCompressedTexImage2D (target, level, internalformat, width, height, border, imageSize, data);
   }
   void context::generateMipmap (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGenerateMipmap (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGenerateMipmap (target);
   }
   void context::activeTexture (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glActiveTexture (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glActiveTexture (target);
   }
 
   void context::texEnvf (GLenum target, GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexEnvf (target, pname, param);
   }
   void context::texEnvi (GLenum target, GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexEnvi (target, pname, param);
   }
 
   void context::texGeni (GLenum coord, GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGeni (coord, pname, param);
   }
   void context::texGenf (GLenum coord, GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGenf (coord, pname, param);
   }
   void context::texGend (GLenum coord, GLenum pname, GLdouble param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGend (coord, pname, param);
   }
   void context::texGeniv (GLenum coord, GLenum pname, GLint const* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGeniv (coord, pname, params);
   }
   void context::texGenfv (GLenum coord, GLenum pname, GLfloat const* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGenfv (coord, pname, params);
   }
   void context::texGendv (GLenum coord, GLenum pname, GLdouble const* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glTexGendv (coord, pname, params);
   }
 
   void context::texParameteri (GLenum target, GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glTexParameteri (target, pname, param);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glTexParameteri (target, pname, param);
   }
   void context::texParameterf (GLenum target, GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glTexParameterf (target, pname, param);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glTexParameterf (target, pname, param);
   }
   void context::texParameteriv (GLenum target, GLenum pname, GLint const* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glTexParameteriv (target, pname, params);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glTexParameteriv (target, pname, params);
   }
   void context::texParameterfv (GLenum target, GLenum pname, GLfloat const* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glTexParameterfv (target, pname, params);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glTexParameterfv (target, pname, params);
   }
 
   void context::genBuffers (GLuint count, GLuint* buffers)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGenBuffers (count, buffers);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGenBuffers (count, buffers);
   }
   void context::deleteBuffers (GLuint count, GLuint* buffers)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDeleteBuffers (count, buffers);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDeleteBuffers (count, buffers);
   }
   void context::bindBuffer (GLenum target, GLuint buffer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBindBuffer (target, buffer);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBindBuffer (target, buffer);
   }
   void context::bufferData (GLenum target, GLsizeiptr size, GLvoid const* data, GLenum usage)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBufferData (target, size, data, usage);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBufferData (target, size, data, usage);
   }
   GLvoid* context::mapBuffer (GLenum target, GLenum access)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_5>()->glMapBuffer (target, access);
   }
   GLboolean context::unmapBuffer (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_5>()->glUnmapBuffer (target);
   }
+  void context::drawArrays (GLenum mode, GLint first, GLsizei count)
+  {
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDrawArrays (mode, first, count);
+  }
   void context::drawElements (GLenum mode, GLsizei count, GLenum type, GLvoid const* indices)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDrawElements (mode, count, type, indices);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDrawElements (mode, count, type, indices);
   }
   void context::drawRangeElements (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, GLvoid const* indices)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_2>()->glDrawRangeElements (mode, start, end, count, type, indices);
   }
 
   void context::vertexPointer (GLint size, GLenum type, GLsizei stride, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glVertexPointer (size, type, stride, pointer);
   }
   void context::colorPointer (GLint size, GLenum type, GLsizei stride, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glColorPointer (size, type, stride, pointer);
   }
   void context::texCoordPointer (GLint size, GLenum type, GLsizei stride, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glTexCoordPointer (size, type, stride, pointer);
   }
   void context::normalPointer (GLenum type, GLsizei stride, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_1>()->glNormalPointer (type, stride, pointer);
   }
 
   GLuint context::genLists (GLsizei range)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glGenLists (range);
   }
   void context::deleteLists (GLuint list, GLsizei range)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glDeleteLists (list, range);
   }
   void context::newList (GLuint list, GLenum mode)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glNewList (list, mode);
   }
   void context::endList()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glEndList();
   }
   void context::callList (GLuint list)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glCallList (list);
   }
 
   void context::genPrograms (GLsizei count, GLuint* programs)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.extension_functions<QOpenGLExtension_ARB_vertex_program>()->glGenProgramsARB (count, programs);
   }
   void context::deletePrograms (GLsizei count, GLuint* programs)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.extension_functions<QOpenGLExtension_ARB_vertex_program>()->glDeleteProgramsARB (count, programs);
   }
   void context::bindProgram (GLenum target, GLuint program)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.extension_functions<QOpenGLExtension_ARB_vertex_program>()->glBindProgramARB (target, program);
   }
   void context::programString (GLenum target, GLenum format, GLsizei len, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _
-      ( _current_context
-      , BOOST_CURRENT_FUNCTION
-      , [this]
+    auto const error_location
+      ( [this]
         {
           GLint error_position;
           getIntegerv (GL_PROGRAM_ERROR_POSITION_ARB, &error_position);
           return " at " + std::to_string (error_position) + ": " + reinterpret_cast<char const*> (getString (GL_PROGRAM_ERROR_STRING_ARB));
         }
       );
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION, error_location);
     return _.extension_functions<QOpenGLExtension_ARB_vertex_program>()->glProgramStringARB (target, format, len, pointer);
   }
   void context::getProgramiv (GLuint program, GLenum pname, GLint* params)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetProgramiv (program, pname, params);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetProgramiv (program, pname, params);
   }
   void context::programLocalParameter4f (GLenum target, GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.extension_functions<QOpenGLExtension_ARB_vertex_program>()->glProgramLocalParameter4fARB (target, index, x, y, z, w);
   }
 
   void context::lightf (GLenum light, GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightf (light, pname, param);
   }
   void context::lighti (GLenum light, GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLighti (light, pname, param);
   }
   void context::lightfv (GLenum light, GLenum pname, GLfloat const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightfv (light, pname, param);
   }
   void context::lightiv (GLenum light, GLenum pname, GLint const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightiv (light, pname, param);
   }
   void context::lightModelf (GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightModelf (pname, param);
   }
   void context::lightModeli (GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightModeli (pname, param);
   }
   void context::lightModelfv (GLenum pname, GLfloat const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightModelfv (pname, param);
   }
   void context::lightModeliv (GLenum pname, GLint const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glLightModeliv (pname, param);
   }
 
   void context::materiali (GLenum face, GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMateriali (face, pname, param);
   }
   void context::materialf (GLenum face, GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMaterialf (face, pname, param);
   }
   void context::materialiv (GLenum face, GLenum pname, GLint const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMaterialiv (face, pname, param);
   }
   void context::materialfv (GLenum face, GLenum pname, GLfloat const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glMaterialfv (face, pname, param);
   }
   void context::colorMaterial (GLenum face, GLenum mode)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glColorMaterial (face, mode);
   }
 
   void context::fogi (GLenum pname, GLint param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glFogi (pname, param);
   }
   void context::fogiv (GLenum pname, GLint const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glFogiv (pname, param);
   }
   void context::fogf (GLenum pname, GLfloat param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glFogf (pname, param);
   }
   void context::fogfv (GLenum pname, GLfloat const* param)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glFogfv (pname, param);
   }
 
   void context::getBooleanv (GLenum target, GLboolean* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetBooleanv (target, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetBooleanv (target, value);
   }
   void context::getDoublev (GLenum target, GLdouble* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glGetDoublev (target, value);
   }
   void context::getFloatv (GLenum target, GLfloat* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetFloatv (target, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetFloatv (target, value);
   }
   void context::getIntegerv (GLenum target, GLint* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetIntegerv (target, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetIntegerv (target, value);
   }
 
   GLubyte const* context::getString (GLenum target)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetString (target);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetString (target);
   }
 
   GLuint context::createShader (GLenum shader_type)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glCreateShader (shader_type);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glCreateShader (shader_type);
   }
   void context::deleteShader (GLuint shader)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDeleteShader (shader);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDeleteShader (shader);
   }
   void context::shaderSource (GLuint shader, GLsizei count, GLchar const** string, GLint const* length)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glShaderSource (shader, count, string, length);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glShaderSource (shader, count, string, length);
   }
   void context::compile_shader (GLuint shader)
   {
     {
-      verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-      _current_context->functions()->glCompileShader (shader);
+      verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+      _.functions()->glCompileShader (shader);
     }
     if (get_shader (shader, GL_COMPILE_STATUS) != GL_TRUE)
     {
@@ -780,37 +912,37 @@ namespace opengl
   }
   GLint context::get_shader (GLuint shader, GLenum pname)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     GLint params;
-    _current_context->functions()->glGetShaderiv (shader, pname, &params);
+    _.functions()->glGetShaderiv (shader, pname, &params);
     return params;
   }
 
   GLuint context::createProgram()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glCreateProgram();
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glCreateProgram();
   }
   void context::deleteProgram (GLuint program)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDeleteProgram (program);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDeleteProgram (program);
   }
   void context::attachShader (GLuint program, GLuint shader)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glAttachShader (program, shader);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glAttachShader (program, shader);
   }
   void context::detachShader (GLuint program, GLuint shader)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDetachShader (program, shader);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDetachShader (program, shader);
   }
   void context::link_program (GLuint program)
   {
     {
-      verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-      _current_context->functions()->glLinkProgram (program);
+      verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+      _.functions()->glLinkProgram (program);
     }
     if (get_program (program, GL_LINK_STATUS) != GL_TRUE)
     {
@@ -821,14 +953,14 @@ namespace opengl
   }
   void context::useProgram (GLuint program)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUseProgram (program);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUseProgram (program);
   }
   void context::validate_program (GLuint program)
   {
     {
-      verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-      _current_context->functions()->glValidateProgram (program);
+      verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+      _.functions()->glValidateProgram (program);
     }
     if (get_program (program, GL_VALIDATE_STATUS) != GL_TRUE)
     {
@@ -838,37 +970,37 @@ namespace opengl
   }
   GLint context::get_program (GLuint program, GLenum pname)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     GLint params;
-    _current_context->functions()->glGetProgramiv (program, pname, &params);
+    _.functions()->glGetProgramiv (program, pname, &params);
     return params;
   }
 
   GLint context::getAttribLocation (GLuint program, GLchar const* name)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGetAttribLocation (program, name);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGetAttribLocation (program, name);
   }
   void context::vertexAttribPointer (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLvoid const* pointer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glVertexAttribPointer (index, size, type, normalized, stride, pointer);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glVertexAttribPointer (index, size, type, normalized, stride, pointer);
   }
   void context::enableVertexAttribArray (GLuint index)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glEnableVertexAttribArray (index);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glEnableVertexAttribArray (index);
   }
   void context::disableVertexAttribArray (GLuint index)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glDisableVertexAttribArray (index);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glDisableVertexAttribArray (index);
   }
 
   GLint context::getUniformLocation (GLuint program, GLchar const* name)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    auto val (_current_context->functions()->glGetUniformLocation (program, name));
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    auto val (_.functions()->glGetUniformLocation (program, name));
     if (val == -1)
     {
       throw std::logic_error ("unknown uniform " + std::string (name));
@@ -878,110 +1010,110 @@ namespace opengl
 
   void context::uniform1i (GLint location, GLint value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniform1i (location, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniform1i (location, value);
   }
   void context::uniform1f (GLint location, GLfloat value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniform1f (location, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniform1f (location, value);
   }
 
   void context::uniform1iv (GLint location, GLsizei count, GLint const* value)
   {
-    verify_context_and_check_for_gl_errors const _(_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniform1iv(location, count, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniform1iv(location, count, value);
   }
 
   void context::uniform3fv (GLint location, GLsizei count, GLfloat const* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniform3fv (location, count, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniform3fv (location, count, value);
   }
   void context::uniform4fv (GLint location, GLsizei count, GLfloat const* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniform4fv (location, count, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniform4fv (location, count, value);
   }
   void context::uniformMatrix4fv (GLint location, GLsizei count, GLboolean transpose, GLfloat const* value)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glUniformMatrix4fv (location, count, transpose, value);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glUniformMatrix4fv (location, count, transpose, value);
   }
 
   void context::clearStencil (GLint s)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glClearStencil (s);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glClearStencil (s);
   }
   void context::stencilFunc (GLenum func, GLint ref, GLuint mask)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glStencilFunc (func, ref, mask);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glStencilFunc (func, ref, mask);
   }
   void context::stencilOp (GLenum sfail, GLenum dpfail, GLenum dppass)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glStencilOp (sfail, dpfail, dppass);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glStencilOp (sfail, dpfail, dppass);
   }
   void context::colorMask (GLboolean r, GLboolean g, GLboolean b, GLboolean a)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glColorMask (r, g, b, a);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glColorMask (r, g, b, a);
   }
 
   void context::polygonOffset (GLfloat factor, GLfloat units)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glPolygonOffset (factor, units);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glPolygonOffset (factor, units);
   }
 
   void context::pushAttrib (GLbitfield mask)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPushAttrib (mask);
   }
   void context::popAttrib()
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
     return _.version_functions<QOpenGLFunctions_1_0>()->glPopAttrib();
   }
 
   void context::genFramebuffers (GLsizei n, GLuint *ids)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGenFramebuffers (n, ids);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGenFramebuffers (n, ids);
   }
   void context::bindFramebuffer (GLenum target, GLuint framebuffer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBindFramebuffer (target, framebuffer);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBindFramebuffer (target, framebuffer);
   }
   void context::framebufferTexture2D (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glFramebufferTexture2D (target, attachment, textarget, texture, level);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glFramebufferTexture2D (target, attachment, textarget, texture, level);
   }
 
   void context::genRenderbuffers (GLsizei n, GLuint *ids)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glGenRenderbuffers (n, ids);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glGenRenderbuffers (n, ids);
   }
   void context::bindRenderbuffer (GLenum target, GLuint renderbuffer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glBindRenderbuffer (target, renderbuffer);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glBindRenderbuffer (target, renderbuffer);
   }
   void context::renderbufferStorage (GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glRenderbufferStorage (target, internalformat, width, height);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glRenderbufferStorage (target, internalformat, width, height);
   }
   void context::framebufferRenderbuffer (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
   {
-    verify_context_and_check_for_gl_errors const _ (_current_context, BOOST_CURRENT_FUNCTION);
-    return _current_context->functions()->glFramebufferRenderbuffer (target, attachment, renderbuffertarget, renderbuffer);
+    verify_context_and_check_for_gl_errors const _ (*this, BOOST_CURRENT_FUNCTION);
+    return _.functions()->glFramebufferRenderbuffer (target, attachment, renderbuffertarget, renderbuffer);
   }
 
   template<GLenum target>
@@ -4,10 +4,28 @@
 
 #include <opengl/types.hpp>
 
+#include <array>
+#include <cstddef>
+#include <memory>
+
 namespace opengl
 {
   struct context
   {
+    //! How much every call verifies. full checks the context and drains
+    //! glGetError after every call, sampled does so every
+    //! _sampled_check_interval calls and in check_for_errors(), release
+    //! only makes sure there is a context at all.
+    enum class check_mode
+    {
+      full,
+      sampled,
+      release,
+    };
+
+    context();
+    ~context();
+
     struct scoped_setter
     {
       scoped_setter (context& context_, QOpenGLContext* current_context)
@@ -15,10 +33,12 @@ namespace opengl
         , _old_context (_context._current_context)
       {
         _context._current_context = current_context;
+        _context.invalidate_function_cache();
       }
       ~scoped_setter()
       {
         _context._current_context = _old_context;
+        _context.invalidate_function_cache();
       }
 
       scoped_setter (scoped_setter const&) = delete;
@@ -66,6 +86,27 @@ namespace opengl
 
     QOpenGLContext* _current_context = nullptr;
 
+#if defined (NOGGIT_DO_NOT_CHECK_FOR_OPENGL_ERRORS)
+    check_mode _check_mode = check_mode::release;
+#elif defined (NDEBUG)
+    check_mode _check_mode = check_mode::sampled;
+#else
+    check_mode _check_mode = check_mode::full;
+#endif
+    std::size_t _sampled_check_interval = 1024;
+
+    //! drains pending errors unless in release mode, e.g. once per frame
+    void check_for_errors (char const* where);
+
+    //! function tables of _current_context, fetched once per context
+    struct function_cache;
+    std::unique_ptr<function_cache> _functions;
+    void invalidate_function_cache();
+
+    //! call sites since the last sampled check, reported with its errors
+    std::array<char const*, 16> _recent_calls;
+    std::size_t _call_count = 0;
+
     void enable (GLenum);
     void disable (GLenum);
     GLboolean isEnabled (GLenum);
@@ -99,6 +140,7 @@ namespace opengl
     void scalef (GLfloat, GLfloat, GLfloat);
     void rotatef (GLfloat, GLfloat, GLfloat, GLfloat);
     void multMatrixf (GLfloat const*);
+    void loadMatrixf (GLfloat const*);
 
     void ortho (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble nearVal, GLdouble farVal);
     void frustum (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble nearVal, GLdouble farVal);
@@ -158,6 +200,7 @@ namespace opengl
     void bufferData (GLenum target, GLsizeiptr size, GLvoid const* data, GLenum usage);
     GLvoid* mapBuffer (GLenum target, GLenum access);
     GLboolean unmapBuffer (GLenum);
+    void drawArrays (GLenum mode, GLint first, GLsizei count);
     void drawElements (GLenum mode, GLsizei count, GLenum type, GLvoid const* indices);
     void drawRangeElements (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, GLvoid const* indices);
 
@@ -1,5 +1,7 @@
 // This file is part of Noggit3, licensed under GNU General Public License (version 3).
 
+#include <math/matrix_4x4.hpp>
+#include <math/vector_3d.hpp>
 #include <math/vector_4d.hpp>
 #include <opengl/context.hpp>
 #include <opengl/matrix.hpp>
@@ -8,16 +10,15 @@
 #include <opengl/types.hpp>
 
 #include <array>
+#include <cstdint>
 
 namespace opengl
 {
   namespace primitives
   {
-    wire_box::wire_box ( math::vector_3d const& min_point
-                       , math::vector_3d const& max_point
-                       )
-      : _program { { GL_VERTEX_SHADER
-                   , R"code(
+    namespace
+    {
+      char const* const vertex_shader = R"code(
 #version 110
 
 attribute vec4 position;
@@ -29,10 +30,9 @@ void main()
 {
   gl_Position = projection * model_view * position;
 }
-)code"
-                   }
-                 , { GL_FRAGMENT_SHADER
-                   , R"code(
+)code";
+
+      char const* const fragment_shader = R"code(
 #version 110
 
 uniform vec4 color;
@@ -41,44 +41,53 @@ void main()
 {
   gl_FragColor = color;
 }
-)code"
-                   }
-                 }
-    {
-      std::vector<math::vector_3d> positions;
-      positions.reserve (8);
-      positions.emplace_back (max_point.x, max_point.y, max_point.z);
-      positions.emplace_back (max_point.x, max_point.y, min_point.z);
-      positions.emplace_back (max_point.x, min_point.y, max_point.z);
-      positions.emplace_back (max_point.x, min_point.y, min_point.z);
-      positions.emplace_back (min_point.x, max_point.y, max_point.z);
-      positions.emplace_back (min_point.x, max_point.y, min_point.z);
-      positions.emplace_back (min_point.x, min_point.y, max_point.z);
-      positions.emplace_back (min_point.x, min_point.y, min_point.z);
-
-      static std::array<unsigned char, 16> const indices
-        {{5, 7, 3, 2, 0, 1, 3, 1, 5, 4, 0, 4, 6, 2, 6, 7}};
+)code";
 
+      std::size_t const sphere_segments (15);
+      std::size_t const disk_segments (180);
+
+      template<GLenum target, typename T>
+        void upload (GLuint buffer, std::vector<T> const& data)
       {
-        scoped::buffer_binder<GL_ARRAY_BUFFER> const buffer (_positions);
-        gl.bufferData ( GL_ARRAY_BUFFER
-                      , positions.size() * sizeof (*positions.data())
-                      , positions.data()
-                      , GL_STATIC_DRAW
-                      );
+        gl.bufferData<target> (buffer, data.size() * sizeof (T), data.data(), GL_STATIC_DRAW);
       }
 
+      void setup ( scoped::use_program& shader
+                 , GLuint positions
+                 , math::matrix_4x4 const& model
+                 , math::vector_4d const& color
+                 )
       {
-        scoped::buffer_binder<GL_ELEMENT_ARRAY_BUFFER> const buffer (_indices);
-        gl.bufferData ( GL_ELEMENT_ARRAY_BUFFER
-                      , indices.size() * sizeof (*indices.data())
-                      , indices.data()
-                      , GL_STATIC_DRAW
-                      );
+        shader.uniform ("model_view", opengl::matrix::model_view() * model);
+        shader.uniform ("projection", opengl::matrix::projection());
+        shader.uniform ("color", color);
+        shader.attrib ("position", positions, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
       }
     }
 
-    void wire_box::draw (math::vector_4d const& color, float line_width) const
+    wire_box::wire_box()
+      : _program { {GL_VERTEX_SHADER, vertex_shader}
+                 , {GL_FRAGMENT_SHADER, fragment_shader}
+                 }
+    {
+      // unit cube, scaled to the requested extents on draw
+      std::vector<math::vector_3d> const positions
+        { {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}
+        , {0.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}
+        };
+
+      std::vector<unsigned char> const indices
+        {5, 7, 3, 2, 0, 1, 3, 1, 5, 4, 0, 4, 6, 2, 6, 7};
+
+      upload<GL_ARRAY_BUFFER> (_positions, positions);
+      upload<GL_ELEMENT_ARRAY_BUFFER> (_indices, indices);
+    }
+
+    void wire_box::draw ( math::vector_3d const& min_point
+                        , math::vector_3d const& max_point
+                        , math::vector_4d const& color
+                        , float line_width
+                        ) const
     {
       opengl::scoped::use_program wire_box_shader {_program};
 
@@ -86,14 +95,205 @@ void main()
       gl.hint (GL_LINE_SMOOTH_HINT, GL_NICEST);
       gl.lineWidth (line_width);
 
-      wire_box_shader.uniform ("model_view", opengl::matrix::model_view());
-      wire_box_shader.uniform ("projection", opengl::matrix::projection());
+      setup ( wire_box_shader
+            , _positions
+            , math::matrix_4x4 (math::matrix_4x4::translation, min_point)
+            * math::matrix_4x4 (math::matrix_4x4::scale, max_point - min_point)
+            , color
+            );
 
-      wire_box_shader.attrib ("position", _positions, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+      gl.drawElements (GL_LINE_STRIP, _indices, 16, GL_UNSIGNED_BYTE, 0);
+    }
 
-      wire_box_shader.uniform ("color", color);
+    sphere::sphere()
+      : _program { {GL_VERTEX_SHADER, vertex_shader}
+                 , {GL_FRAGMENT_SHADER, fragment_shader}
+                 }
+    {
+      math::radians const drho (math::constants::pi / sphere_segments);
+      math::radians const dtheta (2.0f * drho._);
 
-      gl.drawElements (GL_LINE_STRIP, _indices, 16, GL_UNSIGNED_BYTE, 0);
+      std::vector<math::vector_3d> positions;
+      for (std::size_t i (0); i <= sphere_segments; ++i)
+      {
+        for (std::size_t j (0); j < sphere_segments; ++j)
+        {
+          math::radians const rho (i * drho._);
+          math::radians const theta (j * dtheta._);
+          positions.emplace_back ( math::cos (theta) * math::sin (rho)
+                                 , math::sin (theta) * math::sin (rho)
+                                 , math::cos (rho)
+                                 );
+        }
+      }
+
+      auto const index
+        ( [] (std::size_t i, std::size_t j)
+          {
+            return static_cast<std::uint16_t> (i * sphere_segments + j % sphere_segments);
+          }
+        );
+
+      std::vector<std::uint16_t> indices;
+      // circles of latitude, without the degenerate ones at the poles
+      for (std::size_t i (1); i < sphere_segments; ++i)
+      {
+        for (std::size_t j (0); j < sphere_segments; ++j)
+        {
+          indices.emplace_back (index (i, j));
+          indices.emplace_back (index (i, j + 1));
+        }
+      }
+      // meridians from pole to pole
+      for (std::size_t j (0); j < sphere_segments; ++j)
+      {
+        for (std::size_t i (0); i < sphere_segments; ++i)
+        {
+          indices.emplace_back (index (i, j));
+          indices.emplace_back (index (i + 1, j));
+        }
+      }
+
+      _index_count = indices.size();
+
+      upload<GL_ARRAY_BUFFER> (_positions, positions);
+      upload<GL_ELEMENT_ARRAY_BUFFER> (_indices, indices);
+    }
+
+    void sphere::draw ( math::vector_3d const& position
+                      , float radius
+                      , math::vector_4d const& color
+                      ) const
+    {
+      opengl::scoped::use_program sphere_shader {_program};
+
+      setup ( sphere_shader
+            , _positions
+            , math::matrix_4x4 (math::matrix_4x4::translation, position)
+            * math::matrix_4x4 (math::matrix_4x4::scale, radius)
+            , color
+            );
+
+      gl.drawElements (GL_LINES, _indices, _index_count, GL_UNSIGNED_SHORT, 0);
+    }
+
+    disk::disk()
+      : _program { {GL_VERTEX_SHADER, vertex_shader}
+                 , {GL_FRAGMENT_SHADER, fragment_shader}
+                 }
+    {
+      std::vector<math::vector_3d> positions;
+      for (std::size_t i (0); i < disk_segments; ++i)
+      {
+        math::radians const arc (2.0f * math::constants::pi * i / disk_segments);
+        positions.emplace_back (math::sin (arc), math::cos (arc), 0.0f);
+      }
+
+      upload<GL_ARRAY_BUFFER> (_positions, positions);
+    }
+
+    void disk::draw ( math::vector_3d const& position
+                    , float radius
+                    , math::vector_4d const& color
+                    , math::radians const& angle
+                    , math::radians const& orientation
+                    ) const
+    {
+      opengl::scoped::use_program disk_shader {_program};
+
+      float const slope (math::tan (angle));
+
+      // the circle is built in the xy plane, z being the tilt towards orientation
+      math::matrix_4x4 const tilt
+        ( 1.0f, 0.0f, 0.0f, 0.0f
+        , 0.0f, 1.0f, 0.0f, 0.0f
+        , slope * math::sin (orientation), slope * math::cos (orientation), 1.0f, 0.0f
+        , 0.0f, 0.0f, 0.0f, 1.0f
+        );
+
+      setup ( disk_shader
+            , _positions
+            , math::matrix_4x4 (math::matrix_4x4::translation, position)
+            * math::matrix_4x4 ( math::matrix_4x4::rotation_xyz
+                               , { math::degrees (90.0f)
+                                 , math::degrees (0.0f)
+                                 , math::degrees (0.0f)
+                                 }
+                               )
+            * tilt
+            * math::matrix_4x4 (math::matrix_4x4::scale, radius)
+            , color
+            );
+
+      gl.drawArrays (GL_LINE_LOOP, 0, disk_segments);
+    }
+
+    square::square()
+      : _program { {GL_VERTEX_SHADER, vertex_shader}
+                 , {GL_FRAGMENT_SHADER, fragment_shader}
+                 }
+    {
+      std::vector<math::vector_3d> const positions
+        { {1.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, -1.0f}, {1.0f, 0.0f, -1.0f} };
+
+      upload<GL_ARRAY_BUFFER> (_positions, positions);
+    }
+
+    void square::draw ( math::vector_3d const& position
+                      , float size
+                      , math::radians const& orientation
+                      , math::vector_4d const& color
+                      ) const
+    {
+      opengl::scoped::use_program square_shader {_program};
+
+      float const c (math::cos (orientation));
+      float const s (math::sin (orientation));
+
+      setup ( square_shader
+            , _positions
+            , math::matrix_4x4 (math::matrix_4x4::translation, position)
+            * math::matrix_4x4 ( c, 0.0f, -s, 0.0f
+                               , 0.0f, 1.0f, 0.0f, 0.0f
+                               , s, 0.0f, c, 0.0f
+                               , 0.0f, 0.0f, 0.0f, 1.0f
+                               )
+            * math::matrix_4x4 (math::matrix_4x4::scale, size)
+            , color
+            );
+
+      gl.drawArrays (GL_TRIANGLE_FAN, 0, 4);
+    }
+
+    vertex_stream::vertex_stream()
+      : _program { {GL_VERTEX_SHADER, vertex_shader}
+                 , {GL_FRAGMENT_SHADER, fragment_shader}
+                 }
+    {}
+
+    void vertex_stream::draw ( GLenum mode
+                             , std::vector<math::vector_3d> const& positions
+                             , math::vector_4d const& color
+                             ) const
+    {
+      if (positions.empty())
+      {
+        return;
+      }
+
+      // respecifying the whole store lets the driver hand out fresh
+      // memory instead of waiting for last frame's draw
+      gl.bufferData<GL_ARRAY_BUFFER> ( _positions
+                                     , positions.size() * sizeof (math::vector_3d)
+                                     , positions.data()
+                                     , GL_STREAM_DRAW
+                                     );
+
+      opengl::scoped::use_program stream_shader {_program};
+
+      setup (stream_shader, _positions, math::matrix_4x4::unit, color);
+
+      gl.drawArrays (mode, 0, positions.size());
     }
   }
 }
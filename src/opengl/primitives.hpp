@@ -2,9 +2,12 @@
 
 #pragma once
 
+#include <math/trig.hpp>
 #include <opengl/scoped.hpp>
 #include <opengl/shader.hpp>
 
+#include <vector>
+
 namespace math
 {
   struct vector_3d;
@@ -15,19 +18,100 @@ namespace opengl
 {
   namespace primitives
   {
+    //! The helpers below upload their unit geometry once and are scaled
+    //! into place through the model view matrix, so they are meant to be
+    //! created once per context and drawn as often as needed.
+
     class wire_box
     {
     public:
-      wire_box ( math::vector_3d const& min_point
-               , math::vector_3d const& max_point
-               );
+      wire_box();
+
+      void draw ( math::vector_3d const& min_point
+                , math::vector_3d const& max_point
+                , math::vector_4d const& color
+                , float line_width
+                ) const;
+
+    private:
+      scoped::buffers<2> _buffers;
+      GLuint const& _positions = _buffers[0];
+      GLuint const& _indices = _buffers[1];
+      opengl::program _program;
+    };
+
+    //! latitude and longitude lines of a sphere around the z axis
+    class sphere
+    {
+    public:
+      sphere();
 
-      void draw (math::vector_4d const& color, float line_width) const;
+      void draw ( math::vector_3d const& position
+                , float radius
+                , math::vector_4d const& color
+                ) const;
 
     private:
       scoped::buffers<2> _buffers;
       GLuint const& _positions = _buffers[0];
       GLuint const& _indices = _buffers[1];
+      GLsizei _index_count;
+      opengl::program _program;
+    };
+
+    //! circle in the xz plane, optionally tilted by \a angle towards
+    //! \a orientation like the angled terrain brushes
+    class disk
+    {
+    public:
+      disk();
+
+      void draw ( math::vector_3d const& position
+                , float radius
+                , math::vector_4d const& color
+                , math::radians const& angle = math::radians (0.0f)
+                , math::radians const& orientation = math::radians (0.0f)
+                ) const;
+
+    private:
+      scoped::buffers<1> _buffers;
+      GLuint const& _positions = _buffers[0];
+      opengl::program _program;
+    };
+
+    //! filled square in the xz plane, \a size being half its side
+    class square
+    {
+    public:
+      square();
+
+      void draw ( math::vector_3d const& position
+                , float size
+                , math::radians const& orientation
+                , math::vector_4d const& color
+                ) const;
+
+    private:
+      scoped::buffers<1> _buffers;
+      GLuint const& _positions = _buffers[0];
+      opengl::program _program;
+    };
+
+    //! geometry changing every frame, like brush lines or the selected
+    //! vertices. Reuses one stream buffer instead of immediate mode.
+    class vertex_stream
+    {
+    public:
+      vertex_stream();
+
+      void draw ( GLenum mode
+                , std::vector<math::vector_3d> const& positions
+                , math::vector_4d const& color
+                ) const;
+
+    private:
+      scoped::buffers<1> _buffers;
+      GLuint const& _positions = _buffers[0];
       opengl::program _program;
     };
   }
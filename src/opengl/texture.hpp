@@ -10,14 +10,14 @@ namespace opengl
   {
   public:
     texture();
-    ~texture();
+    virtual ~texture();
 
     texture (texture const&) = delete;
     texture (texture&&);
     texture& operator= (texture const&) = delete;
     texture& operator= (texture&&);
 
-    void bind() const;
+    virtual void bind() const;
 
     static void enable_texture();
     static void enable_texture (size_t num);
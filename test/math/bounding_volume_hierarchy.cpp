@@ -0,0 +1,87 @@
+#include <boost/test/included/unit_test.hpp>
+
+#include <math/bounding_volume_hierarchy.hpp>
+
+#include <random>
+
+namespace math
+{
+  namespace
+  {
+    boost::optional<float> brute_force_nearest
+      (std::vector<vector_3d> const& triangles, ray const& r)
+    {
+      boost::optional<float> nearest;
+      for (std::size_t i (0); i < triangles.size(); i += 3)
+      {
+        if (auto distance = r.intersect_triangle (triangles[i], triangles[i + 1], triangles[i + 2]))
+        {
+          if (!nearest || *distance < *nearest)
+          {
+            nearest = distance;
+          }
+        }
+      }
+      return nearest;
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (empty_hierarchy_never_hits)
+  {
+    bounding_volume_hierarchy const bvh;
+    BOOST_CHECK (!bvh.intersect_nearest ({{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}));
+  }
+
+  BOOST_AUTO_TEST_CASE (single_triangle)
+  {
+    bounding_volume_hierarchy const bvh
+      ({{-1.0f, -1.0f, 5.0f}, {1.0f, -1.0f, 5.0f}, {0.0f, 1.0f, 5.0f}});
+
+    auto const hit (bvh.intersect_nearest ({{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}));
+    BOOST_REQUIRE (hit);
+    BOOST_CHECK_CLOSE (*hit, 5.0f, 0.0001f);
+
+    BOOST_CHECK (!bvh.intersect_nearest ({{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}}));
+    BOOST_CHECK (!bvh.intersect_nearest ({{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}, 4.0f));
+  }
+
+  BOOST_AUTO_TEST_CASE (matches_brute_force)
+  {
+    std::mt19937 engine (1337);
+    std::uniform_real_distribution<float> position (-100.0f, 100.0f);
+    std::uniform_real_distribution<float> offset (-5.0f, 5.0f);
+
+    std::vector<vector_3d> triangles;
+    for (int i (0); i < 2000; ++i)
+    {
+      vector_3d const center (position (engine), position (engine), position (engine));
+      for (int v (0); v < 3; ++v)
+      {
+        triangles.emplace_back
+          (center + vector_3d (offset (engine), offset (engine), offset (engine)));
+      }
+    }
+
+    bounding_volume_hierarchy const bvh (triangles);
+
+    int hits (0);
+    for (int i (0); i < 500; ++i)
+    {
+      ray const r ( {position (engine), position (engine), position (engine)}
+                  , {position (engine), position (engine), position (engine)}
+                  );
+
+      auto const expected (brute_force_nearest (triangles, r));
+      auto const actual (bvh.intersect_nearest (r));
+
+      BOOST_REQUIRE_EQUAL (!!expected, !!actual);
+      if (expected)
+      {
+        ++hits;
+        BOOST_CHECK_CLOSE (*expected, *actual, 0.0001f);
+      }
+    }
+
+    BOOST_CHECK (hits > 0);
+  }
+}
@@ -0,0 +1,90 @@
+#include <boost/test/included/unit_test.hpp>
+
+#include <math/quantized_set.hpp>
+
+#include <chrono>
+#include <random>
+#include <string>
+
+namespace math
+{
+  BOOST_AUTO_TEST_CASE (values_within_epsilon_are_equal)
+  {
+    quantized_set<3, int> set (0.0001f, 1.0f);
+
+    BOOST_CHECK (set.insert (0, {{10.5f, 20.5f, 30.5f}}));
+    BOOST_CHECK (!set.insert (0, {{10.50005f, 20.49995f, 30.5f}}));
+    BOOST_CHECK (set.insert (0, {{10.5002f, 20.5f, 30.5f}}));
+    BOOST_CHECK_EQUAL (set.size(), 2);
+  }
+
+  BOOST_AUTO_TEST_CASE (tags_have_to_match_exactly)
+  {
+    quantized_set<3, std::string> set (0.0001f, 1.0f);
+
+    BOOST_CHECK (set.insert ("a.m2", {{1.5f, 2.5f, 3.5f}}));
+    BOOST_CHECK (set.insert ("b.m2", {{1.5f, 2.5f, 3.5f}}));
+    BOOST_CHECK (!set.insert ("a.m2", {{1.5f, 2.5f, 3.5f}}));
+  }
+
+  BOOST_AUTO_TEST_CASE (neighbouring_cells_are_probed_at_the_borders)
+  {
+    quantized_set<3, int> set (0.0001f, 1.0f);
+
+    BOOST_CHECK (set.insert (0, {{1.99997f, -0.00003f, 5.0f}}));
+    BOOST_CHECK (set.contains (0, {{2.00003f, 0.00003f, 4.99997f}}));
+    BOOST_CHECK (!set.contains (0, {{2.0002f, 0.00003f, 4.99997f}}));
+  }
+
+  BOOST_AUTO_TEST_CASE (deduplicate_generated_instances)
+  {
+    std::size_t const unique_count (200000);
+    std::size_t const duplicate_count (20000);
+
+    std::mt19937 engine (42);
+    std::uniform_int_distribution<int> grid (0, 170000);
+    std::uniform_real_distribution<float> jitter (-0.00002f, 0.00002f);
+    std::uniform_int_distribution<int> pick (0, unique_count - 1);
+
+    // unique placements on a 0.2 unit grid, far apart compared to epsilon,
+    // a tenth of them lying right on a cell border. the jitter is small
+    // enough for two copies of the same placement to still be equal.
+    std::vector<std::array<float, 6>> placements;
+    placements.reserve (unique_count + duplicate_count);
+    for (std::size_t i (0); i < unique_count; ++i)
+    {
+      float const x (i % 10 ? 0.2f * grid (engine) : float (grid (engine) / 5));
+      placements.push_back
+        ({{x, 0.2f * (i % 500), 0.2f * (i / 500), 0.0f, 0.2f * (i % 1800), 0.0f}});
+    }
+    for (std::size_t i (0); i < duplicate_count; ++i)
+    {
+      auto duplicate (placements[pick (engine)]);
+      for (float& value : duplicate)
+      {
+        value += jitter (engine);
+      }
+      placements.push_back (duplicate);
+    }
+    std::shuffle (placements.begin(), placements.end(), engine);
+
+    auto const start (std::chrono::steady_clock::now());
+
+    quantized_set<6, int> set (0.0001f, 1.0f);
+    set.reserve (placements.size());
+    std::size_t duplicates (0);
+    for (auto const& placement : placements)
+    {
+      duplicates += !set.insert (0, placement);
+    }
+
+    auto const elapsed (std::chrono::steady_clock::now() - start);
+
+    BOOST_CHECK_EQUAL (duplicates, duplicate_count);
+    BOOST_CHECK_EQUAL (set.size(), unique_count);
+    BOOST_TEST_MESSAGE ( "deduplicated " << placements.size() << " instances in "
+                       << std::chrono::duration_cast<std::chrono::milliseconds> (elapsed).count()
+                       << " ms"
+                       );
+  }
+}
@@ -0,0 +1,149 @@
+#include <boost/test/included/unit_test.hpp>
+
+#include <noggit/byte_delta.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace noggit
+{
+  namespace
+  {
+    using state = std::vector<std::uint8_t>;
+
+    // sizes, hashes and the length of the runs, see byte_delta::write
+    std::size_t const serialized_header (5 * sizeof (std::uint64_t));
+
+    std::size_t serialized_size (byte_delta const& delta)
+    {
+      state data;
+      delta.write (data);
+      return data.size();
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (round_trip_before_after_before)
+  {
+    state const before {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    state const after {1, 2, 30, 4, 5, 6, 7, 8, 9, 10, 110, 12};
+    byte_delta const delta (before, after);
+
+    BOOST_CHECK (!delta.empty());
+
+    state current (before);
+    BOOST_CHECK (delta.apply_from (byte_delta::side::before, current));
+    BOOST_CHECK (current == after);
+    BOOST_CHECK (delta.apply_from (byte_delta::side::after, current));
+    BOOST_CHECK (current == before);
+  }
+
+  BOOST_AUTO_TEST_CASE (equal_states_give_an_empty_delta)
+  {
+    state const same {1, 2, 3};
+    BOOST_CHECK (byte_delta (same, same).empty());
+    BOOST_CHECK (!byte_delta (same, {1, 2, 3, 0}).empty());
+  }
+
+  BOOST_AUTO_TEST_CASE (size_changes)
+  {
+    state const shorter {1, 2, 3};
+    state const longer {1, 2, 3, 4, 5, 0, 7};
+
+    for (auto const& sides : {std::make_pair (shorter, longer), std::make_pair (longer, shorter)})
+    {
+      byte_delta const delta (sides.first, sides.second);
+
+      state current (sides.first);
+      BOOST_CHECK (delta.apply_from (byte_delta::side::before, current));
+      BOOST_CHECK (current == sides.second);
+      BOOST_CHECK (delta.apply_from (byte_delta::side::after, current));
+      BOOST_CHECK (current == sides.first);
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (gaps_shorter_than_minimum_gap_are_merged)
+  {
+    // three unchanged bytes in between: one run of five changed bytes
+    state const before (8, 0);
+    state merged (before);
+    merged[0] = merged[4] = 1;
+
+    byte_delta const merged_delta (before, merged);
+    BOOST_CHECK_EQUAL (serialized_size (merged_delta), serialized_header + 2 + 5);
+
+    // four unchanged bytes in between: two runs of one changed byte each
+    state const longer_before (10, 0);
+    state split (longer_before);
+    split[0] = split[5] = 1;
+
+    byte_delta const split_delta (longer_before, split);
+    BOOST_CHECK_EQUAL (serialized_size (split_delta), serialized_header + 2 * (2 + 1));
+
+    state current (before);
+    BOOST_CHECK (merged_delta.apply_from (byte_delta::side::before, current));
+    BOOST_CHECK (current == merged);
+
+    current = longer_before;
+    BOOST_CHECK (split_delta.apply_from (byte_delta::side::before, current));
+    BOOST_CHECK (current == split);
+  }
+
+  BOOST_AUTO_TEST_CASE (hash_mismatch_is_rejected)
+  {
+    state const before {1, 2, 3, 4};
+    state const after {1, 2, 5, 4};
+    byte_delta const delta (before, after);
+
+    // same size as both sides, but neither of them
+    state other {9, 2, 3, 4};
+    BOOST_CHECK (!delta.apply_from (byte_delta::side::before, other));
+    BOOST_CHECK (!delta.apply_from (byte_delta::side::after, other));
+    BOOST_CHECK (other == state ({9, 2, 3, 4}));
+
+    // the right state for the other side only
+    state current (before);
+    BOOST_CHECK (!delta.apply_from (byte_delta::side::after, current));
+    BOOST_CHECK (current == before);
+  }
+
+  BOOST_AUTO_TEST_CASE (serialize_and_deserialize)
+  {
+    state before (300, 7);
+    state after (before);
+    after[1] = 8;
+    after[200] = 9;
+    after.resize (310, 1);
+
+    byte_delta const delta (before, after);
+
+    state data;
+    delta.write (data);
+
+    undo::reader reader (data);
+    byte_delta const read (byte_delta::read (reader));
+    BOOST_CHECK_EQUAL (reader.remaining(), 0);
+
+    state current (before);
+    BOOST_CHECK (read.apply_from (byte_delta::side::before, current));
+    BOOST_CHECK (current == after);
+    BOOST_CHECK (read.apply_from (byte_delta::side::after, current));
+    BOOST_CHECK (current == before);
+  }
+
+  BOOST_AUTO_TEST_CASE (truncated_buffer_is_rejected)
+  {
+    state const before {1, 2, 3, 4};
+    state const after {5, 2, 3, 4, 6};
+
+    state data;
+    byte_delta (before, after).write (data);
+
+    for (std::size_t size : {std::size_t (0), serialized_header - 1, data.size() - 1})
+    {
+      state const truncated (data.begin(), data.begin() + size);
+      undo::reader reader (truncated);
+      BOOST_CHECK_THROW (byte_delta::read (reader), std::logic_error);
+    }
+  }
+}
@@ -0,0 +1,184 @@
+#include <boost/test/included/unit_test.hpp>
+
+#include <noggit/path_index.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace noggit
+{
+  namespace
+  {
+    std::vector<std::string> const paths
+      { "world/maps/azeroth/azeroth_32_48.adt"
+      , "world/maps/azeroth/azeroth_32_49.adt"
+      , "world/maps/kalimdor/kalimdor_30_30.adt"
+      , "world/wmo/azeroth/buildings/townhall.wmo"
+      , "world/azeroth/elwynn/passivedoodads/trees/elwynntree01.m2"
+      , "tileset/generic/grass01.blp"
+      , "tileset/elwynn/elwynngrass02.blp"
+      , "tileset/elwynn/elwynndirt.blp"
+      , "creature/wolf/wolf.m2"
+      , "xyz"
+      , "qq"
+      };
+
+    std::vector<path_index::id_type> brute_force_prefix
+      (path_index const& index, std::string const& prefix)
+    {
+      std::vector<path_index::id_type> ids (index.size());
+      std::iota (ids.begin(), ids.end(), path_index::id_type (0));
+      ids.erase ( std::remove_if ( ids.begin(), ids.end()
+                                 , [&] (path_index::id_type id)
+                                   {
+                                     return index.path (id).compare (0, prefix.size(), prefix) != 0;
+                                   }
+                                 )
+                , ids.end()
+                );
+      std::sort ( ids.begin(), ids.end()
+                , [&] (path_index::id_type lhs, path_index::id_type rhs)
+                  {
+                    return index.path (lhs) < index.path (rhs);
+                  }
+                );
+      return ids;
+    }
+
+    std::vector<path_index::id_type> brute_force_find
+      ( path_index const& index
+      , std::vector<path_index::id_type> const& candidates
+      , std::string const& query
+      )
+    {
+      std::vector<path_index::id_type> ids;
+      std::copy_if ( candidates.begin(), candidates.end(), std::back_inserter (ids)
+                   , [&] (path_index::id_type id)
+                     {
+                       return index.path (id).find (query) != std::string::npos;
+                     }
+                   );
+      return ids;
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (insert_keeps_ids_and_rejects_duplicates)
+  {
+    path_index index ({paths[2], paths[0], paths[2]});
+    BOOST_CHECK_EQUAL (index.size(), 2);
+
+    std::size_t const first_new (index.size());
+    for (std::size_t i (1); i < paths.size(); ++i)
+    {
+      index.insert (paths[i]);
+    }
+    BOOST_CHECK_EQUAL (index.size(), paths.size());
+
+    BOOST_CHECK (!index.insert (paths[0]));
+    BOOST_CHECK (!index.insert (paths[5]));
+    BOOST_CHECK_EQUAL (index.size(), paths.size());
+
+    // inserted ids follow the insertion order
+    BOOST_CHECK_EQUAL (index.path (first_new), paths[1]);
+    BOOST_CHECK_EQUAL (index.path (index.size() - 1), paths.back());
+  }
+
+  BOOST_AUTO_TEST_CASE (with_prefix_matches_brute_force)
+  {
+    path_index index ({paths.begin(), paths.begin() + 4});
+    for (std::size_t i (4); i < paths.size(); ++i)
+    {
+      index.insert (paths[i]);
+    }
+
+    std::vector<std::string> const prefixes
+      { "", "w", "world/", "world/maps/", "world/maps/azeroth/azeroth_32_4"
+      , "tileset/elwynn", "tileset/elwynn/elwynndirt.blp", "tileset/elwynn/elwynndirt.blpx"
+      , "x", "xyz", "zzz", "a"
+      };
+
+    for (std::string const& prefix : prefixes)
+    {
+      BOOST_TEST_CONTEXT ("prefix \"" << prefix << "\"")
+      {
+        std::vector<path_index::id_type> const expected (brute_force_prefix (index, prefix));
+        std::vector<path_index::id_type> const found (index.with_prefix (prefix));
+        BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), expected.begin(), expected.end());
+      }
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (with_extension_buckets)
+  {
+    path_index index (paths);
+
+    for (std::string const extension : {".blp", ".adt", ".m2", ".wmo", ".mdx", ""})
+    {
+      BOOST_TEST_CONTEXT ("extension \"" << extension << "\"")
+      {
+        for (path_index::id_type id : index.with_extension (extension))
+        {
+          std::string const& path (index.path (id));
+          BOOST_CHECK (path.size() >= extension.size());
+          BOOST_CHECK_EQUAL (path.compare (path.size() - extension.size(), extension.size(), extension), 0);
+        }
+      }
+    }
+
+    BOOST_CHECK_EQUAL (index.with_extension (".blp").size(), 3);
+    BOOST_CHECK_EQUAL (index.with_extension (".mdx").size(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE (find_matches_brute_force)
+  {
+    path_index const index (paths);
+
+    // every path but one, not in id order
+    std::vector<path_index::id_type> candidates;
+    for (path_index::id_type id (index.size()); id-- > 1;)
+    {
+      candidates.emplace_back (id);
+    }
+
+    substring_search search (index, candidates);
+
+    // queries extending and shortening the previous one, shorter than a
+    // trigram, with a rare trigram among common ones and without matches
+    std::vector<std::string> const queries
+      { "", "e", "el", "elw", "elwy", "elwynn", "elwynng", "elwynn", "elw", "el"
+      , "world", "world/maps/", "world/maps/azeroth", "world/maps/kal", "world/"
+      , "01", "01.", "01.m2", "tree01", ".blp", "wmo/azeroth"
+      , "xyz", "xy", "qq", "q", "qqq", "nothing", "zz"
+      };
+
+    for (std::string const& query : queries)
+    {
+      BOOST_TEST_CONTEXT ("query \"" << query << "\"")
+      {
+        std::vector<path_index::id_type> const expected (brute_force_find (index, candidates, query));
+        std::vector<path_index::id_type> const found (search.find (query));
+        BOOST_CHECK_EQUAL_COLLECTIONS (found.begin(), found.end(), expected.begin(), expected.end());
+      }
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE (find_sees_added_candidates)
+  {
+    path_index index (paths);
+    std::vector<path_index::id_type> const maps (index.with_prefix ("world/maps/azeroth/"));
+    std::vector<path_index::id_type> const wmos (index.with_prefix ("world/wmo/azeroth/"));
+    BOOST_REQUIRE_EQUAL (maps.size(), 2);
+    BOOST_REQUIRE_EQUAL (wmos.size(), 1);
+
+    substring_search search (index, maps);
+    BOOST_CHECK_EQUAL (search.find ("azeroth").size(), 2);
+
+    // extending the last query must not keep using the stale result
+    search.add (wmos[0]);
+    std::vector<path_index::id_type> const found (search.find ("azeroth/"));
+    BOOST_CHECK_EQUAL (found.size(), 3);
+    BOOST_CHECK_EQUAL (found.back(), wmos[0]);
+  }
+}